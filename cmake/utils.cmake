@@ -144,7 +144,7 @@ if(COMMAND cmake_policy)
     cmake_policy(SET CMP0003 NEW)
 endif(COMMAND cmake_policy)
 ADD_EXECUTABLE(${_name} ${PROJECT_BINARY_DIR}/${_name}.cpp ${ARGN})
-  TARGET_LINK_LIBRARIES( ${_name} ${global_link_libs} entities common )
+  TARGET_LINK_LIBRARIES( ${_name} ${global_link_libs} entities common rt pthread )
 
   ADD_TEST(${_name} ${_name})
 ENDMACRO ( ADD_CXXTEST )
@@ -0,0 +1,44 @@
+//------------------------------------------------------------------------------
+// File: EntityPoseList.h
+// Desc: The layout of the packed list of entity poses that the simulation
+//       interface sends back for the "poses" property. The list is a header
+//       followed by mNumEntities records, all taken from the same simulation
+//       frame. Clients can include this file to unpack the reply.
+//
+//       Positions are in metres and rotations are in radians, with
+//       mRotation[ 0 ] the pitch, mRotation[ 1 ] the roll and
+//       mRotation[ 2 ] the yaw, as for the GET_POSE3D request.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef ENTITY_POSE_LIST_H
+#define ENTITY_POSE_LIST_H
+
+//------------------------------------------------------------------------------
+#include "Common.h"
+
+//------------------------------------------------------------------------------
+// Changes whenever the layout below changes
+const U32 ENTITY_POSE_LIST_VERSION = 1;
+const U32 ENTITY_POSE_LIST_NAME_LENGTH = 32;    // Including the terminator
+
+//------------------------------------------------------------------------------
+struct EntityPoseListHeader
+{
+    U32 mVersion;
+    U32 mNumEntities;
+    U32 mFrameIdx;      // The simulation frame that the poses come from
+    U32 mPadding;
+    double mSimTime;    // The sim time of that frame in seconds
+};
+
+//------------------------------------------------------------------------------
+struct EntityPoseRecord
+{
+    char mName[ ENTITY_POSE_LIST_NAME_LENGTH ];
+    char mTypeName[ ENTITY_POSE_LIST_NAME_LENGTH ];
+    F32 mPosition[ 3 ];
+    F32 mRotation[ 3 ];
+};
+
+#endif // ENTITY_POSE_LIST_H
@@ -8,12 +8,30 @@
 #define SIMULATOR_H
 
 //------------------------------------------------------------------------------
+#include <vector>
 #include "Common.h"
 #include "Vector.h"
+#include "Simulator/EntityPoseList.h"
 
 //------------------------------------------------------------------------------
 struct SimulatorImpl;
 
+//------------------------------------------------------------------------------
+// Identifies an entity in the world that has been loaded by the simulator
+typedef S32 EntityHandle;
+const EntityHandle INVALID_ENTITY_HANDLE = -1;
+
+//------------------------------------------------------------------------------
+// A complete set of setpoints for the submarine. Speeds are in metres per 
+// second and angular speeds are in radians per second
+struct SubVelocityCommand
+{
+    F32 mForwardSpeed;
+    F32 mDepthSpeed;
+    F32 mYawSpeed;
+    F32 mPitchSpeed;
+};
+
 //------------------------------------------------------------------------------
 class Simulator
 {
@@ -22,26 +40,124 @@ class Simulator
     public: ~Simulator();
 
     //--------------------------------------------------------------------------
-    public: bool Init( const char* worldFilename = NULL );
+    // If bHeadless is true then no window is opened and the main view is
+    // never drawn. The sub camera is rendered with the software rasteriser
+    // only whilst it has been made active with SetSubCameraActive.
+    //
+    // If bThreaded is true then rendering and the simulation tick each run on
+    // their own thread and Update does nothing. The other routines can then 
+    // be called from the owning thread without waiting for a frame to render
+    public: bool Init( const char* worldFilename = NULL, bool bHeadless = false,
+                       bool bThreaded = false );
     public: void DeInit();
 
     //--------------------------------------------------------------------------
     public: void Update();
     
+    //--------------------------------------------------------------------------
+    // Lockstep mode. Whilst lockstep is enabled Update no longer advances the
+    // simulation with the wall clock and the simulation only moves forward
+    // when Step or RunFor is called. Step and RunFor don't render anything
+    // so they can run much faster than real time
+    public: void SetLockstepEnabled( bool bEnabled );
+    public: bool IsLockstepEnabled() const;
+    
+    //--------------------------------------------------------------------------
+    //! Whilst paused the simulation only moves forward when Step or RunFor
+    //! is called, whether or not lockstep is enabled
+    public: void SetPaused( bool bPaused );
+    public: bool IsPaused() const;
+    
+    //--------------------------------------------------------------------------
+    //! Puts every entity back to the pose it had when the world was loaded
+    //! and brings everything to a stop, without reloading the world. Sub
+    //! commands that haven't been applied yet are dropped. Sim time is not
+    //! reset so that timestamps keep going forwards. Must be called from the
+    //! thread that controls the submarine
+    public: void ResetWorld();
+    
+    //--------------------------------------------------------------------------
+    //! Saves the state of the world, i.e. the pose of every entity, the
+    //! state of every rigid body, the setpoints and velocities of the 
+    //! submarine and the sim time, into a compact binary blob. The blob can
+    //! only be restored into the world it was saved from
+    public: void SaveState( std::vector<U8>* pStateOut ) const;
+    
+    //--------------------------------------------------------------------------
+    //! Puts the world back into a state saved by SaveState, including the
+    //! sim time, so sim time goes backwards if the state is older. As with 
+    //! ResetWorld, unapplied sub commands are dropped and this must be called
+    //! from the thread that controls the submarine. Returns false if the 
+    //! state doesn't match the world
+    public: bool RestoreState( const U8* pState, U32 stateSize );
+    
+    //--------------------------------------------------------------------------
+    //! Gets the wall clock time in seconds since the world was loaded, and
+    //! how much of that time the simulation has spent paused
+    public: double GetRealTime() const;
+    public: double GetPauseTime() const;
+    
+    //--------------------------------------------------------------------------
+    //! Advances the simulation by a number of fixed length frames
+    public: void Step( U32 numFrames = 1 );
+    
+    //--------------------------------------------------------------------------
+    //! Advances the simulation by at least the given number of seconds of
+    //! simulation time. Returns the number of frames that were simulated
+    public: U32 RunFor( double simSeconds );
+    
+    //--------------------------------------------------------------------------
+    //! Sets the maximum number of fixed length physics sub steps that can be 
+    //! taken by one call to UpdateSimulator whilst it catches up with the 
+    //! wall clock. Each frame takes two sub steps, and frames beyond the 
+    //! budget are put off until the next update. Doesn't limit Step
+    public: void SetMaxPhysicsSubSteps( S32 maxSubSteps );
+    
     //--------------------------------------------------------------------------
     // Helper routines
+    private: bool InitWorld( const char* worldFilename );
+    private: void DeInitWorld();
+    private: void SimulateFrame();
+    private: void SyncEntitiesWithPhysics();
+    private: void BuildEntityTables();
+    private: void PublishEntityStates();
+    private: void ApplySubCommand();
+    private: void WriteState( std::vector<U8>* pStateOut ) const;
+    private: bool ApplyState( const U8* pState, U32 stateSize, bool bRestoreSimTime );
     private: S32 UpdateSimulator();
     private: void UpdateFrameRender();
+    private: void ApplyRenderTransforms();
+    private: void ReadBackSubCameraImage();
     private: void UpdateFPSCounter( S32 numUpdates );
     
+    //--------------------------------------------------------------------------
+    // Thread routines used in threaded mode
+    private: static void* RenderThreadEntry( void* pSimulator );
+    private: static void* SimThreadEntry( void* pSimulator );
+    private: void RenderThreadMain();
+    private: void SimThreadMain();
+    
     //--------------------------------------------------------------------------
     // Returns true whilst the simulation is up and running
     public: bool IsRunning() const;
     
     //--------------------------------------------------------------------------
-    // Interface for controlling the submarine
+    // Returns true if the simulator was initialised without a window
+    public: bool IsHeadless() const;
+    
+    //--------------------------------------------------------------------------
+    // Interface for controlling the submarine. Commands are posted to a lock
+    // free mailbox and the latest one is applied at the start of the next
+    // simulation frame, so these never wait for the simulation. They must 
+    // all be called from the same thread
     //--------------------------------------------------------------------------
     
+    //--------------------------------------------------------------------------
+    //! Sets all of the setpoints of the submarine at once so that they are
+    //! applied in the same frame. Returns the index of the command, which
+    //! goes up by 1 with every command
+    public: U32 SetSubVelocities( const SubVelocityCommand& command );
+    
     //--------------------------------------------------------------------------
     //! Sets the desired forward speed of the submarine in metres per second
     public: void SetSubForwardSpeed( F32 forwardSpeed );
@@ -57,21 +173,81 @@ class Simulator
     //--------------------------------------------------------------------------
     //! Sets the desired pitch speed of the submarine in radians per second
     public: void SetSubPitchSpeed( F32 pitchSpeed );
+    
+    //--------------------------------------------------------------------------
+    //! Returns the index of the last command that has been applied to the
+    //! submarine, or 0 if none has been applied yet. Commands that are 
+    //! replaced before a frame is simulated are never applied
+    public: U32 GetAppliedSubCommandIdx() const;
         
+    //--------------------------------------------------------------------------
+    //! Returns a handle that can be used to query an entity without looking
+    //! up its name each time, or INVALID_ENTITY_HANDLE if there's no entity
+    //! with that name. Names are not case sensitive. Handles stay valid for
+    //! as long as the world is loaded
+    public: EntityHandle GetEntityHandle( const char* entityName ) const;
+    
     //--------------------------------------------------------------------------
     //! Routines to get information about an entity. Returns false if the
     //! entity can't be found and true otherwise
+    public: bool GetEntityPose( EntityHandle entityHandle, Vector* pPosOut, Vector* pRotationOut ) const;
     public: bool GetEntityPose( const char* entityName, Vector* pPosOut, Vector* pRotationOut ) const;
     
+    //--------------------------------------------------------------------------
+    //! Gets the pose and velocities of an entity from a single simulation
+    //! frame, along with the sim time of that frame. Velocities are in the
+    //! body frame of the entity, with y forwards, x to the right and z up
+    public: bool GetEntityMotion( EntityHandle entityHandle, Vector* pPosOut, Vector* pRotationOut,
+                                  Vector* pLinearVelocityOut, Vector* pAngularVelocityOut,
+                                  double* pTimestampOut ) const;
+    
+    //--------------------------------------------------------------------------
+    //! Gets the poses of every entity whose type is called typeName, or of
+    //! every entity if typeName is NULL, all from the same simulation frame.
+    //! Type names are not case sensitive. Returns false if typeName isn't
+    //! the name of an entity type
+    public: bool GetEntityPoseList( const char* typeName, EntityPoseListHeader* pHeaderOut,
+                                    std::vector<EntityPoseRecord>* pRecordsOut ) const;
+    
     //--------------------------------------------------------------------------
     //! Gets the time in seconds that the simulator has been running for.
-    //! Can be used to timestamp data from interfaces
+    //! This is simulation time, i.e. the number of frames that have been
+    //! simulated multiplied by the frame length, and so may run faster or
+    //! slower than the wall clock. Can be used to timestamp data from 
+    //! interfaces
     public: double GetSimTime() const;
     
+    //--------------------------------------------------------------------------
+    //! Gets the number of frames that have been simulated, as of the latest
+    //! entity state snapshot
+    public: U32 GetSimFrameIdx() const;
+    
+    //--------------------------------------------------------------------------
+    //! Simulates the sonar on the sub by casting a beam out at each of the
+    //! given angles, which are in radians anticlockwise from the heading of
+    //! the sub. The returns of each beam are binned into numBins bins that 
+    //! cover range metres, scaled by gain, and written to pBinsOut which must
+    //! hold numBeams*numBins bytes. Returns the sim time of the cast
+    public: double CastSubSonarBeams( const F32* pBeamAngles, U32 numBeams,
+                                      F32 range, U32 numBins, F32 gain, U8* pBinsOut );
+    
     // Returns (0,0) if no image is available
     public: void GetSubCameraImageDimensions( U32* pWidthOut, U32* pHeightOut ) const;
     
-    public: void GetSubCameraImage( U8* pBufferInOut, U32 bufferSize ) const;
+    //--------------------------------------------------------------------------
+    //! Copies the most recent image from the sub camera into the supplied
+    //! buffer as RGB888. With the OpenGL driver the image is read back 
+    //! asynchronously and so lags one rendered frame behind. If 
+    //! pTimestampOut is not NULL it receives the sim time of the frame
+    //! the image shows
+    public: void GetSubCameraImage( U8* pBufferInOut, U32 bufferSize, 
+                                    double* pTimestampOut = NULL ) const;
+    
+    //--------------------------------------------------------------------------
+    //! Turns rendering of the sub camera on or off. In headless mode the sub
+    //! camera is only rendered whilst it is active, otherwise it is always
+    //! rendered
+    public: void SetSubCameraActive( bool bActive );
 
     //--------------------------------------------------------------------------
     // Members
@@ -13,9 +13,10 @@
 #include "Utils.h"
 
 //------------------------------------------------------------------------------
-char CommandLineParser::mArgNames[ MAX_NUM_ARGS ][ MAX_ARG_LENGTH + 1 ];
-char CommandLineParser::mArgValues[ MAX_NUM_ARGS ][ MAX_ARG_VALUE_LENGTH + 1 ];
-int CommandLineParser::mNumArgs = 0;
+CommandLineParser::CommandLineParser()
+    : mNumArgs( 0 )
+{
+}
 
 //------------------------------------------------------------------------------
 void CommandLineParser::ParseCommandLine( int argc, const char** argv )
@@ -97,7 +98,7 @@ void CommandLineParser::ParseCommandLine( int argc, const char** argv )
 }
     
 //------------------------------------------------------------------------------
-bool CommandLineParser::IsArgSet( const char* argName )
+bool CommandLineParser::IsArgSet( const char* argName ) const
 {
     bool bResult = false;
     
@@ -114,7 +115,7 @@ bool CommandLineParser::IsArgSet( const char* argName )
 }
 
 //------------------------------------------------------------------------------
-const char* CommandLineParser::GetArgValue( const char* argName )
+const char* CommandLineParser::GetArgValue( const char* argName ) const
 {
     const char* pResult = NULL;
     
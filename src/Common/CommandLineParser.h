@@ -14,21 +14,24 @@
 #include "Common.h"
 
 //------------------------------------------------------------------------------
+// Each parser holds its own arguments so that several can be used at once
 class CommandLineParser
 {
-    public: static void ParseCommandLine( S32 argc, const char** argv );
+    public: CommandLineParser();
     
-    public: static bool IsArgSet( const char* argName );
-    public: static const char* GetArgValue( const char* argName );
-    public: static S32 GetNumArgs() { return mNumArgs; }
+    public: void ParseCommandLine( S32 argc, const char** argv );
+    
+    public: bool IsArgSet( const char* argName ) const;
+    public: const char* GetArgValue( const char* argName ) const;
+    public: S32 GetNumArgs() const { return mNumArgs; }
     
     private: static const S32 MAX_NUM_ARGS = 32;
     private: static const S32 MAX_ARG_LENGTH = 64;
     private: static const S32 MAX_ARG_VALUE_LENGTH = 512;
     
-    private: static char mArgNames[ MAX_NUM_ARGS ][ MAX_ARG_LENGTH + 1 ];
-    private: static char mArgValues[ MAX_NUM_ARGS ][ MAX_ARG_VALUE_LENGTH + 1 ];
-    private: static int mNumArgs;
+    private: char mArgNames[ MAX_NUM_ARGS ][ MAX_ARG_LENGTH + 1 ];
+    private: char mArgValues[ MAX_NUM_ARGS ][ MAX_ARG_VALUE_LENGTH + 1 ];
+    private: int mNumArgs;
 };
 
 #endif // COMMAND_LINE_PARSER_H
@@ -0,0 +1,134 @@
+//------------------------------------------------------------------------------
+// File: LatestValueMailbox.h
+// Desc: A lock free mailbox for passing values from one thread to another
+//       when only the most recent value matters, such as a set of control
+//       setpoints. It's a triple buffer, so the writer always has a slot to
+//       fill, the reader always has a slot to read and neither ever waits for
+//       the other. Values that are overwritten before the reader gets to them
+//       are dropped.
+//
+//       There must only be one writing thread and one reading thread.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef LATEST_VALUE_MAILBOX_H
+#define LATEST_VALUE_MAILBOX_H
+
+//------------------------------------------------------------------------------
+#include "Common.h"
+
+//------------------------------------------------------------------------------
+template <typename T>
+class LatestValueMailbox
+{
+    //--------------------------------------------------------------------------
+    public: LatestValueMailbox();
+
+    //--------------------------------------------------------------------------
+    //! Writer interface. Copies a value into the mailbox, replacing any value
+    //! that hasn't been read yet. Returns the sequence number given to the
+    //! value. Sequence numbers start at 1 and go up by 1 with each post
+    public: U32 Post( const T& value );
+
+    //--------------------------------------------------------------------------
+    //! Reader interface. If a value has been posted since the last call then
+    //! the newest one is copied into pValueOut and true is returned.
+    //! pSequenceNumberOut can be NULL
+    public: bool TakeLatest( T* pValueOut, U32* pSequenceNumberOut = NULL );
+
+    //--------------------------------------------------------------------------
+    //! Atomically swaps the shared slot with newSharedSlot and returns the
+    //! slot that was shared before
+    private: U32 ExchangeSharedSlot( U32 newSharedSlot );
+
+    //--------------------------------------------------------------------------
+    // The index of the shared slot is kept in the low bits of mSharedSlot and
+    // this bit is set if the shared slot holds a value the reader hasn't seen
+    private: static const U32 NEW_VALUE_BIT = 0x4;
+    private: static const U32 SLOT_IDX_MASK = 0x3;
+
+    //--------------------------------------------------------------------------
+    // Members
+    private: T mValues[ 3 ];
+    private: U32 mSequenceNumbers[ 3 ];
+    private: volatile U32 mSharedSlot;
+    private: U32 mWriteSlotIdx;         // Only touched by the writer
+    private: U32 mLastSequenceNumber;   // Only touched by the writer
+    private: U32 mReadSlotIdx;          // Only touched by the reader
+};
+
+//------------------------------------------------------------------------------
+template <typename T>
+LatestValueMailbox<T>::LatestValueMailbox()
+    : mSharedSlot( 1 ),
+    mWriteSlotIdx( 0 ),
+    mLastSequenceNumber( 0 ),
+    mReadSlotIdx( 2 )
+{
+    for ( U32 slotIdx = 0; slotIdx < 3; slotIdx++ )
+    {
+        mValues[ slotIdx ] = T();
+        mSequenceNumbers[ slotIdx ] = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+template <typename T>
+U32 LatestValueMailbox<T>::Post( const T& value )
+{
+    mLastSequenceNumber++;
+    mValues[ mWriteSlotIdx ] = value;
+    mSequenceNumbers[ mWriteSlotIdx ] = mLastSequenceNumber;
+
+    // The reader can't pick up the slot before the value has been written
+    // as the exchange is fenced
+    U32 oldSharedSlot = ExchangeSharedSlot( mWriteSlotIdx | NEW_VALUE_BIT );
+    mWriteSlotIdx = oldSharedSlot & SLOT_IDX_MASK;
+
+    return mLastSequenceNumber;
+}
+
+//------------------------------------------------------------------------------
+template <typename T>
+bool LatestValueMailbox<T>::TakeLatest( T* pValueOut, U32* pSequenceNumberOut )
+{
+    // An atomic read, so that the check is ordered with the writer's exchange
+    if ( 0 == ( __sync_fetch_and_or( &mSharedSlot, 0 ) & NEW_VALUE_BIT ) )
+    {
+        return false;
+    }
+
+    // Swap the slot we've finished with for the new one. If the writer posts
+    // again in between then we just get the newer value
+    U32 oldSharedSlot = ExchangeSharedSlot( mReadSlotIdx );
+    mReadSlotIdx = oldSharedSlot & SLOT_IDX_MASK;
+
+    *pValueOut = mValues[ mReadSlotIdx ];
+    if ( NULL != pSequenceNumberOut )
+    {
+        *pSequenceNumberOut = mSequenceNumbers[ mReadSlotIdx ];
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+template <typename T>
+U32 LatestValueMailbox<T>::ExchangeSharedSlot( U32 newSharedSlot )
+{
+    // A compare and swap is used rather than __sync_lock_test_and_set as it's
+    // a full barrier, and so also publishes the writes to the slots
+    U32 oldSharedSlot = __sync_fetch_and_or( &mSharedSlot, 0 );
+    for ( ;; )
+    {
+        U32 actualSharedSlot = __sync_val_compare_and_swap(
+            &mSharedSlot, oldSharedSlot, newSharedSlot );
+        if ( actualSharedSlot == oldSharedSlot )
+        {
+            return oldSharedSlot;
+        }
+        oldSharedSlot = actualSharedSlot;
+    }
+}
+
+#endif // LATEST_VALUE_MAILBOX_H
@@ -0,0 +1,142 @@
+//------------------------------------------------------------------------------
+// File: NameHashTable.cpp
+// Desc: A hash table that maps names to non-negative integer values. Names
+//       are compared without regard to case. Lookups don't allocate any
+//       memory so the table can be used from time critical code once it has
+//       been built.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "NameHashTable.h"
+
+#include <ctype.h>
+#include <string.h>
+#include "Utils.h"
+
+//------------------------------------------------------------------------------
+static const U32 NHT_INITIAL_NUM_SLOTS = 16;
+static const U32 NHT_FNV_OFFSET_BASIS = 2166136261u;
+static const U32 NHT_FNV_PRIME = 16777619u;
+
+//------------------------------------------------------------------------------
+NameHashTable::NameHashTable()
+    : mNumEntries( 0 )
+{
+}
+
+//------------------------------------------------------------------------------
+U32 NameHashTable::HashName( const char* name )
+{
+    U32 hash = NHT_FNV_OFFSET_BASIS;
+    for ( const U8* pChar = (const U8*)name; '\0' != *pChar; pChar++ )
+    {
+        hash ^= (U32)tolower( *pChar );
+        hash *= NHT_FNV_PRIME;
+    }
+
+    return hash;
+}
+
+//------------------------------------------------------------------------------
+bool NameHashTable::Insert( const char* name, S32 value )
+{
+    if ( value < 0 )
+    {
+        return false;
+    }
+
+    // Keep the table at most half full so that probe sequences stay short
+    if ( 2*( mNumEntries + 1 ) > mSlots.size() )
+    {
+        Grow();
+    }
+
+    U32 hash = HashName( name );
+    S32 slotIdx = FindSlot( name, hash );
+    if ( mSlots[ slotIdx ].mValue >= 0 )
+    {
+        // The name is already in the table
+        return false;
+    }
+
+    Entry& entry = mSlots[ slotIdx ];
+    entry.mHash = hash;
+    entry.mValue = value;
+    entry.mNameOffset = mNamePool.size();
+    mNamePool.insert( mNamePool.end(), name, name + strlen( name ) + 1 );
+    mNumEntries++;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+S32 NameHashTable::Find( const char* name ) const
+{
+    if ( mSlots.empty() )
+    {
+        return -1;
+    }
+
+    return mSlots[ FindSlot( name, HashName( name ) ) ].mValue;
+}
+
+//------------------------------------------------------------------------------
+void NameHashTable::Clear()
+{
+    mSlots.clear();
+    mNamePool.clear();
+    mNumEntries = 0;
+}
+
+//------------------------------------------------------------------------------
+// Returns the slot holding the name, or the empty slot where it would go if
+// it isn't in the table. Uses linear probing
+S32 NameHashTable::FindSlot( const char* name, U32 hash ) const
+{
+    U32 slotMask = mSlots.size() - 1;
+    U32 slotIdx = hash & slotMask;
+
+    while ( mSlots[ slotIdx ].mValue >= 0 )
+    {
+        const Entry& entry = mSlots[ slotIdx ];
+        if ( entry.mHash == hash
+            && Utils::stricmp( &mNamePool[ entry.mNameOffset ], name ) == 0 )
+        {
+            break;
+        }
+
+        slotIdx = ( slotIdx + 1 ) & slotMask;
+    }
+
+    return (S32)slotIdx;
+}
+
+//------------------------------------------------------------------------------
+void NameHashTable::Grow()
+{
+    std::vector<Entry> oldSlots;
+    oldSlots.swap( mSlots );
+
+    Entry emptyEntry;
+    emptyEntry.mHash = 0;
+    emptyEntry.mValue = -1;
+    emptyEntry.mNameOffset = 0;
+    mSlots.resize( oldSlots.empty() ? NHT_INITIAL_NUM_SLOTS : 2*oldSlots.size(), emptyEntry );
+
+    // Names in the table are unique so entries can go straight into the
+    // first free slot of their probe sequence
+    U32 slotMask = mSlots.size() - 1;
+    for ( U32 oldSlotIdx = 0; oldSlotIdx < oldSlots.size(); oldSlotIdx++ )
+    {
+        const Entry& entry = oldSlots[ oldSlotIdx ];
+        if ( entry.mValue >= 0 )
+        {
+            U32 slotIdx = entry.mHash & slotMask;
+            while ( mSlots[ slotIdx ].mValue >= 0 )
+            {
+                slotIdx = ( slotIdx + 1 ) & slotMask;
+            }
+            mSlots[ slotIdx ] = entry;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+//------------------------------------------------------------------------------
+// File: NameHashTable.h
+// Desc: A hash table that maps names to non-negative integer values. Names
+//       are compared without regard to case. Lookups don't allocate any
+//       memory so the table can be used from time critical code once it has
+//       been built.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef NAME_HASH_TABLE_H
+#define NAME_HASH_TABLE_H
+
+//------------------------------------------------------------------------------
+#include <vector>
+#include "Common.h"
+
+//------------------------------------------------------------------------------
+class NameHashTable
+{
+    //--------------------------------------------------------------------------
+    public: NameHashTable();
+
+    //--------------------------------------------------------------------------
+    //! Adds a name to the table. The name is copied. Returns false if the
+    //! name is already in the table or the value is negative, in which case
+    //! the table is left unchanged
+    public: bool Insert( const char* name, S32 value );
+
+    //--------------------------------------------------------------------------
+    //! Returns the value stored for the name or -1 if it can't be found
+    public: S32 Find( const char* name ) const;
+
+    //--------------------------------------------------------------------------
+    public: void Clear();
+    public: U32 GetNumEntries() const { return mNumEntries; }
+
+    //--------------------------------------------------------------------------
+    //! Case insensitive FNV-1a hash
+    public: static U32 HashName( const char* name );
+
+    //--------------------------------------------------------------------------
+    private: struct Entry
+    {
+        U32 mHash;
+        S32 mValue;         // -1 for an empty slot
+        U32 mNameOffset;    // Offset of the name in mNamePool
+    };
+
+    //--------------------------------------------------------------------------
+    private: S32 FindSlot( const char* name, U32 hash ) const;
+    private: void Grow();
+
+    //--------------------------------------------------------------------------
+    // Members
+    private: std::vector<Entry> mSlots;     // Size is always a power of 2
+    private: std::vector<char> mNamePool;
+    private: U32 mNumEntries;
+};
+
+#endif // NAME_HASH_TABLE_H
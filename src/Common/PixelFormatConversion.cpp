@@ -0,0 +1,627 @@
+//------------------------------------------------------------------------------
+// File: PixelFormatConversion.cpp
+// Desc: Routines for converting images between pixel formats. Each
+//       conversion has a plain C++ version along with SSE2, SSSE3 and AVX2
+//       versions, and the fastest one supported by the CPU is picked at
+//       runtime. All versions give exactly the same output.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "PixelFormatConversion.h"
+
+#if defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#define PIXEL_FORMAT_CONVERSION_X86
+#include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Converts a single row of pixels
+typedef void (*RowConverter)( const U8* pSrc, U8* pDst, U32 width );
+
+//------------------------------------------------------------------------------
+// Grey level weights, these add up to 256
+static const U32 GRAY_RED_WEIGHT = 77;
+static const U32 GRAY_GREEN_WEIGHT = 150;
+static const U32 GRAY_BLUE_WEIGHT = 29;
+
+//------------------------------------------------------------------------------
+// Scalar versions
+//------------------------------------------------------------------------------
+static void ARGB8888ToRGB888Row_Scalar( const U8* pSrc, U8* pDst, U32 width )
+{
+    for ( U32 pixelIdx = 0; pixelIdx < width; pixelIdx++ )
+    {
+        pDst[ 0 ] = pSrc[ 2 ];
+        pDst[ 1 ] = pSrc[ 1 ];
+        pDst[ 2 ] = pSrc[ 0 ];
+        pSrc += 4;
+        pDst += 3;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void ARGB8888ToBGR888Row_Scalar( const U8* pSrc, U8* pDst, U32 width )
+{
+    for ( U32 pixelIdx = 0; pixelIdx < width; pixelIdx++ )
+    {
+        pDst[ 0 ] = pSrc[ 0 ];
+        pDst[ 1 ] = pSrc[ 1 ];
+        pDst[ 2 ] = pSrc[ 2 ];
+        pSrc += 4;
+        pDst += 3;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void ARGB8888ToGRAY8Row_Scalar( const U8* pSrc, U8* pDst, U32 width )
+{
+    for ( U32 pixelIdx = 0; pixelIdx < width; pixelIdx++ )
+    {
+        U32 gray = GRAY_RED_WEIGHT*pSrc[ 2 ] + GRAY_GREEN_WEIGHT*pSrc[ 1 ]
+            + GRAY_BLUE_WEIGHT*pSrc[ 0 ] + 128;
+        *pDst++ = (U8)( gray >> 8 );
+        pSrc += 4;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void A1R5G5B5ToRGB888Row_Scalar( const U8* pSrc, U8* pDst, U32 width )
+{
+    const U16* pSrcPixel = (const U16*)pSrc;
+    for ( U32 pixelIdx = 0; pixelIdx < width; pixelIdx++ )
+    {
+        U32 pixel = *pSrcPixel++;
+        U32 red = ( pixel >> 10 ) & 0x1F;
+        U32 green = ( pixel >> 5 ) & 0x1F;
+        U32 blue = pixel & 0x1F;
+
+        pDst[ 0 ] = (U8)( ( red << 3 ) | ( red >> 2 ) );
+        pDst[ 1 ] = (U8)( ( green << 3 ) | ( green >> 2 ) );
+        pDst[ 2 ] = (U8)( ( blue << 3 ) | ( blue >> 2 ) );
+        pDst += 3;
+    }
+}
+
+#ifdef PIXEL_FORMAT_CONVERSION_X86
+
+//------------------------------------------------------------------------------
+// Helpers shared by the SIMD versions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Takes 4 pixels that have had their 3 wanted bytes placed in the bottom 3
+// bytes of each dword and packs them into the bottom 12 bytes of the result
+__attribute__((target("sse2")))
+static inline __m128i Pack4To3_SSE2( __m128i pixels )
+{
+    pixels = _mm_and_si128( pixels, _mm_set1_epi32( 0x00FFFFFF ) );
+
+    // Pack the pairs of pixels in each 64-bit half into 6 bytes
+    __m128i packedPairs = _mm_or_si128(
+        _mm_and_si128( pixels, _mm_set_epi32( 0, 0x00FFFFFF, 0, 0x00FFFFFF ) ),
+        _mm_and_si128( _mm_srli_epi64( pixels, 8 ), _mm_set_epi32( 0x0000FFFF, 0xFF000000, 0x0000FFFF, 0xFF000000 ) ) );
+
+    // Then bring the two halves together
+    return _mm_or_si128( _mm_move_epi64( packedPairs ),
+        _mm_slli_si128( _mm_srli_si128( packedPairs, 8 ), 6 ) );
+}
+
+//------------------------------------------------------------------------------
+// Stores 4 lots of 12 packed bytes as 48 contiguous bytes
+__attribute__((target("sse2")))
+static inline void Store4x12Bytes_SSE2( U8* pDst, __m128i p0, __m128i p1, __m128i p2, __m128i p3 )
+{
+    _mm_storeu_si128( (__m128i*)pDst,
+        _mm_or_si128( p0, _mm_slli_si128( p1, 12 ) ) );
+    _mm_storeu_si128( (__m128i*)( pDst + 16 ),
+        _mm_or_si128( _mm_srli_si128( p1, 4 ), _mm_slli_si128( p2, 8 ) ) );
+    _mm_storeu_si128( (__m128i*)( pDst + 32 ),
+        _mm_or_si128( _mm_srli_si128( p2, 8 ), _mm_slli_si128( p3, 4 ) ) );
+}
+
+//------------------------------------------------------------------------------
+// Swaps the red and blue bytes of each ARGB8888 pixel
+__attribute__((target("sse2")))
+static inline __m128i SwapRedAndBlue_SSE2( __m128i pixels )
+{
+    const __m128i BYTE_MASK = _mm_set1_epi32( 0xFF );
+    return _mm_or_si128( _mm_or_si128(
+        _mm_and_si128( pixels, _mm_set1_epi32( 0xFF00 ) ),
+        _mm_and_si128( _mm_srli_epi32( pixels, 16 ), BYTE_MASK ) ),
+        _mm_slli_epi32( _mm_and_si128( pixels, BYTE_MASK ), 16 ) );
+}
+
+//------------------------------------------------------------------------------
+// Calculates the grey level of 4 ARGB8888 pixels, one per dword. The
+// channels are multiplied with 16-bit multiplies, this works because the
+// top half of each dword is zero and the products fit in 16 bits
+__attribute__((target("sse2")))
+static inline __m128i CalculateGray_SSE2( __m128i pixels )
+{
+    const __m128i BYTE_MASK = _mm_set1_epi32( 0xFF );
+    __m128i red = _mm_and_si128( _mm_srli_epi32( pixels, 16 ), BYTE_MASK );
+    __m128i green = _mm_and_si128( _mm_srli_epi32( pixels, 8 ), BYTE_MASK );
+    __m128i blue = _mm_and_si128( pixels, BYTE_MASK );
+
+    __m128i gray = _mm_add_epi32(
+        _mm_add_epi32( _mm_mullo_epi16( red, _mm_set1_epi32( GRAY_RED_WEIGHT ) ),
+                       _mm_mullo_epi16( green, _mm_set1_epi32( GRAY_GREEN_WEIGHT ) ) ),
+        _mm_add_epi32( _mm_mullo_epi16( blue, _mm_set1_epi32( GRAY_BLUE_WEIGHT ) ),
+                       _mm_set1_epi32( 128 ) ) );
+    return _mm_srli_epi32( gray, 8 );
+}
+
+//------------------------------------------------------------------------------
+// Expands 4 A1R5G5B5 pixels, one per dword, into dwords holding R, G and B
+// in their bottom 3 bytes
+__attribute__((target("sse2")))
+static inline __m128i ExpandA1R5G5B5_SSE2( __m128i pixels )
+{
+    const __m128i CHANNEL_MASK = _mm_set1_epi32( 0x1F );
+    __m128i red = _mm_and_si128( _mm_srli_epi32( pixels, 10 ), CHANNEL_MASK );
+    __m128i green = _mm_and_si128( _mm_srli_epi32( pixels, 5 ), CHANNEL_MASK );
+    __m128i blue = _mm_and_si128( pixels, CHANNEL_MASK );
+
+    red = _mm_or_si128( _mm_slli_epi32( red, 3 ), _mm_srli_epi32( red, 2 ) );
+    green = _mm_or_si128( _mm_slli_epi32( green, 3 ), _mm_srli_epi32( green, 2 ) );
+    blue = _mm_or_si128( _mm_slli_epi32( blue, 3 ), _mm_srli_epi32( blue, 2 ) );
+
+    return _mm_or_si128( _mm_or_si128( red, _mm_slli_epi32( green, 8 ) ),
+                         _mm_slli_epi32( blue, 16 ) );
+}
+
+//------------------------------------------------------------------------------
+// SSE2 versions
+//------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+static void ARGB8888ToRGB888Row_SSE2( const U8* pSrc, U8* pDst, U32 width )
+{
+    U32 pixelIdx = 0;
+    for ( ; pixelIdx + 16 <= width; pixelIdx += 16 )
+    {
+        const __m128i* pSrcBlock = (const __m128i*)( pSrc + 4*pixelIdx );
+        Store4x12Bytes_SSE2( pDst + 3*pixelIdx,
+            Pack4To3_SSE2( SwapRedAndBlue_SSE2( _mm_loadu_si128( pSrcBlock ) ) ),
+            Pack4To3_SSE2( SwapRedAndBlue_SSE2( _mm_loadu_si128( pSrcBlock + 1 ) ) ),
+            Pack4To3_SSE2( SwapRedAndBlue_SSE2( _mm_loadu_si128( pSrcBlock + 2 ) ) ),
+            Pack4To3_SSE2( SwapRedAndBlue_SSE2( _mm_loadu_si128( pSrcBlock + 3 ) ) ) );
+    }
+
+    ARGB8888ToRGB888Row_Scalar( pSrc + 4*pixelIdx, pDst + 3*pixelIdx, width - pixelIdx );
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+static void ARGB8888ToBGR888Row_SSE2( const U8* pSrc, U8* pDst, U32 width )
+{
+    U32 pixelIdx = 0;
+    for ( ; pixelIdx + 16 <= width; pixelIdx += 16 )
+    {
+        const __m128i* pSrcBlock = (const __m128i*)( pSrc + 4*pixelIdx );
+        Store4x12Bytes_SSE2( pDst + 3*pixelIdx,
+            Pack4To3_SSE2( _mm_loadu_si128( pSrcBlock ) ),
+            Pack4To3_SSE2( _mm_loadu_si128( pSrcBlock + 1 ) ),
+            Pack4To3_SSE2( _mm_loadu_si128( pSrcBlock + 2 ) ),
+            Pack4To3_SSE2( _mm_loadu_si128( pSrcBlock + 3 ) ) );
+    }
+
+    ARGB8888ToBGR888Row_Scalar( pSrc + 4*pixelIdx, pDst + 3*pixelIdx, width - pixelIdx );
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+static void ARGB8888ToGRAY8Row_SSE2( const U8* pSrc, U8* pDst, U32 width )
+{
+    U32 pixelIdx = 0;
+    for ( ; pixelIdx + 16 <= width; pixelIdx += 16 )
+    {
+        const __m128i* pSrcBlock = (const __m128i*)( pSrc + 4*pixelIdx );
+        __m128i gray0 = CalculateGray_SSE2( _mm_loadu_si128( pSrcBlock ) );
+        __m128i gray1 = CalculateGray_SSE2( _mm_loadu_si128( pSrcBlock + 1 ) );
+        __m128i gray2 = CalculateGray_SSE2( _mm_loadu_si128( pSrcBlock + 2 ) );
+        __m128i gray3 = CalculateGray_SSE2( _mm_loadu_si128( pSrcBlock + 3 ) );
+
+        _mm_storeu_si128( (__m128i*)( pDst + pixelIdx ), _mm_packus_epi16(
+            _mm_packs_epi32( gray0, gray1 ), _mm_packs_epi32( gray2, gray3 ) ) );
+    }
+
+    ARGB8888ToGRAY8Row_Scalar( pSrc + 4*pixelIdx, pDst + pixelIdx, width - pixelIdx );
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+static void A1R5G5B5ToRGB888Row_SSE2( const U8* pSrc, U8* pDst, U32 width )
+{
+    const __m128i ZERO = _mm_setzero_si128();
+
+    U32 pixelIdx = 0;
+    for ( ; pixelIdx + 16 <= width; pixelIdx += 16 )
+    {
+        const __m128i* pSrcBlock = (const __m128i*)( pSrc + 2*pixelIdx );
+        __m128i pixels0 = _mm_loadu_si128( pSrcBlock );
+        __m128i pixels1 = _mm_loadu_si128( pSrcBlock + 1 );
+
+        Store4x12Bytes_SSE2( pDst + 3*pixelIdx,
+            Pack4To3_SSE2( ExpandA1R5G5B5_SSE2( _mm_unpacklo_epi16( pixels0, ZERO ) ) ),
+            Pack4To3_SSE2( ExpandA1R5G5B5_SSE2( _mm_unpackhi_epi16( pixels0, ZERO ) ) ),
+            Pack4To3_SSE2( ExpandA1R5G5B5_SSE2( _mm_unpacklo_epi16( pixels1, ZERO ) ) ),
+            Pack4To3_SSE2( ExpandA1R5G5B5_SSE2( _mm_unpackhi_epi16( pixels1, ZERO ) ) ) );
+    }
+
+    A1R5G5B5ToRGB888Row_Scalar( pSrc + 2*pixelIdx, pDst + 3*pixelIdx, width - pixelIdx );
+}
+
+//------------------------------------------------------------------------------
+// SSSE3 versions. These use a byte shuffle to pick out and pack the channels
+// in one go. There's no SSSE3 instruction that helps with the grey level
+// calculation so the SSE2 version is used for that
+//------------------------------------------------------------------------------
+__attribute__((target("ssse3")))
+static void ShuffleARGB8888Row_SSSE3( const U8* pSrc, U8* pDst, U32 width, __m128i shuffleMask )
+{
+    for ( U32 pixelIdx = 0; pixelIdx < width; pixelIdx += 16 )
+    {
+        const __m128i* pSrcBlock = (const __m128i*)( pSrc + 4*pixelIdx );
+        Store4x12Bytes_SSE2( pDst + 3*pixelIdx,
+            _mm_shuffle_epi8( _mm_loadu_si128( pSrcBlock ), shuffleMask ),
+            _mm_shuffle_epi8( _mm_loadu_si128( pSrcBlock + 1 ), shuffleMask ),
+            _mm_shuffle_epi8( _mm_loadu_si128( pSrcBlock + 2 ), shuffleMask ),
+            _mm_shuffle_epi8( _mm_loadu_si128( pSrcBlock + 3 ), shuffleMask ) );
+    }
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("ssse3")))
+static void ARGB8888ToRGB888Row_SSSE3( const U8* pSrc, U8* pDst, U32 width )
+{
+    U32 numBlockPixels = width & ~15;
+    ShuffleARGB8888Row_SSSE3( pSrc, pDst, numBlockPixels,
+        _mm_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 ) );
+
+    ARGB8888ToRGB888Row_Scalar( pSrc + 4*numBlockPixels, pDst + 3*numBlockPixels,
+                                width - numBlockPixels );
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("ssse3")))
+static void ARGB8888ToBGR888Row_SSSE3( const U8* pSrc, U8* pDst, U32 width )
+{
+    U32 numBlockPixels = width & ~15;
+    ShuffleARGB8888Row_SSSE3( pSrc, pDst, numBlockPixels,
+        _mm_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 ) );
+
+    ARGB8888ToBGR888Row_Scalar( pSrc + 4*numBlockPixels, pDst + 3*numBlockPixels,
+                                width - numBlockPixels );
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("ssse3")))
+static void A1R5G5B5ToRGB888Row_SSSE3( const U8* pSrc, U8* pDst, U32 width )
+{
+    const __m128i ZERO = _mm_setzero_si128();
+    const __m128i PACK_MASK = _mm_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 );
+
+    U32 pixelIdx = 0;
+    for ( ; pixelIdx + 16 <= width; pixelIdx += 16 )
+    {
+        const __m128i* pSrcBlock = (const __m128i*)( pSrc + 2*pixelIdx );
+        __m128i pixels0 = _mm_loadu_si128( pSrcBlock );
+        __m128i pixels1 = _mm_loadu_si128( pSrcBlock + 1 );
+
+        Store4x12Bytes_SSE2( pDst + 3*pixelIdx,
+            _mm_shuffle_epi8( ExpandA1R5G5B5_SSE2( _mm_unpacklo_epi16( pixels0, ZERO ) ), PACK_MASK ),
+            _mm_shuffle_epi8( ExpandA1R5G5B5_SSE2( _mm_unpackhi_epi16( pixels0, ZERO ) ), PACK_MASK ),
+            _mm_shuffle_epi8( ExpandA1R5G5B5_SSE2( _mm_unpacklo_epi16( pixels1, ZERO ) ), PACK_MASK ),
+            _mm_shuffle_epi8( ExpandA1R5G5B5_SSE2( _mm_unpackhi_epi16( pixels1, ZERO ) ), PACK_MASK ) );
+    }
+
+    A1R5G5B5ToRGB888Row_Scalar( pSrc + 2*pixelIdx, pDst + 3*pixelIdx, width - pixelIdx );
+}
+
+//------------------------------------------------------------------------------
+// AVX2 versions. The byte shuffle only works within each 128-bit lane so the
+// packed bytes from the two lanes are brought together with a dword permute.
+// Each block of 8 pixels gives 24 bytes but a full 32 bytes is stored, so
+// blocks are only processed whilst the extra bytes still land in the row
+//------------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static inline void StorePacked8Pixels_AVX2( U8* pDst, __m256i pixels, __m256i shuffleMask )
+{
+    const __m256i LANE_MERGE_IDXS = _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, 3, 7 );
+    _mm256_storeu_si256( (__m256i*)pDst, _mm256_permutevar8x32_epi32(
+        _mm256_shuffle_epi8( pixels, shuffleMask ), LANE_MERGE_IDXS ) );
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static U32 ShuffleARGB8888Row_AVX2( const U8* pSrc, U8* pDst, U32 width, __m256i shuffleMask )
+{
+    U32 pixelIdx = 0;
+    for ( ; pixelIdx + 11 <= width; pixelIdx += 8 )
+    {
+        StorePacked8Pixels_AVX2( pDst + 3*pixelIdx,
+            _mm256_loadu_si256( (const __m256i*)( pSrc + 4*pixelIdx ) ), shuffleMask );
+    }
+
+    return pixelIdx;
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static void ARGB8888ToRGB888Row_AVX2( const U8* pSrc, U8* pDst, U32 width )
+{
+    U32 pixelIdx = ShuffleARGB8888Row_AVX2( pSrc, pDst, width,
+        _mm256_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 ) );
+
+    ARGB8888ToRGB888Row_Scalar( pSrc + 4*pixelIdx, pDst + 3*pixelIdx, width - pixelIdx );
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static void ARGB8888ToBGR888Row_AVX2( const U8* pSrc, U8* pDst, U32 width )
+{
+    U32 pixelIdx = ShuffleARGB8888Row_AVX2( pSrc, pDst, width,
+        _mm256_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 ) );
+
+    ARGB8888ToBGR888Row_Scalar( pSrc + 4*pixelIdx, pDst + 3*pixelIdx, width - pixelIdx );
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static inline __m256i CalculateGray_AVX2( __m256i pixels )
+{
+    const __m256i BYTE_MASK = _mm256_set1_epi32( 0xFF );
+    __m256i red = _mm256_and_si256( _mm256_srli_epi32( pixels, 16 ), BYTE_MASK );
+    __m256i green = _mm256_and_si256( _mm256_srli_epi32( pixels, 8 ), BYTE_MASK );
+    __m256i blue = _mm256_and_si256( pixels, BYTE_MASK );
+
+    __m256i gray = _mm256_add_epi32(
+        _mm256_add_epi32( _mm256_mullo_epi16( red, _mm256_set1_epi32( GRAY_RED_WEIGHT ) ),
+                          _mm256_mullo_epi16( green, _mm256_set1_epi32( GRAY_GREEN_WEIGHT ) ) ),
+        _mm256_add_epi32( _mm256_mullo_epi16( blue, _mm256_set1_epi32( GRAY_BLUE_WEIGHT ) ),
+                          _mm256_set1_epi32( 128 ) ) );
+    return _mm256_srli_epi32( gray, 8 );
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static void ARGB8888ToGRAY8Row_AVX2( const U8* pSrc, U8* pDst, U32 width )
+{
+    // The packs work within each 128-bit lane, so the dwords come out as
+    // 0a 1a 2a 3a 0b 1b 2b 3b and need putting back in order
+    const __m256i LANE_MERGE_IDXS = _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 );
+
+    U32 pixelIdx = 0;
+    for ( ; pixelIdx + 32 <= width; pixelIdx += 32 )
+    {
+        const __m256i* pSrcBlock = (const __m256i*)( pSrc + 4*pixelIdx );
+        __m256i gray0 = CalculateGray_AVX2( _mm256_loadu_si256( pSrcBlock ) );
+        __m256i gray1 = CalculateGray_AVX2( _mm256_loadu_si256( pSrcBlock + 1 ) );
+        __m256i gray2 = CalculateGray_AVX2( _mm256_loadu_si256( pSrcBlock + 2 ) );
+        __m256i gray3 = CalculateGray_AVX2( _mm256_loadu_si256( pSrcBlock + 3 ) );
+
+        __m256i gray = _mm256_packus_epi16(
+            _mm256_packs_epi32( gray0, gray1 ), _mm256_packs_epi32( gray2, gray3 ) );
+        _mm256_storeu_si256( (__m256i*)( pDst + pixelIdx ),
+            _mm256_permutevar8x32_epi32( gray, LANE_MERGE_IDXS ) );
+    }
+
+    ARGB8888ToGRAY8Row_Scalar( pSrc + 4*pixelIdx, pDst + pixelIdx, width - pixelIdx );
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static void A1R5G5B5ToRGB888Row_AVX2( const U8* pSrc, U8* pDst, U32 width )
+{
+    const __m256i CHANNEL_MASK = _mm256_set1_epi32( 0x1F );
+    const __m256i PACK_MASK = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 );
+
+    U32 pixelIdx = 0;
+    for ( ; pixelIdx + 11 <= width; pixelIdx += 8 )
+    {
+        __m256i pixels = _mm256_cvtepu16_epi32(
+            _mm_loadu_si128( (const __m128i*)( pSrc + 2*pixelIdx ) ) );
+
+        __m256i red = _mm256_and_si256( _mm256_srli_epi32( pixels, 10 ), CHANNEL_MASK );
+        __m256i green = _mm256_and_si256( _mm256_srli_epi32( pixels, 5 ), CHANNEL_MASK );
+        __m256i blue = _mm256_and_si256( pixels, CHANNEL_MASK );
+
+        red = _mm256_or_si256( _mm256_slli_epi32( red, 3 ), _mm256_srli_epi32( red, 2 ) );
+        green = _mm256_or_si256( _mm256_slli_epi32( green, 3 ), _mm256_srli_epi32( green, 2 ) );
+        blue = _mm256_or_si256( _mm256_slli_epi32( blue, 3 ), _mm256_srli_epi32( blue, 2 ) );
+
+        StorePacked8Pixels_AVX2( pDst + 3*pixelIdx,
+            _mm256_or_si256( _mm256_or_si256( red, _mm256_slli_epi32( green, 8 ) ),
+                             _mm256_slli_epi32( blue, 16 ) ), PACK_MASK );
+    }
+
+    A1R5G5B5ToRGB888Row_Scalar( pSrc + 2*pixelIdx, pDst + 3*pixelIdx, width - pixelIdx );
+}
+
+//------------------------------------------------------------------------------
+// Dispatch tables indexed by instruction set
+static const RowConverter ARGB8888_TO_RGB888_ROW_CONVERTERS[] =
+{
+    ARGB8888ToRGB888Row_Scalar, ARGB8888ToRGB888Row_SSE2,
+    ARGB8888ToRGB888Row_SSSE3, ARGB8888ToRGB888Row_AVX2
+};
+
+static const RowConverter ARGB8888_TO_BGR888_ROW_CONVERTERS[] =
+{
+    ARGB8888ToBGR888Row_Scalar, ARGB8888ToBGR888Row_SSE2,
+    ARGB8888ToBGR888Row_SSSE3, ARGB8888ToBGR888Row_AVX2
+};
+
+static const RowConverter ARGB8888_TO_GRAY8_ROW_CONVERTERS[] =
+{
+    ARGB8888ToGRAY8Row_Scalar, ARGB8888ToGRAY8Row_SSE2,
+    ARGB8888ToGRAY8Row_SSE2, ARGB8888ToGRAY8Row_AVX2
+};
+
+static const RowConverter A1R5G5B5_TO_RGB888_ROW_CONVERTERS[] =
+{
+    A1R5G5B5ToRGB888Row_Scalar, A1R5G5B5ToRGB888Row_SSE2,
+    A1R5G5B5ToRGB888Row_SSSE3, A1R5G5B5ToRGB888Row_AVX2
+};
+
+#else
+
+//------------------------------------------------------------------------------
+// Only the scalar versions are available on this platform
+static const RowConverter ARGB8888_TO_RGB888_ROW_CONVERTERS[] =
+{
+    ARGB8888ToRGB888Row_Scalar
+};
+
+static const RowConverter ARGB8888_TO_BGR888_ROW_CONVERTERS[] =
+{
+    ARGB8888ToBGR888Row_Scalar
+};
+
+static const RowConverter ARGB8888_TO_GRAY8_ROW_CONVERTERS[] =
+{
+    ARGB8888ToGRAY8Row_Scalar
+};
+
+static const RowConverter A1R5G5B5_TO_RGB888_ROW_CONVERTERS[] =
+{
+    A1R5G5B5ToRGB888Row_Scalar
+};
+
+#endif // PIXEL_FORMAT_CONVERSION_X86
+
+//------------------------------------------------------------------------------
+static PixelFormatConversion::eInstructionSet DetectBestInstructionSet()
+{
+#ifdef PIXEL_FORMAT_CONVERSION_X86
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx2" ) )
+    {
+        return PixelFormatConversion::eIS_AVX2;
+    }
+    else if ( __builtin_cpu_supports( "ssse3" ) )
+    {
+        return PixelFormatConversion::eIS_SSSE3;
+    }
+    else if ( __builtin_cpu_supports( "sse2" ) )
+    {
+        return PixelFormatConversion::eIS_SSE2;
+    }
+#endif
+
+    return PixelFormatConversion::eIS_Scalar;
+}
+
+//------------------------------------------------------------------------------
+static void ConvertImage( const RowConverter* pRowConverters,
+    PixelFormatConversion::eInstructionSet instructionSet,
+    const U8* pSrc, S32 srcPitch, U32 width, U32 height, U8* pDst, S32 dstPitch )
+{
+    PixelFormatConversion::eInstructionSet bestInstructionSet =
+        PixelFormatConversion::GetBestInstructionSet();
+    if ( instructionSet > bestInstructionSet )
+    {
+        instructionSet = bestInstructionSet;
+    }
+
+    RowConverter rowConverter = pRowConverters[ instructionSet ];
+    for ( U32 rowIdx = 0; rowIdx < height; rowIdx++ )
+    {
+        rowConverter( pSrc, pDst, width );
+        pSrc += srcPitch;
+        pDst += dstPitch;
+    }
+}
+
+//------------------------------------------------------------------------------
+// PixelFormatConversion
+//------------------------------------------------------------------------------
+PixelFormatConversion::eInstructionSet PixelFormatConversion::GetBestInstructionSet()
+{
+    static const eInstructionSet BEST_INSTRUCTION_SET = DetectBestInstructionSet();
+    return BEST_INSTRUCTION_SET;
+}
+
+//------------------------------------------------------------------------------
+bool PixelFormatConversion::IsInstructionSetSupported( eInstructionSet instructionSet )
+{
+    return ( instructionSet >= eIS_Scalar
+        && instructionSet <= GetBestInstructionSet() );
+}
+
+//------------------------------------------------------------------------------
+const char* PixelFormatConversion::GetInstructionSetName( eInstructionSet instructionSet )
+{
+    switch ( instructionSet )
+    {
+        case eIS_Scalar: return "Scalar";
+        case eIS_SSE2: return "SSE2";
+        case eIS_SSSE3: return "SSSE3";
+        case eIS_AVX2: return "AVX2";
+        default: return "Unknown";
+    }
+}
+
+//------------------------------------------------------------------------------
+void PixelFormatConversion::ARGB8888ToRGB888( const U8* pSrc, S32 srcPitch,
+    U32 width, U32 height, U8* pDst, S32 dstPitch )
+{
+    ARGB8888ToRGB888( pSrc, srcPitch, width, height, pDst, dstPitch, GetBestInstructionSet() );
+}
+
+//------------------------------------------------------------------------------
+void PixelFormatConversion::ARGB8888ToRGB888( const U8* pSrc, S32 srcPitch,
+    U32 width, U32 height, U8* pDst, S32 dstPitch, eInstructionSet instructionSet )
+{
+    ConvertImage( ARGB8888_TO_RGB888_ROW_CONVERTERS, instructionSet,
+                  pSrc, srcPitch, width, height, pDst, dstPitch );
+}
+
+//------------------------------------------------------------------------------
+void PixelFormatConversion::ARGB8888ToBGR888( const U8* pSrc, S32 srcPitch,
+    U32 width, U32 height, U8* pDst, S32 dstPitch )
+{
+    ARGB8888ToBGR888( pSrc, srcPitch, width, height, pDst, dstPitch, GetBestInstructionSet() );
+}
+
+//------------------------------------------------------------------------------
+void PixelFormatConversion::ARGB8888ToBGR888( const U8* pSrc, S32 srcPitch,
+    U32 width, U32 height, U8* pDst, S32 dstPitch, eInstructionSet instructionSet )
+{
+    ConvertImage( ARGB8888_TO_BGR888_ROW_CONVERTERS, instructionSet,
+                  pSrc, srcPitch, width, height, pDst, dstPitch );
+}
+
+//------------------------------------------------------------------------------
+void PixelFormatConversion::ARGB8888ToGRAY8( const U8* pSrc, S32 srcPitch,
+    U32 width, U32 height, U8* pDst, S32 dstPitch )
+{
+    ARGB8888ToGRAY8( pSrc, srcPitch, width, height, pDst, dstPitch, GetBestInstructionSet() );
+}
+
+//------------------------------------------------------------------------------
+void PixelFormatConversion::ARGB8888ToGRAY8( const U8* pSrc, S32 srcPitch,
+    U32 width, U32 height, U8* pDst, S32 dstPitch, eInstructionSet instructionSet )
+{
+    ConvertImage( ARGB8888_TO_GRAY8_ROW_CONVERTERS, instructionSet,
+                  pSrc, srcPitch, width, height, pDst, dstPitch );
+}
+
+//------------------------------------------------------------------------------
+void PixelFormatConversion::A1R5G5B5ToRGB888( const U8* pSrc, S32 srcPitch,
+    U32 width, U32 height, U8* pDst, S32 dstPitch )
+{
+    A1R5G5B5ToRGB888( pSrc, srcPitch, width, height, pDst, dstPitch, GetBestInstructionSet() );
+}
+
+//------------------------------------------------------------------------------
+void PixelFormatConversion::A1R5G5B5ToRGB888( const U8* pSrc, S32 srcPitch,
+    U32 width, U32 height, U8* pDst, S32 dstPitch, eInstructionSet instructionSet )
+{
+    ConvertImage( A1R5G5B5_TO_RGB888_ROW_CONVERTERS, instructionSet,
+                  pSrc, srcPitch, width, height, pDst, dstPitch );
+}
@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+// File: PixelFormatConversion.h
+// Desc: Routines for converting images between pixel formats. Each
+//       conversion has a plain C++ version along with SSE2, SSSE3 and AVX2
+//       versions, and the fastest one supported by the CPU is picked at
+//       runtime. All versions give exactly the same output.
+//
+//       ARGB8888 is the Irrlicht A8R8G8B8 format, i.e. a 32-bit word per
+//       pixel which on x86 is stored as the bytes B, G, R, A. A1R5G5B5 is a
+//       16-bit word per pixel. The 24-bit formats are stored in the order
+//       given by their names.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef PIXEL_FORMAT_CONVERSION_H
+#define PIXEL_FORMAT_CONVERSION_H
+
+//------------------------------------------------------------------------------
+#include "Common.h"
+
+//------------------------------------------------------------------------------
+class PixelFormatConversion
+{
+    //--------------------------------------------------------------------------
+    // The instruction sets are ordered so that each one includes everything
+    // that comes before it
+    public: enum eInstructionSet
+    {
+        eIS_Scalar = 0,
+        eIS_SSE2,
+        eIS_SSSE3,
+        eIS_AVX2,
+        eIS_NumInstructionSets
+    };
+
+    //--------------------------------------------------------------------------
+    //! Returns the fastest instruction set supported by this CPU
+    public: static eInstructionSet GetBestInstructionSet();
+    public: static bool IsInstructionSetSupported( eInstructionSet instructionSet );
+    public: static const char* GetInstructionSetName( eInstructionSet instructionSet );
+
+    //--------------------------------------------------------------------------
+    // The conversion routines. The pitches give the number of bytes from the
+    // start of one row to the start of the next and may be negative for
+    // images that are stored bottom row first. The versions that take an
+    // instruction set are mainly for testing, if the instruction set isn't
+    // supported then the best supported one below it is used instead
+    public: static void ARGB8888ToRGB888( const U8* pSrc, S32 srcPitch,
+        U32 width, U32 height, U8* pDst, S32 dstPitch );
+    public: static void ARGB8888ToRGB888( const U8* pSrc, S32 srcPitch,
+        U32 width, U32 height, U8* pDst, S32 dstPitch, eInstructionSet instructionSet );
+
+    public: static void ARGB8888ToBGR888( const U8* pSrc, S32 srcPitch,
+        U32 width, U32 height, U8* pDst, S32 dstPitch );
+    public: static void ARGB8888ToBGR888( const U8* pSrc, S32 srcPitch,
+        U32 width, U32 height, U8* pDst, S32 dstPitch, eInstructionSet instructionSet );
+
+    //! Grey level is ( 77*R + 150*G + 29*B + 128 ) >> 8
+    public: static void ARGB8888ToGRAY8( const U8* pSrc, S32 srcPitch,
+        U32 width, U32 height, U8* pDst, S32 dstPitch );
+    public: static void ARGB8888ToGRAY8( const U8* pSrc, S32 srcPitch,
+        U32 width, U32 height, U8* pDst, S32 dstPitch, eInstructionSet instructionSet );
+
+    //! The 5-bit channels are expanded to 8 bits by replicating their top
+    //! bits so that 0x1F becomes 0xFF
+    public: static void A1R5G5B5ToRGB888( const U8* pSrc, S32 srcPitch,
+        U32 width, U32 height, U8* pDst, S32 dstPitch );
+    public: static void A1R5G5B5ToRGB888( const U8* pSrc, S32 srcPitch,
+        U32 width, U32 height, U8* pDst, S32 dstPitch, eInstructionSet instructionSet );
+};
+
+#endif // PIXEL_FORMAT_CONVERSION_H
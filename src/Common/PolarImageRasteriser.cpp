@@ -0,0 +1,215 @@
+//------------------------------------------------------------------------------
+// File: PolarImageRasteriser.cpp
+// Desc: Draws polar data, such as the beams of a scanning sonar, into a
+//       square MONO8 image. The pixel that each (beam, bin) pair lands on is
+//       worked out once when the geometry is set, after which drawing the
+//       image is just a pass through a lookup table.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "PolarImageRasteriser.h"
+
+#include <math.h>
+
+#if defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#define POLAR_IMAGE_RASTERISER_X86
+#include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+static const F32 PIR_TWO_PI = 2.0f*(F32)M_PI;
+
+//------------------------------------------------------------------------------
+// Wraps an angle into the range [0, 2*PI)
+static F32 WrapAngle( F32 angle )
+{
+    angle = fmodf( angle, PIR_TWO_PI );
+    return ( angle < 0.0f ? angle + PIR_TWO_PI : angle );
+}
+
+//------------------------------------------------------------------------------
+static void RasteriseRow_Scalar( const U8* pBins, const S32* pPixelBinIdxs,
+                                 U8* pImage, U32 numPixels )
+{
+    for ( U32 pixelIdx = 0; pixelIdx < numPixels; pixelIdx++ )
+    {
+        S32 binIdx = pPixelBinIdxs[ pixelIdx ];
+        pImage[ pixelIdx ] = ( binIdx >= 0 ? pBins[ binIdx ] : 0 );
+    }
+}
+
+#ifdef POLAR_IMAGE_RASTERISER_X86
+
+//------------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static void RasteriseRow_AVX2( const U8* pBins, const S32* pPixelBinIdxs,
+                               U8* pImage, U32 numPixels )
+{
+    const __m256i BYTE_MASK = _mm256_set1_epi32( 0xFF );
+    const __m256i MINUS_ONE = _mm256_set1_epi32( -1 );
+
+    // Gathers read 4 bytes for each pixel so the bins need some padding
+    U32 pixelIdx = 0;
+    for ( ; pixelIdx + 16 <= numPixels; pixelIdx += 16 )
+    {
+        __m256i binIdxs0 = _mm256_loadu_si256( (const __m256i*)( pPixelBinIdxs + pixelIdx ) );
+        __m256i binIdxs1 = _mm256_loadu_si256( (const __m256i*)( pPixelBinIdxs + pixelIdx + 8 ) );
+
+        // Pixels outside the beams are masked off and come out as 0
+        __m256i values0 = _mm256_mask_i32gather_epi32( _mm256_setzero_si256(),
+            (const int*)pBins, binIdxs0, _mm256_cmpgt_epi32( binIdxs0, MINUS_ONE ), 1 );
+        __m256i values1 = _mm256_mask_i32gather_epi32( _mm256_setzero_si256(),
+            (const int*)pBins, binIdxs1, _mm256_cmpgt_epi32( binIdxs1, MINUS_ONE ), 1 );
+        values0 = _mm256_and_si256( values0, BYTE_MASK );
+        values1 = _mm256_and_si256( values1, BYTE_MASK );
+
+        // The packs work within each 128-bit lane so the results come out as
+        // 0-3 8-11 4-7 12-15 and need putting back in order
+        __m256i words = _mm256_packus_epi32( values0, values1 );
+        __m128i bytes = _mm_packus_epi16( _mm256_castsi256_si128( words ),
+                                          _mm256_extracti128_si256( words, 1 ) );
+        bytes = _mm_shuffle_epi32( bytes, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        _mm_storeu_si128( (__m128i*)( pImage + pixelIdx ), bytes );
+    }
+
+    RasteriseRow_Scalar( pBins, pPixelBinIdxs + pixelIdx, pImage + pixelIdx, numPixels - pixelIdx );
+}
+
+#endif // POLAR_IMAGE_RASTERISER_X86
+
+//------------------------------------------------------------------------------
+PolarImageRasteriser::PolarImageRasteriser()
+    : mNumBins( 0 ),
+    mNumBeams( 0 ),
+    mStartAngle( 0.0f ),
+    mStepAngle( 0.0f )
+{
+}
+
+//------------------------------------------------------------------------------
+bool PolarImageRasteriser::SetGeometry( U32 numBins, U32 numBeams,
+                                        F32 startAngle, F32 stepAngle )
+{
+    if ( numBins == mNumBins && numBeams == mNumBeams
+        && startAngle == mStartAngle && stepAngle == mStepAngle )
+    {
+        return false;
+    }
+
+    mNumBins = numBins;
+    mNumBeams = numBeams;
+    mStartAngle = startAngle;
+    mStepAngle = stepAngle;
+
+    U32 imageDim = 2*numBins;
+    mPixelBinIdxs.assign( imageDim*imageDim, -1 );
+    mBeamPixelStarts.assign( numBeams + 1, 0 );
+    mBeamPixelIdxs.clear();
+
+    if ( 0 == numBins || 0 == numBeams || stepAngle <= 0.0f )
+    {
+        return true;
+    }
+
+    // If the beams go all the way round then the last beam meets the first
+    bool bFullCircle = ( numBeams*stepAngle > PIR_TWO_PI - 0.5f*stepAngle );
+
+    std::vector<S32> pixelBeamIdxs( imageDim*imageDim, -1 );
+    for ( U32 y = 0; y < imageDim; y++ )
+    {
+        F32 offsetY = (F32)numBins - (F32)y - 0.5f;
+        for ( U32 x = 0; x < imageDim; x++ )
+        {
+            F32 offsetX = (F32)x - (F32)numBins + 0.5f;
+
+            U32 binIdx = (U32)sqrtf( offsetX*offsetX + offsetY*offsetY );
+            if ( binIdx >= numBins )
+            {
+                continue;
+            }
+
+            F32 angle = WrapAngle( atan2f( -offsetX, offsetY ) - startAngle );
+            U32 beamIdx = (U32)( angle/stepAngle + 0.5f );
+            if ( bFullCircle && beamIdx >= numBeams )
+            {
+                beamIdx = 0;
+            }
+
+            if ( beamIdx < numBeams )
+            {
+                U32 pixelIdx = y*imageDim + x;
+                mPixelBinIdxs[ pixelIdx ] = (S32)( beamIdx*numBins + binIdx );
+                pixelBeamIdxs[ pixelIdx ] = (S32)beamIdx;
+                mBeamPixelStarts[ beamIdx + 1 ]++;
+            }
+        }
+    }
+
+    // Sort the pixels by beam
+    for ( U32 beamIdx = 0; beamIdx < numBeams; beamIdx++ )
+    {
+        mBeamPixelStarts[ beamIdx + 1 ] += mBeamPixelStarts[ beamIdx ];
+    }
+
+    mBeamPixelIdxs.resize( mBeamPixelStarts[ numBeams ] );
+    std::vector<U32> beamFillIdxs( mBeamPixelStarts.begin(), mBeamPixelStarts.end() - 1 );
+    for ( U32 pixelIdx = 0; pixelIdx < pixelBeamIdxs.size(); pixelIdx++ )
+    {
+        S32 beamIdx = pixelBeamIdxs[ pixelIdx ];
+        if ( beamIdx >= 0 )
+        {
+            mBeamPixelIdxs[ beamFillIdxs[ beamIdx ]++ ] = pixelIdx;
+        }
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void PolarImageRasteriser::Rasterise( const U8* pBins, U8* pImageOut ) const
+{
+    Rasterise( pBins, pImageOut, PixelFormatConversion::GetBestInstructionSet() );
+}
+
+//------------------------------------------------------------------------------
+void PolarImageRasteriser::Rasterise( const U8* pBins, U8* pImageOut,
+    PixelFormatConversion::eInstructionSet instructionSet ) const
+{
+    if ( mPixelBinIdxs.empty() )
+    {
+        return;
+    }
+
+#ifdef POLAR_IMAGE_RASTERISER_X86
+    if ( instructionSet >= PixelFormatConversion::eIS_AVX2
+        && PixelFormatConversion::IsInstructionSetSupported( PixelFormatConversion::eIS_AVX2 ) )
+    {
+        RasteriseRow_AVX2( pBins, &mPixelBinIdxs[ 0 ], pImageOut, mPixelBinIdxs.size() );
+        return;
+    }
+#endif
+
+    // There's no gather before AVX2 so everything else uses the plain version
+    RasteriseRow_Scalar( pBins, &mPixelBinIdxs[ 0 ], pImageOut, mPixelBinIdxs.size() );
+}
+
+//------------------------------------------------------------------------------
+void PolarImageRasteriser::RasteriseBeams( const U8* pBins, U32 firstBeamIdx, U32 endBeamIdx,
+                                           U8* pImageInOut ) const
+{
+    if ( endBeamIdx > mNumBeams )
+    {
+        endBeamIdx = mNumBeams;
+    }
+    if ( firstBeamIdx >= endBeamIdx )
+    {
+        return;
+    }
+
+    U32 endIdx = mBeamPixelStarts[ endBeamIdx ];
+    for ( U32 idx = mBeamPixelStarts[ firstBeamIdx ]; idx < endIdx; idx++ )
+    {
+        U32 pixelIdx = mBeamPixelIdxs[ idx ];
+        pImageInOut[ pixelIdx ] = pBins[ mPixelBinIdxs[ pixelIdx ] ];
+    }
+}
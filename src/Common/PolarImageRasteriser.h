@@ -0,0 +1,77 @@
+//------------------------------------------------------------------------------
+// File: PolarImageRasteriser.h
+// Desc: Draws polar data, such as the beams of a scanning sonar, into a
+//       square MONO8 image. The pixel that each (beam, bin) pair lands on is
+//       worked out once when the geometry is set, after which drawing the
+//       image is just a pass through a lookup table.
+//
+//       The image has one pixel per bin, with the centre of the polar data
+//       in the middle of the image and angle 0 pointing straight up. Angles
+//       go anticlockwise. Bins are stored one beam after another.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef POLAR_IMAGE_RASTERISER_H
+#define POLAR_IMAGE_RASTERISER_H
+
+//------------------------------------------------------------------------------
+#include <vector>
+#include "Common.h"
+#include "Common/PixelFormatConversion.h"
+
+//------------------------------------------------------------------------------
+class PolarImageRasteriser
+{
+    //--------------------------------------------------------------------------
+    //! The vectorised routines read a few bytes past the end of the bins, so
+    //! bin buffers must have this many bytes of padding after the last bin
+    public: static const U32 BIN_PADDING = 4;
+
+    //--------------------------------------------------------------------------
+    public: PolarImageRasteriser();
+
+    //--------------------------------------------------------------------------
+    //! Builds the lookup tables for beams that start at startAngle and step
+    //! anticlockwise by stepAngle (both in radians). Each pixel takes the
+    //! value of the nearest beam, and pixels that aren't within half a step
+    //! of a beam are left at 0. Does nothing if the geometry hasn't changed.
+    //! Returns true if the tables were rebuilt
+    public: bool SetGeometry( U32 numBins, U32 numBeams, F32 startAngle, F32 stepAngle );
+
+    //--------------------------------------------------------------------------
+    public: U32 GetNumBins() const { return mNumBins; }
+    public: U32 GetNumBeams() const { return mNumBeams; }
+    public: U32 GetImageWidth() const { return 2*mNumBins; }
+    public: U32 GetImageHeight() const { return 2*mNumBins; }
+    public: U32 GetImageSize() const { return 4*mNumBins*mNumBins; }
+
+    //--------------------------------------------------------------------------
+    //! Draws the whole image. Pixels that aren't covered by a beam are set
+    //! to 0
+    public: void Rasterise( const U8* pBins, U8* pImageOut ) const;
+    public: void Rasterise( const U8* pBins, U8* pImageOut,
+                            PixelFormatConversion::eInstructionSet instructionSet ) const;
+
+    //--------------------------------------------------------------------------
+    //! Redraws the pixels of the beams in the range [firstBeamIdx, endBeamIdx)
+    //! and leaves the rest of the image alone
+    public: void RasteriseBeams( const U8* pBins, U32 firstBeamIdx, U32 endBeamIdx,
+                                 U8* pImageInOut ) const;
+
+    //--------------------------------------------------------------------------
+    // Members
+    private: U32 mNumBins;
+    private: U32 mNumBeams;
+    private: F32 mStartAngle;
+    private: F32 mStepAngle;
+
+    // The bin index of each pixel, or -1 for pixels not covered by a beam
+    private: std::vector<S32> mPixelBinIdxs;
+
+    // The pixels covered by each beam. The pixels of beam i are the entries
+    // from mBeamPixelStarts[ i ] to mBeamPixelStarts[ i + 1 ]
+    private: std::vector<U32> mBeamPixelStarts;
+    private: std::vector<U32> mBeamPixelIdxs;
+};
+
+#endif // POLAR_IMAGE_RASTERISER_H
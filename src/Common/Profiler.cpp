@@ -0,0 +1,344 @@
+//------------------------------------------------------------------------------
+// File: Profiler.cpp
+// Desc: A lightweight scoped timer for finding out where the time in a frame
+//       goes.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+static const U32 PROF_MAX_THREAD_NAME_LENGTH = 31;
+static const char* PROF_FOLDED_EXTENSION = ".folded";
+
+//------------------------------------------------------------------------------
+struct ProfileEvent
+{
+    const char* mpName;
+    double mStartTimeUS;
+    double mEndTimeUS;
+};
+
+//------------------------------------------------------------------------------
+// Each thread writes to its own buffer so that recording an event never has
+// to wait. Buffers live for as long as the process so that a thread never
+// writes to a buffer that has been freed. They're kept in a linked list
+// rather than a container so that nothing frees them when the process exits
+struct ThreadBuffer
+{
+    U32 mThreadIdx;
+    char mName[ PROF_MAX_THREAD_NAME_LENGTH + 1 ];
+    U32 mRunIdx;                // The run that the events belong to
+    std::vector<ProfileEvent> mEvents;
+    volatile U32 mNumEventsWritten;
+    ThreadBuffer* mpNext;
+};
+
+//------------------------------------------------------------------------------
+volatile bool Profiler::mbEnabled = false;
+
+static pthread_mutex_t gThreadBuffersMutex = PTHREAD_MUTEX_INITIALIZER;
+static ThreadBuffer* gpFirstThreadBuffer = NULL;
+static U32 gNumThreadBuffers = 0;
+static __thread ThreadBuffer* gpThreadBuffer = NULL;
+
+// Settings for the current run. These only change whilst profiling is off
+static volatile U32 gRunIdx = 0;
+static U32 gMaxEventsPerThread = Profiler::DEFAULT_MAX_EVENTS_PER_THREAD;
+static double gStartTimeUS = 0.0;
+static std::string gFilename;
+
+//------------------------------------------------------------------------------
+static ThreadBuffer* GetThreadBuffer()
+{
+    if ( NULL == gpThreadBuffer )
+    {
+        ThreadBuffer* pBuffer = new ThreadBuffer();
+        pBuffer->mRunIdx = 0;
+        pBuffer->mNumEventsWritten = 0;
+
+        pthread_mutex_lock( &gThreadBuffersMutex );
+        pBuffer->mThreadIdx = gNumThreadBuffers++;
+        snprintf( pBuffer->mName, sizeof( pBuffer->mName ), "Thread %u", pBuffer->mThreadIdx );
+        pBuffer->mpNext = gpFirstThreadBuffer;
+        gpFirstThreadBuffer = pBuffer;
+        pthread_mutex_unlock( &gThreadBuffersMutex );
+
+        gpThreadBuffer = pBuffer;
+    }
+
+    return gpThreadBuffer;
+}
+
+//------------------------------------------------------------------------------
+static bool HasExtension( const std::string& filename, const char* extension )
+{
+    size_t extensionLength = strlen( extension );
+    return ( filename.size() >= extensionLength
+        && 0 == filename.compare( filename.size() - extensionLength, extensionLength, extension ) );
+}
+
+//------------------------------------------------------------------------------
+// Orders events so that a scope comes before the scopes nested inside it
+static bool IsEarlierEvent( const ProfileEvent& a, const ProfileEvent& b )
+{
+    if ( a.mStartTimeUS != b.mStartTimeUS )
+    {
+        return a.mStartTimeUS < b.mStartTimeUS;
+    }
+    return a.mEndTimeUS > b.mEndTimeUS;
+}
+
+//------------------------------------------------------------------------------
+static void WriteJSONString( FILE* pFile, const char* pString )
+{
+    fputc( '"', pFile );
+    for ( const char* pChar = pString; '\0' != *pChar; pChar++ )
+    {
+        if ( '"' == *pChar || '\\' == *pChar )
+        {
+            fputc( '\\', pFile );
+        }
+        fputc( *pChar, pFile );
+    }
+    fputc( '"', pFile );
+}
+
+//------------------------------------------------------------------------------
+static void WriteChromeTrace( FILE* pFile, const std::vector<ThreadBuffer*>& threadBuffers,
+                              const std::vector< std::vector<ProfileEvent> >& threadEvents )
+{
+    fprintf( pFile, "{\"traceEvents\":[\n" );
+
+    bool bFirstEvent = true;
+    for ( U32 threadIdx = 0; threadIdx < threadBuffers.size(); threadIdx++ )
+    {
+        const ThreadBuffer* pBuffer = threadBuffers[ threadIdx ];
+        fprintf( pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                 ( bFirstEvent ? "" : ",\n" ), pBuffer->mThreadIdx );
+        WriteJSONString( pFile, pBuffer->mName );
+        fprintf( pFile, "}}" );
+        bFirstEvent = false;
+
+        const std::vector<ProfileEvent>& events = threadEvents[ threadIdx ];
+        for ( U32 eventIdx = 0; eventIdx < events.size(); eventIdx++ )
+        {
+            const ProfileEvent& event = events[ eventIdx ];
+            fprintf( pFile, ",\n{\"name\":" );
+            WriteJSONString( pFile, event.mpName );
+            fprintf( pFile, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                     pBuffer->mThreadIdx, event.mStartTimeUS - gStartTimeUS,
+                     event.mEndTimeUS - event.mStartTimeUS );
+        }
+    }
+
+    fprintf( pFile, "\n],\"displayTimeUnit\":\"ms\"}\n" );
+}
+
+//------------------------------------------------------------------------------
+// Writes one line per call stack, giving the time spent in the innermost
+// scope of the stack but not in any scope nested inside it
+static void WriteFoldedStacks( FILE* pFile, const std::vector<ThreadBuffer*>& threadBuffers,
+                               std::vector< std::vector<ProfileEvent> >* pThreadEvents )
+{
+    std::map<std::string, double> selfTimes;
+
+    for ( U32 threadIdx = 0; threadIdx < threadBuffers.size(); threadIdx++ )
+    {
+        std::vector<ProfileEvent>& events = (*pThreadEvents)[ threadIdx ];
+        std::sort( events.begin(), events.end(), IsEarlierEvent );
+
+        std::vector<double> stackEndTimes;
+        std::vector<std::string> stackPaths;
+        for ( U32 eventIdx = 0; eventIdx < events.size(); eventIdx++ )
+        {
+            const ProfileEvent& event = events[ eventIdx ];
+            while ( !stackEndTimes.empty() && stackEndTimes.back() <= event.mStartTimeUS )
+            {
+                stackEndTimes.pop_back();
+                stackPaths.pop_back();
+            }
+
+            double duration = event.mEndTimeUS - event.mStartTimeUS;
+            std::string path = ( stackPaths.empty() ?
+                std::string( threadBuffers[ threadIdx ]->mName ) : stackPaths.back() );
+            if ( !stackPaths.empty() )
+            {
+                selfTimes[ stackPaths.back() ] -= duration;
+            }
+            path += ";";
+            path += event.mpName;
+            selfTimes[ path ] += duration;
+
+            stackEndTimes.push_back( event.mEndTimeUS );
+            stackPaths.push_back( path );
+        }
+    }
+
+    for ( std::map<std::string, double>::const_iterator timeIter = selfTimes.begin();
+        selfTimes.end() != timeIter; ++timeIter )
+    {
+        // Rounding can leave a parent with a tiny negative self time
+        U32 selfTimeUS = ( timeIter->second > 0.0 ? (U32)( timeIter->second + 0.5 ) : 0 );
+        if ( selfTimeUS > 0 )
+        {
+            fprintf( pFile, "%s %u\n", timeIter->first.c_str(), selfTimeUS );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool Profiler::Start( const char* filename, U32 maxEventsPerThread )
+{
+    if ( mbEnabled )
+    {
+        fprintf( stderr, "Error: The profiler is already running\n" );
+        return false;
+    }
+
+    if ( NULL == filename || 0 == maxEventsPerThread )
+    {
+        fprintf( stderr, "Error: The profiler needs a filename and room for some events\n" );
+        return false;
+    }
+
+    gFilename = filename;
+    gMaxEventsPerThread = maxEventsPerThread;
+    gStartTimeUS = GetTimeUS();
+
+    // Buffers left over from an earlier run are cleared by their threads
+    // when they next record an event
+    __sync_fetch_and_add( &gRunIdx, 1 );
+    mbEnabled = true;
+    __sync_synchronize();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool Profiler::Stop()
+{
+    if ( !mbEnabled )
+    {
+        return false;
+    }
+
+    mbEnabled = false;
+    __sync_synchronize();
+
+    // Buffers are added to the front of the list so the list is walked
+    // backwards to keep the threads in the order they first recorded
+    std::vector<ThreadBuffer*> threadBuffers;
+    pthread_mutex_lock( &gThreadBuffersMutex );
+    for ( ThreadBuffer* pBuffer = gpFirstThreadBuffer; NULL != pBuffer; pBuffer = pBuffer->mpNext )
+    {
+        threadBuffers.push_back( pBuffer );
+    }
+    pthread_mutex_unlock( &gThreadBuffersMutex );
+    std::reverse( threadBuffers.begin(), threadBuffers.end() );
+
+    // Copy out the events of this run. If a buffer has wrapped then its
+    // oldest slot is skipped as a scope that was open when profiling
+    // stopped may be writing over it
+    U32 runIdx = __sync_fetch_and_or( &gRunIdx, 0 );
+    std::vector< std::vector<ProfileEvent> > threadEvents( threadBuffers.size() );
+    for ( U32 threadIdx = 0; threadIdx < threadBuffers.size(); threadIdx++ )
+    {
+        ThreadBuffer* pBuffer = threadBuffers[ threadIdx ];
+        if ( __sync_fetch_and_or( &pBuffer->mRunIdx, 0 ) != runIdx )
+        {
+            continue;
+        }
+
+        U32 numEventsWritten = __sync_fetch_and_or( &pBuffer->mNumEventsWritten, 0 );
+        U32 maxNumEvents = pBuffer->mEvents.size();
+        U32 firstEventIdx = 0;
+        if ( numEventsWritten >= maxNumEvents )
+        {
+            firstEventIdx = numEventsWritten - maxNumEvents + 1;
+        }
+
+        std::vector<ProfileEvent>& events = threadEvents[ threadIdx ];
+        events.reserve( numEventsWritten - firstEventIdx );
+        for ( U32 eventIdx = firstEventIdx; eventIdx < numEventsWritten; eventIdx++ )
+        {
+            events.push_back( pBuffer->mEvents[ eventIdx % maxNumEvents ] );
+        }
+    }
+
+    FILE* pFile = fopen( gFilename.c_str(), "w" );
+    if ( NULL == pFile )
+    {
+        fprintf( stderr, "Error: Unable to open %s to write the profile\n", gFilename.c_str() );
+        return false;
+    }
+
+    if ( HasExtension( gFilename, PROF_FOLDED_EXTENSION ) )
+    {
+        WriteFoldedStacks( pFile, threadBuffers, &threadEvents );
+    }
+    else
+    {
+        WriteChromeTrace( pFile, threadBuffers, threadEvents );
+    }
+
+    bool bSucceeded = ( 0 == ferror( pFile ) );
+    fclose( pFile );
+    if ( !bSucceeded )
+    {
+        fprintf( stderr, "Error: Unable to write the profile to %s\n", gFilename.c_str() );
+    }
+
+    return bSucceeded;
+}
+
+//------------------------------------------------------------------------------
+void Profiler::SetThreadName( const char* name )
+{
+    ThreadBuffer* pBuffer = GetThreadBuffer();
+    strncpy( pBuffer->mName, name, PROF_MAX_THREAD_NAME_LENGTH );
+    pBuffer->mName[ PROF_MAX_THREAD_NAME_LENGTH ] = '\0';
+}
+
+//------------------------------------------------------------------------------
+double Profiler::GetTimeUS()
+{
+    // The monotonic clock is used so that the timings aren't upset if the
+    // system clock is changed
+    timespec timeSpec;
+    clock_gettime( CLOCK_MONOTONIC, &timeSpec );
+    return (double)timeSpec.tv_sec*1e6 + (double)timeSpec.tv_nsec/1e3;
+}
+
+//------------------------------------------------------------------------------
+void Profiler::RecordEvent( const char* pName, double startTimeUS, double endTimeUS )
+{
+    ThreadBuffer* pBuffer = GetThreadBuffer();
+
+    U32 runIdx = __sync_fetch_and_or( &gRunIdx, 0 );
+    if ( pBuffer->mRunIdx != runIdx )
+    {
+        // First event of a new run on this thread
+        pBuffer->mEvents.resize( gMaxEventsPerThread );
+        pBuffer->mNumEventsWritten = 0;
+        __sync_lock_test_and_set( &pBuffer->mRunIdx, runIdx );
+    }
+
+    ProfileEvent& event = pBuffer->mEvents[ pBuffer->mNumEventsWritten % pBuffer->mEvents.size() ];
+    event.mpName = pName;
+    event.mStartTimeUS = startTimeUS;
+    event.mEndTimeUS = endTimeUS;
+
+    // The event is written before the count goes up so that Stop never
+    // reads a half written event
+    __sync_fetch_and_add( &pBuffer->mNumEventsWritten, 1 );
+}
@@ -0,0 +1,93 @@
+//------------------------------------------------------------------------------
+// File: Profiler.h
+// Desc: A lightweight scoped timer for finding out where the time in a frame
+//       goes. Wrap a block in PROFILE_SCOPE( "Name" ) and, whilst profiling is
+//       running, the time spent in the block is written to a ring buffer
+//       belonging to the calling thread. No locks are taken when timing a
+//       scope, and when profiling isn't running a scope costs a single test.
+//
+//       When profiling stops the events are written out as Chrome trace JSON
+//       (load it with chrome://tracing) or, if the filename ends in .folded,
+//       as collapsed stacks of self time in microseconds that can be fed to
+//       flamegraph.pl.
+//
+//       Names must be string literals, or at least outlive the profiler, as
+//       only the pointer is stored. The profiler is shared by the whole
+//       process, events from different threads are kept apart by thread.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef PROFILER_H
+#define PROFILER_H
+
+//------------------------------------------------------------------------------
+#include "Common.h"
+
+//------------------------------------------------------------------------------
+class Profiler
+{
+    //--------------------------------------------------------------------------
+    //! Starts recording events, clearing any from a previous run. The events
+    //! are written to filename when Stop is called. Each thread keeps its
+    //! most recent maxEventsPerThread events
+    public: static bool Start( const char* filename,
+                               U32 maxEventsPerThread = DEFAULT_MAX_EVENTS_PER_THREAD );
+
+    //--------------------------------------------------------------------------
+    //! Stops recording and writes out the events. Events from scopes that are
+    //! still open on other threads when this is called may be lost
+    public: static bool Stop();
+
+    //--------------------------------------------------------------------------
+    public: static bool IsEnabled() { return mbEnabled; }
+
+    //--------------------------------------------------------------------------
+    //! Gives the calling thread a name to show in the output. The name is
+    //! copied
+    public: static void SetThreadName( const char* name );
+
+    //--------------------------------------------------------------------------
+    //! Used by ProfileScope. Times are in microseconds from an arbitrary
+    //! starting point
+    public: static double GetTimeUS();
+    public: static void RecordEvent( const char* pName, double startTimeUS, double endTimeUS );
+
+    public: static const U32 DEFAULT_MAX_EVENTS_PER_THREAD = 65536;
+
+    private: static volatile bool mbEnabled;
+};
+
+//------------------------------------------------------------------------------
+class ProfileScope
+{
+    public: explicit ProfileScope( const char* pName )
+        : mpName( pName ),
+        mbActive( Profiler::IsEnabled() ),
+        mStartTimeUS( 0.0 )
+    {
+        if ( mbActive )
+        {
+            mStartTimeUS = Profiler::GetTimeUS();
+        }
+    }
+
+    public: ~ProfileScope()
+    {
+        if ( mbActive )
+        {
+            Profiler::RecordEvent( mpName, mStartTimeUS, Profiler::GetTimeUS() );
+        }
+    }
+
+    private: const char* mpName;
+    private: bool mbActive;
+    private: double mStartTimeUS;
+};
+
+//------------------------------------------------------------------------------
+#define PROFILE_SCOPE_CONCAT_INNER( a, b ) a##b
+#define PROFILE_SCOPE_CONCAT( a, b ) PROFILE_SCOPE_CONCAT_INNER( a, b )
+#define PROFILE_SCOPE( name ) \
+    ProfileScope PROFILE_SCOPE_CONCAT( profileScope_, __LINE__ )( name )
+
+#endif // PROFILER_H
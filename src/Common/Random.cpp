@@ -0,0 +1,48 @@
+//------------------------------------------------------------------------------
+// File: Random.cpp
+// Desc: A small, fast pseudo random number generator (xorshift32) that can
+//       be seeded and so gives the same sequence every time for a given seed.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "Random.h"
+
+//------------------------------------------------------------------------------
+Random::Random( U32 seed )
+{
+    SetSeed( seed );
+}
+
+//------------------------------------------------------------------------------
+void Random::SetSeed( U32 seed )
+{
+    mSeed = seed;
+
+    // Scramble the seed so that similar seeds give different sequences. 
+    // This is the finaliser from MurmurHash3
+    U32 state = seed;
+    state ^= state >> 16;
+    state *= 0x85ebca6bu;
+    state ^= state >> 13;
+    state *= 0xc2b2ae35u;
+    state ^= state >> 16;
+
+    // xorshift gets stuck at 0
+    mState = ( 0 != state ? state : 0x6d2b79f5u );
+}
+
+//------------------------------------------------------------------------------
+U32 Random::NextU32()
+{
+    mState ^= mState << 13;
+    mState ^= mState >> 17;
+    mState ^= mState << 5;
+    return mState;
+}
+
+//------------------------------------------------------------------------------
+F32 Random::NextF32()
+{
+    // Use the top 24 bits as that's all a float can hold exactly
+    return (F32)( NextU32() >> 8 )*( 1.0f/16777216.0f );
+}
@@ -0,0 +1,42 @@
+//------------------------------------------------------------------------------
+// File: Random.h
+// Desc: A small, fast pseudo random number generator (xorshift32) that can
+//       be seeded and so gives the same sequence every time for a given seed.
+//       Each user keeps its own generator so that the sequence one sensor 
+//       sees doesn't depend on what any other part of the simulator is doing.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef RANDOM_H
+#define RANDOM_H
+
+//------------------------------------------------------------------------------
+#include "Common.h"
+
+//------------------------------------------------------------------------------
+class Random
+{
+    //--------------------------------------------------------------------------
+    public: Random( U32 seed = 1 );
+
+    //--------------------------------------------------------------------------
+    //! Restarts the sequence. Any seed can be used, including 0, and seeds
+    //! that are close together still give unrelated sequences
+    public: void SetSeed( U32 seed );
+    public: U32 GetSeed() const { return mSeed; }
+
+    //--------------------------------------------------------------------------
+    //! Returns a number from the full range of a U32
+    public: U32 NextU32();
+
+    //--------------------------------------------------------------------------
+    //! Returns a number in the range [0, 1)
+    public: F32 NextF32();
+
+    //--------------------------------------------------------------------------
+    // Members
+    private: U32 mSeed;
+    private: U32 mState;
+};
+
+#endif // RANDOM_H
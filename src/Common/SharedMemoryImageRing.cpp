@@ -0,0 +1,297 @@
+//------------------------------------------------------------------------------
+// File: SharedMemoryImageRing.cpp
+// Desc: A ring of image slots held in POSIX shared memory so that images can
+//       be passed to processes on the same machine without copying them
+//       through a socket. The writer fills in a slot and then hands out a
+//       small descriptor which readers use to find the image.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "SharedMemoryImageRing.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//------------------------------------------------------------------------------
+// Slots are aligned to cache lines so that the image data is nicely aligned
+// for the pixel conversion routines
+static const U32 SMIR_SLOT_ALIGNMENT = 64;
+
+//------------------------------------------------------------------------------
+static U32 AlignSize( U32 size )
+{
+    return ( size + SMIR_SLOT_ALIGNMENT - 1 ) & ~( SMIR_SLOT_ALIGNMENT - 1 );
+}
+
+//------------------------------------------------------------------------------
+SharedMemoryImageRing::SharedMemoryImageRing()
+    : mpMemory( NULL ),
+    mMemorySize( 0 ),
+    mbIsWriter( false ),
+    mNextFrameIdx( 0 )
+{
+    mName[ 0 ] = '\0';
+}
+
+//------------------------------------------------------------------------------
+SharedMemoryImageRing::~SharedMemoryImageRing()
+{
+    Close();
+}
+
+//------------------------------------------------------------------------------
+bool SharedMemoryImageRing::Create( const char* name, U32 numSlots, U32 slotDataSize )
+{
+    Close();
+
+    if ( strlen( name ) >= SHARED_MEMORY_IMAGE_RING_MAX_NAME_LENGTH || 0 == numSlots )
+    {
+        fprintf( stderr, "Error: Invalid shared memory image ring %s\n", name );
+        return false;
+    }
+
+    U32 headerSize = AlignSize( sizeof( SharedMemoryImageRingHeader ) );
+    U32 slotStride = AlignSize( sizeof( SharedMemoryImageSlotHeader ) ) + AlignSize( slotDataSize );
+    U32 memorySize = headerSize + numSlots*slotStride;
+
+    // Start from scratch in case a previous run didn't clean up
+    shm_unlink( name );
+    S32 fd = shm_open( name, O_RDWR | O_CREAT | O_EXCL, 0644 );
+    if ( fd < 0 )
+    {
+        fprintf( stderr, "Error: Unable to create shared memory %s\n", name );
+        return false;
+    }
+
+    if ( ftruncate( fd, memorySize ) != 0 )
+    {
+        fprintf( stderr, "Error: Unable to size shared memory %s\n", name );
+        close( fd );
+        shm_unlink( name );
+        return false;
+    }
+
+    void* pMemory = mmap( NULL, memorySize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( MAP_FAILED == pMemory )
+    {
+        fprintf( stderr, "Error: Unable to map shared memory %s\n", name );
+        shm_unlink( name );
+        return false;
+    }
+
+    mpMemory = (U8*)pMemory;
+    mMemorySize = memorySize;
+    mbIsWriter = true;
+    mNextFrameIdx = 0;
+    strcpy( mName, name );
+
+    // The memory from ftruncate is zeroed so all the slots start out empty
+    SharedMemoryImageRingHeader* pHeader = (SharedMemoryImageRingHeader*)mpMemory;
+    pHeader->mVersion = SHARED_MEMORY_IMAGE_RING_VERSION;
+    pHeader->mNumSlots = numSlots;
+    pHeader->mSlotDataSize = slotDataSize;
+    pHeader->mSlotStride = slotStride;
+    pHeader->mHeaderSize = headerSize;
+
+    // Readers check the magic number last
+    __sync_synchronize();
+    pHeader->mMagic = SHARED_MEMORY_IMAGE_RING_MAGIC;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool SharedMemoryImageRing::Open( const char* name )
+{
+    Close();
+
+    if ( strlen( name ) >= SHARED_MEMORY_IMAGE_RING_MAX_NAME_LENGTH )
+    {
+        return false;
+    }
+
+    S32 fd = shm_open( name, O_RDONLY, 0 );
+    if ( fd < 0 )
+    {
+        fprintf( stderr, "Error: Unable to open shared memory %s\n", name );
+        return false;
+    }
+
+    struct stat fileStats;
+    if ( fstat( fd, &fileStats ) != 0
+        || (U32)fileStats.st_size < sizeof( SharedMemoryImageRingHeader ) )
+    {
+        fprintf( stderr, "Error: Shared memory %s is too small\n", name );
+        close( fd );
+        return false;
+    }
+
+    U32 memorySize = (U32)fileStats.st_size;
+    void* pMemory = mmap( NULL, memorySize, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( MAP_FAILED == pMemory )
+    {
+        fprintf( stderr, "Error: Unable to map shared memory %s\n", name );
+        return false;
+    }
+
+    const SharedMemoryImageRingHeader* pHeader = (const SharedMemoryImageRingHeader*)pMemory;
+    if ( SHARED_MEMORY_IMAGE_RING_MAGIC != pHeader->mMagic
+        || SHARED_MEMORY_IMAGE_RING_VERSION != pHeader->mVersion
+        || pHeader->mHeaderSize + pHeader->mNumSlots*pHeader->mSlotStride > memorySize )
+    {
+        fprintf( stderr, "Error: Shared memory %s is not a valid image ring\n", name );
+        munmap( pMemory, memorySize );
+        return false;
+    }
+
+    mpMemory = (U8*)pMemory;
+    mMemorySize = memorySize;
+    mbIsWriter = false;
+    strcpy( mName, name );
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void SharedMemoryImageRing::Close()
+{
+    if ( NULL != mpMemory )
+    {
+        munmap( mpMemory, mMemorySize );
+        if ( mbIsWriter )
+        {
+            shm_unlink( mName );
+        }
+
+        mpMemory = NULL;
+        mMemorySize = 0;
+        mbIsWriter = false;
+        mName[ 0 ] = '\0';
+    }
+}
+
+//------------------------------------------------------------------------------
+U32 SharedMemoryImageRing::GetNumSlots() const
+{
+    return ( NULL == mpMemory ? 0 : ((SharedMemoryImageRingHeader*)mpMemory)->mNumSlots );
+}
+
+//------------------------------------------------------------------------------
+U32 SharedMemoryImageRing::GetSlotDataSize() const
+{
+    return ( NULL == mpMemory ? 0 : ((SharedMemoryImageRingHeader*)mpMemory)->mSlotDataSize );
+}
+
+//------------------------------------------------------------------------------
+SharedMemoryImageSlotHeader* SharedMemoryImageRing::GetSlotHeader( U32 slotIdx ) const
+{
+    const SharedMemoryImageRingHeader* pHeader = (const SharedMemoryImageRingHeader*)mpMemory;
+    return (SharedMemoryImageSlotHeader*)( mpMemory + pHeader->mHeaderSize
+        + slotIdx*pHeader->mSlotStride );
+}
+
+//------------------------------------------------------------------------------
+U8* SharedMemoryImageRing::BeginWrite()
+{
+    if ( NULL == mpMemory || !mbIsWriter )
+    {
+        return NULL;
+    }
+
+    SharedMemoryImageSlotHeader* pSlotHeader = GetSlotHeader( mNextFrameIdx % GetNumSlots() );
+
+    // Mark the slot as being written before touching the data
+    pSlotHeader->mSequence++;
+    __sync_synchronize();
+
+    return (U8*)pSlotHeader + AlignSize( sizeof( SharedMemoryImageSlotHeader ) );
+}
+
+//------------------------------------------------------------------------------
+void SharedMemoryImageRing::EndWrite( U32 width, U32 height, U32 format, U32 dataSize,
+    double timestamp, SharedMemoryImageDescriptor* pDescriptorOut )
+{
+    if ( NULL == mpMemory || !mbIsWriter )
+    {
+        return;
+    }
+
+    U32 slotIdx = mNextFrameIdx % GetNumSlots();
+    SharedMemoryImageSlotHeader* pSlotHeader = GetSlotHeader( slotIdx );
+    pSlotHeader->mFrameIdx = mNextFrameIdx;
+    pSlotHeader->mWidth = width;
+    pSlotHeader->mHeight = height;
+    pSlotHeader->mFormat = format;
+    pSlotHeader->mDataSize = dataSize;
+    pSlotHeader->mTimestamp = timestamp;
+
+    // Make sure that everything is visible before the slot is marked as done
+    __sync_synchronize();
+    pSlotHeader->mSequence++;
+
+    if ( NULL != pDescriptorOut )
+    {
+        pDescriptorOut->mMagic = SHARED_MEMORY_IMAGE_RING_MAGIC;
+        pDescriptorOut->mFrameIdx = mNextFrameIdx;
+        pDescriptorOut->mSlotIdx = slotIdx;
+        pDescriptorOut->mSlotSequence = pSlotHeader->mSequence;
+        pDescriptorOut->mWidth = width;
+        pDescriptorOut->mHeight = height;
+        pDescriptorOut->mFormat = format;
+        pDescriptorOut->mDataSize = dataSize;
+        pDescriptorOut->mTimestamp = timestamp;
+        memset( pDescriptorOut->mRingName, 0, sizeof( pDescriptorOut->mRingName ) );
+        strcpy( pDescriptorOut->mRingName, mName );
+    }
+
+    mNextFrameIdx++;
+}
+
+//------------------------------------------------------------------------------
+bool SharedMemoryImageRing::IsDescriptorValid( const SharedMemoryImageDescriptor& descriptor ) const
+{
+    if ( NULL == mpMemory
+        || SHARED_MEMORY_IMAGE_RING_MAGIC != descriptor.mMagic
+        || descriptor.mSlotIdx >= GetNumSlots()
+        || descriptor.mDataSize > GetSlotDataSize() )
+    {
+        return false;
+    }
+
+    __sync_synchronize();
+    return ( GetSlotHeader( descriptor.mSlotIdx )->mSequence == descriptor.mSlotSequence );
+}
+
+//------------------------------------------------------------------------------
+const U8* SharedMemoryImageRing::GetImageData( const SharedMemoryImageDescriptor& descriptor ) const
+{
+    if ( !IsDescriptorValid( descriptor ) )
+    {
+        return NULL;
+    }
+
+    return (const U8*)GetSlotHeader( descriptor.mSlotIdx )
+        + AlignSize( sizeof( SharedMemoryImageSlotHeader ) );
+}
+
+//------------------------------------------------------------------------------
+bool SharedMemoryImageRing::CopyImage( const SharedMemoryImageDescriptor& descriptor,
+                                       U8* pBufferOut, U32 bufferSize ) const
+{
+    const U8* pImageData = GetImageData( descriptor );
+    if ( NULL == pImageData || bufferSize < descriptor.mDataSize )
+    {
+        return false;
+    }
+
+    memcpy( pBufferOut, pImageData, descriptor.mDataSize );
+
+    // Check that the writer didn't come back round whilst we were copying
+    return IsDescriptorValid( descriptor );
+}
@@ -0,0 +1,121 @@
+//------------------------------------------------------------------------------
+// File: SharedMemoryImageRing.h
+// Desc: A ring of image slots held in POSIX shared memory so that images can
+//       be passed to processes on the same machine without copying them
+//       through a socket. The writer fills in a slot and then hands out a
+//       small descriptor which readers use to find the image.
+//
+//       Each slot is guarded by a sequence count which is odd whilst the slot
+//       is being written. A reader checks that the count matches the one in
+//       the descriptor before and after using the image data, and if it
+//       doesn't then the slot has been reused and the data should be thrown
+//       away. Readers that work on the image in place have NUM_SLOTS - 1
+//       frames in which to finish before the slot is reused.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef SHARED_MEMORY_IMAGE_RING_H
+#define SHARED_MEMORY_IMAGE_RING_H
+
+//------------------------------------------------------------------------------
+#include "Common.h"
+
+//------------------------------------------------------------------------------
+// Layout of the shared memory. The ring header is followed by the slots,
+// each of which is a slot header followed by SlotDataSize bytes of image
+const U32 SHARED_MEMORY_IMAGE_RING_MAGIC = 0x53534952;     // 'SSIR'
+const U32 SHARED_MEMORY_IMAGE_RING_VERSION = 1;
+const U32 SHARED_MEMORY_IMAGE_RING_MAX_NAME_LENGTH = 64;
+
+struct SharedMemoryImageRingHeader
+{
+    U32 mMagic;
+    U32 mVersion;
+    U32 mNumSlots;
+    U32 mSlotDataSize;
+    U32 mSlotStride;        // Bytes from the start of one slot to the next
+    U32 mHeaderSize;        // Bytes from the start of the memory to slot 0
+};
+
+struct SharedMemoryImageSlotHeader
+{
+    volatile U32 mSequence; // Odd whilst the slot is being written
+    U32 mFrameIdx;
+    U32 mWidth;
+    U32 mHeight;
+    U32 mFormat;
+    U32 mDataSize;
+    double mTimestamp;
+};
+
+//------------------------------------------------------------------------------
+// The message that is passed to readers to tell them about a new image
+struct SharedMemoryImageDescriptor
+{
+    U32 mMagic;
+    U32 mFrameIdx;
+    U32 mSlotIdx;
+    U32 mSlotSequence;
+    U32 mWidth;
+    U32 mHeight;
+    U32 mFormat;
+    U32 mDataSize;
+    double mTimestamp;
+    char mRingName[ SHARED_MEMORY_IMAGE_RING_MAX_NAME_LENGTH ];
+};
+
+//------------------------------------------------------------------------------
+class SharedMemoryImageRing
+{
+    //--------------------------------------------------------------------------
+    public: SharedMemoryImageRing();
+    public: ~SharedMemoryImageRing();
+
+    //--------------------------------------------------------------------------
+    //! Creates the shared memory as the writer. The name should start with a
+    //! '/', e.g. "/subsim_camera". Any existing ring of the same name is
+    //! replaced. The shared memory is removed again when the ring is closed
+    public: bool Create( const char* name, U32 numSlots, U32 slotDataSize );
+
+    //--------------------------------------------------------------------------
+    //! Opens an existing ring as a reader
+    public: bool Open( const char* name );
+    public: void Close();
+
+    //--------------------------------------------------------------------------
+    public: bool IsOpen() const { return NULL != mpMemory; }
+    public: U32 GetNumSlots() const;
+    public: U32 GetSlotDataSize() const;
+
+    //--------------------------------------------------------------------------
+    // Writer interface. BeginWrite returns a pointer to the image data of the
+    // next slot, which must then be filled in before calling EndWrite. The
+    // descriptor for the new image is filled in by EndWrite
+    public: U8* BeginWrite();
+    public: void EndWrite( U32 width, U32 height, U32 format, U32 dataSize,
+                           double timestamp, SharedMemoryImageDescriptor* pDescriptorOut );
+
+    //--------------------------------------------------------------------------
+    // Reader interface. GetImageData returns a pointer to the image in
+    // shared memory, or NULL if the descriptor is no longer valid.
+    // IsDescriptorValid should be called once the data has been used to
+    // check that it wasn't overwritten in the meantime. CopyImage does both
+    // and returns false if the image couldn't be copied
+    public: const U8* GetImageData( const SharedMemoryImageDescriptor& descriptor ) const;
+    public: bool IsDescriptorValid( const SharedMemoryImageDescriptor& descriptor ) const;
+    public: bool CopyImage( const SharedMemoryImageDescriptor& descriptor,
+                            U8* pBufferOut, U32 bufferSize ) const;
+
+    //--------------------------------------------------------------------------
+    private: SharedMemoryImageSlotHeader* GetSlotHeader( U32 slotIdx ) const;
+
+    //--------------------------------------------------------------------------
+    // Members
+    private: U8* mpMemory;
+    private: U32 mMemorySize;
+    private: bool mbIsWriter;
+    private: U32 mNextFrameIdx;
+    private: char mName[ SHARED_MEMORY_IMAGE_RING_MAX_NAME_LENGTH ];
+};
+
+#endif // SHARED_MEMORY_IMAGE_RING_H
@@ -0,0 +1,191 @@
+//------------------------------------------------------------------------------
+// File: SimulationRecorder.cpp
+// Desc: Records the inputs to a simulation run into an append only binary
+//       log so that the run can be replayed exactly.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "SimulationRecorder.h"
+
+#include <string.h>
+
+//------------------------------------------------------------------------------
+static const U32 SR_MAGIC = 0x4c525353;     // "SSRL"
+static const U32 SR_VERSION = 1;
+static const U32 SR_FNV_OFFSET_BASIS = 2166136261u;
+static const U32 SR_FNV_PRIME = 16777619u;
+
+//------------------------------------------------------------------------------
+// The log is a LogHeader followed by any number of messages, each of which
+// is a MessageHeader followed by mDataSize bytes of data
+struct LogHeader
+{
+    U32 mMagic;
+    U32 mVersion;
+    U32 mWorldHash;
+    U32 mRandomSeed;
+};
+
+struct MessageHeader
+{
+    U32 mFrameIdx;
+    U8 mType;
+    U8 mSubtype;
+    U16 mInterface;
+    U16 mIndex;
+    U16 mPadding;
+    U32 mDataSize;
+};
+
+//------------------------------------------------------------------------------
+SimulationRecorder::SimulationRecorder()
+    : mpFile( NULL ),
+    mWorldHash( 0 ),
+    mRandomSeed( 0 )
+{
+}
+
+//------------------------------------------------------------------------------
+SimulationRecorder::~SimulationRecorder()
+{
+    StopRecording();
+}
+
+//------------------------------------------------------------------------------
+bool SimulationRecorder::StartRecording( const char* filename, U32 worldHash, U32 randomSeed )
+{
+    StopRecording();
+
+    mpFile = fopen( filename, "wb" );
+    if ( NULL == mpFile )
+    {
+        fprintf( stderr, "Error: Unable to open %s for recording\n", filename );
+        return false;
+    }
+
+    LogHeader header;
+    header.mMagic = SR_MAGIC;
+    header.mVersion = SR_VERSION;
+    header.mWorldHash = worldHash;
+    header.mRandomSeed = randomSeed;
+    if ( 1 != fwrite( &header, sizeof( header ), 1, mpFile ) )
+    {
+        fprintf( stderr, "Error: Unable to write to %s\n", filename );
+        StopRecording();
+        return false;
+    }
+    fflush( mpFile );
+
+    mWorldHash = worldHash;
+    mRandomSeed = randomSeed;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void SimulationRecorder::StopRecording()
+{
+    if ( NULL != mpFile )
+    {
+        fclose( mpFile );
+        mpFile = NULL;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool SimulationRecorder::RecordMessage( U32 frameIdx, U8 type, U8 subtype, U16 interf,
+                                        U16 index, const void* pData, U32 dataSize )
+{
+    if ( NULL == mpFile )
+    {
+        return false;
+    }
+
+    MessageHeader messageHeader;
+    messageHeader.mFrameIdx = frameIdx;
+    messageHeader.mType = type;
+    messageHeader.mSubtype = subtype;
+    messageHeader.mInterface = interf;
+    messageHeader.mIndex = index;
+    messageHeader.mPadding = 0;
+    messageHeader.mDataSize = ( NULL != pData ? dataSize : 0 );
+
+    bool bWritten = ( 1 == fwrite( &messageHeader, sizeof( messageHeader ), 1, mpFile ) );
+    if ( bWritten && messageHeader.mDataSize > 0 )
+    {
+        bWritten = ( 1 == fwrite( pData, messageHeader.mDataSize, 1, mpFile ) );
+    }
+    fflush( mpFile );
+
+    if ( !bWritten )
+    {
+        fprintf( stderr, "Error: Unable to write to the recording, recording stopped\n" );
+        StopRecording();
+    }
+    return bWritten;
+}
+
+//------------------------------------------------------------------------------
+bool SimulationRecorder::LoadRecording( const char* filename )
+{
+    mMessages.clear();
+
+    FILE* pFile = fopen( filename, "rb" );
+    if ( NULL == pFile )
+    {
+        fprintf( stderr, "Error: Unable to open recording %s\n", filename );
+        return false;
+    }
+
+    LogHeader header;
+    if ( 1 != fread( &header, sizeof( header ), 1, pFile )
+        || SR_MAGIC != header.mMagic )
+    {
+        fprintf( stderr, "Error: %s is not a simulation recording\n", filename );
+        fclose( pFile );
+        return false;
+    }
+    if ( SR_VERSION != header.mVersion )
+    {
+        fprintf( stderr, "Error: %s was recorded with a different version\n", filename );
+        fclose( pFile );
+        return false;
+    }
+    mWorldHash = header.mWorldHash;
+    mRandomSeed = header.mRandomSeed;
+
+    MessageHeader messageHeader;
+    while ( 1 == fread( &messageHeader, sizeof( messageHeader ), 1, pFile ) )
+    {
+        RecordedMessage message;
+        message.mFrameIdx = messageHeader.mFrameIdx;
+        message.mType = messageHeader.mType;
+        message.mSubtype = messageHeader.mSubtype;
+        message.mInterface = messageHeader.mInterface;
+        message.mIndex = messageHeader.mIndex;
+        message.mData.resize( messageHeader.mDataSize );
+        if ( messageHeader.mDataSize > 0
+            && 1 != fread( &message.mData[ 0 ], messageHeader.mDataSize, 1, pFile ) )
+        {
+            fprintf( stderr, "Warning: %s ends part way through a message\n", filename );
+            break;
+        }
+
+        mMessages.push_back( message );
+    }
+
+    fclose( pFile );
+    return true;
+}
+
+//------------------------------------------------------------------------------
+U32 SimulationRecorder::HashData( const U8* pData, U32 dataSize )
+{
+    U32 hash = SR_FNV_OFFSET_BASIS;
+    for ( U32 byteIdx = 0; byteIdx < dataSize; byteIdx++ )
+    {
+        hash ^= (U32)pData[ byteIdx ];
+        hash *= SR_FNV_PRIME;
+    }
+
+    return hash;
+}
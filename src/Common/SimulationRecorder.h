@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+// File: SimulationRecorder.h
+// Desc: Records the inputs to a simulation run into an append only binary
+//       log so that the run can be replayed exactly. The log starts with a
+//       hash of the initial world state and the random seed used for the
+//       run, and then holds every recorded message along with the index of
+//       the simulation frame it arrived on.
+//
+//       Each message is written and flushed as soon as it's recorded, so a
+//       log is still usable if the simulator crashes part way through a run.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef SIMULATION_RECORDER_H
+#define SIMULATION_RECORDER_H
+
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <vector>
+#include "Common.h"
+
+//------------------------------------------------------------------------------
+struct RecordedMessage
+{
+    U32 mFrameIdx;
+    U8 mType;
+    U8 mSubtype;
+    U16 mInterface;
+    U16 mIndex;
+    std::vector<U8> mData;
+};
+
+//------------------------------------------------------------------------------
+class SimulationRecorder
+{
+    //--------------------------------------------------------------------------
+    public: SimulationRecorder();
+    public: ~SimulationRecorder();
+
+    //--------------------------------------------------------------------------
+    //! Creates a new log, overwriting any file that's already there
+    public: bool StartRecording( const char* filename, U32 worldHash, U32 randomSeed );
+    public: void StopRecording();
+    public: bool IsRecording() const { return NULL != mpFile; }
+
+    //--------------------------------------------------------------------------
+    //! Appends a message to the log. The data must not contain any pointers
+    public: bool RecordMessage( U32 frameIdx, U8 type, U8 subtype, U16 interf,
+                                U16 index, const void* pData, U32 dataSize );
+
+    //--------------------------------------------------------------------------
+    //! Reads in a whole log for replay. A log that was cut short by a crash
+    //! is loaded up to the last complete message
+    public: bool LoadRecording( const char* filename );
+    public: U32 GetWorldHash() const { return mWorldHash; }
+    public: U32 GetRandomSeed() const { return mRandomSeed; }
+    public: U32 GetNumMessages() const { return mMessages.size(); }
+    public: const RecordedMessage& GetMessage( U32 messageIdx ) const { return mMessages[ messageIdx ]; }
+
+    //--------------------------------------------------------------------------
+    //! FNV-1a hash used to check that a replay starts from the same world
+    public: static U32 HashData( const U8* pData, U32 dataSize );
+
+    //--------------------------------------------------------------------------
+    // Members
+    private: FILE* mpFile;
+    private: U32 mWorldHash;
+    private: U32 mRandomSeed;
+    private: std::vector<RecordedMessage> mMessages;
+};
+
+#endif // SIMULATION_RECORDER_H
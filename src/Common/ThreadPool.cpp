@@ -0,0 +1,208 @@
+//------------------------------------------------------------------------------
+// File: ThreadPool.cpp
+// Desc: A small pool of worker threads for splitting a loop over a number of
+//       independent items. The thread that calls ParallelFor works on the
+//       loop as well, and doesn't return until every item has been processed.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "ThreadPool.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+// Stops us from starting silly numbers of threads on big machines
+static const S32 TP_MAX_NUM_WORKER_THREADS = 15;
+
+//------------------------------------------------------------------------------
+ThreadPool::ThreadPool()
+    : mbInitialised( false ),
+    mbStopWorkers( false ),
+    mLoopIdx( 0 ),
+    mTaskFunction( NULL ),
+    mpUserData( NULL ),
+    mNumItems( 0 ),
+    mChunkSize( 1 ),
+    mNextItemIdx( 0 ),
+    mNumActiveWorkers( 0 )
+{
+    pthread_mutex_init( &mMutex, NULL );
+    pthread_cond_init( &mWorkCondition, NULL );
+    pthread_cond_init( &mDoneCondition, NULL );
+}
+
+//------------------------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+    DeInit();
+
+    pthread_cond_destroy( &mDoneCondition );
+    pthread_cond_destroy( &mWorkCondition );
+    pthread_mutex_destroy( &mMutex );
+}
+
+//------------------------------------------------------------------------------
+bool ThreadPool::Init( S32 numWorkerThreads )
+{
+    DeInit();
+
+    if ( numWorkerThreads < 0 )
+    {
+        numWorkerThreads = (S32)sysconf( _SC_NPROCESSORS_ONLN ) - 1;
+    }
+    if ( numWorkerThreads > TP_MAX_NUM_WORKER_THREADS )
+    {
+        numWorkerThreads = TP_MAX_NUM_WORKER_THREADS;
+    }
+
+    mbStopWorkers = false;
+    mNumActiveWorkers = 0;
+    mNumItems = 0;
+    mNextItemIdx = 0;
+
+    for ( S32 threadIdx = 0; threadIdx < numWorkerThreads; threadIdx++ )
+    {
+        pthread_t thread;
+        if ( 0 != pthread_create( &thread, NULL, WorkerThreadEntry, this ) )
+        {
+            fprintf( stderr, "Warning: Unable to create worker thread, "
+                "using %i worker threads\n", threadIdx );
+            break;
+        }
+        mWorkerThreads.push_back( thread );
+    }
+
+    mbInitialised = true;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void ThreadPool::DeInit()
+{
+    if ( mbInitialised )
+    {
+        pthread_mutex_lock( &mMutex );
+        mbStopWorkers = true;
+        pthread_cond_broadcast( &mWorkCondition );
+        pthread_mutex_unlock( &mMutex );
+
+        for ( U32 threadIdx = 0; threadIdx < mWorkerThreads.size(); threadIdx++ )
+        {
+            pthread_join( mWorkerThreads[ threadIdx ], NULL );
+        }
+        mWorkerThreads.clear();
+
+        mbInitialised = false;
+    }
+}
+
+//------------------------------------------------------------------------------
+void ThreadPool::ParallelFor( U32 numItems, TaskFunction taskFunction,
+                              void* pUserData, U32 chunkSize )
+{
+    if ( 0 == numItems )
+    {
+        return;
+    }
+    if ( 0 == chunkSize )
+    {
+        chunkSize = 1;
+    }
+
+    // Don't bother waking the workers if there's only one chunk
+    if ( mWorkerThreads.empty() || numItems <= chunkSize )
+    {
+        taskFunction( pUserData, 0, numItems );
+        return;
+    }
+
+    pthread_mutex_lock( &mMutex );
+    mTaskFunction = taskFunction;
+    mpUserData = pUserData;
+    mNumItems = numItems;
+    mChunkSize = chunkSize;
+    mNextItemIdx = 0;
+    mLoopIdx++;
+    pthread_cond_broadcast( &mWorkCondition );
+    pthread_mutex_unlock( &mMutex );
+
+    ProcessChunks( taskFunction, pUserData, numItems, chunkSize );
+
+    // Once all of the chunks have been handed out we just need to wait for
+    // the workers that are still busy with one
+    pthread_mutex_lock( &mMutex );
+    while ( mNumActiveWorkers > 0 )
+    {
+        pthread_cond_wait( &mDoneCondition, &mMutex );
+    }
+    mTaskFunction = NULL;
+    mpUserData = NULL;
+    mNumItems = 0;
+    pthread_mutex_unlock( &mMutex );
+}
+
+//------------------------------------------------------------------------------
+void* ThreadPool::WorkerThreadEntry( void* pThreadPool )
+{
+    ((ThreadPool*)pThreadPool)->WorkerThreadMain();
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+void ThreadPool::WorkerThreadMain()
+{
+    U32 lastLoopIdx = 0;
+
+    pthread_mutex_lock( &mMutex );
+    lastLoopIdx = mLoopIdx;
+
+    while ( !mbStopWorkers )
+    {
+        if ( lastLoopIdx == mLoopIdx )
+        {
+            pthread_cond_wait( &mWorkCondition, &mMutex );
+            continue;
+        }
+        lastLoopIdx = mLoopIdx;
+
+        // A worker that wakes up late may find that the loop has already
+        // finished, in which case there's nothing to do
+        if ( NULL == mTaskFunction )
+        {
+            continue;
+        }
+
+        TaskFunction taskFunction = mTaskFunction;
+        void* pUserData = mpUserData;
+        U32 numItems = mNumItems;
+        U32 chunkSize = mChunkSize;
+        mNumActiveWorkers++;
+        pthread_mutex_unlock( &mMutex );
+
+        ProcessChunks( taskFunction, pUserData, numItems, chunkSize );
+
+        pthread_mutex_lock( &mMutex );
+        mNumActiveWorkers--;
+        pthread_cond_signal( &mDoneCondition );
+    }
+
+    pthread_mutex_unlock( &mMutex );
+}
+
+//------------------------------------------------------------------------------
+void ThreadPool::ProcessChunks( TaskFunction taskFunction, void* pUserData,
+                                U32 numItems, U32 chunkSize )
+{
+    while ( true )
+    {
+        U32 startIdx = __sync_fetch_and_add( &mNextItemIdx, chunkSize );
+        if ( startIdx >= numItems )
+        {
+            break;
+        }
+
+        U32 endIdx = startIdx + chunkSize;
+        taskFunction( pUserData, startIdx, ( endIdx < numItems ? endIdx : numItems ) );
+    }
+}
@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+// File: ThreadPool.h
+// Desc: A small pool of worker threads for splitting a loop over a number of
+//       independent items. The thread that calls ParallelFor works on the
+//       loop as well, and doesn't return until every item has been processed.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+//------------------------------------------------------------------------------
+#include <pthread.h>
+#include <vector>
+#include "Common.h"
+
+//------------------------------------------------------------------------------
+class ThreadPool
+{
+    //--------------------------------------------------------------------------
+    //! Processes the items in the range [startIdx, endIdx)
+    public: typedef void (*TaskFunction)( void* pUserData, U32 startIdx, U32 endIdx );
+
+    //--------------------------------------------------------------------------
+    public: ThreadPool();
+    public: ~ThreadPool();
+
+    //--------------------------------------------------------------------------
+    //! Starts the worker threads. If numWorkerThreads is negative then one
+    //! worker is started for each processor apart from the one used by the
+    //! calling thread. With no workers ParallelFor just runs the loop
+    public: bool Init( S32 numWorkerThreads = -1 );
+    public: void DeInit();
+
+    //--------------------------------------------------------------------------
+    public: bool IsInitialised() const { return mbInitialised; }
+    public: U32 GetNumWorkerThreads() const { return mWorkerThreads.size(); }
+
+    //--------------------------------------------------------------------------
+    //! Calls taskFunction on chunks of up to chunkSize items until all
+    //! numItems items have been processed. The chunks may be processed in
+    //! any order and on any thread. Only one loop can run at a time so this
+    //! should only be called from one thread
+    public: void ParallelFor( U32 numItems, TaskFunction taskFunction,
+                              void* pUserData, U32 chunkSize = 1 );
+
+    //--------------------------------------------------------------------------
+    private: static void* WorkerThreadEntry( void* pThreadPool );
+    private: void WorkerThreadMain();
+    private: void ProcessChunks( TaskFunction taskFunction, void* pUserData,
+                                 U32 numItems, U32 chunkSize );
+
+    //--------------------------------------------------------------------------
+    // Members
+    private: bool mbInitialised;
+    private: std::vector<pthread_t> mWorkerThreads;
+    private: pthread_mutex_t mMutex;
+    private: pthread_cond_t mWorkCondition;     // Signalled when a loop starts
+    private: pthread_cond_t mDoneCondition;     // Signalled when a worker leaves a loop
+    private: bool mbStopWorkers;
+
+    // The current loop. These are only changed whilst no workers are active
+    private: U32 mLoopIdx;
+    private: TaskFunction mTaskFunction;
+    private: void* mpUserData;
+    private: U32 mNumItems;
+    private: U32 mChunkSize;
+    private: volatile U32 mNextItemIdx;
+    private: U32 mNumActiveWorkers;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,256 @@
+//------------------------------------------------------------------------------
+// File: BatchSceneNode.cpp
+// Desc: A scene node that draws the mesh nodes of many entities of one type
+//       in a single batch.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "BatchSceneNode.h"
+
+#include <stdio.h>
+
+//------------------------------------------------------------------------------
+// Merged buffers use 16 bit indices
+static const U32 BSN_MAX_VERTICES_PER_BUFFER = 65535;
+
+//------------------------------------------------------------------------------
+BatchSceneNode::BatchSceneNode( irr::scene::ISceneNode* pParent,
+                                irr::scene::ISceneManager* pSceneManager, eMode mode )
+    : irr::scene::ISceneNode( pParent, pSceneManager, -1 ),
+    mMode( mode ),
+    mBoundingBox( 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f ),
+    mbMergedBuffersDirty( false ),
+    mNumMergedBuffers( 0 )
+{
+    // The same material that the entities give their own mesh nodes
+    mMaterial.setFlag( irr::video::EMF_LIGHTING, false );
+    mMaterial.setFlag( irr::video::EMF_FOG_ENABLE, true );
+}
+
+//------------------------------------------------------------------------------
+BatchSceneNode::~BatchSceneNode()
+{
+    while ( !mMembers.empty() )
+    {
+        RemoveMember( mMembers.back().mpMeshNode );
+    }
+
+    ClearMergedBuffers();
+}
+
+//------------------------------------------------------------------------------
+void BatchSceneNode::AddMember( irr::scene::IMeshSceneNode* pMeshNode )
+{
+    if ( NULL == pMeshNode || HasMember( pMeshNode ) )
+    {
+        return;
+    }
+
+    pMeshNode->grab();
+    pMeshNode->setVisible( false );
+
+    Member member;
+    member.mpMeshNode = pMeshNode;
+    member.mTransform = pMeshNode->getAbsoluteTransformation();
+    mMembers.push_back( member );
+
+    mbMergedBuffersDirty = true;
+}
+
+//------------------------------------------------------------------------------
+void BatchSceneNode::RemoveMember( irr::scene::IMeshSceneNode* pMeshNode )
+{
+    for ( U32 memberIdx = 0; memberIdx < mMembers.size(); memberIdx++ )
+    {
+        if ( mMembers[ memberIdx ].mpMeshNode == pMeshNode )
+        {
+            // Give the node back its own draw call
+            pMeshNode->setVisible( true );
+            pMeshNode->drop();
+
+            mMembers[ memberIdx ] = mMembers.back();
+            mMembers.pop_back();
+            mbMergedBuffersDirty = true;
+            return;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool BatchSceneNode::HasMember( irr::scene::IMeshSceneNode* pMeshNode ) const
+{
+    for ( U32 memberIdx = 0; memberIdx < mMembers.size(); memberIdx++ )
+    {
+        if ( mMembers[ memberIdx ].mpMeshNode == pMeshNode )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------------------
+void BatchSceneNode::Refresh()
+{
+    bool bMoved = false;
+    bool bBoxStarted = false;
+    mBoundingBox.reset( 0.0f, 0.0f, 0.0f );
+
+    for ( U32 memberIdx = 0; memberIdx < mMembers.size(); memberIdx++ )
+    {
+        Member& member = mMembers[ memberIdx ];
+
+        // The members are hidden so the scene manager no longer keeps their
+        // absolute transforms up to date. The parent is the entity's
+        // transform node, which is still visible and so has been animated
+        irr::scene::ISceneNode* pParent = member.mpMeshNode->getParent();
+        if ( NULL != pParent )
+        {
+            pParent->updateAbsolutePosition();
+        }
+        member.mpMeshNode->updateAbsolutePosition();
+
+        const irr::core::matrix4& transform = member.mpMeshNode->getAbsoluteTransformation();
+        if ( !( transform == member.mTransform ) )
+        {
+            member.mTransform = transform;
+            bMoved = true;
+        }
+
+        irr::scene::IMesh* pMesh = member.mpMeshNode->getMesh();
+        if ( NULL != pMesh )
+        {
+            irr::core::aabbox3d<irr::f32> box = pMesh->getBoundingBox();
+            member.mTransform.transformBoxEx( box );
+            if ( bBoxStarted )
+            {
+                mBoundingBox.addInternalBox( box );
+            }
+            else
+            {
+                mBoundingBox.reset( box );
+                bBoxStarted = true;
+            }
+        }
+    }
+
+    if ( bMoved || mbMergedBuffersDirty )
+    {
+        BuildMergedBuffers();
+    }
+}
+
+//------------------------------------------------------------------------------
+void BatchSceneNode::BuildMergedBuffers()
+{
+    U32 numBuffersUsed = 0;
+    irr::scene::SMeshBuffer* pBuffer = NULL;
+
+    for ( U32 memberIdx = 0; memberIdx < mMembers.size(); memberIdx++ )
+    {
+        const Member& member = mMembers[ memberIdx ];
+        irr::scene::IMesh* pMesh = member.mpMeshNode->getMesh();
+        for ( U32 sourceIdx = 0; NULL != pMesh && sourceIdx < pMesh->getMeshBufferCount(); sourceIdx++ )
+        {
+            irr::scene::IMeshBuffer* pSource = pMesh->getMeshBuffer( sourceIdx );
+            U32 numVertices = pSource->getVertexCount();
+            if ( irr::video::EVT_STANDARD != pSource->getVertexType()
+                || irr::video::EIT_16BIT != pSource->getIndexType()
+                || numVertices > BSN_MAX_VERTICES_PER_BUFFER )
+            {
+                fprintf( stderr, "Warning: Unable to merge a mesh buffer, it won't be drawn\n" );
+                continue;
+            }
+
+            // Start a new buffer once the indices would overflow
+            if ( NULL == pBuffer
+                || pBuffer->Vertices.size() + numVertices > BSN_MAX_VERTICES_PER_BUFFER )
+            {
+                if ( numBuffersUsed == mMergedBuffers.size() )
+                {
+                    irr::scene::SMeshBuffer* pNewBuffer = new irr::scene::SMeshBuffer();
+                    pNewBuffer->setHardwareMappingHint( 
+                        eM_Static == mMode ? irr::scene::EHM_STATIC : irr::scene::EHM_STREAM );
+                    mMergedBuffers.push_back( pNewBuffer );
+                }
+
+                pBuffer = mMergedBuffers[ numBuffersUsed++ ];
+                pBuffer->Vertices.set_used( 0 );
+                pBuffer->Indices.set_used( 0 );
+            }
+
+            U32 firstVertexIdx = pBuffer->Vertices.size();
+            const irr::video::S3DVertex* pVertices =
+                (const irr::video::S3DVertex*)pSource->getVertices();
+            for ( U32 vertexIdx = 0; vertexIdx < numVertices; vertexIdx++ )
+            {
+                irr::video::S3DVertex vertex = pVertices[ vertexIdx ];
+                member.mTransform.transformVect( vertex.Pos );
+                member.mTransform.rotateVect( vertex.Normal );
+                vertex.Normal.normalize();
+                pBuffer->Vertices.push_back( vertex );
+            }
+
+            const irr::u16* pIndices = pSource->getIndices();
+            U32 numIndices = pSource->getIndexCount();
+            for ( U32 indexIdx = 0; indexIdx < numIndices; indexIdx++ )
+            {
+                pBuffer->Indices.push_back( (irr::u16)( firstVertexIdx + pIndices[ indexIdx ] ) );
+            }
+        }
+    }
+
+    // Let go of any buffers that are no longer needed
+    while ( mMergedBuffers.size() > numBuffersUsed )
+    {
+        mMergedBuffers.back()->drop();
+        mMergedBuffers.pop_back();
+    }
+
+    // The driver has to upload the buffers again
+    for ( U32 bufferIdx = 0; bufferIdx < numBuffersUsed; bufferIdx++ )
+    {
+        mMergedBuffers[ bufferIdx ]->recalculateBoundingBox();
+        mMergedBuffers[ bufferIdx ]->setDirty( irr::scene::EBT_VERTEX_AND_INDEX );
+    }
+
+    mNumMergedBuffers = numBuffersUsed;
+    mbMergedBuffersDirty = false;
+}
+
+//------------------------------------------------------------------------------
+void BatchSceneNode::ClearMergedBuffers()
+{
+    for ( U32 bufferIdx = 0; bufferIdx < mMergedBuffers.size(); bufferIdx++ )
+    {
+        mMergedBuffers[ bufferIdx ]->drop();
+    }
+    mMergedBuffers.clear();
+    mNumMergedBuffers = 0;
+}
+
+//------------------------------------------------------------------------------
+void BatchSceneNode::OnRegisterSceneNode()
+{
+    if ( IsVisible && !mMembers.empty() )
+    {
+        Refresh();
+        SceneManager->registerNodeForRendering( this, irr::scene::ESNRP_SOLID );
+    }
+
+    irr::scene::ISceneNode::OnRegisterSceneNode();
+}
+
+//------------------------------------------------------------------------------
+void BatchSceneNode::render()
+{
+    irr::video::IVideoDriver* pDriver = SceneManager->getVideoDriver();
+    pDriver->setMaterial( mMaterial );
+
+    pDriver->setTransform( irr::video::ETS_WORLD, AbsoluteTransformation );
+    for ( U32 bufferIdx = 0; bufferIdx < mNumMergedBuffers; bufferIdx++ )
+    {
+        pDriver->drawMeshBuffer( mMergedBuffers[ bufferIdx ] );
+    }
+}
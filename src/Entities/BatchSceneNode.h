@@ -0,0 +1,90 @@
+//------------------------------------------------------------------------------
+// File: BatchSceneNode.h
+// Desc: A scene node that draws the mesh nodes of many entities of one type
+//       in a single batch. The entities keep their own mesh nodes, so that
+//       their geometry can still be found by walking the scene graph, but
+//       the nodes are hidden and the batch draws them instead.
+//
+//       The meshes of all of the members are transformed into world space and
+//       copied into as few mesh buffers as possible, which are drawn with one
+//       call each. The buffers are only built again if a member moves. Static
+//       batches are for entities that don't move, and keep their buffers in
+//       video memory. Dynamic batches are for entities that do move, such as
+//       buoys, and have their buffers streamed to the driver each time they
+//       are built again.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef BATCH_SCENE_NODE_H
+#define BATCH_SCENE_NODE_H
+
+//------------------------------------------------------------------------------
+#include <vector>
+#include <irrlicht/irrlicht.h>
+#include "Common.h"
+
+//------------------------------------------------------------------------------
+class BatchSceneNode : public irr::scene::ISceneNode
+{
+    //--------------------------------------------------------------------------
+    public: enum eMode
+    {
+        eM_Static,
+        eM_Dynamic
+    };
+
+    //--------------------------------------------------------------------------
+    public: BatchSceneNode( irr::scene::ISceneNode* pParent,
+                            irr::scene::ISceneManager* pSceneManager, eMode mode );
+    public: virtual ~BatchSceneNode();
+
+    //--------------------------------------------------------------------------
+    // Members are hidden whilst they're in the batch. A member must be
+    // removed before it's taken out of the scene graph
+    public: void AddMember( irr::scene::IMeshSceneNode* pMeshNode );
+    public: void RemoveMember( irr::scene::IMeshSceneNode* pMeshNode );
+    public: bool HasMember( irr::scene::IMeshSceneNode* pMeshNode ) const;
+    public: U32 GetNumMembers() const { return mMembers.size(); }
+    public: eMode GetMode() const { return mMode; }
+
+    //--------------------------------------------------------------------------
+    // Picks up any members that have moved, and builds the merged mesh
+    // buffers again if needed. Called when the node is registered for 
+    // rendering
+    public: void Refresh();
+
+    //--------------------------------------------------------------------------
+    // The number of mesh buffers drawn by the batch
+    public: U32 GetNumMergedBuffers() const { return mNumMergedBuffers; }
+
+    //--------------------------------------------------------------------------
+    // ISceneNode interface
+    public: virtual void OnRegisterSceneNode();
+    public: virtual void render();
+    public: virtual const irr::core::aabbox3d<irr::f32>& getBoundingBox() const { return mBoundingBox; }
+    public: virtual irr::u32 getMaterialCount() const { return 1; }
+    public: virtual irr::video::SMaterial& getMaterial( irr::u32 num ) { return mMaterial; }
+
+    //--------------------------------------------------------------------------
+    private: struct Member
+    {
+        irr::scene::IMeshSceneNode* mpMeshNode;
+        irr::core::matrix4 mTransform;
+    };
+
+    //--------------------------------------------------------------------------
+    private: void BuildMergedBuffers();
+    private: void ClearMergedBuffers();
+
+    //--------------------------------------------------------------------------
+    // Members
+    private: eMode mMode;
+    private: irr::video::SMaterial mMaterial;
+    private: irr::core::aabbox3d<irr::f32> mBoundingBox;
+    private: std::vector<Member> mMembers;
+    private: bool mbMergedBuffersDirty;
+    private: std::vector<irr::scene::SMeshBuffer*> mMergedBuffers;
+    private: U32 mNumMergedBuffers;
+};
+
+#endif // BATCH_SCENE_NODE_H
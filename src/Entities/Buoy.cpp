@@ -5,9 +5,11 @@
 
 //------------------------------------------------------------------------------
 #include "Buoy.h"
+#include "MeshCache.h"
 //#include <LinearMath/btTransform.h>
 
 //------------------------------------------------------------------------------
+const irr::video::SColor Buoy::COLOUR( 255, 194, 92, 48 );
 const F32 Buoy::DEFAULT_RADIUS = 0.3f;
 const F32 Buoy::MASS = 1.0f;
 
@@ -41,10 +43,9 @@ bool Buoy::Init( irr::scene::ISceneManager* pSceneManager,
             return false;
         }
         
-        // Create a sphere for the buoy
-        const irr::scene::IGeometryCreator* pCreator = pSceneManager->getGeometryCreator();
-
-        mpMesh = pCreator->createSphereMesh( radius );
+        // Create a sphere for the buoy, shared with all other buoys of the
+        // same size
+        mpMesh = MeshCache::GetSphereMesh( pSceneManager, radius, COLOUR );
         if ( NULL == mpMesh )
         {
             fprintf( stderr, "Error: Unable to create mesh" );
@@ -52,15 +53,6 @@ bool Buoy::Init( irr::scene::ISceneManager* pSceneManager,
             return false;
         }
         
-        // Change colour to red
-        irr::scene::IMeshBuffer* pMeshBuffer = mpMesh->getMeshBuffer( 0 );
-        S32 numVertices = pMeshBuffer->getVertexCount();
-        irr::video::S3DVertex* pVertices = (irr::video::S3DVertex*)pMeshBuffer->getVertices();
-        for ( S32 vertexIdx = 0; vertexIdx < numVertices; vertexIdx++ )
-        {
-            pVertices[ vertexIdx ].Color.set( 255, 194, 92, 48 );
-        }   
-        
         mpMeshNode = pSceneManager->addMeshSceneNode( mpMesh );
         if ( NULL == mpMeshNode )
         {
@@ -74,6 +66,10 @@ bool Buoy::Init( irr::scene::ISceneManager* pSceneManager,
         // Put the node under the control of SubSim
         AddChildNode( mpMeshNode );
         
+        // Buoys are moved by the physics engine, so their merged buffer is
+        // built again whenever one of them moves
+        MeshCache::AddToBatch( pSceneManager, eT_Buoy, BatchSceneNode::eM_Dynamic, mpMeshNode );
+        
         // Setup physics representation
         mpPhysicsWorld = pPhysicsWorld;
         mpCollisionShape = new btSphereShape( radius );
@@ -128,6 +124,7 @@ void Buoy::DeInit()
     
     mpPhysicsWorld = NULL;
     
+    MeshCache::RemoveFromBatch( GetSceneManager(), mpMeshNode );
     RemoveAllChildNodes();
     
     if ( NULL != mpMeshNode )
@@ -152,10 +149,30 @@ void Buoy::SetPosition( const Vector& pos )
 {
     if ( mbInitialised )
     {
-        mpMotionState->m_graphicsWorldTrans.setOrigin( 
-            btVector3( pos.mX, pos.mY, pos.mZ ) );
-        
+        MovePhysicsBody( pos );
         Entity::SetPosition( pos );
     }
 }
 
+//------------------------------------------------------------------------------
+void Buoy::SetPose( const Vector& pos, const Vector& rotation )
+{
+    if ( mbInitialised )
+    {
+        MovePhysicsBody( pos );
+        Entity::SetPose( pos, rotation );
+    }
+}
+
+//------------------------------------------------------------------------------
+void Buoy::MovePhysicsBody( const Vector& pos )
+{
+    // Move the rigid body as well as the motion state, otherwise the body
+    // is simulated at the origin
+    btTransform bodyTransform = mpPhysicsBody->getWorldTransform();
+    bodyTransform.setOrigin( btVector3( pos.mX, pos.mY, pos.mZ ) );
+    mpPhysicsBody->setWorldTransform( bodyTransform );
+    mpMotionState->setWorldTransform( bodyTransform );
+    mpPhysicsBody->activate();
+}
+
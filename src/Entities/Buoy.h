@@ -26,6 +26,14 @@ class Buoy : public Entity
     
     //--------------------------------------------------------------------------
     public: virtual void SetPosition( const Vector& pos );
+    public: virtual void SetPose( const Vector& pos, const Vector& rotation );
+    
+    //--------------------------------------------------------------------------
+    // Moves the rigid body to a new position
+    private: void MovePhysicsBody( const Vector& pos );
+    
+    //--------------------------------------------------------------------------
+    public: virtual btRigidBody* GetPhysicsBody() const { return mpPhysicsBody; }
 
     //--------------------------------------------------------------------------
     // Members
@@ -39,6 +47,7 @@ class Buoy : public Entity
     private: btRigidBody* mpPhysicsBody;
     
     public: static const F32 DEFAULT_RADIUS;
+    private: static const irr::video::SColor COLOUR;
     private: static const F32 MASS;
 };
 
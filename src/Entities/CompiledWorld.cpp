@@ -0,0 +1,326 @@
+//------------------------------------------------------------------------------
+// File: CompiledWorld.cpp
+// Desc: A world file that has been compiled from XML into a flat binary table
+//       of entity descriptions.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "CompiledWorld.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//------------------------------------------------------------------------------
+static const U32 CW_MAGIC = 0x57535353;     // "SSSW"
+static const U32 CW_VERSION = 2;
+static const U32 CW_MAX_SOURCE_NAME_LENGTH = 255;
+static const U32 CW_TABLE_ALIGNMENT = 16;
+static const U32 CW_FNV_OFFSET_BASIS = 2166136261u;
+static const U32 CW_FNV_PRIME = 16777619u;
+static const U32 CW_HASH_BUFFER_SIZE = 64*1024;
+
+//------------------------------------------------------------------------------
+// The file is a FileHeader followed, at mEntityTableOffset, by mNumEntities
+// EntityDescs. The size of an EntityDesc is kept in the header so that files
+// written with a different layout are turned away
+struct FileHeader
+{
+    U32 mMagic;
+    U32 mVersion;
+    U32 mEntityDescSize;
+    U32 mNumEntities;
+    U32 mEntityTableOffset;
+
+    // The XML file that the world was compiled from, without its directory,
+    // along with an FNV-1a hash of its contents
+    U32 mSourceSize;
+    U32 mSourceHash;
+    char mSourceName[ CW_MAX_SOURCE_NAME_LENGTH + 1 ];
+};
+
+//------------------------------------------------------------------------------
+// Hashes the contents of a file. Returns false if it can't be read
+static bool CW_HashFile( const char* filename, U32* pSizeOut, U32* pHashOut )
+{
+    FILE* pFile = fopen( filename, "rb" );
+    if ( NULL == pFile )
+    {
+        return false;
+    }
+
+    U8 buffer[ CW_HASH_BUFFER_SIZE ];
+    U32 size = 0;
+    U32 hash = CW_FNV_OFFSET_BASIS;
+    size_t numBytesRead = 0;
+    while ( ( numBytesRead = fread( buffer, 1, sizeof( buffer ), pFile ) ) > 0 )
+    {
+        for ( size_t byteIdx = 0; byteIdx < numBytesRead; byteIdx++ )
+        {
+            hash ^= (U32)buffer[ byteIdx ];
+            hash *= CW_FNV_PRIME;
+        }
+        size += numBytesRead;
+    }
+
+    bool bRead = ( 0 == ferror( pFile ) );
+    fclose( pFile );
+
+    *pSizeOut = size;
+    *pHashOut = hash;
+    return bRead;
+}
+
+//------------------------------------------------------------------------------
+const char* CompiledWorld::FILE_EXTENSION = ".ssw";
+
+//------------------------------------------------------------------------------
+CompiledWorld::CompiledWorld()
+    : mpFileData( NULL ),
+    mFileSize( 0 ),
+    mNumEntities( 0 ),
+    mpEntityDescs( NULL ),
+    mSourceSize( 0 ),
+    mSourceHash( 0 )
+{
+}
+
+//------------------------------------------------------------------------------
+CompiledWorld::~CompiledWorld()
+{
+    Close();
+}
+
+//------------------------------------------------------------------------------
+bool CompiledWorld::Open( const char* filename )
+{
+    Close();
+
+    S32 fileDescriptor = open( filename, O_RDONLY );
+    if ( -1 == fileDescriptor )
+    {
+        fprintf( stderr, "Error: Unable to open %s\n", filename );
+        return false;
+    }
+
+    struct stat fileStats;
+    if ( 0 != fstat( fileDescriptor, &fileStats )
+        || (U32)fileStats.st_size < sizeof( FileHeader ) )
+    {
+        fprintf( stderr, "Error: %s is not a compiled world\n", filename );
+        close( fileDescriptor );
+        return false;
+    }
+
+    // The mapping stays valid once the file has been closed
+    mFileSize = (U32)fileStats.st_size;
+    mpFileData = mmap( NULL, mFileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0 );
+    close( fileDescriptor );
+    if ( MAP_FAILED == mpFileData )
+    {
+        fprintf( stderr, "Error: Unable to map %s\n", filename );
+        mpFileData = NULL;
+        return false;
+    }
+
+    const FileHeader* pHeader = (const FileHeader*)mpFileData;
+    if ( CW_MAGIC != pHeader->mMagic )
+    {
+        fprintf( stderr, "Error: %s is not a compiled world\n", filename );
+        Close();
+        return false;
+    }
+
+    if ( CW_VERSION != pHeader->mVersion
+        || sizeof( EntityDesc ) != pHeader->mEntityDescSize )
+    {
+        fprintf( stderr, "Error: %s was compiled by a different version of "
+            "subsim-worldc and needs to be compiled again\n", filename );
+        Close();
+        return false;
+    }
+
+    if ( pHeader->mEntityTableOffset < sizeof( FileHeader )
+        || pHeader->mEntityTableOffset > mFileSize
+        || pHeader->mNumEntities > ( mFileSize - pHeader->mEntityTableOffset )/sizeof( EntityDesc ) )
+    {
+        fprintf( stderr, "Error: %s has been cut short\n", filename );
+        Close();
+        return false;
+    }
+
+    mNumEntities = pHeader->mNumEntities;
+    mpEntityDescs = (const EntityDesc*)( (const U8*)mpFileData + pHeader->mEntityTableOffset );
+
+    // The names are used as C strings so each one must be terminated. The
+    // mapping is read only so a bad name can't be fixed up in place
+    for ( U32 entityIdx = 0; entityIdx < mNumEntities; entityIdx++ )
+    {
+        const EntityDesc& entityDesc = mpEntityDescs[ entityIdx ];
+        if ( NULL == memchr( entityDesc.mName, '\0', sizeof( entityDesc.mName ) ) )
+        {
+            fprintf( stderr, "Error: Entity %u in %s has a name that isn't terminated\n",
+                entityIdx, filename );
+            Close();
+            return false;
+        }
+    }
+
+    // The source file is looked for in the same directory as the compiled file
+    char sourceName[ CW_MAX_SOURCE_NAME_LENGTH + 1 ];
+    memcpy( sourceName, pHeader->mSourceName, sizeof( sourceName ) );
+    sourceName[ CW_MAX_SOURCE_NAME_LENGTH ] = '\0';
+
+    const char* pLastSlash = strrchr( filename, '/' );
+    mSourceFilename.assign( filename, ( NULL != pLastSlash ? pLastSlash - filename + 1 : 0 ) );
+    mSourceFilename += sourceName;
+    mSourceSize = pHeader->mSourceSize;
+    mSourceHash = pHeader->mSourceHash;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void CompiledWorld::Close()
+{
+    if ( NULL != mpFileData )
+    {
+        munmap( mpFileData, mFileSize );
+        mpFileData = NULL;
+    }
+
+    mFileSize = 0;
+    mNumEntities = 0;
+    mpEntityDescs = NULL;
+    mSourceFilename.clear();
+    mSourceSize = 0;
+    mSourceHash = 0;
+}
+
+//------------------------------------------------------------------------------
+bool CompiledWorld::IsStale() const
+{
+    if ( !IsOpen() )
+    {
+        return true;
+    }
+
+    struct stat sourceStats;
+    if ( 0 != stat( mSourceFilename.c_str(), &sourceStats ) )
+    {
+        return false;
+    }
+
+    // A change of size is enough to tell. Otherwise the contents are hashed,
+    // as modification times are too coarse to catch an edit made straight
+    // after compiling
+    if ( mSourceSize != (U32)sourceStats.st_size )
+    {
+        return true;
+    }
+
+    U32 sourceSize = 0;
+    U32 sourceHash = 0;
+    if ( !CW_HashFile( mSourceFilename.c_str(), &sourceSize, &sourceHash ) )
+    {
+        return false;
+    }
+
+    return ( mSourceSize != sourceSize || mSourceHash != sourceHash );
+}
+
+//------------------------------------------------------------------------------
+bool CompiledWorld::WriteCompiledWorldFile( const char* filename,
+                                            const char* sourceFilename,
+                                            const std::vector<EntityDesc>& entityDescs )
+{
+    U32 sourceSize = 0;
+    U32 sourceHash = 0;
+    if ( !CW_HashFile( sourceFilename, &sourceSize, &sourceHash ) )
+    {
+        fprintf( stderr, "Error: Unable to read %s\n", sourceFilename );
+        return false;
+    }
+
+    const char* pLastSlash = strrchr( sourceFilename, '/' );
+    const char* pSourceName = ( NULL != pLastSlash ? pLastSlash + 1 : sourceFilename );
+    if ( strlen( pSourceName ) > CW_MAX_SOURCE_NAME_LENGTH )
+    {
+        fprintf( stderr, "Error: The name of %s is too long\n", sourceFilename );
+        return false;
+    }
+
+    FileHeader header;
+    memset( &header, 0, sizeof( header ) );
+    header.mMagic = CW_MAGIC;
+    header.mVersion = CW_VERSION;
+    header.mEntityDescSize = sizeof( EntityDesc );
+    header.mNumEntities = entityDescs.size();
+    header.mEntityTableOffset =
+        ( ( sizeof( FileHeader ) + CW_TABLE_ALIGNMENT - 1 )/CW_TABLE_ALIGNMENT )*CW_TABLE_ALIGNMENT;
+    header.mSourceSize = sourceSize;
+    header.mSourceHash = sourceHash;
+    strcpy( header.mSourceName, pSourceName );
+
+    std::string tempFilename = std::string( filename ) + ".tmp";
+    FILE* pFile = fopen( tempFilename.c_str(), "wb" );
+    if ( NULL == pFile )
+    {
+        fprintf( stderr, "Error: Unable to open %s for writing\n", tempFilename.c_str() );
+        return false;
+    }
+
+    U8 padding[ CW_TABLE_ALIGNMENT ];
+    memset( padding, 0, sizeof( padding ) );
+    U32 paddingSize = header.mEntityTableOffset - sizeof( FileHeader );
+
+    bool bWritten = ( 1 == fwrite( &header, sizeof( header ), 1, pFile ) );
+    if ( bWritten && paddingSize > 0 )
+    {
+        bWritten = ( 1 == fwrite( padding, paddingSize, 1, pFile ) );
+    }
+    if ( bWritten && !entityDescs.empty() )
+    {
+        bWritten = ( entityDescs.size() == fwrite( &entityDescs[ 0 ],
+            sizeof( EntityDesc ), entityDescs.size(), pFile ) );
+    }
+    bWritten = ( 0 == fclose( pFile ) ) && bWritten;
+
+    if ( !bWritten || 0 != rename( tempFilename.c_str(), filename ) )
+    {
+        fprintf( stderr, "Error: Unable to write to %s\n", filename );
+        unlink( tempFilename.c_str() );
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+std::string CompiledWorld::GetCompiledFilename( const char* worldFilename )
+{
+    std::string compiledFilename( worldFilename );
+
+    // Only look for an extension after the last directory separator
+    size_t dotPos = compiledFilename.rfind( '.' );
+    size_t slashPos = compiledFilename.rfind( '/' );
+    if ( std::string::npos != dotPos
+        && ( std::string::npos == slashPos || dotPos > slashPos ) )
+    {
+        compiledFilename.erase( dotPos );
+    }
+
+    return compiledFilename + FILE_EXTENSION;
+}
+
+//------------------------------------------------------------------------------
+bool CompiledWorld::IsCompiledFilename( const char* filename )
+{
+    size_t nameLength = strlen( filename );
+    size_t extensionLength = strlen( FILE_EXTENSION );
+    return ( nameLength >= extensionLength
+        && 0 == strcmp( filename + nameLength - extensionLength, FILE_EXTENSION ) );
+}
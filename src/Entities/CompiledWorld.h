@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+// File: CompiledWorld.h
+// Desc: A world file that has been compiled by subsim-worldc from XML into a
+//       flat binary table of entity descriptions. Compiled worlds are memory
+//       mapped when they're opened, so loading one is little more than
+//       walking through an array of EntityDescs.
+//
+//       A compiled world remembers the size and a hash of the contents of the
+//       XML file that it was compiled from, and is stale if that file has
+//       changed since. The XML file is looked for next to the compiled world.
+//
+//       Only the entity descriptions are stored. The collision meshes and
+//       BVHs that the sonar uses for static entities are still built when the
+//       world is loaded, by SonarModel::AddStaticEntity. They only depend on
+//       the descriptions so could be precomputed, but the compiler would then
+//       need an Irrlicht device to run the entity builders, and Bullet's
+//       serialised BVHs depend on the Bullet version and build settings, so
+//       compiled worlds would no longer be portable between builds. The static
+//       meshes are boxes and 16 sided cylinders, so they're quick to build.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef COMPILED_WORLD_H
+#define COMPILED_WORLD_H
+
+//------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+
+#include "Common.h"
+#include "EntityDesc.h"
+
+//------------------------------------------------------------------------------
+class CompiledWorld
+{
+    //--------------------------------------------------------------------------
+    public: CompiledWorld();
+    public: ~CompiledWorld();
+
+    //--------------------------------------------------------------------------
+    // Maps in a compiled world file. Files written by a different version of
+    // the compiler, or with entity names that aren't terminated, are rejected
+    public: bool Open( const char* filename );
+    public: void Close();
+    public: bool IsOpen() const { return NULL != mpFileData; }
+
+    //--------------------------------------------------------------------------
+    public: U32 GetNumEntities() const { return mNumEntities; }
+    public: const EntityDesc& GetEntityDesc( U32 entityIdx ) const { return mpEntityDescs[ entityIdx ]; }
+
+    //--------------------------------------------------------------------------
+    // The XML file that the world was compiled from, found next to the
+    // compiled world
+    public: const char* GetSourceFilename() const { return mSourceFilename.c_str(); }
+
+    //--------------------------------------------------------------------------
+    // Returns true if the XML file that the world was compiled from has
+    // changed since. If the XML file can't be found then the compiled world
+    // is all there is, and so it isn't stale
+    public: bool IsStale() const;
+
+    //--------------------------------------------------------------------------
+    // Writes out a compiled world for entityDescs. The file is written under
+    // a temporary name and then moved into place, so that a simulator that's
+    // starting up never sees half a file
+    public: static bool WriteCompiledWorldFile( const char* filename,
+                                                const char* sourceFilename,
+                                                const std::vector<EntityDesc>& entityDescs );
+
+    //--------------------------------------------------------------------------
+    // Gives the name that the compiled version of a world file has by
+    // default, which is the world filename with its extension swapped for
+    // FILE_EXTENSION
+    public: static std::string GetCompiledFilename( const char* worldFilename );
+    public: static bool IsCompiledFilename( const char* filename );
+
+    public: static const char* FILE_EXTENSION;
+
+    //--------------------------------------------------------------------------
+    // Members
+    private: void* mpFileData;
+    private: U32 mFileSize;
+    private: U32 mNumEntities;
+    private: const EntityDesc* mpEntityDescs;
+
+    private: std::string mSourceFilename;
+    private: U32 mSourceSize;
+    private: U32 mSourceHash;
+};
+
+#endif // COMPILED_WORLD_H
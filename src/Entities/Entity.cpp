@@ -8,6 +8,8 @@
 #include "Common/MathUtils.h"
 #include "Common/Utils.h"
 
+#include <btBulletDynamicsCommon.h>
+
 //------------------------------------------------------------------------------
 const char* Entity::TYPE_NAMES[ eT_NumTypes ] =
 {
@@ -23,8 +25,6 @@ const char* Entity::TYPE_NAMES[ eT_NumTypes ] =
     "SurveyWall"
 };
 
-S32 Entity::mEntityCount = 0;
-
 //------------------------------------------------------------------------------
 Entity::eType Entity::GetTypeFromString( const char* pTypeString )
 {
@@ -62,11 +62,22 @@ const char* Entity::ConvertTypeToString( eType type )
 Entity::Entity()
     : mbInitialised( false ),
     mpSceneManager( NULL ),
-    mpTransformNode( NULL )
+    mpTransformNode( NULL ),
+    mpTranslation( &mOwnState.mPosition ),
+    mpRotation( &mOwnState.mRotation ),
+    mpLinearVelocity( &mOwnState.mLinearVelocity ),
+    mpAngularVelocity( &mOwnState.mAngularVelocity ),
+    mpPoseVersion( &mOwnState.mPoseVersion )
 {
-    snprintf( mName, MAX_NAME_LENGTH, "Entity_%i", mEntityCount );
-    mName[ MAX_NAME_LENGTH ] = '\0';
-    mEntityCount++;
+    mOwnState.mPosition.Set( 0.0f, 0.0f, 0.0f );
+    mOwnState.mRotation.Set( 0.0f, 0.0f, 0.0f );
+    mOwnState.mLinearVelocity.Set( 0.0f, 0.0f, 0.0f );
+    mOwnState.mAngularVelocity.Set( 0.0f, 0.0f, 0.0f );
+    mOwnState.mPoseVersion = 1;
+    
+    // Entities are given a unique name by the world that loads them so 
+    // that several worlds can be built at once without sharing a counter
+    snprintf( mName, MAX_NAME_LENGTH + 1, "Entity" );
 }
 
 //------------------------------------------------------------------------------
@@ -91,9 +102,9 @@ bool Entity::Init( irr::scene::ISceneManager* pSceneManager )
             return false;
         }
         
-        mTranslation.Set( 0.0f, 0.0f, 0.0f );
-        mRotation.Set( 0.0f, 0.0f, 0.0f );
-        UpdateTransform();
+        mpTranslation->Set( 0.0f, 0.0f, 0.0f );
+        mpRotation->Set( 0.0f, 0.0f, 0.0f );
+        Entity::ApplyRenderTransform( *mpTranslation, *mpRotation );
 
         mbInitialised = true;
     }
@@ -118,20 +129,58 @@ void Entity::DeInit()
     mbInitialised = false;
 }
 
+//------------------------------------------------------------------------------
+void Entity::BindStateTable( EntityStateTable* pTable, U32 rowIdx )
+{
+    UnbindStateTable();
+    
+    pTable->mPositions[ rowIdx ] = mOwnState.mPosition;
+    pTable->mRotations[ rowIdx ] = mOwnState.mRotation;
+    pTable->mLinearVelocities[ rowIdx ] = mOwnState.mLinearVelocity;
+    pTable->mAngularVelocities[ rowIdx ] = mOwnState.mAngularVelocity;
+    pTable->mPoseVersions[ rowIdx ] = mOwnState.mPoseVersion;
+    
+    mpTranslation = &pTable->mPositions[ rowIdx ];
+    mpRotation = &pTable->mRotations[ rowIdx ];
+    mpLinearVelocity = &pTable->mLinearVelocities[ rowIdx ];
+    mpAngularVelocity = &pTable->mAngularVelocities[ rowIdx ];
+    mpPoseVersion = &pTable->mPoseVersions[ rowIdx ];
+}
+
+//------------------------------------------------------------------------------
+void Entity::UnbindStateTable()
+{
+    if ( &mOwnState.mPosition != mpTranslation )
+    {
+        // Take the state back out of the table
+        mOwnState.mPosition = *mpTranslation;
+        mOwnState.mRotation = *mpRotation;
+        mOwnState.mLinearVelocity = *mpLinearVelocity;
+        mOwnState.mAngularVelocity = *mpAngularVelocity;
+        mOwnState.mPoseVersion = *mpPoseVersion;
+    }
+    
+    mpTranslation = &mOwnState.mPosition;
+    mpRotation = &mOwnState.mRotation;
+    mpLinearVelocity = &mOwnState.mLinearVelocity;
+    mpAngularVelocity = &mOwnState.mAngularVelocity;
+    mpPoseVersion = &mOwnState.mPoseVersion;
+}
+
 //------------------------------------------------------------------------------
 void Entity::SetPosition( const Vector& pos )
 {
     if ( mbInitialised )
     {
-        mTranslation = pos;
-        UpdateTransform();
+        *mpTranslation = pos;
+        (*mpPoseVersion)++;
     }
 }
 
 //------------------------------------------------------------------------------
 const Vector& Entity::GetPosition() const
 {
-    return mTranslation;
+    return *mpTranslation;
 }
 
 //------------------------------------------------------------------------------
@@ -139,15 +188,37 @@ void Entity::SetRotation( const Vector& rotation )
 {
     if ( mbInitialised )
     {
-        mRotation = rotation;
-        UpdateTransform();
+        *mpRotation = rotation;
+        (*mpPoseVersion)++;
     }
 }
 
 //------------------------------------------------------------------------------
 const Vector& Entity::GetRotation() const
 {
-    return mRotation;
+    return *mpRotation;
+}
+
+//------------------------------------------------------------------------------
+void Entity::SetPose( const Vector& pos, const Vector& rotation )
+{
+    if ( mbInitialised )
+    {
+        *mpTranslation = pos;
+        *mpRotation = rotation;
+        (*mpPoseVersion)++;
+    }
+}
+
+//------------------------------------------------------------------------------
+void Entity::SetPoseFromPhysics( const Vector& pos, const Vector& rotation )
+{
+    if ( mbInitialised )
+    {
+        *mpTranslation = pos;
+        *mpRotation = rotation;
+        (*mpPoseVersion)++;
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -170,15 +241,15 @@ void Entity::SetYaw( F32 yawAngle )
 {
     if ( mbInitialised )
     {
-        mRotation.mZ = yawAngle;
-        UpdateTransform();
+        mpRotation->mZ = yawAngle;
+        (*mpPoseVersion)++;
     }
 }
 
 //------------------------------------------------------------------------------
 F32 Entity::GetYaw() const
 {
-    return mRotation.mZ;
+    return mpRotation->mZ;
 }
 
 //------------------------------------------------------------------------------
@@ -186,15 +257,15 @@ void Entity::SetPitch( F32 pitchAngle )
 {
     if ( mbInitialised )
     {
-        mRotation.mX = pitchAngle;
-        UpdateTransform();
+        mpRotation->mX = pitchAngle;
+        (*mpPoseVersion)++;
     }
 }
 
 //------------------------------------------------------------------------------
 F32 Entity::GetPitch() const
 {
-    return mRotation.mX;
+    return mpRotation->mX;
 }
 
 //------------------------------------------------------------------------------
@@ -202,28 +273,86 @@ void Entity::SetDepth( F32 depth )
 {
     if ( mbInitialised )
     {
-        mTranslation.mZ = depth;
-        UpdateTransform();
+        mpTranslation->mZ = depth;
+        (*mpPoseVersion)++;
     }
 }
 
 //------------------------------------------------------------------------------
 F32 Entity::GetDepth() const
 {
-    return mTranslation.mZ;
+    return mpTranslation->mZ;
 }
 
 //------------------------------------------------------------------------------
-void Entity::UpdateTransform()
+void Entity::ApplyRenderTransform( const Vector& pos, const Vector& rotation )
 {
-    irr::core::vector3df irrRotation = MathUtils::TransformRotation_SubToIrr( mRotation );
-    irr::core::vector3df irrTranslation = MathUtils::TransformVector_SubToIrr( mTranslation );
+    irr::core::vector3df irrRotation = MathUtils::TransformRotation_SubToIrr( rotation );
+    irr::core::vector3df irrTranslation = MathUtils::TransformVector_SubToIrr( pos );
     
     irr::core::matrix4& subTransform = mpTransformNode->getRelativeTransformationMatrix();
     subTransform.setRotationRadians( irrRotation );
     subTransform.setTranslation( irrTranslation );
 }
 
+//------------------------------------------------------------------------------
+static U32 AddNodeMeshTriangles( irr::scene::ISceneNode* pNode, btTriangleMesh* pTriangleMesh )
+{
+    U32 numTrianglesAdded = 0;
+    pNode->updateAbsolutePosition();
+    
+    if ( irr::scene::ESNT_MESH == pNode->getType() )
+    {
+        irr::scene::IMesh* pMesh = static_cast<irr::scene::IMeshSceneNode*>( pNode )->getMesh();
+        const irr::core::matrix4& transform = pNode->getAbsoluteTransformation();
+        
+        for ( U32 bufferIdx = 0; NULL != pMesh && bufferIdx < pMesh->getMeshBufferCount(); bufferIdx++ )
+        {
+            irr::scene::IMeshBuffer* pMeshBuffer = pMesh->getMeshBuffer( bufferIdx );
+            const irr::u16* pIndices = pMeshBuffer->getIndices();
+            U32 numIndices = pMeshBuffer->getIndexCount();
+            
+            for ( U32 indexIdx = 0; indexIdx + 2 < numIndices; indexIdx += 3 )
+            {
+                btVector3 corners[ 3 ];
+                for ( U32 cornerIdx = 0; cornerIdx < 3; cornerIdx++ )
+                {
+                    irr::core::vector3df irrPos = pMeshBuffer->getPosition( pIndices[ indexIdx + cornerIdx ] );
+                    transform.transformVect( irrPos );
+                    
+                    Vector pos = MathUtils::TransformVector_IrrToSub( irrPos );
+                    corners[ cornerIdx ].setValue( pos.mX, pos.mY, pos.mZ );
+                }
+                
+                pTriangleMesh->addTriangle( corners[ 0 ], corners[ 1 ], corners[ 2 ] );
+                numTrianglesAdded++;
+            }
+        }
+    }
+    
+    const irr::core::list<irr::scene::ISceneNode*>& children = pNode->getChildren();
+    for ( irr::core::list<irr::scene::ISceneNode*>::ConstIterator childIter = children.begin();
+        children.end() != childIter; ++childIter )
+    {
+        numTrianglesAdded += AddNodeMeshTriangles( *childIter, pTriangleMesh );
+    }
+    
+    return numTrianglesAdded;
+}
+
+//------------------------------------------------------------------------------
+U32 Entity::AddMeshTriangles( btTriangleMesh* pTriangleMesh )
+{
+    if ( !mbInitialised )
+    {
+        return 0;
+    }
+    
+    // The scene graph may not have caught up with the simulation yet
+    ApplyRenderTransform( *mpTranslation, *mpRotation );
+    return AddNodeMeshTriangles( mpTransformNode, pTriangleMesh );
+}
+
 //------------------------------------------------------------------------------
 void Entity::AddChildNode( irr::scene::ISceneNode* pChildNode )
 {
@@ -11,6 +11,12 @@
 #include <irrlicht/irrlicht.h>
 #include "Common.h"
 #include "Vector.h"
+#include "EntityStateTable.h"
+
+//------------------------------------------------------------------------------
+// Forward declarations
+class btRigidBody;
+class btTriangleMesh;
 
 //------------------------------------------------------------------------------
 class Entity
@@ -60,6 +66,16 @@ class Entity
     public: virtual void SetRotation( const Vector& rotation );
     public: virtual const Vector& GetRotation() const;
     
+    //--------------------------------------------------------------------------
+    // Sets the position and rotation together. Prefer this to calling the
+    // individual setters one after another
+    public: virtual void SetPose( const Vector& pos, const Vector& rotation );
+    
+    //--------------------------------------------------------------------------
+    // Goes up whenever the pose of the entity changes, so that users of the
+    // pose can skip work when the entity hasn't moved
+    public: U32 GetPoseVersion() const { return *mpPoseVersion; }
+    
     //--------------------------------------------------------------------------
     public: void SetName( const char* name );
     public: const char* GetName() const { return mName; }
@@ -82,8 +98,10 @@ class Entity
     public: void SetDepth( F32 depthAngle );
     public: F32 GetDepth() const;
     //--------------------------------------------------------------------------
-    // Helper routine for working with the entity's transform
-    private: void UpdateTransform();
+    // Copies a pose into the scene graph. The setters above only change the
+    // simulation state of the entity, this must be called from the thread
+    // that owns the scene manager for the change to become visible
+    public: virtual void ApplyRenderTransform( const Vector& pos, const Vector& rotation );
     
     //--------------------------------------------------------------------------
     public: irr::scene::ISceneManager* GetSceneManager() const { return mpSceneManager; }
@@ -96,8 +114,52 @@ class Entity
     protected: void RemoveAllChildNodes();
     
     //--------------------------------------------------------------------------
-    // Updates the entity by a given number of seconds
+    // Updates the entity by a given number of seconds. Only called if 
+    // NeedsUpdate returns true, entities that don't move themselves are 
+    // skipped by the simulation step
     public: virtual void Update( F32 timeStep ) {}
+    public: virtual bool NeedsUpdate() const { return false; }
+    
+    //--------------------------------------------------------------------------
+    // Velocities over the last update in the body frame of the entity, i.e.
+    // y is forwards, x is to the right and z is up. Angular velocities are
+    // the rates of change of the rotation vector. Entities that don't keep
+    // track of their velocity return zero
+    public: const Vector& GetLinearVelocity() const { return *mpLinearVelocity; }
+    public: const Vector& GetAngularVelocity() const { return *mpAngularVelocity; }
+    
+    //--------------------------------------------------------------------------
+    // Brings the entity to a stop and clears any motion that it has been 
+    // told to make. Used when the world is reset
+    public: virtual void ResetMotion() {}
+    
+    //--------------------------------------------------------------------------
+    // Returns the rigid body used to represent the entity in the physics
+    // world, or NULL if the entity isn't simulated by the physics engine
+    public: virtual btRigidBody* GetPhysicsBody() const { return NULL; }
+    
+    //--------------------------------------------------------------------------
+    // Sets the entity transform from the physics simulation. Unlike 
+    // SetPosition and SetRotation this doesn't push the new pose back into 
+    // the physics world
+    public: void SetPoseFromPhysics( const Vector& pos, const Vector& rotation );
+    
+    //--------------------------------------------------------------------------
+    // Moves the state of the entity into a row of a table, so that the
+    // simulation can pass over the states of all of its entities as a few
+    // arrays. The entity reads and writes its state in the table from then
+    // on, so the table mustn't be resized until the entity is unbound.
+    // Entities that aren't bound to a table hold their state themselves
+    public: void BindStateTable( EntityStateTable* pTable, U32 rowIdx );
+    public: void UnbindStateTable();
+    
+    //--------------------------------------------------------------------------
+    // Adds the triangles of all the meshes attached to the entity to a
+    // triangle mesh, in SubSim world coordinates, so that sensors can see
+    // the entity. Moves the scene graph to the current pose of the entity 
+    // so must be called from the thread that owns the scene manager.
+    // Returns the number of triangles added
+    public: U32 AddMeshTriangles( btTriangleMesh* pTriangleMesh );
 
     //--------------------------------------------------------------------------
     // Members
@@ -106,13 +168,18 @@ class Entity
     // Node for SubSim transforms
     private: irr::scene::IDummyTransformationSceneNode* mpTransformNode;
     
-    // Translation and rotation in SubSim coordinates
-    protected: Vector mTranslation;
-    protected: Vector mRotation;
+    // Translation and rotation in SubSim coordinates, and the velocities in
+    // the body frame. These point to a row of a state table, or to mOwnState
+    // if the entity isn't bound to one
+    private: EntityState mOwnState;
+    protected: Vector* mpTranslation;
+    protected: Vector* mpRotation;
+    protected: Vector* mpLinearVelocity;
+    protected: Vector* mpAngularVelocity;
+    private: U32* mpPoseVersion;
     
     public: static const S32 MAX_NAME_LENGTH = 31;
     private: char mName[ MAX_NAME_LENGTH + 1 ];
-    private: static S32 mEntityCount;
 };
 
 #endif // ENTITY_H
\ No newline at end of file
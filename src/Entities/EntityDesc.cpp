@@ -0,0 +1,101 @@
+//------------------------------------------------------------------------------
+// File: EntityDesc.cpp
+// Desc: A plain description of an entity as it's given in a world file.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "EntityDesc.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+static const char* ED_FLOAT_NAMES[ EntityDesc::eF_NumFloats ] =
+{
+    "yaw",
+    "radius",
+    "width",
+    "height"
+};
+
+static const char* ED_VECTOR_NAMES[ EntityDesc::eV_NumVectors ] =
+{
+    "pos",
+    "rotation"
+};
+
+//------------------------------------------------------------------------------
+void EntityDesc::Reset()
+{
+    // Clear the padding as well so that compiled world files don't change
+    // from one build of them to the next
+    memset( this, 0, sizeof( *this ) );
+    mType = Entity::eT_Invalid;
+}
+
+//------------------------------------------------------------------------------
+void EntityDesc::SetName( const char* name )
+{
+    strncpy( mName, name, Entity::MAX_NAME_LENGTH );
+    mName[ Entity::MAX_NAME_LENGTH ] = '\0';
+    mbHasName = true;
+}
+
+//------------------------------------------------------------------------------
+bool EntityDesc::GetFloat( eFloat floatValue, F32* pFloatOut, bool bPrintErrors, bool bOptional ) const
+{
+    bool bFound = ( 0 != ( mFloatsFound & ( 1 << floatValue ) ) );
+    if ( bFound )
+    {
+        *pFloatOut = mFloats[ floatValue ];
+    }
+    else if ( !bOptional && bPrintErrors )
+    {
+        fprintf( stderr, "Error: Unable to parse float called %s\n", GetFloatName( floatValue ) );
+    }
+
+    return bFound;
+}
+
+//------------------------------------------------------------------------------
+bool EntityDesc::GetVector( eVector vector, Vector* pVectorOut, bool bPrintErrors, bool bOptional ) const
+{
+    bool bElementFound = ( 0 != ( mVectorsFound & ( 1 << vector ) ) );
+    bool bFound = ( bElementFound && ALL_VECTOR_COMPONENTS == mVectorComponentsFound[ vector ] );
+    if ( bFound )
+    {
+        pVectorOut->Set( mVectors[ vector ][ 0 ], mVectors[ vector ][ 1 ], mVectors[ vector ][ 2 ] );
+    }
+    else if ( bPrintErrors && ( !bOptional || bElementFound ) )
+    {
+        // An optional vector that is given but is missing components is
+        // still an error
+        fprintf( stderr, "Error: Unable to parse vector called %s\n", GetVectorName( vector ) );
+    }
+
+    return bFound;
+}
+
+//------------------------------------------------------------------------------
+bool EntityDesc::GetPos( Vector* pPosOut, bool bPrintErrors ) const
+{
+    bool bFound = GetVector( eV_Pos, pPosOut, bPrintErrors );
+    if ( !bFound && bPrintErrors )
+    {
+        fprintf( stderr, "Error: Unable to parse pos element\n" );
+    }
+
+    return bFound;
+}
+
+//------------------------------------------------------------------------------
+const char* EntityDesc::GetFloatName( eFloat floatValue )
+{
+    return ED_FLOAT_NAMES[ floatValue ];
+}
+
+//------------------------------------------------------------------------------
+const char* EntityDesc::GetVectorName( eVector vector )
+{
+    return ED_VECTOR_NAMES[ vector ];
+}
@@ -0,0 +1,81 @@
+//------------------------------------------------------------------------------
+// File: EntityDesc.h
+// Desc: A plain description of an entity as it's given in a world file. World
+//       files are read into EntityDescs which are then used to build the
+//       entities. An EntityDesc holds no pointers, so descs can be written
+//       straight into a compiled world file and used from there.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef ENTITY_DESC_H
+#define ENTITY_DESC_H
+
+//------------------------------------------------------------------------------
+#include "Common.h"
+#include "Vector.h"
+#include "Entity.h"
+
+//------------------------------------------------------------------------------
+struct EntityDesc
+{
+    //--------------------------------------------------------------------------
+    // The single values and vectors that an entity can be given. Which of
+    // them are used depends on the type of the entity
+    enum eFloat
+    {
+        eF_Yaw = 0,
+        eF_Radius,
+        eF_Width,
+        eF_Height,
+
+        eF_NumFloats
+    };
+
+    enum eVector
+    {
+        eV_Pos = 0,
+        eV_Rotation,
+
+        eV_NumVectors
+    };
+
+    static const U32 ALL_VECTOR_COMPONENTS = 0x7;
+
+    //--------------------------------------------------------------------------
+    void Reset();
+
+    //--------------------------------------------------------------------------
+    // Names that are too long are cut short
+    void SetName( const char* name );
+
+    //--------------------------------------------------------------------------
+    // These return false if the value wasn't given. Values that aren't
+    // optional are reported as errors if bPrintErrors is true
+    bool GetFloat( eFloat floatValue, F32* pFloatOut,
+                   bool bPrintErrors = false, bool bOptional = false ) const;
+    bool GetVector( eVector vector, Vector* pVectorOut,
+                    bool bPrintErrors = false, bool bOptional = false ) const;
+    bool GetPos( Vector* pPosOut, bool bPrintErrors = false ) const;
+
+    //--------------------------------------------------------------------------
+    static const char* GetFloatName( eFloat floatValue );
+    static const char* GetVectorName( eVector vector );
+
+    //--------------------------------------------------------------------------
+    // Members. Everything has a fixed size so that the layout of a desc is
+    // the same wherever it's used
+    S32 mType;                  // An Entity::eType
+    char mName[ Entity::MAX_NAME_LENGTH + 1 ];
+    U8 mbHasName;
+
+    F32 mFloats[ eF_NumFloats ];
+    U32 mFloatsFound;           // One bit per float
+
+    // Only the first element of each vector in a world file is used, and a
+    // vector is only complete once all of its components have been found
+    F32 mVectors[ eV_NumVectors ][ 3 ];
+    U32 mVectorsFound;          // One bit per vector element found
+    U32 mVectorComponentsFound[ eV_NumVectors ];    // One bit per component
+};
+
+#endif // ENTITY_DESC_H
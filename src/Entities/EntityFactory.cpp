@@ -0,0 +1,419 @@
+//------------------------------------------------------------------------------
+// File: EntityFactory.cpp
+// Desc: Builds entities from the descriptions read in from world files.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "EntityFactory.h"
+
+#include <stdio.h>
+
+#include "Common/MathUtils.h"
+#include "Entities/Sub.h"
+#include "Entities/CoordinateSystemAxes.h"
+#include "Entities/Gate.h"
+#include "Entities/Buoy.h"
+#include "Entities/Pool.h"
+#include "Entities/CircularPool.h"
+#include "Entities/FloorTarget.h"
+#include "Entities/Pipe.h"
+#include "Entities/SurveyWall.h"
+#include "Entities/HarbourFloor.h"
+
+//------------------------------------------------------------------------------
+// Helper Routine Prototypes
+//------------------------------------------------------------------------------
+static Sub* EF_BuildSub( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager, irr::video::IVideoDriver* pVideoDriver );
+static Buoy* EF_BuildBuoy( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager, btDiscreteDynamicsWorld* pPhysicsWorld );
+static CoordinateSystemAxes* EF_BuildCoordinateSystemAxes( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager );
+static FloorTarget* EF_BuildFloorTarget( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager );
+static Gate* EF_BuildGate( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager );
+static Pool* EF_BuildPool( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager );
+static CircularPool* EF_BuildCircularPool( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager );
+static HarbourFloor* EF_BuildHarbourFloor( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager );
+static Pipe* EF_BuildPipe( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager );
+static SurveyWall* EF_BuildSurveyWall( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager );
+
+static void EF_SetRotation( const EntityDesc& desc, Entity* pEntity );
+
+//------------------------------------------------------------------------------
+Entity* EntityFactory::BuildEntity( const EntityDesc& desc,
+                                    S32 entityIdx,
+                                    irr::scene::ISceneManager* pSceneManager,
+                                    irr::video::IVideoDriver* pVideoDriver,
+                                    btDiscreteDynamicsWorld* pPhysicsWorld )
+{
+    Entity* pNewEntity = NULL;
+    switch ( desc.mType )
+    {
+        case Entity::eT_Sub:
+        {
+            pNewEntity = EF_BuildSub( desc, pSceneManager, pVideoDriver );
+            break;
+        }
+        case Entity::eT_Buoy:
+        {
+            pNewEntity = EF_BuildBuoy( desc, pSceneManager, pPhysicsWorld );
+            break;
+        }
+        case Entity::eT_CoordinateSystemAxes:
+        {
+            pNewEntity = EF_BuildCoordinateSystemAxes( desc, pSceneManager );
+            break;
+        }
+        case Entity::eT_FloorTarget:
+        {
+            pNewEntity = EF_BuildFloorTarget( desc, pSceneManager );
+            break;
+        }
+        case Entity::eT_Gate:
+        {
+            pNewEntity = EF_BuildGate( desc, pSceneManager );
+            break;
+        }
+        case Entity::eT_Pool:
+        {
+            pNewEntity = EF_BuildPool( desc, pSceneManager );
+            break;
+        }
+        case Entity::eT_CircularPool:
+        {
+            pNewEntity = EF_BuildCircularPool( desc, pSceneManager );
+            break;
+        }
+        case Entity::eT_HarbourFloor:
+        {
+            pNewEntity = EF_BuildHarbourFloor( desc, pSceneManager );
+            break;
+        }
+        case Entity::eT_Pipe:
+        {
+            pNewEntity = EF_BuildPipe( desc, pSceneManager );
+            break;
+        }
+        case Entity::eT_SurveyWall:
+        {
+            pNewEntity = EF_BuildSurveyWall( desc, pSceneManager );
+            break;
+        }
+        default:
+        {
+            fprintf( stderr, "Warning: Unable to identify type of entity %i\n", entityIdx );
+        }
+    }
+
+    if ( NULL != pNewEntity )
+    {
+        // Use the name of the new entity if it has one, otherwise it's
+        // named after its place in the world
+        if ( desc.mbHasName )
+        {
+            pNewEntity->SetName( desc.mName );
+        }
+        else
+        {
+            char defaultName[ Entity::MAX_NAME_LENGTH + 1 ];
+            snprintf( defaultName, sizeof( defaultName ), "Entity_%i", entityIdx );
+            pNewEntity->SetName( defaultName );
+        }
+    }
+
+    return pNewEntity;
+}
+
+//------------------------------------------------------------------------------
+Sub* EF_BuildSub( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager, irr::video::IVideoDriver* pVideoDriver )
+{
+    const bool PRINT_ERRORS = true;
+    Sub* pSub = NULL;
+
+    Vector pos;
+    F32 yaw;
+
+    if ( desc.GetPos( &pos, PRINT_ERRORS )
+         && desc.GetFloat( EntityDesc::eF_Yaw, &yaw, PRINT_ERRORS ) )
+    {
+        pSub = new Sub();
+        if ( !pSub->Init( pSceneManager, pVideoDriver ) )
+        {
+            fprintf( stderr, "Error: Unable to initialise sub\n" );
+            delete pSub;
+            pSub = NULL;
+        }
+        else
+        {
+            pSub->SetYaw( MathUtils::DegToRad( yaw ) );
+            pSub->SetPosition( pos );
+        }
+    }
+
+    return pSub;
+}
+
+//------------------------------------------------------------------------------
+Buoy* EF_BuildBuoy( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager, btDiscreteDynamicsWorld* pPhysicsWorld )
+{
+    const bool PRINT_ERRORS = true;
+    Buoy* pBuoy = NULL;
+
+    Vector pos;
+
+    if ( desc.GetPos( &pos, PRINT_ERRORS ) )
+    {
+        const bool OPTIONAL = true;
+        F32 radius = Buoy::DEFAULT_RADIUS;
+        desc.GetFloat( EntityDesc::eF_Radius, &radius, PRINT_ERRORS, OPTIONAL );
+
+        pBuoy = new Buoy();
+        if ( !pBuoy->Init( pSceneManager, pPhysicsWorld, radius ) )
+        {
+            fprintf( stderr, "Error: Unable to initialise buoy\n" );
+            delete pBuoy;
+            pBuoy = NULL;
+        }
+        else
+        {
+            pBuoy->SetPosition( pos );
+        }
+    }
+
+    return pBuoy;
+}
+
+//------------------------------------------------------------------------------
+CoordinateSystemAxes* EF_BuildCoordinateSystemAxes( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager )
+{
+    const bool PRINT_ERRORS = true;
+    CoordinateSystemAxes* pCoordinateSystemAxes = NULL;
+
+    Vector pos;
+
+    if ( desc.GetPos( &pos, PRINT_ERRORS ) )
+    {
+        pCoordinateSystemAxes = new CoordinateSystemAxes();
+        if ( !pCoordinateSystemAxes->Init( pSceneManager ) )
+        {
+            fprintf( stderr, "Error: Unable to initialise coordinate system axes\n" );
+            delete pCoordinateSystemAxes;
+            pCoordinateSystemAxes = NULL;
+        }
+        else
+        {
+            pCoordinateSystemAxes->SetPosition( pos );
+        }
+    }
+
+    return pCoordinateSystemAxes;
+}
+
+//------------------------------------------------------------------------------
+FloorTarget* EF_BuildFloorTarget( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager )
+{
+    const bool PRINT_ERRORS = true;
+    FloorTarget* pFloorTarget = NULL;
+
+    Vector pos;
+
+    if ( desc.GetPos( &pos, PRINT_ERRORS ) )
+    {
+        pFloorTarget = new FloorTarget();
+        if ( !pFloorTarget->Init( pSceneManager ) )
+        {
+            fprintf( stderr, "Error: Unable to initialise floor target\n" );
+            delete pFloorTarget;
+            pFloorTarget = NULL;
+        }
+        else
+        {
+            pFloorTarget->SetPosition( pos );
+        }
+    }
+
+    return pFloorTarget;
+}
+
+//------------------------------------------------------------------------------
+Gate* EF_BuildGate( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager )
+{
+    const bool PRINT_ERRORS = true;
+    Gate* pGate = NULL;
+
+    Vector pos;
+
+    if ( desc.GetPos( &pos, PRINT_ERRORS ) )
+    {
+        const bool OPTIONAL = true;
+        F32 width = Gate::DEFAULT_WIDTH;
+        F32 height = Gate::DEFAULT_HEIGHT;
+        desc.GetFloat( EntityDesc::eF_Width, &width, PRINT_ERRORS, OPTIONAL );
+        desc.GetFloat( EntityDesc::eF_Height, &height, PRINT_ERRORS, OPTIONAL );
+
+        pGate = new Gate();
+        if ( !pGate->Init( pSceneManager, width, height ) )
+        {
+            fprintf( stderr, "Error: Unable to initialise gate\n" );
+            delete pGate;
+            pGate = NULL;
+        }
+        else
+        {
+            pGate->SetPosition( pos );
+            EF_SetRotation( desc, pGate );
+        }
+    }
+
+    return pGate;
+}
+
+//------------------------------------------------------------------------------
+Pool* EF_BuildPool( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager )
+{
+    const bool PRINT_ERRORS = true;
+    Pool* pPool = NULL;
+
+    Vector pos;
+
+    if ( desc.GetPos( &pos, PRINT_ERRORS ) )
+    {
+        pPool = new Pool();
+        if ( !pPool->Init( pSceneManager ) )
+        {
+            fprintf( stderr, "Error: Unable to initialise pool\n" );
+            delete pPool;
+            pPool = NULL;
+        }
+        else
+        {
+            pPool->SetPosition( pos );
+        }
+    }
+
+    return pPool;
+}
+
+//------------------------------------------------------------------------------
+CircularPool* EF_BuildCircularPool( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager )
+{
+    const bool PRINT_ERRORS = true;
+    CircularPool* pCircularPool = NULL;
+
+    Vector pos;
+
+    if ( desc.GetPos( &pos, PRINT_ERRORS ) )
+    {
+        const bool OPTIONAL = true;
+        F32 radius = CircularPool::DEFAULT_RADIUS;
+        desc.GetFloat( EntityDesc::eF_Radius, &radius, PRINT_ERRORS, OPTIONAL );
+
+        pCircularPool = new CircularPool();
+        if ( !pCircularPool->Init( pSceneManager, radius ) )
+        {
+            fprintf( stderr, "Error: Unable to initialise circular pool\n" );
+            delete pCircularPool;
+            pCircularPool = NULL;
+        }
+        else
+        {
+            pCircularPool->SetPosition( pos );
+        }
+    }
+
+    return pCircularPool;
+}
+
+//------------------------------------------------------------------------------
+HarbourFloor* EF_BuildHarbourFloor( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager )
+{
+    const bool PRINT_ERRORS = true;
+    HarbourFloor* pHarbourFloor = NULL;
+
+    Vector pos;
+
+    if ( desc.GetPos( &pos, PRINT_ERRORS ) )
+    {
+        pHarbourFloor = new HarbourFloor();
+        if ( !pHarbourFloor->Init( pSceneManager ) )
+        {
+            fprintf( stderr, "Error: Unable to initialise harbour floor\n" );
+            delete pHarbourFloor;
+            pHarbourFloor = NULL;
+        }
+        else
+        {
+            pHarbourFloor->SetPosition( pos );
+        }
+    }
+
+    return pHarbourFloor;
+}
+
+//------------------------------------------------------------------------------
+Pipe* EF_BuildPipe( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager )
+{
+    const bool PRINT_ERRORS = true;
+    Pipe* pPipe = NULL;
+
+    Vector pos;
+
+    if ( desc.GetPos( &pos, PRINT_ERRORS ) )
+    {
+        pPipe = new Pipe();
+        if ( !pPipe->Init( pSceneManager ) )
+        {
+            fprintf( stderr, "Error: Unable to initialise pipe\n" );
+            delete pPipe;
+            pPipe = NULL;
+        }
+        else
+        {
+            pPipe->SetPosition( pos );
+        }
+    }
+
+    return pPipe;
+}
+
+//------------------------------------------------------------------------------
+SurveyWall* EF_BuildSurveyWall( const EntityDesc& desc, irr::scene::ISceneManager* pSceneManager )
+{
+    const bool PRINT_ERRORS = true;
+    SurveyWall* pSurveyWall = NULL;
+
+    Vector pos;
+
+    if ( desc.GetPos( &pos, PRINT_ERRORS ) )
+    {
+        pSurveyWall = new SurveyWall();
+        if ( !pSurveyWall->Init( pSceneManager ) )
+        {
+            fprintf( stderr, "Error: Unable to initialise survey wall\n" );
+            delete pSurveyWall;
+            pSurveyWall = NULL;
+        }
+        else
+        {
+            pSurveyWall->SetPosition( pos );
+            EF_SetRotation( desc, pSurveyWall );
+        }
+    }
+
+    return pSurveyWall;
+}
+
+//------------------------------------------------------------------------------
+void EF_SetRotation( const EntityDesc& desc, Entity* pEntity )
+{
+    // Rotations are optional and given in degrees
+    const bool PRINT_ERRORS = true;
+    const bool OPTIONAL = true;
+    Vector rotationDegrees;
+
+    if ( desc.GetVector( EntityDesc::eV_Rotation, &rotationDegrees, PRINT_ERRORS, OPTIONAL ) )
+    {
+        pEntity->SetRotation( Vector(
+            MathUtils::DegToRad( rotationDegrees.mX ),
+            MathUtils::DegToRad( rotationDegrees.mY ),
+            MathUtils::DegToRad( rotationDegrees.mZ ) ) );
+    }
+}
+
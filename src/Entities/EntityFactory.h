@@ -0,0 +1,33 @@
+//------------------------------------------------------------------------------
+// File: EntityFactory.h
+// Desc: Builds entities from the descriptions read in from world files.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef ENTITY_FACTORY_H
+#define ENTITY_FACTORY_H
+
+//------------------------------------------------------------------------------
+#include "Common.h"
+#include "Entity.h"
+#include "EntityDesc.h"
+
+//------------------------------------------------------------------------------
+class btDiscreteDynamicsWorld;
+
+//------------------------------------------------------------------------------
+class EntityFactory
+{
+    //--------------------------------------------------------------------------
+    // Creates and initialises the entity that desc describes. Entities that
+    // aren't given a name are named after entityIdx, their place in the
+    // world. Returns NULL if the entity can't be built, after printing out
+    // what the problem was
+    public: static Entity* BuildEntity( const EntityDesc& desc,
+                                        S32 entityIdx,
+                                        irr::scene::ISceneManager* pSceneManager,
+                                        irr::video::IVideoDriver* pVideoDriver,
+                                        btDiscreteDynamicsWorld* pPhysicsWorld );
+};
+
+#endif // ENTITY_FACTORY_H
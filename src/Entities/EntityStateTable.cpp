@@ -0,0 +1,29 @@
+//------------------------------------------------------------------------------
+// File: EntityStateTable.cpp
+// Desc: The state of a set of entities stored as a table with one array per
+//       field.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "EntityStateTable.h"
+
+//------------------------------------------------------------------------------
+void EntityStateTable::Resize( U32 numEntities )
+{
+    const Vector ZERO( 0.0f, 0.0f, 0.0f );
+    mPositions.resize( numEntities, ZERO );
+    mRotations.resize( numEntities, ZERO );
+    mLinearVelocities.resize( numEntities, ZERO );
+    mAngularVelocities.resize( numEntities, ZERO );
+    mPoseVersions.resize( numEntities, 0 );
+}
+
+//------------------------------------------------------------------------------
+void EntityStateTable::GetState( U32 entityIdx, EntityState* pStateOut ) const
+{
+    pStateOut->mPosition = mPositions[ entityIdx ];
+    pStateOut->mRotation = mRotations[ entityIdx ];
+    pStateOut->mLinearVelocity = mLinearVelocities[ entityIdx ];
+    pStateOut->mAngularVelocity = mAngularVelocities[ entityIdx ];
+    pStateOut->mPoseVersion = mPoseVersions[ entityIdx ];
+}
@@ -0,0 +1,45 @@
+//------------------------------------------------------------------------------
+// File: EntityStateTable.h
+// Desc: The state of a set of entities stored as a table with one array per
+//       field, so that passes over many entities only touch the fields they
+//       need, and so that copying a table is a handful of block copies.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef ENTITY_STATE_TABLE_H
+#define ENTITY_STATE_TABLE_H
+
+//------------------------------------------------------------------------------
+#include <vector>
+#include "Common.h"
+#include "Vector.h"
+
+//------------------------------------------------------------------------------
+// The state of a single entity, gathered from the columns of a table
+struct EntityState
+{
+    Vector mPosition;
+    Vector mRotation;
+    Vector mLinearVelocity;     // In the body frame of the entity
+    Vector mAngularVelocity;
+    U32 mPoseVersion;           // From Entity::GetPoseVersion
+};
+
+//------------------------------------------------------------------------------
+// The states of all of the entities in the world, indexed by entity handle
+class EntityStateTable
+{
+    public: std::vector<Vector> mPositions;
+    public: std::vector<Vector> mRotations;
+    public: std::vector<Vector> mLinearVelocities;
+    public: std::vector<Vector> mAngularVelocities;
+    public: std::vector<U32> mPoseVersions;
+
+    //--------------------------------------------------------------------------
+    // New entries are at the origin and not moving
+    public: void Resize( U32 numEntities );
+    public: U32 GetNumEntities() const { return mPositions.size(); }
+    public: void GetState( U32 entityIdx, EntityState* pStateOut ) const;
+};
+
+#endif // ENTITY_STATE_TABLE_H
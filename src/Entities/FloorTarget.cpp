@@ -5,6 +5,7 @@
 
 //------------------------------------------------------------------------------
 #include "FloorTarget.h"
+#include "MeshCache.h"
 #include "Common/MathUtils.h"
 
 //------------------------------------------------------------------------------
@@ -44,36 +45,20 @@ bool FloorTarget::Init( irr::scene::ISceneManager* pSceneManager )
             return false;
         }
         
-        // Create a cylinder and cross to represent the target
-        const irr::scene::IGeometryCreator* pCreator = pSceneManager->getGeometryCreator();
-        
-        mpMainMesh = pCreator->createCylinderMesh( RADIUS, HEIGHT, 16, MAIN_COLOUR );
-        mpCrossMeshA = pCreator->createCubeMesh( irr::core::vector3df( 2.0*CROSS_RADIUS, HEIGHT, CROSS_WIDTH ) );
-        mpCrossMeshB = pCreator->createCubeMesh( irr::core::vector3df( CROSS_WIDTH, HEIGHT, 2.0*CROSS_RADIUS ) );
-           if ( NULL == mpMainMesh
+        // Create a cylinder and cross to represent the target. The meshes are
+        // shared by all floor targets
+        mpMainMesh = MeshCache::GetCylinderMesh( pSceneManager, RADIUS, HEIGHT, 16, MAIN_COLOUR );
+        mpCrossMeshA = MeshCache::GetCubeMesh( pSceneManager,
+            irr::core::vector3df( 2.0*CROSS_RADIUS, HEIGHT, CROSS_WIDTH ), CROSS_COLOUR );
+        mpCrossMeshB = MeshCache::GetCubeMesh( pSceneManager,
+            irr::core::vector3df( CROSS_WIDTH, HEIGHT, 2.0*CROSS_RADIUS ), CROSS_COLOUR );
+        if ( NULL == mpMainMesh
             || NULL == mpCrossMeshA || NULL == mpCrossMeshB )
         {
             DeInit();
             return false;
         }
         
-        // Change colour of cross
-        irr::scene::IMeshBuffer* pMeshBuffer = mpCrossMeshA->getMeshBuffer( 0 );
-        S32 numVertices = pMeshBuffer->getVertexCount();
-        irr::video::S3DVertex* pVertices = (irr::video::S3DVertex*)pMeshBuffer->getVertices();
-        for ( S32 vertexIdx = 0; vertexIdx < numVertices; vertexIdx++ )
-        {
-            pVertices[ vertexIdx ].Color = CROSS_COLOUR;
-        } 
-        
-        pMeshBuffer = mpCrossMeshB->getMeshBuffer( 0 );
-        numVertices = pMeshBuffer->getVertexCount();
-        pVertices = (irr::video::S3DVertex*)pMeshBuffer->getVertices();
-        for ( S32 vertexIdx = 0; vertexIdx < numVertices; vertexIdx++ )
-        {
-            pVertices[ vertexIdx ].Color = CROSS_COLOUR;
-        } 
-        
         mpMainMeshNode = pSceneManager->addMeshSceneNode( mpMainMesh );
         mpCrossMeshANode = pSceneManager->addMeshSceneNode( mpCrossMeshA );
         mpCrossMeshBNode = pSceneManager->addMeshSceneNode( mpCrossMeshB );
@@ -98,6 +83,11 @@ bool FloorTarget::Init( irr::scene::ISceneManager* pSceneManager )
         AddChildNode( mpMainMeshNode );
         AddChildNode( mpCrossMeshANode );
         AddChildNode( mpCrossMeshBNode );
+        
+        // Floor targets don't move so all of them are merged and drawn together
+        MeshCache::AddToBatch( pSceneManager, eT_FloorTarget, BatchSceneNode::eM_Static, mpMainMeshNode );
+        MeshCache::AddToBatch( pSceneManager, eT_FloorTarget, BatchSceneNode::eM_Static, mpCrossMeshANode );
+        MeshCache::AddToBatch( pSceneManager, eT_FloorTarget, BatchSceneNode::eM_Static, mpCrossMeshBNode );
 
         mbInitialised = true;
     }
@@ -108,6 +98,9 @@ bool FloorTarget::Init( irr::scene::ISceneManager* pSceneManager )
 //------------------------------------------------------------------------------
 void FloorTarget::DeInit()
 {
+    MeshCache::RemoveFromBatch( GetSceneManager(), mpMainMeshNode );
+    MeshCache::RemoveFromBatch( GetSceneManager(), mpCrossMeshANode );
+    MeshCache::RemoveFromBatch( GetSceneManager(), mpCrossMeshBNode );
     RemoveAllChildNodes();
     
     mpMainMeshNode = NULL;
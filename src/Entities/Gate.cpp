@@ -5,6 +5,7 @@
 
 //------------------------------------------------------------------------------
 #include "Gate.h"
+#include "MeshCache.h"
 #include "Common/MathUtils.h"
 
 //------------------------------------------------------------------------------
@@ -44,13 +45,12 @@ bool Gate::Init( irr::scene::ISceneManager* pSceneManager, F32 width, F32 height
             return false;
         }
         
-        // Create cylinders to represent the gate
-        const irr::scene::IGeometryCreator* pCreator = pSceneManager->getGeometryCreator();
-        
-        mpTopMesh = pCreator->createCylinderMesh( STRUT_RADIUS, width, 16, COLOUR );
-        mpBottomMesh = pCreator->createCylinderMesh( STRUT_RADIUS, width, 16, COLOUR );
-        mpLeftMesh = pCreator->createCylinderMesh( STRUT_RADIUS, height, 16, COLOUR );
-        mpRightMesh = pCreator->createCylinderMesh( STRUT_RADIUS, height, 16, COLOUR );
+        // Create cylinders to represent the gate. Struts of the same length
+        // share a mesh, both within the gate and with other gates
+        mpTopMesh = MeshCache::GetCylinderMesh( pSceneManager, STRUT_RADIUS, width, 16, COLOUR );
+        mpBottomMesh = MeshCache::GetCylinderMesh( pSceneManager, STRUT_RADIUS, width, 16, COLOUR );
+        mpLeftMesh = MeshCache::GetCylinderMesh( pSceneManager, STRUT_RADIUS, height, 16, COLOUR );
+        mpRightMesh = MeshCache::GetCylinderMesh( pSceneManager, STRUT_RADIUS, height, 16, COLOUR );
         if ( NULL == mpTopMesh || NULL == mpBottomMesh 
             || NULL == mpLeftMesh || NULL == mpRightMesh )
         {
@@ -91,6 +91,12 @@ bool Gate::Init( irr::scene::ISceneManager* pSceneManager, F32 width, F32 height
         AddChildNode( mpBottomMeshNode );
         AddChildNode( mpLeftMeshNode );
         AddChildNode( mpRightMeshNode );
+        
+        // Gates don't move so all of them are merged and drawn together
+        MeshCache::AddToBatch( pSceneManager, eT_Gate, BatchSceneNode::eM_Static, mpTopMeshNode );
+        MeshCache::AddToBatch( pSceneManager, eT_Gate, BatchSceneNode::eM_Static, mpBottomMeshNode );
+        MeshCache::AddToBatch( pSceneManager, eT_Gate, BatchSceneNode::eM_Static, mpLeftMeshNode );
+        MeshCache::AddToBatch( pSceneManager, eT_Gate, BatchSceneNode::eM_Static, mpRightMeshNode );
 
         mbInitialised = true;
     }
@@ -101,6 +107,10 @@ bool Gate::Init( irr::scene::ISceneManager* pSceneManager, F32 width, F32 height
 //------------------------------------------------------------------------------
 void Gate::DeInit()
 {
+    MeshCache::RemoveFromBatch( GetSceneManager(), mpTopMeshNode );
+    MeshCache::RemoveFromBatch( GetSceneManager(), mpBottomMeshNode );
+    MeshCache::RemoveFromBatch( GetSceneManager(), mpLeftMeshNode );
+    MeshCache::RemoveFromBatch( GetSceneManager(), mpRightMeshNode );
     RemoveAllChildNodes();
     
     if ( NULL != mpTopMeshNode )
@@ -0,0 +1,318 @@
+//------------------------------------------------------------------------------
+// File: MeshCache.cpp
+// Desc: Shares the simple meshes made by Irrlicht's geometry creator between
+//       all of the entities that ask for the same shape, and batches the
+//       drawing of entities of the same type.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "MeshCache.h"
+
+#include <stdio.h>
+#include <pthread.h>
+#include <string.h>
+#include <map>
+
+//------------------------------------------------------------------------------
+enum eMeshShape
+{
+    eMS_Sphere = 0,
+    eMS_Cylinder,
+    eMS_Cube
+};
+
+//------------------------------------------------------------------------------
+// Everything that goes into making a mesh
+struct MeshKey
+{
+    MeshKey( eMeshShape shape, F32 sizeX, F32 sizeY, F32 sizeZ,
+             U32 tessellationA, U32 tessellationB, const irr::video::SColor& colour )
+        : mShape( shape ),
+        mTessellationA( tessellationA ),
+        mTessellationB( tessellationB ),
+        mColour( colour.color )
+    {
+        mSize[ 0 ] = sizeX;
+        mSize[ 1 ] = sizeY;
+        mSize[ 2 ] = sizeZ;
+    }
+
+    bool operator<( const MeshKey& other ) const
+    {
+        if ( mShape != other.mShape ) return mShape < other.mShape;
+        for ( U32 axisIdx = 0; axisIdx < 3; axisIdx++ )
+        {
+            if ( mSize[ axisIdx ] != other.mSize[ axisIdx ] ) return mSize[ axisIdx ] < other.mSize[ axisIdx ];
+        }
+        if ( mTessellationA != other.mTessellationA ) return mTessellationA < other.mTessellationA;
+        if ( mTessellationB != other.mTessellationB ) return mTessellationB < other.mTessellationB;
+        return mColour < other.mColour;
+    }
+
+    eMeshShape mShape;
+    F32 mSize[ 3 ];
+    U32 mTessellationA;
+    U32 mTessellationB;
+    U32 mColour;
+};
+
+typedef std::map<MeshKey, irr::scene::IMesh*> MeshMap;
+
+//------------------------------------------------------------------------------
+// The shared meshes and batches of one scene manager
+struct SceneResources
+{
+    SceneResources()
+    {
+        for ( S32 typeIdx = 0; typeIdx < Entity::eT_NumTypes; typeIdx++ )
+        {
+            mpBatches[ typeIdx ] = NULL;
+        }
+    }
+
+    MeshMap mMeshes;
+    BatchSceneNode* mpBatches[ Entity::eT_NumTypes ];
+};
+
+typedef std::map<irr::scene::ISceneManager*, SceneResources> SceneResourcesMap;
+
+//------------------------------------------------------------------------------
+// The resources of every scene manager. Entities are created on the thread
+// that owns their scene manager, and several simulators may be creating
+// entities at once, so the map is only used with the mutex held
+static pthread_mutex_t gMeshCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static SceneResourcesMap gSceneResources;
+
+//------------------------------------------------------------------------------
+// Creates a mesh for the key. Returns NULL if it can't be created
+static irr::scene::IMesh* CreateMesh( irr::scene::ISceneManager* pSceneManager, const MeshKey& key )
+{
+    const irr::scene::IGeometryCreator* pCreator = pSceneManager->getGeometryCreator();
+    irr::video::SColor colour( key.mColour );
+
+    irr::scene::IMesh* pMesh = NULL;
+    switch ( key.mShape )
+    {
+        case eMS_Sphere:
+        {
+            pMesh = pCreator->createSphereMesh( key.mSize[ 0 ], key.mTessellationA, key.mTessellationB );
+            break;
+        }
+        case eMS_Cylinder:
+        {
+            pMesh = pCreator->createCylinderMesh( key.mSize[ 0 ], key.mSize[ 1 ], key.mTessellationA, colour );
+            break;
+        }
+        case eMS_Cube:
+        {
+            pMesh = pCreator->createCubeMesh(
+                irr::core::vector3df( key.mSize[ 0 ], key.mSize[ 1 ], key.mSize[ 2 ] ) );
+            break;
+        }
+    }
+
+    if ( NULL == pMesh )
+    {
+        return NULL;
+    }
+
+    // The geometry creator doesn't colour every shape so the colour is set
+    // here, once for all of the entities that share the mesh
+    for ( U32 bufferIdx = 0; bufferIdx < pMesh->getMeshBufferCount(); bufferIdx++ )
+    {
+        irr::scene::IMeshBuffer* pMeshBuffer = pMesh->getMeshBuffer( bufferIdx );
+        if ( irr::video::EVT_STANDARD == pMeshBuffer->getVertexType() )
+        {
+            S32 numVertices = pMeshBuffer->getVertexCount();
+            irr::video::S3DVertex* pVertices = (irr::video::S3DVertex*)pMeshBuffer->getVertices();
+            for ( S32 vertexIdx = 0; vertexIdx < numVertices; vertexIdx++ )
+            {
+                pVertices[ vertexIdx ].Color = colour;
+            }
+        }
+    }
+
+    // The mesh never changes after this so it can live in video memory
+    pMesh->setHardwareMappingHint( irr::scene::EHM_STATIC );
+
+    return pMesh;
+}
+
+//------------------------------------------------------------------------------
+// Finds or creates the mesh for the key, and grabs it for the caller
+static irr::scene::IMesh* GetMesh( irr::scene::ISceneManager* pSceneManager, const MeshKey& key )
+{
+    pthread_mutex_lock( &gMeshCacheMutex );
+
+    MeshMap& meshes = gSceneResources[ pSceneManager ].mMeshes;
+    irr::scene::IMesh* pMesh = NULL;
+
+    MeshMap::iterator meshIter = meshes.find( key );
+    if ( meshes.end() != meshIter )
+    {
+        pMesh = meshIter->second;
+    }
+    else
+    {
+        // The cache keeps the reference that comes with the new mesh
+        pMesh = CreateMesh( pSceneManager, key );
+        if ( NULL != pMesh )
+        {
+            meshes[ key ] = pMesh;
+        }
+    }
+
+    if ( NULL != pMesh )
+    {
+        pMesh->grab();
+    }
+
+    pthread_mutex_unlock( &gMeshCacheMutex );
+    return pMesh;
+}
+
+//------------------------------------------------------------------------------
+irr::scene::IMesh* MeshCache::GetSphereMesh( irr::scene::ISceneManager* pSceneManager,
+    F32 radius, const irr::video::SColor& colour, U32 polyCountX, U32 polyCountY )
+{
+    return GetMesh( pSceneManager,
+        MeshKey( eMS_Sphere, radius, 0.0f, 0.0f, polyCountX, polyCountY, colour ) );
+}
+
+//------------------------------------------------------------------------------
+irr::scene::IMesh* MeshCache::GetCylinderMesh( irr::scene::ISceneManager* pSceneManager,
+    F32 radius, F32 length, U32 tessellation, const irr::video::SColor& colour )
+{
+    return GetMesh( pSceneManager,
+        MeshKey( eMS_Cylinder, radius, length, 0.0f, tessellation, 0, colour ) );
+}
+
+//------------------------------------------------------------------------------
+irr::scene::IMesh* MeshCache::GetCubeMesh( irr::scene::ISceneManager* pSceneManager,
+    const irr::core::vector3df& size, const irr::video::SColor& colour )
+{
+    return GetMesh( pSceneManager,
+        MeshKey( eMS_Cube, size.X, size.Y, size.Z, 0, 0, colour ) );
+}
+
+//------------------------------------------------------------------------------
+bool MeshCache::AddToBatch( irr::scene::ISceneManager* pSceneManager, Entity::eType type,
+                            BatchSceneNode::eMode mode, irr::scene::IMeshSceneNode* pMeshNode )
+{
+    if ( type < 0 || type >= Entity::eT_NumTypes || NULL == pMeshNode )
+    {
+        return false;
+    }
+
+    pthread_mutex_lock( &gMeshCacheMutex );
+
+    BatchSceneNode*& pBatch = gSceneResources[ pSceneManager ].mpBatches[ type ];
+    if ( NULL == pBatch )
+    {
+        // The scene graph and the cache both hold on to the batch
+        pBatch = new BatchSceneNode( pSceneManager->getRootSceneNode(), pSceneManager, mode );
+    }
+
+    bool bAdded = ( mode == pBatch->GetMode() );
+    if ( bAdded )
+    {
+        pBatch->AddMember( pMeshNode );
+    }
+    else
+    {
+        fprintf( stderr, "Warning: All %s entities must be batched in the same way\n",
+            Entity::ConvertTypeToString( type ) );
+    }
+
+    pthread_mutex_unlock( &gMeshCacheMutex );
+    return bAdded;
+}
+
+//------------------------------------------------------------------------------
+void MeshCache::RemoveFromBatch( irr::scene::ISceneManager* pSceneManager,
+                                 irr::scene::IMeshSceneNode* pMeshNode )
+{
+    pthread_mutex_lock( &gMeshCacheMutex );
+
+    SceneResourcesMap::iterator sceneIter = gSceneResources.find( pSceneManager );
+    if ( gSceneResources.end() != sceneIter )
+    {
+        for ( S32 typeIdx = 0; typeIdx < Entity::eT_NumTypes; typeIdx++ )
+        {
+            BatchSceneNode* pBatch = sceneIter->second.mpBatches[ typeIdx ];
+            if ( NULL != pBatch )
+            {
+                pBatch->RemoveMember( pMeshNode );
+            }
+        }
+    }
+
+    pthread_mutex_unlock( &gMeshCacheMutex );
+}
+
+//------------------------------------------------------------------------------
+BatchSceneNode* MeshCache::GetBatch( irr::scene::ISceneManager* pSceneManager, Entity::eType type )
+{
+    if ( type < 0 || type >= Entity::eT_NumTypes )
+    {
+        return NULL;
+    }
+
+    pthread_mutex_lock( &gMeshCacheMutex );
+
+    BatchSceneNode* pBatch = NULL;
+    SceneResourcesMap::const_iterator sceneIter = gSceneResources.find( pSceneManager );
+    if ( gSceneResources.end() != sceneIter )
+    {
+        pBatch = sceneIter->second.mpBatches[ type ];
+    }
+
+    pthread_mutex_unlock( &gMeshCacheMutex );
+    return pBatch;
+}
+
+//------------------------------------------------------------------------------
+void MeshCache::ReleaseSceneManager( irr::scene::ISceneManager* pSceneManager )
+{
+    pthread_mutex_lock( &gMeshCacheMutex );
+
+    SceneResourcesMap::iterator sceneIter = gSceneResources.find( pSceneManager );
+    if ( gSceneResources.end() != sceneIter )
+    {
+        SceneResources& resources = sceneIter->second;
+        for ( S32 typeIdx = 0; typeIdx < Entity::eT_NumTypes; typeIdx++ )
+        {
+            BatchSceneNode* pBatch = resources.mpBatches[ typeIdx ];
+            if ( NULL != pBatch )
+            {
+                pBatch->remove();
+                pBatch->drop();
+            }
+        }
+
+        MeshMap& meshes = resources.mMeshes;
+        for ( MeshMap::iterator meshIter = meshes.begin(); meshes.end() != meshIter; ++meshIter )
+        {
+            meshIter->second->drop();
+        }
+        gSceneResources.erase( sceneIter );
+    }
+
+    pthread_mutex_unlock( &gMeshCacheMutex );
+}
+
+//------------------------------------------------------------------------------
+U32 MeshCache::GetNumCachedMeshes( irr::scene::ISceneManager* pSceneManager )
+{
+    pthread_mutex_lock( &gMeshCacheMutex );
+
+    U32 numMeshes = 0;
+    SceneResourcesMap::const_iterator sceneIter = gSceneResources.find( pSceneManager );
+    if ( gSceneResources.end() != sceneIter )
+    {
+        numMeshes = sceneIter->second.mMeshes.size();
+    }
+
+    pthread_mutex_unlock( &gMeshCacheMutex );
+    return numMeshes;
+}
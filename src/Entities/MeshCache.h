@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+// File: MeshCache.h
+// Desc: Shares the simple meshes made by Irrlicht's geometry creator between
+//       all of the entities that ask for the same shape. Meshes are looked up
+//       by their shape, dimensions, tessellation and colour, so a world with
+//       dozens of buoys holds a single buoy mesh. Cached meshes are marked
+//       as static so that the video driver keeps their vertices in a
+//       hardware buffer rather than sending them every time they're drawn.
+//
+//       The mesh nodes of entities of the same type can also be put in a
+//       BatchSceneNode so that they're drawn together rather than one node
+//       at a time.
+//
+//       Each scene manager has its own set of meshes and batches, as
+//       Irrlicht's reference counting isn't safe to share between threads.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+//------------------------------------------------------------------------------
+#include <irrlicht/irrlicht.h>
+#include "Common.h"
+#include "Entity.h"
+#include "BatchSceneNode.h"
+
+//------------------------------------------------------------------------------
+class MeshCache
+{
+    //--------------------------------------------------------------------------
+    // These hand out a mesh that's been grabbed for the caller, so it must
+    // be dropped when it's no longer needed, just as if it had come from the
+    // geometry creator. Meshes are shared and so must not be changed. All of
+    // the vertices of a mesh are given the colour asked for. NULL is
+    // returned if the mesh can't be created
+    public: static irr::scene::IMesh* GetSphereMesh( irr::scene::ISceneManager* pSceneManager,
+        F32 radius, const irr::video::SColor& colour,
+        U32 polyCountX = DEFAULT_SPHERE_POLY_COUNT, U32 polyCountY = DEFAULT_SPHERE_POLY_COUNT );
+    public: static irr::scene::IMesh* GetCylinderMesh( irr::scene::ISceneManager* pSceneManager,
+        F32 radius, F32 length, U32 tessellation, const irr::video::SColor& colour );
+    public: static irr::scene::IMesh* GetCubeMesh( irr::scene::ISceneManager* pSceneManager,
+        const irr::core::vector3df& size, const irr::video::SColor& colour );
+
+    //--------------------------------------------------------------------------
+    // Hands a mesh node over to the batch for an entity type, which is made
+    // the first time it's asked for. All of the nodes of a type must use the
+    // same mode. Nodes must be removed from their batch before they're
+    // removed from the scene graph
+    public: static bool AddToBatch( irr::scene::ISceneManager* pSceneManager, Entity::eType type,
+                                    BatchSceneNode::eMode mode, irr::scene::IMeshSceneNode* pMeshNode );
+    public: static void RemoveFromBatch( irr::scene::ISceneManager* pSceneManager,
+                                         irr::scene::IMeshSceneNode* pMeshNode );
+
+    //--------------------------------------------------------------------------
+    // Returns NULL if nothing of the type has been batched
+    public: static BatchSceneNode* GetBatch( irr::scene::ISceneManager* pSceneManager, Entity::eType type );
+
+    //--------------------------------------------------------------------------
+    // Drops the cache's hold on all of the meshes made for a scene manager,
+    // and takes its batches out of the scene graph. Should be called once the
+    // scene manager's entities have been destroyed and before the scene
+    // manager is
+    public: static void ReleaseSceneManager( irr::scene::ISceneManager* pSceneManager );
+
+    //--------------------------------------------------------------------------
+    public: static U32 GetNumCachedMeshes( irr::scene::ISceneManager* pSceneManager );
+
+    public: static const U32 DEFAULT_SPHERE_POLY_COUNT = 16;
+};
+
+#endif // MESH_CACHE_H
@@ -94,10 +94,10 @@ bool Sub::Init( irr::scene::ISceneManager* pSceneManager,
         AddChildNode( mpBodyMeshNode );
         
         // Add a camera to the nose of the submarine
-        /*if ( pVideoDriver->queryFeature( irr::video::EVDF_RENDER_TO_TARGET ) )
+        if ( pVideoDriver->queryFeature( irr::video::EVDF_RENDER_TO_TARGET ) )
         {
-            snprintf( mRenderTargetName, sizeof( mRenderTargetName ), "RTT_%x", *(int*)this );
-            mRenderTargetName[ sizeof( mRenderTargetName ) ] = '\0';
+            snprintf( mRenderTargetName, sizeof( mRenderTargetName ), "RTT_%p", (void*)this );
+            mRenderTargetName[ sizeof( mRenderTargetName ) - 1 ] = '\0';
             mpCameraRenderTarget = pVideoDriver->addRenderTargetTexture(
                 irr::core::dimension2d<U32>(320,240), mRenderTargetName );
                 
@@ -115,7 +115,7 @@ bool Sub::Init( irr::scene::ISceneManager* pSceneManager,
             // Put the camera node under the control of SubSim
             AddChildNode( mpCameraNode );
         }
-        else*/
+        else
         {
             fprintf( stderr, "Warning: Render to texture not available. "
                 "So the submarine will have no camera\n" );
@@ -125,6 +125,8 @@ bool Sub::Init( irr::scene::ISceneManager* pSceneManager,
         mDepthSpeed = 0.0f;
         mYawSpeed = 0.0f;
         mPitchSpeed = 0.0f;
+        *mpLinearVelocity = Vector( 0.0f, 0.0f, 0.0f );
+        *mpAngularVelocity = Vector( 0.0f, 0.0f, 0.0f );
         mbInitialised = true;
     }
 
@@ -190,16 +192,48 @@ void Sub::Update( F32 timeStep )
         newDepth += BUOYANCY_SPEED*timeStep;
     }
     
-    SetPosition( newPos );
-    SetRotation( mRotation );
-    SetYaw( newYaw );
-    SetPitch( newPitch );
-    SetDepth( newDepth );
+    // Set the whole pose in one go rather than a component at a time
+    newPos.mZ = newDepth;
+    SetPose( newPos, Vector( newPitch, mpRotation->mY, newYaw ) );
+    
+    // The depth overrides any vertical motion along the heading so the sub
+    // only moves horizontally when going forwards
+    if ( timeStep > 0.0f )
+    {
+        *mpLinearVelocity = Vector( 0.0f, mForwardSpeed, ( newDepth - oldDepth )/timeStep );
+        *mpAngularVelocity = Vector( mPitchSpeed, 0.0f, mYawSpeed );
+    }
+}
+
+//------------------------------------------------------------------------------
+void Sub::ResetMotion()
+{
+    mForwardSpeed = 0.0f;
+    mDepthSpeed = 0.0f;
+    mYawSpeed = 0.0f;
+    mPitchSpeed = 0.0f;
+    *mpLinearVelocity = Vector( 0.0f, 0.0f, 0.0f );
+    *mpAngularVelocity = Vector( 0.0f, 0.0f, 0.0f );
+}
+
+//------------------------------------------------------------------------------
+void Sub::SetVelocities( const Vector& linearVelocity, const Vector& angularVelocity )
+{
+    *mpLinearVelocity = linearVelocity;
+    *mpAngularVelocity = angularVelocity;
+}
+
+//------------------------------------------------------------------------------
+void Sub::ApplyRenderTransform( const Vector& pos, const Vector& rotation )
+{
+    Entity::ApplyRenderTransform( pos, rotation );
     
     if ( NULL != mpCameraNode )
     {
-        Vector newHeading( -(F32)sin( newYaw ), (F32)cos( newYaw ), (F32)sin( newPitch ) );
-        Vector camTarget = newPos + 10.0f*newHeading;
+        F32 yaw = rotation.mZ;
+        F32 pitch = rotation.mX;
+        Vector heading( -(F32)sin( yaw ), (F32)cos( yaw ), (F32)sin( pitch ) );
+        Vector camTarget = pos + 10.0f*heading;
         irr::core::vector3df irrCamTarget = MathUtils::TransformVector_SubToIrr( camTarget );
         mpCameraNode->setTarget( irrCamTarget );
     }
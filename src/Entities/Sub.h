@@ -26,22 +26,40 @@ class Sub : public Entity
     //--------------------------------------------------------------------------
     // Updates the entity by a given number of seconds
     public: virtual void Update( F32 timeStep );
+    public: virtual bool NeedsUpdate() const { return true; }
+    
+    //--------------------------------------------------------------------------
+    // Sets the velocities that the sub moved at in the last update, which 
+    // are normally worked out by Update. Used when a saved state is restored
+    public: void SetVelocities( const Vector& linearVelocity, const Vector& angularVelocity );
+    
+    //--------------------------------------------------------------------------
+    // Clears the speed setpoints as well as the current velocities
+    public: virtual void ResetMotion();
+    
+    //--------------------------------------------------------------------------
+    // Also points the sub camera along the new heading
+    public: virtual void ApplyRenderTransform( const Vector& pos, const Vector& rotation );
     
     //--------------------------------------------------------------------------
     //! Sets the desired forward speed of the submarine in metres per second
     public: void SetForwardSpeed( F32 forwardSpeed ) { mForwardSpeed = forwardSpeed; }
+    public: F32 GetForwardSpeed() const { return mForwardSpeed; }
     
     //--------------------------------------------------------------------------
     //! Sets the desired depth speed of the submarine in metres per second
     public: void SetDepthSpeed( F32 depthSpeed ) { mDepthSpeed = depthSpeed; }
+    public: F32 GetDepthSpeed() const { return mDepthSpeed; }
     
     //--------------------------------------------------------------------------
     //! Sets the desired yaw speed of the submarine in radians per second
     public: void SetYawSpeed( F32 yawSpeed ) { mYawSpeed = yawSpeed; }
+    public: F32 GetYawSpeed() const { return mYawSpeed; }
 
     //--------------------------------------------------------------------------
     //! Sets the desired pitch speed of the submarine in radians per second
     public: void SetPitchSpeed( F32 pitchSpeed ) { mPitchSpeed = pitchSpeed; }
+    public: F32 GetPitchSpeed() const { return mPitchSpeed; }
     
     //--------------------------------------------------------------------------
     //! Gets the render target that the simulator will use to render the view
@@ -64,7 +82,7 @@ class Sub : public Entity
     private: F32 mPitchSpeed;
     private: irr::video::ITexture* mpCameraRenderTarget;
     private: irr::scene::ICameraSceneNode* mpCameraNode;
-    private: char mRenderTargetName[ 16 ];
+    private: char mRenderTargetName[ 32 ];
     
     private: static const F32 RADIUS;
     private: static const F32 NOSE_LENGTH;
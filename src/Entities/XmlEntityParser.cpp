@@ -8,630 +8,457 @@
 #include "XmlEntityParser.h"
 
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <string>
 
-#include <xercesc/parsers/XercesDOMParser.hpp>
-#include <xercesc/dom/DOM.hpp>
-#include <xercesc/sax/HandlerBase.hpp>
+#include <xercesc/sax2/SAX2XMLReader.hpp>
+#include <xercesc/sax2/XMLReaderFactory.hpp>
+#include <xercesc/sax2/DefaultHandler.hpp>
+#include <xercesc/sax2/Attributes.hpp>
+#include <xercesc/sax/Locator.hpp>
 #include <xercesc/util/XMLString.hpp>
+#include <xercesc/util/XMLUni.hpp>
 #include <xercesc/util/PlatformUtils.hpp>
 
-#include "Common/MathUtils.h"
-#include "Entities/Sub.h"
-#include "Entities/CoordinateSystemAxes.h"
-#include "Entities/Gate.h"
-#include "Entities/Buoy.h"
-#include "Entities/Pool.h"
-#include "Entities/CircularPool.h"
-#include "Entities/FloorTarget.h"
-#include "Entities/Pipe.h"
-#include "Entities/SurveyWall.h"
-#include "Entities/HarbourFloor.h"
+#include "Common/HighPrecisionTime.h"
+#include "Entities/EntityFactory.h"
 
 //------------------------------------------------------------------------------
-// Helper Routine Prototypes
-//------------------------------------------------------------------------------
-static Sub* XEP_BuildSub( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager, irr::video::IVideoDriver* pVideoDriver );
-static Buoy* XEP_BuildBuoy( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager, btDiscreteDynamicsWorld* pPhysicsWorld );
-static CoordinateSystemAxes* XEP_BuildCoordinateSystemAxes( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager );
-static FloorTarget* XEP_BuildFloorTarget( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager );
-static Gate* XEP_BuildGate( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager );
-static Pool* XEP_BuildPool( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager );
-static CircularPool* XEP_BuildCircularPool( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager );
-static HarbourFloor* XEP_BuildHarbourFloor( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager );
-static Pipe* XEP_BuildPipe( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager );
-static SurveyWall* XEP_BuildSurveyWall( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager );
-
-static void XEP_ParseAndSetRotation( xercesc::DOMNode* pNode, Entity* pEntity, bool bPrintErrors = false, bool bOptional = true );
-static bool XEP_GetPosVectorElement( xercesc::DOMNode* pNode, Vector* pPosOut, bool bPrintErrors = false );
-static bool XEP_GetVectorElement( xercesc::DOMNode* pNode, XMLCh* pTag, Vector* pVectorOut, bool bPrintErrors = false, bool bOptional = false );
-static bool XEP_GetFloatElement( xercesc::DOMNode* pNode, XMLCh* pTag, F32* pFloatOut, bool bPrintErrors = false, bool bOptional = false );
+// The elements and attributes that the parser understands. Their names are
+// transcoded once when a file is loaded and then compared against the names
+// coming out of the parser, rather than transcoding every name that the
+// parser gives us
+enum eXEP_Tag
+{
+    eXT_Unknown = -1,
+    eXT_Entity = 0,
+    eXT_Pos,
+    eXT_Rotation,
+    eXT_X,
+    eXT_Y,
+    eXT_Z,
+    eXT_Yaw,
+    eXT_Radius,
+    eXT_Width,
+    eXT_Height,
+
+    eXT_NumElementTags,
+
+    eXT_TypeAttribute = eXT_NumElementTags,
+    eXT_NameAttribute,
 
+    eXT_NumTags
+};
+
+static const char* XEP_TAG_NAMES[ eXT_NumTags ] =
+{
+    "entity",
+    "pos",
+    "rotation",
+    "x",
+    "y",
+    "z",
+    "yaw",
+    "radius",
+    "width",
+    "height",
+    "type",
+    "name"
+};
 
 //------------------------------------------------------------------------------
-bool XmlEntityParser::BuildEntitiesFromXMLWorldFile( const char* worldFilename,
-                                                     irr::scene::ISceneManager* pSceneManager, 
-                                                     irr::video::IVideoDriver* pVideoDriver,
-                                                     btDiscreteDynamicsWorld* pPhysicsWorld,
-                                                     std::vector<Entity*>* pEntityListOut )
+// Xerces must only be initialised once per process and it isn't safe to do so
+// from more than one thread at a time, so worlds that are loaded on different
+// threads share a single initialisation
+static pthread_once_t gXercesInitOnce = PTHREAD_ONCE_INIT;
+
+static void XEP_InitialiseXerces()
 {
-    assert( NULL != pEntityListOut && "No entity list provided" );
-    
-    bool bSuccessful = true;
-    
     xercesc::XMLPlatformUtils::Initialize();
-    
-    xercesc::XercesDOMParser* pParser = new xercesc::XercesDOMParser();
-    pParser->setValidationScheme( xercesc::XercesDOMParser::Val_Always );
-    pParser->setDoNamespaces( true );    // optional
+}
 
-    xercesc::ErrorHandler* pErrHandler = 
-        (xercesc::ErrorHandler*)new xercesc::HandlerBase();
-    pParser->setErrorHandler( pErrHandler );
+//------------------------------------------------------------------------------
+// Receives the elements of the world file from the parser one at a time,
+// filling in an entity description as they arrive and building the entity
+// when its element closes. If given a desc list then the descriptions are
+// stored in it rather than being built
+class XEP_WorldFileHandler : public xercesc::DefaultHandler
+{
+    //--------------------------------------------------------------------------
+    public: XEP_WorldFileHandler( irr::scene::ISceneManager* pSceneManager,
+                                  irr::video::IVideoDriver* pVideoDriver,
+                                  btDiscreteDynamicsWorld* pPhysicsWorld,
+                                  std::vector<Entity*>* pEntityListOut,
+                                  std::vector<EntityDesc>* pDescListOut,
+                                  XmlEntityParser::LoadStats* pStats )
+        : mpSceneManager( pSceneManager ),
+        mpVideoDriver( pVideoDriver ),
+        mpPhysicsWorld( pPhysicsWorld ),
+        mpEntityList( pEntityListOut ),
+        mpDescList( pDescListOut ),
+        mpStats( pStats ),
+        mpLocator( NULL ),
+        mEntityDepth( -1 ),
+        mNumEntitiesFound( 0 ),
+        mpTextFloat( NULL )
+    {
+        for ( U32 tagIdx = 0; tagIdx < eXT_NumTags; tagIdx++ )
+        {
+            mpTags[ tagIdx ] = xercesc::XMLString::transcode( XEP_TAG_NAMES[ tagIdx ] );
+        }
+        mElementStack.reserve( 16 );
+        mEntityDesc.Reset();
+    }
 
-    XMLCh* pEntityTag = xercesc::XMLString::transcode( "entity" );
-    XMLCh* pTypeAttributeTag = xercesc::XMLString::transcode( "type" );
-    XMLCh* pNameAttributeTag = xercesc::XMLString::transcode( "name" );
+    //--------------------------------------------------------------------------
+    public: virtual ~XEP_WorldFileHandler()
+    {
+        for ( U32 tagIdx = 0; tagIdx < eXT_NumTags; tagIdx++ )
+        {
+            xercesc::XMLString::release( &mpTags[ tagIdx ] );
+        }
+    }
 
-    try 
+    //--------------------------------------------------------------------------
+    public: virtual void setDocumentLocator( const xercesc::Locator* const pLocator )
     {
-        printf( "Parsing %s\n", worldFilename );
-        pParser->parse( worldFilename );
-        printf( "Parsed...\n" );
-        
-        xercesc::DOMDocument* pDoc = pParser->getDocument();
-        xercesc::DOMNodeList* pNodeList = pDoc->getElementsByTagName( pEntityTag );
-        
-        int numEntities = pNodeList->getLength();
-        
-        for ( int entityIdx = 0; entityIdx < numEntities; entityIdx++ )
+        mpLocator = pLocator;
+    }
+
+    //--------------------------------------------------------------------------
+    public: virtual void startElement( const XMLCh* const uri,
+                                       const XMLCh* const localname,
+                                       const XMLCh* const qname,
+                                       const xercesc::Attributes& attributes )
+    {
+        mpStats->mNumElements++;
+
+        eXEP_Tag tag = LookupElementTag( localname );
+        eXEP_Tag parentTag = ( mElementStack.empty() ? eXT_Unknown : mElementStack.back() );
+        S32 depthInEntity = ( mEntityDepth >= 0 ? (S32)mElementStack.size() - mEntityDepth : -1 );
+        mElementStack.push_back( tag );
+
+        if ( depthInEntity < 0 )
         {
-            xercesc::DOMNode* pEntityNode = pNodeList->item( entityIdx );
-            
-            // Determine the type of the entity
-            Entity::eType entityType = Entity::eT_Invalid;
-            
-            xercesc::DOMNamedNodeMap* pAttributes = pEntityNode->getAttributes();
-            if ( NULL != pAttributes )
+            if ( eXT_Entity == tag )
             {
-                xercesc::DOMNode* pTypeAttribute = pAttributes->getNamedItem( pTypeAttributeTag );
-                if ( NULL != pTypeAttribute )
-                {
-                    char* pTypeString = xercesc::XMLString::transcode( pTypeAttribute->getTextContent() );
-                    entityType = Entity::GetTypeFromString( pTypeString );
-                    xercesc::XMLString::release( &pTypeString );
-                }
+                StartEntity( attributes );
             }
-            
-            // Create the entity
-            Entity* pNewEntity = NULL;
-            switch ( entityType )
-            {
-                case Entity::eT_Sub:
-                {
-                    pNewEntity = XEP_BuildSub( pEntityNode, pSceneManager, pVideoDriver );
-                    break;
-                }
-                case Entity::eT_Buoy:
-                {
-                    pNewEntity = XEP_BuildBuoy( pEntityNode, pSceneManager, pPhysicsWorld );
-                    break;
-                }
-                case Entity::eT_CoordinateSystemAxes:
-                {
-                    pNewEntity = XEP_BuildCoordinateSystemAxes( pEntityNode, pSceneManager );
-                    break;
-                }
-                case Entity::eT_FloorTarget:
-                {
-                    pNewEntity = XEP_BuildFloorTarget( pEntityNode, pSceneManager );
-                    break;
-                }
-                case Entity::eT_Gate:
-                {
-                    pNewEntity = XEP_BuildGate( pEntityNode, pSceneManager );
-                    break;
-                }
-                case Entity::eT_Pool:
-                {
-                    pNewEntity = XEP_BuildPool( pEntityNode, pSceneManager );
-                    break;
-                }
-                case Entity::eT_CircularPool:
-                {
-                    pNewEntity = XEP_BuildCircularPool( pEntityNode, pSceneManager );
-                    break;
-                }
-                case Entity::eT_HarbourFloor:
-                {
-                    pNewEntity = XEP_BuildHarbourFloor( pEntityNode, pSceneManager );
-                    break;
-                }
-                case Entity::eT_Pipe:
-                {
-                    pNewEntity = XEP_BuildPipe( pEntityNode, pSceneManager );
-                    break;
-                }
-                case Entity::eT_SurveyWall:
-                {
-                    pNewEntity = XEP_BuildSurveyWall( pEntityNode, pSceneManager );
-                    break;
-                }
-                default:
-                {
-                    fprintf( stderr, "Warning: Unable to identify type of entity %i\n", entityIdx );
-                }
-            }
-                
-            if ( NULL == pNewEntity )
+        }
+        else if ( 1 == depthInEntity )
+        {
+            // A property of the entity
+            switch ( tag )
             {
-                fprintf( stderr, "Warning: Unable to build entity %i\n", entityIdx );
+                case eXT_Yaw: StartFloat( EntityDesc::eF_Yaw ); break;
+                case eXT_Radius: StartFloat( EntityDesc::eF_Radius ); break;
+                case eXT_Width: StartFloat( EntityDesc::eF_Width ); break;
+                case eXT_Height: StartFloat( EntityDesc::eF_Height ); break;
+                default: break;
             }
-            else
+        }
+        else if ( 2 == depthInEntity )
+        {
+            // A component of a vector property. Only the first element of
+            // each vector is used
+            EntityDesc::eVector vector = EntityDesc::eV_NumVectors;
+            if ( eXT_Pos == parentTag ) vector = EntityDesc::eV_Pos;
+            else if ( eXT_Rotation == parentTag ) vector = EntityDesc::eV_Rotation;
+
+            if ( EntityDesc::eV_NumVectors != vector
+                && 0 == ( mEntityDesc.mVectorsFound & ( 1 << vector ) ) )
             {
-                // Get and set the name of the new entity if it has one                
-                if ( NULL != pAttributes )
+                F32* pVector = mEntityDesc.mVectors[ vector ];
+                U32* pComponentsFound = &mEntityDesc.mVectorComponentsFound[ vector ];
+                switch ( tag )
                 {
-                    xercesc::DOMNode* pNameAttribute = pAttributes->getNamedItem( pNameAttributeTag );
-                    if ( NULL != pNameAttribute )
-                    {
-                        char* pName = xercesc::XMLString::transcode( pNameAttribute->getTextContent() );
-                        pNewEntity->SetName( pName );
-                        xercesc::XMLString::release( &pName );
-                    }
+                    case eXT_X: StartText( &pVector[ 0 ], pComponentsFound, 0x1 ); break;
+                    case eXT_Y: StartText( &pVector[ 1 ], pComponentsFound, 0x2 ); break;
+                    case eXT_Z: StartText( &pVector[ 2 ], pComponentsFound, 0x4 ); break;
+                    default: break;
                 }
-                
-                printf( "Built a %s\n", Entity::ConvertTypeToString( pNewEntity->GetType() ) );
-                pEntityListOut->push_back( pNewEntity );
             }
         }
-                
-    }
-    catch ( const xercesc::XMLException& toCatch ) 
-    {
-        char* message = xercesc::XMLString::transcode( toCatch.getMessage() );
-        fprintf( stderr, "Error: XML Exception message is: %s\n", message );
-        xercesc::XMLString::release( &message );
-        bSuccessful = false;
-    }
-    catch ( const xercesc::DOMException& toCatch ) 
-    {
-        char* message = xercesc::XMLString::transcode( toCatch.msg );
-        fprintf( stderr, "Error: DOM Exception message is: %s\n", message );
-        xercesc::XMLString::release( &message );
-        bSuccessful = false;
-    }
-    catch ( const xercesc::SAXParseException& toCatch ) 
-    {
-        char* message = xercesc::XMLString::transcode( toCatch.getMessage() );
-        fprintf( stderr, "Error: SAX PArse Exception message is: %s\n", message );
-        xercesc::XMLString::release( &message );
-        bSuccessful = false;
-    }
-    catch (...) 
-    {
-        fprintf( stderr, "Error: Unexpected Exception\n" );
-        bSuccessful = false;
     }
-        
-    xercesc::XMLString::release( &pNameAttributeTag );
-    xercesc::XMLString::release( &pTypeAttributeTag );
-    xercesc::XMLString::release( &pEntityTag );
-    
-    // TODO: Fix crash here...
-    //delete pParser;
-    //delete pErrHandler;
-    
-    //xercesc::XMLPlatformUtils::Terminate();
-    
-    return bSuccessful;
-}
 
-//------------------------------------------------------------------------------
-Sub* XEP_BuildSub( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager, irr::video::IVideoDriver* pVideoDriver )
-{
-    const bool PRINT_ERRORS = true;
-    Sub* pSub = NULL;
-    
-    XMLCh* pYawTag = xercesc::XMLString::transcode( "yaw" );
-    
-    Vector pos;
-    float yaw;
-    
-    if ( XEP_GetPosVectorElement( pEntityNode, &pos, PRINT_ERRORS )
-         && XEP_GetFloatElement( pEntityNode, pYawTag, &yaw, PRINT_ERRORS ) )
+    //--------------------------------------------------------------------------
+    public: virtual void endElement( const XMLCh* const uri,
+                                     const XMLCh* const localname,
+                                     const XMLCh* const qname )
     {
-        pSub = new Sub();
-        if ( !pSub->Init( pSceneManager, pVideoDriver ) )
-        {
-            fprintf( stderr, "Error: Unable to initialise sub\n" );
-            delete pSub;
-            pSub = NULL;
-        }
-        else
+        if ( NULL != mpTextFloat )
         {
-            pSub->SetYaw( MathUtils::DegToRad( yaw ) );
-            pSub->SetPosition( pos );
+            *mpTextFloat = (F32)atof( mText.c_str() );
+            *mpTextFound |= mTextFoundMask;
+            mpTextFloat = NULL;
         }
-    }
-    
-    xercesc::XMLString::release( &pYawTag );
-    
-    return pSub;
-}
 
-//------------------------------------------------------------------------------
-Buoy* XEP_BuildBuoy( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager, btDiscreteDynamicsWorld* pPhysicsWorld )
-{
-    const bool PRINT_ERRORS = true;
-    Buoy* pBuoy = NULL;
-    
-    Vector pos;
-    
-    if ( XEP_GetPosVectorElement( pEntityNode, &pos, PRINT_ERRORS ) )
-    {
-        const bool OPTIONAL = true;
-        F32 radius = Buoy::DEFAULT_RADIUS;
-        
-        XMLCh* pRadiusTag = xercesc::XMLString::transcode( "radius" );
-        XEP_GetFloatElement( pEntityNode, pRadiusTag, &radius, PRINT_ERRORS, OPTIONAL );
-        xercesc::XMLString::release( &pRadiusTag );
-        
-        pBuoy = new Buoy();
-        if ( !pBuoy->Init( pSceneManager, pPhysicsWorld, radius ) )
+        eXEP_Tag tag = mElementStack.back();
+        mElementStack.pop_back();
+        S32 depthInEntity = ( mEntityDepth >= 0 ? (S32)mElementStack.size() - mEntityDepth : -1 );
+
+        if ( 0 == depthInEntity )
         {
-            fprintf( stderr, "Error: Unable to initialise buoy\n" );
-            delete pBuoy;
-            pBuoy = NULL;
+            EndEntity();
         }
-        else
+        else if ( 1 == depthInEntity
+            && ( eXT_Pos == tag || eXT_Rotation == tag ) )
         {
-            pBuoy->SetPosition( pos );
+            EntityDesc::eVector vector = ( eXT_Pos == tag ? EntityDesc::eV_Pos : EntityDesc::eV_Rotation );
+            mEntityDesc.mVectorsFound |= ( 1 << vector );
         }
     }
-    
-    return pBuoy;
-}
 
-//------------------------------------------------------------------------------
-CoordinateSystemAxes* XEP_BuildCoordinateSystemAxes( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager )
-{
-    const bool PRINT_ERRORS = true;
-    CoordinateSystemAxes* pCoordinateSystemAxes = NULL;
-    
-    Vector pos;
-    
-    if ( XEP_GetPosVectorElement( pEntityNode, &pos, PRINT_ERRORS ) )
+    //--------------------------------------------------------------------------
+    public: virtual void characters( const XMLCh* const chars, const XMLSize_t length )
     {
-        pCoordinateSystemAxes = new CoordinateSystemAxes();
-        if ( !pCoordinateSystemAxes->Init( pSceneManager ) )
-        {
-            fprintf( stderr, "Error: Unable to initialise coordinate system axes\n" );
-            delete pCoordinateSystemAxes;
-            pCoordinateSystemAxes = NULL;
-        }
-        else
+        if ( NULL != mpTextFloat )
         {
-            pCoordinateSystemAxes->SetPosition( pos );
+            // Only numbers are read from text so anything outside of ASCII
+            // can't be part of a valid value
+            for ( XMLSize_t charIdx = 0; charIdx < length; charIdx++ )
+            {
+                mText += ( chars[ charIdx ] < 128 ? (char)chars[ charIdx ] : '?' );
+            }
         }
     }
-    
-    return pCoordinateSystemAxes;
-}
-
-//------------------------------------------------------------------------------
-FloorTarget* XEP_BuildFloorTarget( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager )
-{
-    const bool PRINT_ERRORS = true;
-    FloorTarget* pFloorTarget = NULL;
 
-    Vector pos;
-    
-    if ( XEP_GetPosVectorElement( pEntityNode, &pos, PRINT_ERRORS ) )
+    //--------------------------------------------------------------------------
+    public: virtual void error( const xercesc::SAXParseException& exception )
     {
-        pFloorTarget = new FloorTarget();
-        if ( !pFloorTarget->Init( pSceneManager ) )
-        {
-            fprintf( stderr, "Error: Unable to initialise floor target\n" );
-            delete pFloorTarget;
-            pFloorTarget = NULL;
-        }
-        else
-        {
-            pFloorTarget->SetPosition( pos );
-        }
+        mpStats->mNumValidationErrors++;
+
+        char* pMessage = xercesc::XMLString::transcode( exception.getMessage() );
+        fprintf( stderr, "Warning: Line %u of world file is invalid: %s\n",
+            (U32)exception.getLineNumber(), pMessage );
+        xercesc::XMLString::release( &pMessage );
     }
-    
-    return pFloorTarget;
-}
 
-//------------------------------------------------------------------------------
-Gate* XEP_BuildGate( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager )
-{
-    const bool PRINT_ERRORS = true;
-    Gate* pGate = NULL;
-    
-    Vector pos;
-    
-    if ( XEP_GetPosVectorElement( pEntityNode, &pos, PRINT_ERRORS ) )
+    //--------------------------------------------------------------------------
+    private: eXEP_Tag LookupElementTag( const XMLCh* pName ) const
     {
-        const bool OPTIONAL = true;
-        F32 width = Gate::DEFAULT_WIDTH;
-        F32 height = Gate::DEFAULT_HEIGHT;
-        
-        XMLCh* pWidthTag = xercesc::XMLString::transcode( "width" );
-        XEP_GetFloatElement( pEntityNode, pWidthTag, &width, PRINT_ERRORS, OPTIONAL );
-        xercesc::XMLString::release( &pWidthTag );
-        XMLCh* pHeightTag = xercesc::XMLString::transcode( "height" );
-        XEP_GetFloatElement( pEntityNode, pHeightTag, &height, PRINT_ERRORS, OPTIONAL );
-        xercesc::XMLString::release( &pHeightTag );
-        
-        pGate = new Gate();
-        if ( !pGate->Init( pSceneManager, width, height ) )
-        {
-            fprintf( stderr, "Error: Unable to initialise gate\n" );
-            delete pGate;
-            pGate = NULL;
-        }
-        else
+        for ( U32 tagIdx = 0; tagIdx < eXT_NumElementTags; tagIdx++ )
         {
-            pGate->SetPosition( pos );
-            XEP_ParseAndSetRotation( pEntityNode, pGate, PRINT_ERRORS );
+            if ( 0 == xercesc::XMLString::compareIString( pName, mpTags[ tagIdx ] ) )
+            {
+                return (eXEP_Tag)tagIdx;
+            }
         }
-    }    
-    
-    return pGate;
-}
 
-//------------------------------------------------------------------------------
-Pool* XEP_BuildPool( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager )
-{
-    const bool PRINT_ERRORS = true;
-    Pool* pPool = NULL;
-    
-    Vector pos;
-    
-    if ( XEP_GetPosVectorElement( pEntityNode, &pos, PRINT_ERRORS ) )
+        return eXT_Unknown;
+    }
+
+    //--------------------------------------------------------------------------
+    private: void StartEntity( const xercesc::Attributes& attributes )
     {
-        pPool = new Pool();
-        if ( !pPool->Init( pSceneManager ) )
+        mEntityDepth = (S32)mElementStack.size() - 1;
+        mEntityDesc.Reset();
+
+        const XMLCh* pType = attributes.getValue( mpTags[ eXT_TypeAttribute ] );
+        if ( NULL != pType )
         {
-            fprintf( stderr, "Error: Unable to initialise pool\n" );
-            delete pPool;
-            pPool = NULL;
+            char* pTypeString = xercesc::XMLString::transcode( pType );
+            mEntityDesc.mType = Entity::GetTypeFromString( pTypeString );
+            xercesc::XMLString::release( &pTypeString );
         }
-        else
+
+        const XMLCh* pName = attributes.getValue( mpTags[ eXT_NameAttribute ] );
+        if ( NULL != pName )
         {
-            pPool->SetPosition( pos );
+            char* pNameString = xercesc::XMLString::transcode( pName );
+            mEntityDesc.SetName( pNameString );
+            xercesc::XMLString::release( &pNameString );
         }
     }
-    
-    return pPool;
-}
 
-//------------------------------------------------------------------------------
-CircularPool* XEP_BuildCircularPool( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager )
-{
-    const bool PRINT_ERRORS = true;
-    CircularPool* pCircularPool = NULL;
-    
-    Vector pos;
-    
-    if ( XEP_GetPosVectorElement( pEntityNode, &pos, PRINT_ERRORS ) )
+    //--------------------------------------------------------------------------
+    private: void EndEntity()
     {
-        const bool OPTIONAL = true;
-        F32 radius = CircularPool::DEFAULT_RADIUS;
-        
-        XMLCh* pRadiusTag = xercesc::XMLString::transcode( "radius" );
-        XEP_GetFloatElement( pEntityNode, pRadiusTag, &radius, PRINT_ERRORS, OPTIONAL );
-        xercesc::XMLString::release( &pRadiusTag );
-        
-        pCircularPool = new CircularPool();
-        if ( !pCircularPool->Init( pSceneManager, radius ) )
-        {
-            fprintf( stderr, "Error: Unable to initialise circular pool\n" );
-            delete pCircularPool;
-            pCircularPool = NULL;
-        }
-        else
+        S32 entityIdx = mNumEntitiesFound++;
+        mEntityDepth = -1;
+
+        if ( NULL != mpDescList )
         {
-            pCircularPool->SetPosition( pos );
+            // Just reading the world
+            mpDescList->push_back( mEntityDesc );
+            mpStats->mNumEntitiesBuilt++;
+            return;
         }
-    }
-    
-    return pCircularPool;
-}
 
-//------------------------------------------------------------------------------
-HarbourFloor* XEP_BuildHarbourFloor( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager )
-{
-    const bool PRINT_ERRORS = true;
-    HarbourFloor* pHarbourFloor = NULL;
-    
-    Vector pos;
-    
-    if ( XEP_GetPosVectorElement( pEntityNode, &pos, PRINT_ERRORS ) )
-    {
-        pHarbourFloor = new HarbourFloor();
-        if ( !pHarbourFloor->Init( pSceneManager ) )
+        HighPrecisionTime buildStartTime = HighPrecisionTime::GetTime();
+
+        Entity* pNewEntity = EntityFactory::BuildEntity( mEntityDesc,
+            (S32)mpEntityList->size(), mpSceneManager, mpVideoDriver, mpPhysicsWorld );
+        if ( NULL == pNewEntity )
         {
-            fprintf( stderr, "Error: Unable to initialise harbour floor\n" );
-            delete pHarbourFloor;
-            pHarbourFloor = NULL;
+            fprintf( stderr, "Warning: Unable to build entity %i (line %u)\n",
+                entityIdx, ( NULL != mpLocator ? (U32)mpLocator->getLineNumber() : 0 ) );
+            mpStats->mNumEntitiesFailed++;
         }
         else
         {
-            pHarbourFloor->SetPosition( pos );
+            mpEntityList->push_back( pNewEntity );
+            mpStats->mNumEntitiesBuilt++;
         }
+
+        mpStats->mBuildSeconds += HighPrecisionTime::ConvertToSeconds(
+            HighPrecisionTime::GetDiff( HighPrecisionTime::GetTime(), buildStartTime ) );
     }
-    
-    return pHarbourFloor;
-}
 
-//------------------------------------------------------------------------------
-Pipe* XEP_BuildPipe( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager )
-{
-    const bool PRINT_ERRORS = true;
-    Pipe* pPipe = NULL;
-    
-    Vector pos;
-    
-    if ( XEP_GetPosVectorElement( pEntityNode, &pos, PRINT_ERRORS ) )
+    //--------------------------------------------------------------------------
+    private: void StartFloat( EntityDesc::eFloat floatValue )
     {
-        pPipe = new Pipe();
-        if ( !pPipe->Init( pSceneManager ) )
-        {
-            fprintf( stderr, "Error: Unable to initialise pipe\n" );
-            delete pPipe;
-            pPipe = NULL;
-        }
-        else
-        {
-            pPipe->SetPosition( pos );
-        }
+        StartText( &mEntityDesc.mFloats[ floatValue ],
+            &mEntityDesc.mFloatsFound, 1 << floatValue );
     }
-    
-    return pPipe;
-}
 
-//------------------------------------------------------------------------------
-SurveyWall* XEP_BuildSurveyWall( xercesc::DOMNode* pEntityNode, irr::scene::ISceneManager* pSceneManager )
-{
-    const bool PRINT_ERRORS = true;
-    SurveyWall* pSurveyWall = NULL;
-    
-    Vector pos;
-    
-    if ( XEP_GetPosVectorElement( pEntityNode, &pos, PRINT_ERRORS ) )
+    //--------------------------------------------------------------------------
+    // Starts reading the text of the current element into pFloat. The first
+    // value found is the one that's kept, so nothing is read if foundMask
+    // is already set in pFound
+    private: void StartText( F32* pFloat, U32* pFound, U32 foundMask )
     {
-        pSurveyWall = new SurveyWall();
-        if ( !pSurveyWall->Init( pSceneManager ) )
-        {
-            fprintf( stderr, "Error: Unable to initialise survey wall\n" );
-            delete pSurveyWall;
-            pSurveyWall = NULL;
-        }
-        else
+        if ( 0 != ( *pFound & foundMask ) )
         {
-            pSurveyWall->SetPosition( pos );
-            XEP_ParseAndSetRotation( pEntityNode, pSurveyWall, PRINT_ERRORS );
+            return;
         }
+
+        mText.clear();
+        mpTextFloat = pFloat;
+        mpTextFound = pFound;
+        mTextFoundMask = foundMask;
     }
-    
-    return pSurveyWall;
-}
+
+    private: irr::scene::ISceneManager* mpSceneManager;
+    private: irr::video::IVideoDriver* mpVideoDriver;
+    private: btDiscreteDynamicsWorld* mpPhysicsWorld;
+    private: std::vector<Entity*>* mpEntityList;
+    private: std::vector<EntityDesc>* mpDescList;   // If set, descs are stored instead of being built
+    private: XmlEntityParser::LoadStats* mpStats;
+    private: const xercesc::Locator* mpLocator;
+
+    private: XMLCh* mpTags[ eXT_NumTags ];
+    private: std::vector<eXEP_Tag> mElementStack;
+
+    private: S32 mEntityDepth;      // Depth of the open entity element, -1 if none is open
+    private: S32 mNumEntitiesFound;
+    private: EntityDesc mEntityDesc;
+
+    // The value that the text of the current element is being read into
+    private: std::string mText;
+    private: F32* mpTextFloat;
+    private: U32* mpTextFound;
+    private: U32 mTextFoundMask;
+};
 
 //------------------------------------------------------------------------------
-void XEP_ParseAndSetRotation( xercesc::DOMNode* pNode, Entity* pEntity, bool bPrintErrors, bool bOptional )
+// Runs the world file through the parser, passing everything found to
+// pHandler, and then prints out the load statistics
+static bool XEP_ParseWorldFile( const char* worldFilename, XEP_WorldFileHandler* pHandler,
+                                bool bValidate, XmlEntityParser::LoadStats* pStats )
 {
-    bool bRotationFound = false;
-    Vector rotationDegrees;
-    
-    XMLCh* pRotationTag = xercesc::XMLString::transcode( "rotation" );
-    bRotationFound = XEP_GetVectorElement( pNode, pRotationTag, &rotationDegrees, bPrintErrors, bOptional );
-    xercesc::XMLString::release( &pRotationTag );
-    
-    if ( bRotationFound )
+    bool bSuccessful = true;
+    HighPrecisionTime startTime = HighPrecisionTime::GetTime();
+
+    pthread_once( &gXercesInitOnce, XEP_InitialiseXerces );
+
+    xercesc::SAX2XMLReader* pReader = xercesc::XMLReaderFactory::createXMLReader();
+    pReader->setFeature( xercesc::XMLUni::fgSAX2CoreNameSpaces, true );
+    pReader->setFeature( xercesc::XMLUni::fgSAX2CoreValidation, bValidate );
+    pReader->setFeature( xercesc::XMLUni::fgXercesDynamic, false );
+    pReader->setFeature( xercesc::XMLUni::fgXercesLoadExternalDTD, bValidate );
+    pReader->setContentHandler( pHandler );
+    pReader->setErrorHandler( pHandler );
+
+    try
+    {
+        printf( "Parsing %s\n", worldFilename );
+        pReader->parse( worldFilename );
+    }
+    catch ( const xercesc::XMLException& toCatch )
+    {
+        char* message = xercesc::XMLString::transcode( toCatch.getMessage() );
+        fprintf( stderr, "Error: XML Exception message is: %s\n", message );
+        xercesc::XMLString::release( &message );
+        bSuccessful = false;
+    }
+    catch ( const xercesc::SAXParseException& toCatch )
     {
-        pEntity->SetRotation( Vector( 
-            MathUtils::DegToRad( rotationDegrees.mX ),
-            MathUtils::DegToRad( rotationDegrees.mY ),
-            MathUtils::DegToRad( rotationDegrees.mZ ) ) );
+        char* message = xercesc::XMLString::transcode( toCatch.getMessage() );
+        fprintf( stderr, "Error: SAX Parse Exception on line %u, message is: %s\n",
+            (U32)toCatch.getLineNumber(), message );
+        xercesc::XMLString::release( &message );
+        bSuccessful = false;
     }
-    else if ( !bRotationFound && !bOptional && bPrintErrors )
+    catch (...)
     {
-        fprintf( stderr, "Error: Unable to parse rotation element\n" );
+        fprintf( stderr, "Error: Unexpected Exception\n" );
+        bSuccessful = false;
     }
-}
 
-//------------------------------------------------------------------------------
-bool XEP_GetPosVectorElement( xercesc::DOMNode* pNode, Vector* pPosOut, bool bPrintErrors )
-{
-    bool bFound = false;
-    
-    XMLCh* pPosTag = xercesc::XMLString::transcode( "pos" );
-    bFound = XEP_GetVectorElement( pNode, pPosTag, pPosOut, bPrintErrors );
-    xercesc::XMLString::release( &pPosTag );
-    
-    if ( !bFound && bPrintErrors )
+    delete pReader;
+
+    pStats->mLoadSeconds = HighPrecisionTime::ConvertToSeconds(
+        HighPrecisionTime::GetDiff( HighPrecisionTime::GetTime(), startTime ) );
+    printf( "Loaded %u entities (%u failed) from %u elements in %.2f ms, "
+        "%.2f ms of which was spent building entities\n",
+        pStats->mNumEntitiesBuilt, pStats->mNumEntitiesFailed, pStats->mNumElements,
+        pStats->mLoadSeconds*1000.0, pStats->mBuildSeconds*1000.0 );
+    if ( pStats->mNumValidationErrors > 0 )
     {
-        fprintf( stderr, "Error: Unable to parse pos element\n" );
+        printf( "%u validation errors were found\n", pStats->mNumValidationErrors );
     }
-    
-    return bFound;
+
+    return bSuccessful;
 }
 
 //------------------------------------------------------------------------------
-bool XEP_GetVectorElement( xercesc::DOMNode* pNode, XMLCh* pTag, Vector* pVectorOut, bool bPrintErrors, bool bOptional )
+bool XmlEntityParser::BuildEntitiesFromXMLWorldFile( const char* worldFilename,
+                                                     irr::scene::ISceneManager* pSceneManager,
+                                                     irr::video::IVideoDriver* pVideoDriver,
+                                                     btDiscreteDynamicsWorld* pPhysicsWorld,
+                                                     std::vector<Entity*>* pEntityListOut,
+                                                     bool bValidate,
+                                                     LoadStats* pStatsOut )
 {
-    bool bFound = false;
-    
-    XMLCh* pXTag = xercesc::XMLString::transcode( "x" );
-    XMLCh* pYTag = xercesc::XMLString::transcode( "y" );
-    XMLCh* pZTag = xercesc::XMLString::transcode( "z" );
-    
-    xercesc::DOMNodeList* pChildNodeList = pNode->getChildNodes();
-    int numChildNodes = pChildNodeList->getLength();
-    for ( int childNodeIdx = 0; childNodeIdx < numChildNodes; childNodeIdx++ )
-    {
-        xercesc::DOMNode* pChildNode = pChildNodeList->item( childNodeIdx );
-        if ( xercesc::XMLString::compareIString( pChildNode->getNodeName(), pTag ) == 0 )
-        {
-            // Found the vector node, now try to parse it
-            
-            F32 x, y, z;
-            if ( XEP_GetFloatElement( pChildNode, pXTag, &x, bPrintErrors )
-                && XEP_GetFloatElement( pChildNode, pYTag, &y, bPrintErrors )
-                && XEP_GetFloatElement( pChildNode, pZTag, &z, bPrintErrors ) )
-            {
-                pVectorOut->Set( x, y, z );
-                bFound = true;
-            }
-    
-            break;
-        }
-    }
-    xercesc::XMLString::release( &pZTag );
-    xercesc::XMLString::release( &pYTag );
-    xercesc::XMLString::release( &pXTag );
-    
-    if ( !bFound && !bOptional && bPrintErrors )
+    assert( NULL != pEntityListOut && "No entity list provided" );
+
+    LoadStats stats;
+    memset( &stats, 0, sizeof( stats ) );
+
+    XEP_WorldFileHandler handler( pSceneManager, pVideoDriver,
+        pPhysicsWorld, pEntityListOut, NULL, &stats );
+    bool bSuccessful = XEP_ParseWorldFile( worldFilename, &handler, bValidate, &stats );
+
+    if ( NULL != pStatsOut )
     {
-        char* pNarrowTag = xercesc::XMLString::transcode( pTag );
-        fprintf( stderr, "Error: Unable to parse vector called %s\n", pNarrowTag );
-        xercesc::XMLString::release( &pNarrowTag );
+        *pStatsOut = stats;
     }
-    
-    return bFound;
+
+    return bSuccessful;
 }
 
 //------------------------------------------------------------------------------
-bool XEP_GetFloatElement( xercesc::DOMNode* pNode, XMLCh* pTag, F32* pFloatOut, bool bPrintErrors, bool bOptional )
+bool XmlEntityParser::ReadEntityDescsFromXMLWorldFile( const char* worldFilename,
+                                                       std::vector<EntityDesc>* pDescListOut,
+                                                       bool bValidate,
+                                                       LoadStats* pStatsOut )
 {
-    bool bFound = false;
-    
-    xercesc::DOMNodeList* pChildNodeList = pNode->getChildNodes();
-    int numChildNodes = pChildNodeList->getLength();
-    for ( int childNodeIdx = 0; childNodeIdx < numChildNodes; childNodeIdx++ )
-    {
-        xercesc::DOMNode* pChildNode = pChildNodeList->item( childNodeIdx );
-        if ( xercesc::XMLString::compareIString( pChildNode->getNodeName(), pTag ) == 0 )
-        {
-            // Node found
-            char* pDataString = xercesc::XMLString::transcode( pChildNode->getTextContent() );
-            *pFloatOut = (float)atof( pDataString );
-            xercesc::XMLString::release( &pDataString );
-            
-            bFound = true;
-            break;
-        }
-    }
-    
-    if ( !bFound && !bOptional && bPrintErrors )
+    assert( NULL != pDescListOut && "No desc list provided" );
+
+    LoadStats stats;
+    memset( &stats, 0, sizeof( stats ) );
+
+    XEP_WorldFileHandler handler( NULL, NULL, NULL, NULL, pDescListOut, &stats );
+    bool bSuccessful = XEP_ParseWorldFile( worldFilename, &handler, bValidate, &stats );
+
+    if ( NULL != pStatsOut )
     {
-        char* pNarrowTag = xercesc::XMLString::transcode( pTag );
-        fprintf( stderr, "Error: Unable to parse float called %s\n", pNarrowTag );
-        xercesc::XMLString::release( &pNarrowTag );
+        *pStatsOut = stats;
     }
-    
-    return bFound;
+
+    return bSuccessful;
 }
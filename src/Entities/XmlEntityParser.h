@@ -13,6 +13,7 @@
 
 #include "Common.h"
 #include "Entity.h"
+#include "EntityDesc.h"
 
 //------------------------------------------------------------------------------
 class btDiscreteDynamicsWorld;
@@ -20,12 +21,41 @@ class btDiscreteDynamicsWorld;
 //------------------------------------------------------------------------------
 class XmlEntityParser
 {
+    //--------------------------------------------------------------------------
+    // What was found in a world file and how long it took to load
+    public: struct LoadStats
+    {
+        U32 mNumElements;
+        U32 mNumEntitiesBuilt;      // Or read, when the entities aren't being built
+        U32 mNumEntitiesFailed;
+        U32 mNumValidationErrors;
+        double mLoadSeconds;        // Total time, including building entities
+        double mBuildSeconds;       // Time spent creating the entities
+    };
+    
+    //--------------------------------------------------------------------------
+    // The file is streamed through and each entity is built as soon as its
+    // element closes, so the document is never held in memory as a whole. If 
+    // bValidate is true then the file is checked against any DTD or schema 
+    // that it names and problems are reported as warnings. The statistics 
+    // are always printed and are also returned if pStatsOut isn't NULL
     public: static bool BuildEntitiesFromXMLWorldFile( 
         const char* worldFilename, 
         irr::scene::ISceneManager* pSceneManager, 
         irr::video::IVideoDriver* pVideoDriver,
         btDiscreteDynamicsWorld* pPhysicsWorld,
-        std::vector<Entity*>* pEntityListOut );
+        std::vector<Entity*>* pEntityListOut,
+        bool bValidate = false,
+        LoadStats* pStatsOut = NULL );
+
+    //--------------------------------------------------------------------------
+    // Reads the entities in the world file without building them. Used for
+    // compiling world files
+    public: static bool ReadEntityDescsFromXMLWorldFile( 
+        const char* worldFilename,
+        std::vector<EntityDesc>* pDescListOut,
+        bool bValidate = false,
+        LoadStats* pStatsOut = NULL );
 };
 
-#endif // XML_ENTITY_PARSER_H
\ No newline at end of file
+#endif // XML_ENTITY_PARSER_H
@@ -12,7 +12,8 @@
 //------------------------------------------------------------------------------
 CameraInterface::CameraInterface( player_devaddr_t addr, 
     SubSimDriver* pDriver, ConfigFile* pConfigFile, int section )
-    : SubSimInterface( addr, pDriver, pConfigFile, section )
+    : SubSimInterface( addr, pDriver, pConfigFile, section ),
+    mNumSubscribers( 0 )
 {
     mpDriver->mSim.GetSubCameraImageDimensions( &mImageWidth, &mImageHeight );
     mImageBufferSize = mImageWidth*mImageHeight*3;
@@ -39,26 +40,52 @@ int CameraInterface::ProcessMessage( QueuePointer& respQueue,
 }
 
 
+//------------------------------------------------------------------------------
+void CameraInterface::Subscribe()
+{
+    mNumSubscribers++;
+    mpDriver->AddSubCameraSubscriber();
+}
+
+//------------------------------------------------------------------------------
+void CameraInterface::Unsubscribe()
+{
+    if ( mNumSubscribers > 0 )
+    {
+        mNumSubscribers--;
+        mpDriver->RemoveSubCameraSubscriber();
+    }
+}
+
 //------------------------------------------------------------------------------
 // Update this interface and publish new info.
 void CameraInterface::Update()
 {
     player_camera_data_t data;
     
-    // Get the camera image and then return it
-    //mpDriver->mSim.GetSubCameraImage( mpImageData, mImageBufferSize );
-    mImageTimestamp = mpDriver->mSim.GetSimTime();
-    
-    /*data.width = mImageWidth;
-    data.height = mImageHeight;
-    data.bpp = 24;
-    data.format = PLAYER_CAMERA_FORMAT_RGB888;
-    data.fdiv = 1;
-    data.compression = PLAYER_CAMERA_COMPRESS_RAW;
-    data.image_count = mImageBufferSize;
-    data.image = mpImageData;*/
+    if ( mImageBufferSize > 0 )
+    {
+        // Get the camera image and then return it stamped with the time
+        // it was captured rather than the current time
+        mpDriver->mSim.GetSubCameraImage( mpImageData, mImageBufferSize, &mImageTimestamp );
+        
+        data.width = mImageWidth;
+        data.height = mImageHeight;
+        data.bpp = 24;
+        data.format = PLAYER_CAMERA_FORMAT_RGB888;
+        data.fdiv = 1;
+        data.compression = PLAYER_CAMERA_COMPRESS_RAW;
+        data.image_count = mImageBufferSize;
+        data.image = mpImageData;
+        
+        mpDriver->Publish( this->mDeviceAddress,
+                           PLAYER_MSGTYPE_DATA, PLAYER_CAMERA_DATA_STATE,
+                           (void*)&data, sizeof( data ), &mImageTimestamp );
+        return;
+    }
 
-    // Fake data for now as camera is broken
+    // Fake data if the simulator has no camera for the sub
+    mImageTimestamp = mpDriver->mSim.GetSimTime();
     data.width = 320;
     data.height = 240;
     data.bpp = 24;
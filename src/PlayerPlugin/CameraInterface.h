@@ -24,6 +24,11 @@ class CameraInterface : public SubSimInterface
     public: virtual int ProcessMessage( QueuePointer &respQueue,
                                       player_msghdr_t* pHeader, void* pData );
 
+    // Subscriptions are counted so that the simulator only needs to render
+    // the sub camera whilst someone is listening
+    public: virtual void Subscribe();
+    public: virtual void Unsubscribe();
+
     // Update this interface, publish new info.
     public: virtual void Update();
     
@@ -32,6 +37,7 @@ class CameraInterface : public SubSimInterface
     private: U32 mImageHeight;
     private: U32 mImageBufferSize;
     private: double mImageTimestamp;
+    private: S32 mNumSubscribers;
 };
 
 #endif // CAMERA_INTERFACE_H
\ No newline at end of file
@@ -15,6 +15,8 @@ CompassInterface::CompassInterface( player_devaddr_t addr,
     SubSimDriver* pDriver, ConfigFile* pConfigFile, int section )
     : SubSimInterface( addr, pDriver, pConfigFile, section )
 {
+    // Resolve the sub once here rather than on every update
+    mSubHandle = mpDriver->mSim.GetEntityHandle( "Sub" );
 }
 
 //------------------------------------------------------------------------------
@@ -42,7 +44,7 @@ void CompassInterface::Update()
 
     Vector subPos;
     Vector subRotation;
-    mpDriver->mSim.GetEntityPose( "Sub", &subPos, &subRotation );
+    mpDriver->mSim.GetEntityPose( mSubHandle, &subPos, &subRotation );
     
     data.pose.px = 0.0;
     data.pose.py = 0.0;
@@ -9,6 +9,7 @@
 
 //------------------------------------------------------------------------------
 #include "SubSimInterface.h"
+#include "Simulator/Simulator.h"
 
 //------------------------------------------------------------------------------
 class CompassInterface : public SubSimInterface
@@ -25,6 +26,8 @@ class CompassInterface : public SubSimInterface
 
     // Update this interface, publish new info.
     public: virtual void Update();
+    
+    private: EntityHandle mSubHandle;
 };
 
 #endif // COMPASS_INTERFACE_H
@@ -20,6 +20,12 @@ DepthSensorInterface::DepthSensorInterface( player_devaddr_t addr,
     mLastValue( 0.0f ),
     mWaitForBreakStartTime( HighPrecisionTime::GetTime() )
 {
+    // Resolve the sub once here rather than on every update
+    mSubHandle = mpDriver->mSim.GetEntityHandle( "Sub" );
+    
+    // Each device gets its own noise sequence from the run's seed
+    mNoiseRandom.SetSeed( mpDriver->GetRandomSeed() 
+        ^ ( ( (U32)addr.interf << 16 ) | addr.index ) );
 }
 
 //------------------------------------------------------------------------------
@@ -58,7 +64,7 @@ void DepthSensorInterface::Update()
 
     Vector subPos;
     Vector subRotation;
-    mpDriver->mSim.GetEntityPose( "Sub", &subPos, &subRotation );
+    mpDriver->mSim.GetEntityPose( mSubHandle, &subPos, &subRotation );
     
     // Convert to positive depth to make the depth sensor more like the 
     // real one
@@ -72,7 +78,7 @@ void DepthSensorInterface::Update()
         
         // Add in some noise so that the control code doesn't think the
         // depth sensor has crashed
-        F32 noise = 1.0f*(F32)random()/(F32)RAND_MAX - 0.5f;
+        F32 noise = mNoiseRandom.NextF32() - 0.5f;
         data.pos += noise;
     }
     mLastValue = data.pos;
@@ -10,7 +10,9 @@
 //------------------------------------------------------------------------------
 #include "Common.h"
 #include "SubSimInterface.h"
+#include "Simulator/Simulator.h"
 #include "Common/HighPrecisionTime.h"
+#include "Common/Random.h"
 
 //------------------------------------------------------------------------------
 class DepthSensorInterface : public SubSimInterface
@@ -28,8 +30,11 @@ class DepthSensorInterface : public SubSimInterface
     // Update this interface, publish new info.
     public: virtual void Update();
     
+    private: EntityHandle mSubHandle;
+    
     private: bool mbDepthSensorBroken;
     private: F32 mLastValue;
+    private: Random mNoiseRandom;   // Seeded from the driver so runs can be replayed
     private: HighPrecisionTime mWaitForBreakStartTime;
     private: static const F32 TIME_UNTILL_DEPTH_SENSOR_BREAKS;
 };
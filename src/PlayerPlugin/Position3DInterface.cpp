@@ -15,6 +15,7 @@ Position3DInterface::Position3DInterface( player_devaddr_t addr,
     SubSimDriver* pDriver, ConfigFile* pConfigFile, int section )
     : SubSimInterface( addr, pDriver, pConfigFile, section )
 {
+    mSubHandle = mpDriver->mSim.GetEntityHandle( "Sub" );
 }
 
 //------------------------------------------------------------------------------
@@ -37,10 +38,14 @@ int Position3DInterface::ProcessMessage( QueuePointer& respQueue,
         //printf( "Set vel = %2.3f, %2.3f, %2.3f\n",
         //    (F32)pCmd->vel.px, (F32)pCmd->vel.py, (F32)pCmd->vel.pz );
         
-        mpDriver->mSim.SetSubForwardSpeed( (F32)pCmd->vel.px );
-        mpDriver->mSim.SetSubDepthSpeed( (F32)pCmd->vel.pz );
-        mpDriver->mSim.SetSubYawSpeed( (F32)pCmd->vel.pyaw );
-        mpDriver->mSim.SetSubPitchSpeed( (F32)pCmd->vel.ppitch );
+        // Send all the setpoints together so that they're applied in the
+        // same simulation frame
+        SubVelocityCommand command;
+        command.mForwardSpeed = (F32)pCmd->vel.px;
+        command.mDepthSpeed = (F32)pCmd->vel.pz;
+        command.mYawSpeed = (F32)pCmd->vel.pyaw;
+        command.mPitchSpeed = (F32)pCmd->vel.ppitch;
+        mpDriver->mSim.SetSubVelocities( command );
                 
         return 0;
     }
@@ -231,33 +236,40 @@ int Position3DInterface::ProcessMessage( QueuePointer& respQueue,
 // Update this interface and publish new info.
 void Position3DInterface::Update()
 {
-    // We don't actually publish anything useful here. After all, we don't know
-    // yet if the Sub will do anything other than just take desired velocity
-    // commands. However, some clients will block till they get fresh data...
+    Vector subPos( 0.0f, 0.0f, 0.0f );
+    Vector subRotation( 0.0f, 0.0f, 0.0f );
+    Vector subLinearVelocity( 0.0f, 0.0f, 0.0f );
+    Vector subAngularVelocity( 0.0f, 0.0f, 0.0f );
+    double timestamp = 0.0;
+    
+    // Some clients will block till they get fresh data so we publish even
+    // if the sub can't be found
+    mpDriver->mSim.GetEntityMotion( mSubHandle, &subPos, &subRotation,
+        &subLinearVelocity, &subAngularVelocity, &timestamp );
+    
     player_position3d_data_t data;
 
-    data.pos.px = 0.0;
-    data.pos.py = 0.0;
-    data.pos.pz = 0.0;
+    data.pos.px = subPos.mX;
+    data.pos.py = subPos.mY;
+    data.pos.pz = subPos.mZ;
 
-    data.pos.proll = 0.0;
-    data.pos.ppitch = 0.0;
-    data.pos.pyaw = 0.0;
+    data.pos.proll = subRotation.mY;
+    data.pos.ppitch = subRotation.mX;
+    data.pos.pyaw = subRotation.mZ;
 
-    data.vel.px = 0.0;
-    data.vel.py = 0.0;
-    data.vel.pz = 0.0;
+    // Player velocities are in the robot frame, with x forwards and y to the
+    // left, to match PLAYER_POSITION3D_CMD_SET_VEL
+    data.vel.px = subLinearVelocity.mY;
+    data.vel.py = -subLinearVelocity.mX;
+    data.vel.pz = subLinearVelocity.mZ;
 
-    data.vel.proll = 0.0;
-    data.vel.ppitch = 0.0;
-    data.vel.pyaw = 0.0;
+    data.vel.proll = subAngularVelocity.mY;
+    data.vel.ppitch = subAngularVelocity.mX;
+    data.vel.pyaw = subAngularVelocity.mZ;
 
     data.stall = (uint8_t)0;
 
     mpDriver->Publish( this->mDeviceAddress,
                        PLAYER_MSGTYPE_DATA, PLAYER_POSITION3D_DATA_STATE,
-                       (void*)&data, sizeof( data ) );
+                       (void*)&data, sizeof( data ), &timestamp );
 }
-
-
-
@@ -10,6 +10,7 @@
 
 //------------------------------------------------------------------------------
 #include "SubSimInterface.h"
+#include "Simulator/Simulator.h"
 
 //------------------------------------------------------------------------------
 class Position3DInterface : public SubSimInterface
@@ -26,6 +27,8 @@ class Position3DInterface : public SubSimInterface
 
     // Update this interface, publish new info.
     public: virtual void Update();
+    
+    private: EntityHandle mSubHandle;
 };
 
 #endif // POSITION_3D_INTERFACE_H
@@ -14,6 +14,8 @@ CompassInterface::PresSensorInterface( player_devaddr_t addr,
     SubSimDriver* pDriver, ConfigFile* pConfigFile, int section )
     : SubSimInterface( addr, pDriver, pConfigFile, section )
 {
+    // Resolve the sub once here rather than on every update
+    mSubHandle = mpDriver->mSim.GetEntityHandle( "Sub" );
 }
 
 //------------------------------------------------------------------------------
@@ -41,7 +43,7 @@ void PresSensorInterface::Update()
 
     Vector subPos;
     Vector subRotation;
-    mpDriver->mSim.GetEntityPose( "Sub", &subPos, &subRotation );
+    mpDriver->mSim.GetEntityPose( mSubHandle, &subPos, &subRotation );
     
     data.pose.px = 0.0;
     data.pose.py = 0.0;
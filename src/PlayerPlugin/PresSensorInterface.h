@@ -9,6 +9,7 @@
 
 //------------------------------------------------------------------------------
 #include "SubSimInterface.h"
+#include "Simulator/Simulator.h"
 
 //------------------------------------------------------------------------------
 class PresSensorInterface : public SubSimInterface
@@ -25,6 +26,8 @@ class PresSensorInterface : public SubSimInterface
 
     // Update this interface, publish new info.
     public: virtual void Update();
+    
+    private: EntityHandle mSubHandle;
 };
 
 #endif // PRES_SENSOR_INTERFACE_H
@@ -0,0 +1,98 @@
+//------------------------------------------------------------------------------
+// File: SharedMemoryCameraInterface.cpp
+// Desc: Provides a view from the sub camera to clients on the same machine.
+//       Images are written into a ring buffer in shared memory and only a
+//       SharedMemoryImageDescriptor is sent through Player, as opaque data.
+//       Clients on other machines should use the camera interface instead.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "SharedMemoryCameraInterface.h"
+
+#include <stdio.h>
+#include "SubSimDriver.h"
+
+//------------------------------------------------------------------------------
+static const char* SMCI_DEFAULT_RING_NAME = "/subsim_camera";
+static const int SMCI_DEFAULT_NUM_SLOTS = 4;
+
+//------------------------------------------------------------------------------
+SharedMemoryCameraInterface::SharedMemoryCameraInterface( player_devaddr_t addr,
+    SubSimDriver* pDriver, ConfigFile* pConfigFile, int section )
+    : SubSimInterface( addr, pDriver, pConfigFile, section ),
+    mNumSubscribers( 0 )
+{
+    mpDriver->mSim.GetSubCameraImageDimensions( &mImageWidth, &mImageHeight );
+    mImageBufferSize = mImageWidth*mImageHeight*3;
+
+    const char* ringName = pConfigFile->ReadString(
+        section, "camera_shm_name", SMCI_DEFAULT_RING_NAME );
+    int numSlots = pConfigFile->ReadInt(
+        section, "camera_shm_slots", SMCI_DEFAULT_NUM_SLOTS );
+
+    if ( mImageBufferSize > 0
+        && !mImageRing.Create( ringName, numSlots > 1 ? numSlots : 2, mImageBufferSize ) )
+    {
+        fprintf( stderr, "Error: Unable to create shared memory for the camera\n" );
+    }
+}
+
+//------------------------------------------------------------------------------
+SharedMemoryCameraInterface::~SharedMemoryCameraInterface()
+{
+    mImageRing.Close();
+}
+
+//------------------------------------------------------------------------------
+// Handle all messages.
+int SharedMemoryCameraInterface::ProcessMessage( QueuePointer& respQueue,
+                                        player_msghdr_t* pHeader, void* pData )
+{
+    // No messages for the shared memory camera interface
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+void SharedMemoryCameraInterface::Subscribe()
+{
+    mNumSubscribers++;
+    mpDriver->AddSubCameraSubscriber();
+}
+
+//------------------------------------------------------------------------------
+void SharedMemoryCameraInterface::Unsubscribe()
+{
+    if ( mNumSubscribers > 0 )
+    {
+        mNumSubscribers--;
+        mpDriver->RemoveSubCameraSubscriber();
+    }
+}
+
+//------------------------------------------------------------------------------
+// Update this interface and publish new info.
+void SharedMemoryCameraInterface::Update()
+{
+    if ( 0 == mNumSubscribers || !mImageRing.IsOpen() )
+    {
+        return;
+    }
+
+    // Copy the image straight into shared memory and then tell the clients
+    // where to find it
+    double imageTimestamp = 0.0;
+    U8* pImageData = mImageRing.BeginWrite();
+    mpDriver->mSim.GetSubCameraImage( pImageData, mImageBufferSize, &imageTimestamp );
+
+    SharedMemoryImageDescriptor descriptor;
+    mImageRing.EndWrite( mImageWidth, mImageHeight, PLAYER_CAMERA_FORMAT_RGB888,
+                         mImageBufferSize, imageTimestamp, &descriptor );
+
+    player_opaque_data_t data;
+    data.data_count = sizeof( descriptor );
+    data.data = (uint8_t*)&descriptor;
+
+    mpDriver->Publish( this->mDeviceAddress,
+                       PLAYER_MSGTYPE_DATA, PLAYER_OPAQUE_DATA_STATE,
+                       (void*)&data, sizeof( data ), &imageTimestamp );
+}
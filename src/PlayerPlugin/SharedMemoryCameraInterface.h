@@ -0,0 +1,44 @@
+//------------------------------------------------------------------------------
+// File: SharedMemoryCameraInterface.h
+// Desc: Provides a view from the sub camera to clients on the same machine.
+//       Images are written into a ring buffer in shared memory and only a
+//       SharedMemoryImageDescriptor is sent through Player, as opaque data.
+//       Clients on other machines should use the camera interface instead.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef SHARED_MEMORY_CAMERA_INTERFACE_H
+#define SHARED_MEMORY_CAMERA_INTERFACE_H
+
+//------------------------------------------------------------------------------
+#include "Common.h"
+#include "SubSimInterface.h"
+#include "Common/SharedMemoryImageRing.h"
+
+//------------------------------------------------------------------------------
+class SharedMemoryCameraInterface : public SubSimInterface
+{
+    // Constructor
+    public: SharedMemoryCameraInterface( player_devaddr_t addr, SubSimDriver* pDriver,
+                                         ConfigFile* pConfigFile, int section );
+    // Destructor
+    public: virtual ~SharedMemoryCameraInterface();
+
+    // Handle all messages.
+    public: virtual int ProcessMessage( QueuePointer &respQueue,
+                                      player_msghdr_t* pHeader, void* pData );
+
+    public: virtual void Subscribe();
+    public: virtual void Unsubscribe();
+
+    // Update this interface, publish new info.
+    public: virtual void Update();
+
+    private: SharedMemoryImageRing mImageRing;
+    private: U32 mImageWidth;
+    private: U32 mImageHeight;
+    private: U32 mImageBufferSize;
+    private: S32 mNumSubscribers;
+};
+
+#endif // SHARED_MEMORY_CAMERA_INTERFACE_H
@@ -6,12 +6,19 @@
 
 //------------------------------------------------------------------------------
 #include <time.h>
+#include <string.h>
 //#include <iostream>
 //#include <boost/thread/recursive_mutex.hpp>
 
 //#include "gazebo.h"
 #include "SubSimDriver.h"
 #include "SimulationInterface.h"
+#include "Common/Utils.h"
+
+//------------------------------------------------------------------------------
+// The most frames that a single step request can ask for. This is a minute
+// of sim time at the default frame rate
+static const U32 SI_MAX_NUM_STEP_FRAMES = 1800;
 
 //------------------------------------------------------------------------------
 SimulationInterface::SimulationInterface( player_devaddr_t addr, 
@@ -160,251 +167,191 @@ int SimulationInterface::ProcessMessage( QueuePointer& respQueue,
         
         return 0;
     }
-/*
-  /// Get a 2D pose
-  else if (Message::MatchMessage(hdr, PLAYER_MSGTYPE_REQ,
-                                 PLAYER_SIMULATION_REQ_GET_POSE2D, 
-                                 this->device_addr))
-  {
-    gazebo::SimulationRequestData *gzReq = NULL;
-    player_simulation_pose2d_req_t *req =
-      (player_simulation_pose2d_req_t*)(data);
-
-    this->iface->Lock(1);
-
-    gzReq = &(this->iface->data->requests[this->iface->data->requestCount++]);
-
-    gzReq->type = gazebo::SimulationRequestData::GET_POSE2D;
-
-    strcpy((char*)gzReq->modelName, req->name);
-
-    this->iface->Unlock();
-  }
-  else if (Message::MatchMessage(hdr, PLAYER_MSGTYPE_REQ,
-                                 PLAYER_SIMULATION_REQ_GET_PROPERTY, 
-                                 this->device_addr))
-  {
-    player_simulation_property_req_t *req =
-      (player_simulation_property_req_t*)(data);
-
-    std::string name = req->name;
-    std::string prop = req->prop;
-
-    if (name == "world")
+    // Get a property
+    else if ( Message::MatchMessage( pHeader, PLAYER_MSGTYPE_REQ,
+        PLAYER_SIMULATION_REQ_GET_PROPERTY, this->mDeviceAddress ) )
     {
-      this->iface->Lock(1);
-      req->value = new char[ sizeof(double) ];
-      req->value_count = sizeof(double);
-
-      if (prop == "sim_time")
-      {
-        memcpy(req->value, &this->iface->data->simTime, sizeof(double));
-      }
-      else if (prop == "pause_time")
-      {
-        memcpy(req->value, &this->iface->data->pauseTime, sizeof(double));
-      }
-      else if (prop == "real_time")
-      {
-        memcpy(req->value, &this->iface->data->realTime, sizeof(double));
-      }
-      else if (prop == "state")
-      {
-        memcpy(req->value, &this->iface->data->state, sizeof(int));
-      }
-      this->iface->Unlock();
-
-      this->driver->Publish(this->device_addr, respQueue,
-                          PLAYER_MSGTYPE_RESP_ACK, PLAYER_SIMULATION_REQ_GET_PROPERTY, req, sizeof(*req), NULL);
-
-      if (req->value)
-      {
-        delete [] req->value;
-        req->value = NULL;
-      }
+        player_simulation_property_req_t* pRequest =
+            (player_simulation_property_req_t*)(pData);
+        
+        bool bIsWorld = ( NULL == pRequest->name 
+            || 0 == Utils::stricmp( pRequest->name, "world" ) );
+        const char* prop = ( NULL != pRequest->prop ? pRequest->prop : "" );
+        
+        U8* pValue = NULL;
+        U32 valueSize = 0;
+        double timeValue = 0.0;
+        U8 pausedValue = 0;
+        if ( 0 == Utils::stricmp( prop, "poses" ) )
+        {
+            // The poses of everything in the world, or just of one type of
+            // entity, in a single reply
+            if ( BuildPoseList( bIsWorld ? NULL : pRequest->name ) )
+            {
+                pValue = &mPoseListBuffer[ 0 ];
+                valueSize = mPoseListBuffer.size();
+            }
+            else
+            {
+                printf( "Can't find entity type called %s\n", pRequest->name );
+            }
+        }
+        else if ( bIsWorld && 0 == Utils::stricmp( prop, "sim_time" ) )
+        {
+            timeValue = mpDriver->mSim.GetSimTime();
+            pValue = (U8*)&timeValue;
+            valueSize = sizeof( timeValue );
+        }
+        else if ( bIsWorld && 0 == Utils::stricmp( prop, "real_time" ) )
+        {
+            timeValue = mpDriver->mSim.GetRealTime();
+            pValue = (U8*)&timeValue;
+            valueSize = sizeof( timeValue );
+        }
+        else if ( bIsWorld && 0 == Utils::stricmp( prop, "pause_time" ) )
+        {
+            timeValue = mpDriver->mSim.GetPauseTime();
+            pValue = (U8*)&timeValue;
+            valueSize = sizeof( timeValue );
+        }
+        else if ( bIsWorld && 0 == Utils::stricmp( prop, "state" ) )
+        {
+            mpDriver->mSim.SaveState( &mSavedState );
+            if ( !mSavedState.empty() )
+            {
+                pValue = &mSavedState[ 0 ];
+                valueSize = mSavedState.size();
+            }
+        }
+        else if ( bIsWorld && 0 == Utils::stricmp( prop, "paused" ) )
+        {
+            pausedValue = ( mpDriver->mSim.IsPaused() ? 1 : 0 );
+            pValue = &pausedValue;
+            valueSize = sizeof( pausedValue );
+        }
+        
+        if ( NULL != pValue )
+        {
+            pRequest->value = (char*)pValue;
+            pRequest->value_count = valueSize;
+            
+            mpDriver->Publish( mDeviceAddress, respQueue, 
+                PLAYER_MSGTYPE_RESP_ACK, PLAYER_SIMULATION_REQ_GET_PROPERTY,
+                pRequest, sizeof( player_simulation_property_req_t ), NULL );
+            
+            pRequest->value = NULL;
+            pRequest->value_count = 0;
+        }
+        else
+        {
+            mpDriver->Publish( mDeviceAddress, respQueue, 
+                PLAYER_MSGTYPE_RESP_NACK, PLAYER_SIMULATION_REQ_GET_PROPERTY );
+        }
+        return 0;
     }
-    else
+    // Set a property
+    else if ( Message::MatchMessage( pHeader, PLAYER_MSGTYPE_REQ,
+        PLAYER_SIMULATION_REQ_SET_PROPERTY, this->mDeviceAddress ) )
     {
-      this->iface->Lock(1);
-      gazebo::SimulationRequestData *gzReq = NULL;
-      gzReq = &(this->iface->data->requests[this->iface->data->requestCount++]);
-
-      if (prop == "num_children")
-      {
-        gzReq->type = gazebo::SimulationRequestData::GET_NUM_CHILDREN;
-        strcpy((char*)gzReq->modelName, req->name);   
-      }
-      else if (prop == "model_name")
-      {
-        gzReq->type = gazebo::SimulationRequestData::GET_MODEL_NAME;
-        //gzReq->uintValue = req->index;
-      }
-      else if (prop == "child_name")
-      {
-        gzReq->type = gazebo::SimulationRequestData::GET_CHILD_NAME;
-        //gzReq->uintValue = req->index;
-        strcpy((char*)gzReq->modelName, req->name);   
-      }
-       else if (prop == "fiducial_id")
-      {
-        gzReq->type = gazebo::SimulationRequestData::GET_MODEL_FIDUCIAL_ID;
-        strcpy((char*)gzReq->modelName, req->name);   
-      }
-      else if (prop == "model_type")
-      {
-        gzReq->type = gazebo::SimulationRequestData::GET_MODEL_TYPE;
-        strcpy((char*)gzReq->modelName, req->name);   
-      }
-      else if ((prop == "num_models") && (name == "world"))
-      { 
-        gazebo::SimulationRequestData *gzReq = NULL;
-        gzReq = &(this->iface->data->requests[this->iface->data->requestCount++]);
-        gzReq->type = gazebo::SimulationRequestData::GET_NUM_MODELS;
-      }
-      else 
-      {
-        this->iface->data->requestCount--; //we did ++ but didnt introduced real request 
-        std::cerr << "The object [" << name << "] does not have the property [" << prop << "].\n";
-      }
-      this->iface->Unlock();
+        player_simulation_property_req_t* pRequest =
+            (player_simulation_property_req_t*)(pData);
+        
+        bool bIsWorld = ( NULL == pRequest->name 
+            || 0 == Utils::stricmp( pRequest->name, "world" ) );
+        const char* prop = ( NULL != pRequest->prop ? pRequest->prop : "" );
+        
+        bool bSucceeded = false;
+        if ( bIsWorld && 0 == Utils::stricmp( prop, "step" ) 
+            && sizeof( U32 ) == pRequest->value_count )
+        {
+            // Stepping only makes sense if nothing else is moving the
+            // simulation forward. The reply isn't sent until the frames
+            // have been simulated
+            U32 numFrames;
+            memcpy( &numFrames, pRequest->value, sizeof( numFrames ) );
+            if ( !mpDriver->mSim.IsPaused() )
+            {
+                printf( "The simulation must be paused before it can be stepped\n" );
+            }
+            else if ( numFrames > SI_MAX_NUM_STEP_FRAMES )
+            {
+                // No other messages are handled whilst stepping
+                printf( "Can't step more than %u frames at a time\n", SI_MAX_NUM_STEP_FRAMES );
+            }
+            else
+            {
+                mpDriver->mSim.Step( numFrames );
+                bSucceeded = true;
+            }
+        }
+        else if ( bIsWorld && 0 == Utils::stricmp( prop, "state" ) )
+        {
+            bSucceeded = mpDriver->mSim.RestoreState( 
+                (const U8*)pRequest->value, pRequest->value_count );
+            if ( bSucceeded )
+            {
+                // Sim time may have gone backwards
+                mpDriver->RescheduleUpdates();
+            }
+        }
+        else if ( bIsWorld && 0 == Utils::stricmp( prop, "paused" )
+            && pRequest->value_count > 0 )
+        {
+            mpDriver->mSim.SetPaused( 0 != pRequest->value[ 0 ] );
+            bSucceeded = true;
+        }
+        
+        mpDriver->Publish( mDeviceAddress, respQueue, 
+            ( bSucceeded ? PLAYER_MSGTYPE_RESP_ACK : PLAYER_MSGTYPE_RESP_NACK ), 
+            PLAYER_SIMULATION_REQ_SET_PROPERTY );
+        return 0;
     }
-  }*/
-  /*else if (Message::MatchMessage(hdr, PLAYER_MSGTYPE_CMD,
-                                 PLAYER_SIMULATION_CMD_PAUSE, 
-                                 this->device_addr))
-  {
-    this->iface->Lock(1);
-    gazebo::SimulationRequestData *gzReq = NULL;
-    gzReq = &(this->iface->data->requests[this->iface->data->requestCount++]);
-    gzReq->type = SimulationRequestData::PAUSE;
-    this->iface->Unlock();
-  } 
-  else if (Message::MatchMessage(hdr, PLAYER_MSGTYPE_CMD,
-                                 PLAYER_SIMULATION_CMD_RESET, 
-                                 this->device_addr))
-  {
-    this->iface->Lock(1);
-    gazebo::SimulationRequestData *gzReq = NULL;
-    gzReq = &(this->iface->data->requests[this->iface->data->requestCount++]);
-    gzReq->type = SimulationRequestData::RESET;
-    this->iface->Unlock();
-  } 
-  else if (Message::MatchMessage(hdr, PLAYER_MSGTYPE_CMD,
-                                 PLAYER_SIMULATION_CMD_SAVE, 
-                                 this->device_addr))
-  {
-    this->iface->Lock(1);
-    gazebo::SimulationRequestData *gzReq = NULL;
-    gzReq = &(this->iface->data->requests[this->iface->data->requestCount++]);
-    gzReq->type = SimulationRequestData::SAVE;
-    this->iface->Unlock();
-  }
-  */
-  //else
-  //  printf("Unhandled Process message[%d][%d]\n",0,0);
-
+    // Pause or resume the simulation
+    else if ( Message::MatchMessage( pHeader, PLAYER_MSGTYPE_CMD,
+        PLAYER_SIMULATION_CMD_PAUSE, this->mDeviceAddress ) )
+    {
+        mpDriver->mSim.SetPaused( !mpDriver->mSim.IsPaused() );
+        return 0;
+    }
+    // Put everything back where it started
+    else if ( Message::MatchMessage( pHeader, PLAYER_MSGTYPE_CMD,
+        PLAYER_SIMULATION_CMD_RESET, this->mDeviceAddress ) )
+    {
+        mpDriver->mSim.ResetWorld();
+        return 0;
+    }
+    
     printf( "Unhandled message\n" );
     return -1;
 }
 
 
 //------------------------------------------------------------------------------
-// Update this interface and publish new info.
-void SimulationInterface::Update()
+bool SimulationInterface::BuildPoseList( const char* typeName )
 {
-  /*boost::recursive_mutex::scoped_lock lock(*this->mutex);
-  gazebo::SimulationRequestData *response = NULL;
-  this->iface->Lock(1);
-
-  for (unsigned int i=0; i < this->iface->data->responseCount; i++)
-  {
-    response = &(this->iface->data->responses[i]);
-
-    switch (response->type)
+    EntityPoseListHeader header;
+    if ( !mpDriver->mSim.GetEntityPoseList( typeName, &header, &mPoseRecords ) )
     {
-      case gazebo::SimulationRequestData::SET_STATE:
-      case gazebo::SimulationRequestData::GO:
-      case gazebo::SimulationRequestData::PAUSE:
-      case gazebo::SimulationRequestData::RESET:
-      case gazebo::SimulationRequestData::SAVE:
-      case gazebo::SimulationRequestData::SET_POSE2D:
-      case gazebo::SimulationRequestData::SET_POSE3D:
-        break;
-
-      case gazebo::SimulationRequestData::GET_POSE3D:
-        {
-
-          if (this->pose3dReq.name_count != strlen(response->modelName))
-          {
-            if (this->pose3dReq.name)
-              delete [] this->pose3dReq.name;
-            this->pose3dReq.name = new char[strlen(response->modelName)+1];
-          }
-
-          strcpy(this->pose3dReq.name, response->modelName);
-          this->pose3dReq.name_count = strlen(this->pose3dReq.name);
-
-          this->pose3dReq.pose.px = response->modelPose.pos.x;
-          this->pose3dReq.pose.py = response->modelPose.pos.y;
-          this->pose3dReq.pose.pz = response->modelPose.pos.z;
-
-          this->pose3dReq.pose.proll = response->modelPose.roll;
-          this->pose3dReq.pose.ppitch = response->modelPose.pitch;
-          this->pose3dReq.pose.pyaw = response->modelPose.yaw;
-
-          this->driver->Publish(this->device_addr, *(this->responseQueue),
-              PLAYER_MSGTYPE_RESP_ACK, PLAYER_SIMULATION_REQ_GET_POSE3D,
-              &this->pose3dReq, sizeof(this->pose3dReq), NULL);
-
-          break;
-        }
-      case gazebo::SimulationRequestData::GET_POSE2D:
-        {
-
-          if (this->pose2dReq.name_count != strlen(response->modelName))
-          {
-            if (this->pose2dReq.name)
-              delete [] this->pose2dReq.name;
-            this->pose2dReq.name = new char[strlen(response->modelName)+1];
-          }
-
-          strcpy(this->pose2dReq.name, response->modelName);
-          this->pose2dReq.name_count = strlen(this->pose2dReq.name);
-
-          this->pose2dReq.pose.px = response->modelPose.pos.x;
-          this->pose2dReq.pose.py = response->modelPose.pos.y;
-          this->pose2dReq.pose.pa = response->modelPose.yaw;
-
-          this->driver->Publish(this->device_addr, *(this->responseQueue),
-              PLAYER_MSGTYPE_RESP_ACK, PLAYER_SIMULATION_REQ_GET_POSE2D,
-              &this->pose2dReq, sizeof(this->pose2dReq), NULL);
-
-          break;
-        }
-
-      case gazebo::SimulationRequestData::GET_MODEL_FIDUCIAL_ID:
-        {
-          player_simulation_property_req_t *req ;
-          memset (req, 0, sizeof(player_simulation_property_req_t));
-
-          memcpy(req->value, (const void *) response->uintValue, sizeof(response->uintValue));
-          req->value_count = sizeof(response->uintValue);
-          this->driver->Publish(this->device_addr, *(this->responseQueue),
-                          PLAYER_MSGTYPE_RESP_ACK, PLAYER_SIMULATION_REQ_GET_PROPERTY, req, sizeof(*req), NULL);
-          break;
-        }
-
-
-
-
+        return false;
     }
-  }
-
-  this->iface->data->responseCount = 0;
-
-  this->iface->Unlock();*/
+    
+    U32 recordsSize = mPoseRecords.size()*sizeof( EntityPoseRecord );
+    mPoseListBuffer.resize( sizeof( EntityPoseListHeader ) + recordsSize );
+    memcpy( &mPoseListBuffer[ 0 ], &header, sizeof( EntityPoseListHeader ) );
+    if ( recordsSize > 0 )
+    {
+        memcpy( &mPoseListBuffer[ sizeof( EntityPoseListHeader ) ], 
+                &mPoseRecords[ 0 ], recordsSize );
+    }
+    
+    return true;
+}
 
-  return;
+//------------------------------------------------------------------------------
+// Update this interface and publish new info.
+void SimulationInterface::Update()
+{
+    // Requests are answered as they arrive so there's nothing to publish
 }
 
 
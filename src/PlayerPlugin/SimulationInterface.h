@@ -9,7 +9,10 @@
 #define SIMULATION_INTERFACE_H
 
 //------------------------------------------------------------------------------
+#include <vector>
+#include "Common.h"
 #include "SubSimInterface.h"
+#include "Simulator/EntityPoseList.h"
 
 /// \addtogroup player_iface 
 /// \{
@@ -27,6 +30,21 @@
 ///    - "sim_time" returns double
 ///    - "real_time" returns double
 ///    - "pause_time" returns double
+///    - "paused" returns a uint8, 1 if the simulation is paused
+///    - "state" returns a snapshot of the world from Simulator::SaveState
+///    - "poses" returns the poses of every entity if the name is "world",
+///      or of every entity of a type if the name is a type name such as
+///      "Gate". The reply is packed as described in 
+///      Simulator/EntityPoseList.h
+///  - PLAYER_SIMULATION_REQ_SET_PROPERTY
+///    - "paused" takes a uint8, non zero to pause the simulation
+///    - "state" restores a snapshot returned by the "state" property
+///    - "step" takes a uint32 number of frames to simulate. Only allowed
+///      whilst paused. The reply is sent once the frames are done
+///  - PLAYER_SIMULATION_CMD_PAUSE
+///    - pauses the simulation, or resumes it if it's already paused
+///  - PLAYER_SIMULATION_CMD_RESET
+///    - puts all entities back where they started, see Simulator::ResetWorld
 
 //------------------------------------------------------------------------------
 class SimulationInterface : public SubSimInterface
@@ -43,6 +61,16 @@ class SimulationInterface : public SubSimInterface
 
     // Update this interface, publish new info.
     public: virtual void Update();
+    
+    // Packs the poses of the entities of a type, or of all entities if 
+    // typeName is NULL, into mPoseListBuffer. Returns false if the type
+    // doesn't exist
+    private: bool BuildPoseList( const char* typeName );
+    
+    // Reused between requests so that polling doesn't allocate
+    private: std::vector<EntityPoseRecord> mPoseRecords;
+    private: std::vector<U8> mPoseListBuffer;
+    private: std::vector<U8> mSavedState;
 };
 
 #endif // SIMULATION_INTERFACE_H
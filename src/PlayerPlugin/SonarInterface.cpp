@@ -1,6 +1,9 @@
 //------------------------------------------------------------------------------
 // File: SonarInterface.cpp
-// Desc: A very faked implementation of the Micron Sonar interface
+// Desc: Simulates a Tritech Micron sonar mounted on the sub. The sonar head
+//       steps around in sim time, casting a beam into the world at each step,
+//       and the finished scan is sent out as an image. In streaming mode each
+//       beam is also sent out as soon as it has been cast.
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
@@ -8,19 +11,49 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include "SubSimDriver.h"
 
 //------------------------------------------------------------------------------
-SonarInterface::SonarInterface( player_devaddr_t addr, 
+static const F32 SI_DEFAULT_STEP_ANGLE_DEGREES = 1.8f;
+static const F32 SI_DEFAULT_STEPS_PER_SECOND = 50.0f;
+static const F32 SI_TWO_PI = 2.0f*(F32)M_PI;
+
+//------------------------------------------------------------------------------
+// Wraps an angle into the range [0, 2*PI)
+static F32 WrapAngle( F32 angle )
+{
+    angle = fmodf( angle, SI_TWO_PI );
+    return ( angle < 0.0f ? angle + SI_TWO_PI : angle );
+}
+
+//------------------------------------------------------------------------------
+SonarInterface::SonarInterface( player_devaddr_t addr,
     SubSimDriver* pDriver, ConfigFile* pConfigFile, int section )
     : SubSimInterface( addr, pDriver, pConfigFile, section ),
     mbScanActive( false ),
+    mScanStartTime( 0.0 ),
     mScanStartAngle( 0.0f*M_PI/180.0f ),
     mScanEndAngle( 0.0f*M_PI/180.0f ),
     mRange( 5 ),
     mNumBins( 100 ),
-    mGain( 0.1f )
+    mGain( 0.1f ),
+    mbStreamBeams( false ),
+    mNumBeamsCast( 0 ),
+    mLastCastTime( 0.0 )
 {
+    F32 stepAngleDegrees = pConfigFile->ReadFloat(
+        section, "sonar_step_angle", SI_DEFAULT_STEP_ANGLE_DEGREES );
+    mStepAngle = ( stepAngleDegrees > 0.0f ? stepAngleDegrees : SI_DEFAULT_STEP_ANGLE_DEGREES )*M_PI/180.0f;
+
+    mStepsPerSecond = pConfigFile->ReadFloat(
+        section, "sonar_steps_per_second", SI_DEFAULT_STEPS_PER_SECOND );
+    if ( mStepsPerSecond <= 0.0f )
+    {
+        mStepsPerSecond = SI_DEFAULT_STEPS_PER_SECOND;
+    }
+
+    mbStreamBeams = ( 0 != pConfigFile->ReadInt( section, "sonar_stream_beams", 0 ) );
 }
 
 //------------------------------------------------------------------------------
@@ -33,17 +66,16 @@ SonarInterface::~SonarInterface()
 int SonarInterface::ProcessMessage( QueuePointer& respQueue,
                                         player_msghdr_t* pHeader, void* pData )
 {
-    if ( Message::MatchMessage( pHeader, PLAYER_MSGTYPE_CMD, 
+    if ( Message::MatchMessage( pHeader, PLAYER_MSGTYPE_CMD,
         PLAYER_MICRONSONAR_CMD_SCAN, mDeviceAddress ) )
     {
         player_micronsonar_cmd_scan_t* pCmd = (player_micronsonar_cmd_scan_t*)pData;
-        
+
         // Start a scan
         mScanStartAngle = pCmd->startAngle;
         mScanEndAngle = pCmd->endAngle;
-        mbScanActive = true;
-        mScanStartTime = HighPrecisionTime::GetTime();
-    
+        StartScan( mpDriver->mSim.GetSimTime() );
+
         return 0;
     }
     else if( Message::MatchMessage( pHeader, PLAYER_MSGTYPE_REQ,
@@ -52,10 +84,16 @@ int SonarInterface::ProcessMessage( QueuePointer& respQueue,
         player_micronsonar_config_t* pConfig =
             (player_micronsonar_config_t*)pData;
 
-        mRange = pConfig->range;
-        mNumBins = pConfig->numBins;
+        mRange = ( pConfig->range > 0 ? pConfig->range : 1 );
+        mNumBins = ( pConfig->numBins > 0 ? pConfig->numBins : 1 );
         mGain = pConfig->gain;
-            
+
+        // The bins of a scan in progress no longer match so start it again
+        if ( mbScanActive )
+        {
+            StartScan( mpDriver->mSim.GetSimTime() );
+        }
+
         mpDriver->Publish( mDeviceAddress, respQueue,
             PLAYER_MSGTYPE_RESP_ACK, PLAYER_MICRONSONAR_REQ_SET_CONFIG,
             pData, pHeader->size, NULL );
@@ -73,64 +111,157 @@ int SonarInterface::ProcessMessage( QueuePointer& respQueue,
         mpDriver->Publish( mDeviceAddress, respQueue,
             PLAYER_MSGTYPE_RESP_ACK, PLAYER_MICRONSONAR_REQ_GET_CONFIG,
             (void*)&config, sizeof(config), NULL );
-    
+
         return 0;
     }
-    
+
     printf( "Unhandled message\n" );
     return -1;
 }
 
+//------------------------------------------------------------------------------
+void SonarInterface::StartScan( double startTime )
+{
+    // Scans go anticlockwise from the start angle to the end angle. If they're
+    // the same then the head goes all the way round
+    F32 scanAngle = WrapAngle( mScanEndAngle - mScanStartAngle );
+    U32 numBeams = 0;
+    if ( scanAngle < 0.5f*mStepAngle )
+    {
+        numBeams = (U32)( SI_TWO_PI/mStepAngle + 0.5f );
+    }
+    else
+    {
+        numBeams = (U32)( scanAngle/mStepAngle + 0.5f ) + 1;
+    }
+
+    mBeamAngles.resize( numBeams );
+    for ( U32 beamIdx = 0; beamIdx < numBeams; beamIdx++ )
+    {
+        mBeamAngles[ beamIdx ] = WrapAngle( mScanStartAngle + beamIdx*mStepAngle );
+    }
+
+    mScanBins.resize( numBeams*mNumBins + PolarImageRasteriser::BIN_PADDING );
+    mNumBeamsCast = 0;
+    mScanStartTime = startTime;
+    mLastCastTime = startTime;
+    mbScanActive = true;
+
+    // The lookup tables for the image only need rebuilding if the geometry
+    // of the scan has changed. The image has one pixel per bin with the
+    // sonar head in the middle and the front of the sub at the top
+    if ( mRasteriser.SetGeometry( mNumBins, numBeams, mScanStartAngle, mStepAngle ) )
+    {
+        mImage.resize( mRasteriser.GetImageSize() );
+        memset( &mImage[ 0 ], 0, mImage.size() );
+    }
+}
+
+//------------------------------------------------------------------------------
+void SonarInterface::PublishBeam( U32 beamIdx, double timestamp )
+{
+    player_micronsonar_data_t data;
+    data.range = mRange;
+    data.numBins = mNumBins;
+    data.startAngle = mBeamAngles[ beamIdx ];
+    data.endAngle = mBeamAngles[ beamIdx ];
+    data.centreX = 0;
+    data.centreY = 0;
+    data.width = mNumBins;
+    data.height = 1;
+    data.bpp = 8;
+    data.format = PLAYER_MICRONSONAR_FORMAT_MONO8;
+    data.image_count = mNumBins;
+    data.image = &mScanBins[ beamIdx*mNumBins ];
+
+    mpDriver->Publish( mDeviceAddress,
+        PLAYER_MSGTYPE_DATA, PLAYER_MICRONSONAR_DATA_STATE,
+        &data, 0, &timestamp );
+}
 
 //------------------------------------------------------------------------------
 // Update this interface and publish new info.
 void SonarInterface::Update()
 {
-    HighPrecisionTime curTime = HighPrecisionTime::GetTime();
-    
-    F32 timeDiff = HighPrecisionTime::ConvertToSeconds(
-        HighPrecisionTime::GetDiff( curTime, mScanStartTime ) );
+    if ( !mbScanActive )
+    {
+        return;
+    }
+
+    // Cast all of the beams that the head should have reached by now
+    U32 numBeams = mBeamAngles.size();
+    double simTime = mpDriver->mSim.GetSimTime();
+    if ( simTime < mScanStartTime )
+    {
+        // The next scan of a stream may not have started yet. If it's 
+        // further away than that then sim time has been wound back and the 
+        // scan is started again from now
+        if ( mScanStartTime - simTime <= numBeams/mStepsPerSecond )
+        {
+            return;
+        }
+        StartScan( simTime );
+    }
     
-    if ( mbScanActive 
-        && timeDiff > 5.0f )
+    U32 numBeamsDue = (U32)( ( simTime - mScanStartTime )*mStepsPerSecond ) + 1;
+    if ( numBeamsDue > numBeams )
+    {
+        numBeamsDue = numBeams;
+    }
+
+    if ( numBeamsDue > mNumBeamsCast )
+    {
+        mLastCastTime = mpDriver->mSim.CastSubSonarBeams(
+            &mBeamAngles[ mNumBeamsCast ], numBeamsDue - mNumBeamsCast,
+            (F32)mRange, mNumBins, mGain, &mScanBins[ mNumBeamsCast*mNumBins ] );
+
+        // When streaming, the image is kept up to date as the head moves
+        // round so that there's nothing left to draw at the end of the scan
+        if ( mbStreamBeams )
+        {
+            for ( U32 beamIdx = mNumBeamsCast; beamIdx < numBeamsDue; beamIdx++ )
+            {
+                PublishBeam( beamIdx, mLastCastTime );
+            }
+            mRasteriser.RasteriseBeams( &mScanBins[ 0 ], mNumBeamsCast, numBeamsDue, &mImage[ 0 ] );
+        }
+        mNumBeamsCast = numBeamsDue;
+    }
+
+    if ( mNumBeamsCast >= numBeams )
     {
         mbScanActive = false;
-     
+        if ( !mbStreamBeams )
+        {
+            mRasteriser.Rasterise( &mScanBins[ 0 ], &mImage[ 0 ] );
+        }
+
         // Build up the data struct
         player_micronsonar_data_t data;
         data.range = mRange;
         data.numBins = mNumBins;
         data.startAngle = mScanStartAngle;
         data.endAngle = mScanEndAngle;
-        
-        S32 imageDim = 2*mRange;
-                
-        data.centreX = imageDim/2;
-        data.centreY = imageDim/2;
-        data.width = imageDim;
-        data.height = imageDim;
+
+        data.centreX = mNumBins;
+        data.centreY = mNumBins;
+        data.width = mRasteriser.GetImageWidth();
+        data.height = mRasteriser.GetImageHeight();
         data.bpp = 8;
         data.format = PLAYER_MICRONSONAR_FORMAT_MONO8;
         data.image_count = data.width*data.height;
-        data.image = new U8[ data.image_count ];
-        memset( data.image, 0, data.image_count );    // Clear image
-    
-        // Put something vaguely interesting in
-        for ( S32 y = 0; y < data.height; y++ )
-        {
-            for ( S32 x = 0; x < data.width; x++ )
-            {
-                data.image[ data.width*y + x ] = (x+y)%256;
-            }
-        }
-                
+        data.image = &mImage[ 0 ];
+
         // Write data to the client (through the server)
         mpDriver->Publish( mDeviceAddress,
-            PLAYER_MSGTYPE_DATA, PLAYER_MICRONSONAR_DATA_STATE, &data );
-        delete [] data.image;
-    
+            PLAYER_MSGTYPE_DATA, PLAYER_MICRONSONAR_DATA_STATE,
+            &data, 0, &mLastCastTime );
+
+        // When streaming, the head carries on scanning from where the last
+        // scan would have finished so that the step rate stays steady
+        if ( mbStreamBeams )
+        {
+            StartScan( mScanStartTime + numBeams/mStepsPerSecond );
+        }
     }
 }
-
-
-
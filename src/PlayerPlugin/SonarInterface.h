@@ -1,6 +1,14 @@
 //------------------------------------------------------------------------------
 // File: SonarInterface.h
-// Desc: A very faked implementation of the Micron Sonar interface
+// Desc: Simulates a Tritech Micron sonar mounted on the sub. The sonar head
+//       steps around in sim time, casting a beam into the world at each step,
+//       and the finished scan is sent out as an image.
+//
+//       In streaming mode each beam is also sent out as soon as it has been
+//       cast, and the head keeps scanning until it is told to do something
+//       else. A beam is sent as an image that is numBins wide and 1 high,
+//       with the bins running outwards from the head, and with startAngle
+//       and endAngle both set to the angle of the beam.
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
@@ -8,8 +16,10 @@
 #define SONAR_INTERFACE_H
 
 //------------------------------------------------------------------------------
+#include <vector>
+#include "Common.h"
 #include "SubSimInterface.h"
-#include "Common/HighPrecisionTime.h"
+#include "Common/PolarImageRasteriser.h"
 
 //------------------------------------------------------------------------------
 class SonarInterface : public SubSimInterface
@@ -26,14 +36,35 @@ class SonarInterface : public SubSimInterface
 
     // Update this interface, publish new info.
     public: virtual void Update();
-    
-    private: HighPrecisionTime mScanStartTime;
+
+    // Works out the beam angles for a scan and starts the head moving
+    private: void StartScan( double startTime );
+
+    // Sends out a beam of the current scan in streaming mode
+    private: void PublishBeam( U32 beamIdx, double timestamp );
+
     private: bool mbScanActive;
+    private: double mScanStartTime;     // Sim time
     private: F32 mScanStartAngle;
     private: F32 mScanEndAngle;
     private: S32 mRange;
     private: S32 mNumBins;
     private: F32 mGain;
+
+    // Movement of the sonar head
+    private: F32 mStepAngle;
+    private: F32 mStepsPerSecond;
+    private: bool mbStreamBeams;
+
+    // The scan in progress. Beams are stored one after the other, each
+    // with mNumBins bins. The buffers are only reallocated if the scan
+    // gets bigger
+    private: std::vector<F32> mBeamAngles;
+    private: std::vector<U8> mScanBins;
+    private: U32 mNumBeamsCast;
+    private: double mLastCastTime;
+    private: PolarImageRasteriser mRasteriser;
+    private: std::vector<U8> mImage;
 };
 
 #endif // SONAR_INTERFACE_H
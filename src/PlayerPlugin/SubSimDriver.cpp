@@ -5,13 +5,19 @@
 
 //------------------------------------------------------------------------------
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
 #include "SubSimDriver.h"
+#include "Common/Profiler.h"
 #include "SimulationInterface.h"
 #include "CameraInterface.h"
 #include "Position3DInterface.h"
 #include "CompassInterface.h"
 #include "DepthSensorInterface.h"
 #include "SonarInterface.h"
+#include "SharedMemoryCameraInterface.h"
 
 //------------------------------------------------------------------------------
 // A factory creation function, declared outside of the class so that it
@@ -57,8 +63,141 @@ extern "C"
 //------------------------------------------------------------------------------
 // SubSimDriver
 //------------------------------------------------------------------------------
-static const double SDD_INTERFACE_UPDATES_PER_SECOND = 30.0;
+static const double SDD_DEADLINE_TOLERANCE = 1.0e-6;
 static const int SDD_NUM_MESSAGES_HANDLED_PER_UPDATE = -1;
+static const size_t SDD_REPLAY_RESPONSE_QUEUE_LENGTH = 64;
+
+//------------------------------------------------------------------------------
+// Anything that changes the simulation has to be in the log for a replay to
+// match the original run, so messages are only recorded if they're listed 
+// here and known to be safe to copy
+struct SDD_MessagePolicy
+{
+    U16 mInterface;
+    U8 mType;
+    U8 mSubtype;
+    eRecordPolicy mPolicy;
+    U32 mPayloadSize;       // Largest payload recorded for eRP_RecordPayload
+};
+
+static const SDD_MessagePolicy SDD_MESSAGE_POLICIES[] =
+{
+    { PLAYER_POSITION3D_CODE, PLAYER_MSGTYPE_CMD, PLAYER_POSITION3D_CMD_SET_VEL, 
+        eRP_RecordPayload, sizeof( player_position3d_cmd_vel_t ) },
+    { PLAYER_POSITION3D_CODE, PLAYER_MSGTYPE_REQ, PLAYER_POSITION3D_REQ_MOTOR_POWER, 
+        eRP_NotRecorded, 0 },
+    { PLAYER_MICRONSONAR_CODE, PLAYER_MSGTYPE_CMD, PLAYER_MICRONSONAR_CMD_SCAN, 
+        eRP_RecordPayload, sizeof( player_micronsonar_cmd_scan_t ) },
+    { PLAYER_MICRONSONAR_CODE, PLAYER_MSGTYPE_REQ, PLAYER_MICRONSONAR_REQ_SET_CONFIG, 
+        eRP_RecordPayload, sizeof( player_micronsonar_config_t ) },
+    { PLAYER_MICRONSONAR_CODE, PLAYER_MSGTYPE_REQ, PLAYER_MICRONSONAR_REQ_GET_CONFIG, 
+        eRP_NotRecorded, 0 },
+    { PLAYER_SIMULATION_CODE, PLAYER_MSGTYPE_CMD, PLAYER_SIMULATION_CMD_PAUSE, 
+        eRP_RecordPayload, sizeof( player_simulation_cmd_t ) },
+    { PLAYER_SIMULATION_CODE, PLAYER_MSGTYPE_CMD, PLAYER_SIMULATION_CMD_RESET, 
+        eRP_RecordPayload, sizeof( player_simulation_cmd_t ) },
+    { PLAYER_SIMULATION_CODE, PLAYER_MSGTYPE_REQ, PLAYER_SIMULATION_REQ_SET_PROPERTY, 
+        eRP_RecordProperty, 0 },
+    { PLAYER_SIMULATION_CODE, PLAYER_MSGTYPE_REQ, PLAYER_SIMULATION_REQ_GET_PROPERTY, 
+        eRP_NotRecorded, 0 },
+    { PLAYER_SIMULATION_CODE, PLAYER_MSGTYPE_REQ, PLAYER_SIMULATION_REQ_GET_POSE2D, 
+        eRP_NotRecorded, 0 },
+    { PLAYER_SIMULATION_CODE, PLAYER_MSGTYPE_REQ, PLAYER_SIMULATION_REQ_GET_POSE3D, 
+        eRP_NotRecorded, 0 }
+};
+static const U32 SDD_NUM_MESSAGE_POLICIES = 
+    sizeof( SDD_MESSAGE_POLICIES )/sizeof( SDD_MESSAGE_POLICIES[ 0 ] );
+
+//------------------------------------------------------------------------------
+// Property requests are flattened into a U32 length and the bytes of the 
+// name, the prop and the value in turn, followed by the index. A length of 
+// SDD_NULL_FIELD_LENGTH stands for a NULL pointer
+static const U32 SDD_NULL_FIELD_LENGTH = 0xFFFFFFFF;
+
+//------------------------------------------------------------------------------
+static void SDD_AppendField( std::vector<U8>* pBuffer, const void* pData, U32 dataSize )
+{
+    U32 length = ( NULL != pData ? dataSize : SDD_NULL_FIELD_LENGTH );
+    const U8* pLength = (const U8*)&length;
+    pBuffer->insert( pBuffer->end(), pLength, pLength + sizeof( length ) );
+    if ( NULL != pData )
+    {
+        pBuffer->insert( pBuffer->end(), (const U8*)pData, (const U8*)pData + dataSize );
+    }
+}
+
+//------------------------------------------------------------------------------
+// Points pField into the buffer, or at NULL. Returns false if the buffer
+// is too short
+static bool SDD_ReadField( std::vector<U8>* pBuffer, U32* pOffset, 
+                           char** pField, uint32_t* pFieldSize )
+{
+    U32 length;
+    if ( *pOffset + sizeof( length ) > pBuffer->size() )
+    {
+        return false;
+    }
+    memcpy( &length, &(*pBuffer)[ *pOffset ], sizeof( length ) );
+    *pOffset += sizeof( length );
+    
+    if ( SDD_NULL_FIELD_LENGTH == length )
+    {
+        *pField = NULL;
+        *pFieldSize = 0;
+        return true;
+    }
+    
+    if ( length > pBuffer->size() - *pOffset )
+    {
+        return false;
+    }
+    *pField = ( length > 0 ? (char*)&(*pBuffer)[ *pOffset ] : NULL );
+    *pFieldSize = length;
+    *pOffset += length;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+static void SDD_FlattenPropertyRequest( const player_simulation_property_req_t* pRequest,
+                                        std::vector<U8>* pBuffer )
+{
+    pBuffer->clear();
+    
+    // Strings are stored with their terminator so that they can be used
+    // straight from the buffer when they're replayed
+    SDD_AppendField( pBuffer, pRequest->name, 
+        ( NULL != pRequest->name ? strlen( pRequest->name ) + 1 : 0 ) );
+    SDD_AppendField( pBuffer, pRequest->prop, 
+        ( NULL != pRequest->prop ? strlen( pRequest->prop ) + 1 : 0 ) );
+    SDD_AppendField( pBuffer, ( pRequest->value_count > 0 ? pRequest->value : NULL ), 
+        pRequest->value_count );
+    SDD_AppendField( pBuffer, &pRequest->index, sizeof( pRequest->index ) );
+}
+
+//------------------------------------------------------------------------------
+// The request points into pBuffer so the buffer must outlive it
+static bool SDD_UnflattenPropertyRequest( std::vector<U8>* pBuffer,
+                                          player_simulation_property_req_t* pRequest )
+{
+    memset( pRequest, 0, sizeof( *pRequest ) );
+    
+    U32 offset = 0;
+    char* pIndex = NULL;
+    uint32_t indexSize = 0;
+    if ( !SDD_ReadField( pBuffer, &offset, &pRequest->name, &pRequest->name_count )
+        || !SDD_ReadField( pBuffer, &offset, &pRequest->prop, &pRequest->prop_count )
+        || !SDD_ReadField( pBuffer, &offset, &pRequest->value, &pRequest->value_count )
+        || !SDD_ReadField( pBuffer, &offset, &pIndex, &indexSize )
+        || sizeof( pRequest->index ) != indexSize )
+    {
+        return false;
+    }
+    memcpy( &pRequest->index, pIndex, sizeof( pRequest->index ) );
+    
+    // The strings were stored with their terminators
+    return ( ( NULL == pRequest->name || '\0' == pRequest->name[ pRequest->name_count - 1 ] )
+        && ( NULL == pRequest->prop || '\0' == pRequest->prop[ pRequest->prop_count - 1 ] ) );
+}
 
 //------------------------------------------------------------------------------
 // Constructor.  Retrieve options from the configuration file and do any
@@ -67,26 +206,102 @@ SubSimDriver::SubSimDriver( ConfigFile* pConfigFile, int section )
     : Driver( pConfigFile, section, false, 4096 ),
     mpDeviceList( NULL ),
     mNumDevices( 0 ),
-    mMaxNumDevices( 0 )
+    mMaxNumDevices( 0 ),
+    mNumSubCameraSubscribers( 0 ),
+    mRandomSeed( 0 ),
+    mbReplaying( false ),
+    mNextReplayMessageIdx( 0 ),
+    mReplayResponseQueue( false, SDD_REPLAY_RESPONSE_QUEUE_LENGTH )
 {
-    if ( !mSim.Init( pConfigFile->ReadString( section, "world", NULL ) ) )
+    // The profile is written out when the driver is destroyed
+    const char* profileFilename = pConfigFile->ReadString( section, "profile", NULL );
+    if ( NULL != profileFilename )
+    {
+        Profiler::SetThreadName( "Player" );
+        Profiler::Start( profileFilename );
+    }
+    
+    bool bHeadless = ( 0 != pConfigFile->ReadInt( section, "headless", 0 ) );
+    
+    // In threaded mode rendering and the simulation run on their own threads
+    // so that a slow frame doesn't hold up message processing
+    bool bThreaded = ( 0 != pConfigFile->ReadInt( section, "threaded", 0 ) );
+    
+    if ( !mSim.Init( pConfigFile->ReadString( section, "world", NULL ), 
+                     bHeadless, bThreaded ) )
     {
         fprintf( stderr, "Error: Unable to initialise simulation\n" );
     }
     else
     { 
         this->alwayson = true;
-        mLastInterfaceUpdateTime = mSim.GetSimTime();
+        
+        // In lockstep mode the simulation is advanced by one frame every time
+        // the driver is updated rather than following the wall clock
+        mSim.SetLockstepEnabled( 0 != pConfigFile->ReadInt( section, "lockstep", 0 ) );
+        
+        S32 maxPhysicsSubSteps = pConfigFile->ReadInt( section, "max_physics_substeps", -1 );
+        if ( maxPhysicsSubSteps > 0 )
+        {
+            mSim.SetMaxPhysicsSubSteps( maxPhysicsSubSteps );
+        }
+        
+        // The world hash lets a replay check that it's starting from the
+        // same world as the recording
+        std::vector<U8> initialState;
+        mSim.SaveState( &initialState );
+        U32 worldHash = SimulationRecorder::HashData( 
+            initialState.empty() ? NULL : &initialState[ 0 ], initialState.size() );
+        
+        S32 randomSeed = pConfigFile->ReadInt( section, "random_seed", -1 );
+        mRandomSeed = ( randomSeed >= 0 ? (U32)randomSeed : (U32)time( NULL ) );
+        
+        const char* replayFilename = pConfigFile->ReadString( section, "replay_log", NULL );
+        const char* recordFilename = pConfigFile->ReadString( section, "record_log", NULL );
+        if ( NULL != replayFilename )
+        {
+            if ( mRecorder.LoadRecording( replayFilename ) )
+            {
+                if ( mRecorder.GetWorldHash() != worldHash )
+                {
+                    fprintf( stderr, "Warning: %s was recorded with a different world, "
+                        "the replay won't match\n", replayFilename );
+                }
+                
+                mRandomSeed = mRecorder.GetRandomSeed();
+                mbReplaying = true;
+                mSim.SetLockstepEnabled( true );
+            }
+        }
+        else if ( NULL != recordFilename )
+        {
+            // In wall clock mode the number of frames simulated between
+            // driver updates varies, which changes the frames that the
+            // sensors sample. A replay steps one frame per update, so the
+            // recording has to as well
+            if ( mRecorder.StartRecording( recordFilename, worldHash, mRandomSeed ) )
+            {
+                mSim.SetLockstepEnabled( true );
+            }
+        }
+        
         if ( LoadDevices( pConfigFile, section ) < 0 )
         {
             fprintf( stderr, "Error: Unable load devices\n" );
         }
+        
+        // Schedule the first update of each interface
+        RescheduleUpdates();
     }
 }
 
 //------------------------------------------------------------------------------
 SubSimDriver::~SubSimDriver()
 {
+    if ( Profiler::IsEnabled() )
+    {
+        Profiler::Stop();
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -109,6 +324,39 @@ int SubSimDriver::Shutdown()
 int SubSimDriver::ProcessMessage( QueuePointer& respQueue,
                                 player_msghdr* pHeader, void* pData )
 {   
+    eRecordPolicy recordPolicy = GetRecordPolicy( pHeader );
+    if ( eRP_NotRecorded != recordPolicy
+        && ( mbReplaying || mRecorder.IsRecording() ) )
+    {
+        // Whilst replaying, everything that changes the simulation comes 
+        // from the log. Whilst recording, anything that can't be put in the
+        // log is turned away so that the replay can't drift from the run
+        bool bAccepted = false;
+        if ( !mbReplaying )
+        {
+            if ( eRP_Refused == recordPolicy )
+            {
+                fprintf( stderr, "Warning: Refusing message %d:%d for device %d.%d "
+                    "as it can't be recorded\n", pHeader->type, pHeader->subtype,
+                    pHeader->addr.interf, pHeader->addr.index );
+            }
+            else
+            {
+                bAccepted = RecordMessage( pHeader, pData, recordPolicy );
+            }
+        }
+        
+        if ( !bAccepted )
+        {
+            if ( PLAYER_MSGTYPE_REQ == pHeader->type )
+            {
+                Publish( pHeader->addr, respQueue, 
+                    PLAYER_MSGTYPE_RESP_NACK, pHeader->subtype );
+            }
+            return 0;
+        }
+    }
+    
     // Find the right device interface to handle this config
     SubSimInterface* pDeviceInterface = LookupDevice( pHeader->addr );
 
@@ -166,29 +414,78 @@ int SubSimDriver::Unsubscribe( QueuePointer& respQueue, player_devaddr_t addr )
     return 1; // error
 }
 
+//------------------------------------------------------------------------------
+void SubSimDriver::AddSubCameraSubscriber()
+{
+    mNumSubCameraSubscribers++;
+    mSim.SetSubCameraActive( true );
+}
+
+//------------------------------------------------------------------------------
+void SubSimDriver::RemoveSubCameraSubscriber()
+{
+    if ( mNumSubCameraSubscribers > 0 )
+    {
+        mNumSubCameraSubscribers--;
+    }
+    
+    if ( 0 == mNumSubCameraSubscribers )
+    {
+        mSim.SetSubCameraActive( false );
+    }
+}
+
 //------------------------------------------------------------------------------
 // Main function for device thread
 void SubSimDriver::Update()
 {
-    Driver::ProcessMessages( SDD_NUM_MESSAGES_HANDLED_PER_UPDATE );
+    {
+        PROFILE_SCOPE( "ProcessMessages" );
+        Driver::ProcessMessages( SDD_NUM_MESSAGES_HANDLED_PER_UPDATE );
+        if ( mbReplaying )
+        {
+            ReplayMessages();
+        }
+    }
     
-    // Check to see if we should update the interfaces
+    // Update each interface whose deadline has been reached. The simulation
+    // only changes once per frame so an interface with a rate faster than 
+    // the frame rate is updated at most once per frame
     double simTime = mSim.GetSimTime();
-    if ( simTime - mLastInterfaceUpdateTime 
-        >= 1.0/SDD_INTERFACE_UPDATES_PER_SECOND )
+    while ( !mUpdateSchedule.empty() 
+        && mUpdateSchedule.front().mDeadline <= simTime + SDD_DEADLINE_TOLERANCE )
     {
-        for ( int deviceIdx = 0; deviceIdx < mNumDevices; deviceIdx++ )
+        std::pop_heap( mUpdateSchedule.begin(), mUpdateSchedule.end(), IsLaterDeadline );
+        InterfaceDeadline& deadline = mUpdateSchedule.back();
+        
+        SubSimInterface* pDeviceInterface = mpDeviceList[ deadline.mDeviceIdx ];
         {
-            SubSimInterface* pDeviceInterface = mpDeviceList[ deviceIdx ];
+            PROFILE_SCOPE( "InterfacePublish" );
             pDeviceInterface->Update();
         }
         
-        mLastInterfaceUpdateTime = simTime;
+        // Move on to the next deadline. If the simulation has jumped past 
+        // several deadlines then they're skipped rather than publishing a
+        // burst of identical data
+        double updatePeriod = pDeviceInterface->mUpdatePeriod;
+        deadline.mDeadline += updatePeriod;
+        if ( deadline.mDeadline <= simTime + SDD_DEADLINE_TOLERANCE )
+        {
+            double numMissedDeadlines = floor( 
+                ( simTime + SDD_DEADLINE_TOLERANCE - deadline.mDeadline )/updatePeriod ) + 1.0;
+            deadline.mDeadline += numMissedDeadlines*updatePeriod;
+        }
+        
+        std::push_heap( mUpdateSchedule.begin(), mUpdateSchedule.end(), IsLaterDeadline );
     }
     
     // Check to see if the simulation is still running
     if ( mSim.IsRunning() )
     {
+        if ( mSim.IsLockstepEnabled() && !mSim.IsPaused() )
+        {
+            mSim.Step( 1 );
+        }
         mSim.Update();
     }
     else
@@ -200,6 +497,174 @@ void SubSimDriver::Update()
     return;
 }
 
+//------------------------------------------------------------------------------
+// Commands and requests that aren't listed in SDD_MESSAGE_POLICIES are
+// assumed to change the simulation. Data and replies are never recorded
+eRecordPolicy SubSimDriver::GetRecordPolicy( const player_msghdr* pHeader )
+{
+    if ( PLAYER_MSGTYPE_CMD != pHeader->type 
+        && PLAYER_MSGTYPE_REQ != pHeader->type )
+    {
+        return eRP_NotRecorded;
+    }
+    
+    for ( U32 policyIdx = 0; policyIdx < SDD_NUM_MESSAGE_POLICIES; policyIdx++ )
+    {
+        const SDD_MessagePolicy& policy = SDD_MESSAGE_POLICIES[ policyIdx ];
+        if ( policy.mInterface == pHeader->addr.interf
+            && policy.mType == pHeader->type
+            && policy.mSubtype == pHeader->subtype )
+        {
+            // A payload bigger than the struct that was listed can't be 
+            // trusted to be free of pointers. Some commands have no payload
+            if ( eRP_RecordPayload == policy.mPolicy 
+                && pHeader->size > policy.mPayloadSize )
+            {
+                return eRP_Refused;
+            }
+            return policy.mPolicy;
+        }
+    }
+    
+    return eRP_Refused;
+}
+
+//------------------------------------------------------------------------------
+bool SubSimDriver::RecordMessage( const player_msghdr* pHeader, 
+                                  const void* pData, eRecordPolicy recordPolicy )
+{
+    const void* pRecordedData = pData;
+    U32 recordedDataSize = pHeader->size;
+    
+    std::vector<U8> flattenedData;
+    if ( eRP_RecordProperty == recordPolicy )
+    {
+        if ( NULL == pData )
+        {
+            return false;
+        }
+        SDD_FlattenPropertyRequest( (const player_simulation_property_req_t*)pData, 
+            &flattenedData );
+        pRecordedData = &flattenedData[ 0 ];
+        recordedDataSize = flattenedData.size();
+    }
+    
+    if ( !mRecorder.RecordMessage( mSim.GetSimFrameIdx(), 
+        pHeader->type, pHeader->subtype, pHeader->addr.interf, pHeader->addr.index,
+        pRecordedData, recordedDataSize ) )
+    {
+        fprintf( stderr, "Warning: Refusing message %d:%d for device %d.%d "
+            "as it couldn't be written to the log\n", pHeader->type, pHeader->subtype,
+            pHeader->addr.interf, pHeader->addr.index );
+        return false;
+    }
+    
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void SubSimDriver::ReplayMessages()
+{
+    // Messages are replayed at the same point in the update, and on the same
+    // frame, as they were originally processed
+    U32 frameIdx = mSim.GetSimFrameIdx();
+    while ( mNextReplayMessageIdx < mRecorder.GetNumMessages() )
+    {
+        const RecordedMessage& message = mRecorder.GetMessage( mNextReplayMessageIdx );
+        if ( message.mFrameIdx > frameIdx )
+        {
+            break;
+        }
+        mNextReplayMessageIdx++;
+        
+        SubSimInterface* pDeviceInterface = NULL;
+        for ( int deviceIdx = 0; deviceIdx < mNumDevices; deviceIdx++ )
+        {
+            if ( mpDeviceList[ deviceIdx ]->mDeviceAddress.interf == message.mInterface
+                && mpDeviceList[ deviceIdx ]->mDeviceAddress.index == message.mIndex )
+            {
+                pDeviceInterface = mpDeviceList[ deviceIdx ];
+                break;
+            }
+        }
+        if ( NULL == pDeviceInterface )
+        {
+            fprintf( stderr, "Warning: Can't find device %d.%d to replay a message to\n",
+                message.mInterface, message.mIndex );
+            continue;
+        }
+        
+        player_msghdr header;
+        memset( &header, 0, sizeof( header ) );
+        header.addr = pDeviceInterface->mDeviceAddress;
+        header.type = message.mType;
+        header.subtype = message.mSubtype;
+        header.timestamp = mSim.GetSimTime();
+        header.size = message.mData.size();
+        
+        // The interfaces take a non const pointer so replay from a copy
+        std::vector<U8> data( message.mData );
+        void* pData = ( data.empty() ? NULL : &data[ 0 ] );
+        
+        player_simulation_property_req_t propertyRequest;
+        if ( eRP_RecordProperty == GetRecordPolicy( &header ) )
+        {
+            if ( !SDD_UnflattenPropertyRequest( &data, &propertyRequest ) )
+            {
+                fprintf( stderr, "Warning: Skipping a property request that's "
+                    "been corrupted in the log\n" );
+                continue;
+            }
+            pData = &propertyRequest;
+            header.size = sizeof( propertyRequest );
+        }
+        
+        pDeviceInterface->ProcessMessage( mReplayResponseQueue, &header, pData );
+        
+        // Nobody is waiting for the replies to replayed requests
+        Message* pResponse = NULL;
+        while ( NULL != ( pResponse = mReplayResponseQueue->Pop() ) )
+        {
+            delete pResponse;
+        }
+    }
+    
+    if ( mNextReplayMessageIdx >= mRecorder.GetNumMessages() )
+    {
+        printf( "Replay finished at frame %u\n", frameIdx );
+        mbReplaying = false;
+    }
+}
+
+//------------------------------------------------------------------------------
+void SubSimDriver::RescheduleUpdates()
+{
+    double simTime = mSim.GetSimTime();
+    mUpdateSchedule.clear();
+    for ( int deviceIdx = 0; deviceIdx < mNumDevices; deviceIdx++ )
+    {
+        InterfaceDeadline deadline;
+        deadline.mDeadline = simTime + mpDeviceList[ deviceIdx ]->mUpdatePeriod;
+        deadline.mDeviceIdx = deviceIdx;
+        mUpdateSchedule.push_back( deadline );
+    }
+    std::make_heap( mUpdateSchedule.begin(), mUpdateSchedule.end(), IsLaterDeadline );
+}
+
+//------------------------------------------------------------------------------
+// Orders the update schedule so that the earliest deadline is at the front of
+// the heap. Ties are broken on the device index so that interfaces due at the
+// same time are always updated in the same order
+bool SubSimDriver::IsLaterDeadline( const InterfaceDeadline& a, const InterfaceDeadline& b )
+{
+    if ( a.mDeadline != b.mDeadline )
+    {
+        return a.mDeadline > b.mDeadline;
+    }
+    
+    return a.mDeviceIdx > b.mDeviceIdx;
+}
+
 //------------------------------------------------------------------------------
 // Helper function to load all devices on startup
 int SubSimDriver::LoadDevices( ConfigFile* pConfigFile, int section )
@@ -254,6 +719,12 @@ int SubSimDriver::LoadDevices( ConfigFile* pConfigFile, int section )
                 pDeviceInterface = new CameraInterface( playerAddr, this, pConfigFile, section );
                 break;
             }
+        case PLAYER_OPAQUE_CODE:
+            {
+                if ( !player_quiet_startup ) printf( " a shared memory camera interface.\n" );
+                pDeviceInterface = new SharedMemoryCameraInterface( playerAddr, this, pConfigFile, section );
+                break;
+            }
         case PLAYER_POSITION3D_CODE:
             {
                 if ( !player_quiet_startup ) printf( " a position3d interface.\n" );
@@ -8,13 +8,25 @@
 #define SUB_SIM_DRIVER_H
 
 //------------------------------------------------------------------------------
+#include <vector>
 #include <libplayercore/playercore.h>
 #include "Simulator/Simulator.h"
+#include "Common/SimulationRecorder.h"
 
 //------------------------------------------------------------------------------
 // Forward declarations
 class SubSimInterface;
 
+//------------------------------------------------------------------------------
+// How the recorder treats a message
+enum eRecordPolicy
+{
+    eRP_NotRecorded = 0,    // Doesn't change the simulation
+    eRP_RecordPayload,      // The payload is a plain struct and is copied as is
+    eRP_RecordProperty,     // A property request, flattened as it holds pointers
+    eRP_Refused             // May change the simulation but can't be recorded
+};
+
 //------------------------------------------------------------------------------
 class SubSimDriver : public Driver
 {
@@ -55,10 +67,48 @@ class SubSimDriver : public Driver
     // Max device count
     protected: int mMaxNumDevices;
     
-    // Used to keep track of the rate at which we update the interfaces
-    protected: double mLastInterfaceUpdateTime;
+    // The next time at which each interface should be updated. This is kept
+    // as a min heap so that the next interface due is always at the front
+    protected: struct InterfaceDeadline
+    {
+        double mDeadline;
+        int mDeviceIdx;
+    };
+    protected: static bool IsLaterDeadline( const InterfaceDeadline& a, 
+                                            const InterfaceDeadline& b );
+    protected: std::vector<InterfaceDeadline> mUpdateSchedule;
+    
+    // Schedules the next update of every interface one update period from
+    // the current sim time. Must be called if sim time jumps backwards
+    public: void RescheduleUpdates();
+    
+    // The sub camera is shared by all of the camera interfaces so it's kept
+    // active whilst any of them have subscribers
+    public: void AddSubCameraSubscriber();
+    public: void RemoveSubCameraSubscriber();
+    private: int mNumSubCameraSubscribers;
     
     public: Simulator mSim;
+    
+    // The seed that interfaces should base their random numbers on so that 
+    // runs can be repeated
+    public: U32 GetRandomSeed() const { return mRandomSeed; }
+    private: U32 mRandomSeed;
+    
+    // Record and replay. Commands and requests that change the simulation
+    // are recorded with the simulation frame they arrived on, and when 
+    // replaying they're fed back in on the same frame whilst the simulation
+    // runs in lockstep
+    private: static eRecordPolicy GetRecordPolicy( const player_msghdr* pHeader );
+    private: bool RecordMessage( const player_msghdr* pHeader, 
+                                 const void* pData, eRecordPolicy recordPolicy );
+    private: void ReplayMessages();
+    private: SimulationRecorder mRecorder;
+    private: bool mbReplaying;
+    private: U32 mNextReplayMessageIdx;
+    
+    // Replies to replayed requests are sent here and thrown away
+    private: QueuePointer mReplayResponseQueue;
 };
 
 #endif // SUB_SIM_DRIVER_H
@@ -5,14 +5,46 @@
 
 //------------------------------------------------------------------------------
 #include "SubSimInterface.h"
+
+#include <stdio.h>
+#include <string.h>
 #include "SubSimDriver.h"
 
+//------------------------------------------------------------------------------
+static const double SSI_DEFAULT_UPDATES_PER_SECOND = 30.0;
+
 //------------------------------------------------------------------------------
 SubSimInterface::SubSimInterface( player_devaddr_t addr, SubSimDriver* pDriver,
-                                 ConfigFile* /* pConfigFile */, int /*section*/ )
+                                 ConfigFile* pConfigFile, int section )
 {
     mDeviceAddress = addr;
     mpDriver = pDriver;
+    mUpdatePeriod = 1.0/SSI_DEFAULT_UPDATES_PER_SECOND;
+    
+    // Look for an update rate for this device. Rates are given as pairs of
+    // device and rate in Hz, e.g. rate [ "camera:0" 15 "position1d:0" 100 ]
+    char deviceName[ 64 ];
+    snprintf( deviceName, sizeof( deviceName ), "%s:%d", 
+              interf_to_str( addr.interf ), addr.index );
+    
+    int numRateValues = pConfigFile->GetTupleCount( section, "rate" );
+    for ( int valueIdx = 0; valueIdx + 1 < numRateValues; valueIdx += 2 )
+    {
+        const char* pRateDeviceName = pConfigFile->ReadTupleString( 
+            section, "rate", valueIdx, "" );
+        if ( 0 == strcmp( pRateDeviceName, deviceName ) )
+        {
+            double rate = pConfigFile->ReadTupleFloat( section, "rate", valueIdx + 1, 0.0 );
+            if ( rate > 0.0 )
+            {
+                mUpdatePeriod = 1.0/rate;
+            }
+            else
+            {
+                fprintf( stderr, "Warning: Ignoring invalid rate for %s\n", deviceName );
+            }
+        }
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -42,6 +42,9 @@ class SubSimInterface
 
     // Driver instance that created this device
     public: SubSimDriver* mpDriver;
+    
+    // The number of seconds of simulation time between calls to Update
+    public: double mUpdatePeriod;
 };
 
 #endif // SUB_SIM_INTERFACE_H
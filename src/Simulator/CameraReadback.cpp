@@ -0,0 +1,208 @@
+//------------------------------------------------------------------------------
+// File: CameraReadback.cpp
+// Desc: Reads rendered camera images back from the graphics card without
+//       stalling the render loop. The read of frame N is queued into one of a
+//       small ring of OpenGL pixel buffer objects and the data for frame N-1,
+//       which will have finished transferring by then, is handed out instead.
+//       Each slot remembers the timestamp of the frame that was captured
+//       into it.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "CameraReadback.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+//------------------------------------------------------------------------------
+static bool ArePixelBufferObjectsSupported()
+{
+    // Pixel buffer objects are core from OpenGL 2.1, before that they're an
+    // extension
+    const char* pVersion = (const char*)glGetString( GL_VERSION );
+    if ( NULL == pVersion )
+    {
+        return false;
+    }
+
+    S32 majorVersion = 0;
+    S32 minorVersion = 0;
+    if ( 2 == sscanf( pVersion, "%i.%i", &majorVersion, &minorVersion )
+        && ( majorVersion > 2 || ( 2 == majorVersion && minorVersion >= 1 ) ) )
+    {
+        return true;
+    }
+
+    const char* pExtensions = (const char*)glGetString( GL_EXTENSIONS );
+    return ( NULL != pExtensions
+        && NULL != strstr( pExtensions, "GL_ARB_pixel_buffer_object" ) );
+}
+
+//------------------------------------------------------------------------------
+CameraReadback::CameraReadback()
+    : mbInitialised( false ),
+    mWidth( 0 ),
+    mHeight( 0 ),
+    mNextSlotIdx( 0 ),
+    mMappedSlotIdx( -1 )
+{
+    for ( S32 slotIdx = 0; slotIdx < NUM_SLOTS; slotIdx++ )
+    {
+        mPixelBuffers[ slotIdx ] = 0;
+        mTimestamps[ slotIdx ] = 0.0;
+        mbPending[ slotIdx ] = false;
+    }
+}
+
+//------------------------------------------------------------------------------
+CameraReadback::~CameraReadback()
+{
+    DeInit();
+}
+
+//------------------------------------------------------------------------------
+bool CameraReadback::Init( U32 width, U32 height )
+{
+    if ( mbInitialised )
+    {
+        DeInit();
+    }
+
+    if ( !ArePixelBufferObjectsSupported() )
+    {
+        return false;
+    }
+
+    mWidth = width;
+    mHeight = height;
+
+    glGenBuffers( NUM_SLOTS, mPixelBuffers );
+    for ( S32 slotIdx = 0; slotIdx < NUM_SLOTS; slotIdx++ )
+    {
+        glBindBuffer( GL_PIXEL_PACK_BUFFER, mPixelBuffers[ slotIdx ] );
+        glBufferData( GL_PIXEL_PACK_BUFFER, mWidth*mHeight*4, NULL, GL_STREAM_READ );
+        mTimestamps[ slotIdx ] = 0.0;
+        mbPending[ slotIdx ] = false;
+    }
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+    if ( GL_NO_ERROR != glGetError() )
+    {
+        fprintf( stderr, "Warning: Unable to create pixel buffers for camera read back\n" );
+        glDeleteBuffers( NUM_SLOTS, mPixelBuffers );
+        return false;
+    }
+
+    mNextSlotIdx = 0;
+    mMappedSlotIdx = -1;
+    mbInitialised = true;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void CameraReadback::DeInit()
+{
+    if ( mbInitialised )
+    {
+        UnmapCompletedRead();
+        glDeleteBuffers( NUM_SLOTS, mPixelBuffers );
+
+        for ( S32 slotIdx = 0; slotIdx < NUM_SLOTS; slotIdx++ )
+        {
+            mPixelBuffers[ slotIdx ] = 0;
+            mbPending[ slotIdx ] = false;
+        }
+
+        mbInitialised = false;
+    }
+}
+
+//------------------------------------------------------------------------------
+void CameraReadback::QueueRead( double timestamp )
+{
+    if ( !mbInitialised )
+    {
+        return;
+    }
+
+    // With a pixel pack buffer bound glReadPixels writes into the buffer
+    // and returns without waiting for the transfer to finish
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, mPixelBuffers[ mNextSlotIdx ] );
+    glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+    glReadPixels( 0, 0, mWidth, mHeight, GL_BGRA, GL_UNSIGNED_BYTE, NULL );
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+    mTimestamps[ mNextSlotIdx ] = timestamp;
+    mbPending[ mNextSlotIdx ] = true;
+    mNextSlotIdx = ( mNextSlotIdx + 1 ) % NUM_SLOTS;
+}
+
+//------------------------------------------------------------------------------
+const U8* CameraReadback::MapCompletedRead( S32* pPitchOut, double* pTimestampOut )
+{
+    if ( !mbInitialised || mMappedSlotIdx >= 0 )
+    {
+        return NULL;
+    }
+
+    // Look for the newest pending read, skipping the one just queued
+    S32 slotIdx = ( mNextSlotIdx + NUM_SLOTS - 2 ) % NUM_SLOTS;
+    if ( !mbPending[ slotIdx ] )
+    {
+        return NULL;
+    }
+
+    // Anything older than this will never be handed out
+    for ( S32 oldSlotIdx = 0; oldSlotIdx < NUM_SLOTS; oldSlotIdx++ )
+    {
+        if ( oldSlotIdx != slotIdx
+            && oldSlotIdx != ( mNextSlotIdx + NUM_SLOTS - 1 ) % NUM_SLOTS )
+        {
+            mbPending[ oldSlotIdx ] = false;
+        }
+    }
+
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, mPixelBuffers[ slotIdx ] );
+    const U8* pData = (const U8*)glMapBuffer( GL_PIXEL_PACK_BUFFER, GL_READ_ONLY );
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+    mbPending[ slotIdx ] = false;
+    if ( NULL == pData )
+    {
+        fprintf( stderr, "Warning: Unable to map camera pixel buffer\n" );
+        return NULL;
+    }
+
+    // Return the rows top first
+    S32 pitch = mWidth*4;
+    *pPitchOut = -pitch;
+    *pTimestampOut = mTimestamps[ slotIdx ];
+    mMappedSlotIdx = slotIdx;
+
+    return pData + pitch*( mHeight - 1 );
+}
+
+//------------------------------------------------------------------------------
+void CameraReadback::UnmapCompletedRead()
+{
+    if ( mMappedSlotIdx >= 0 )
+    {
+        glBindBuffer( GL_PIXEL_PACK_BUFFER, mPixelBuffers[ mMappedSlotIdx ] );
+        glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+        glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+        mMappedSlotIdx = -1;
+    }
+}
+
+//------------------------------------------------------------------------------
+void CameraReadback::DiscardPendingReads()
+{
+    for ( S32 slotIdx = 0; slotIdx < NUM_SLOTS; slotIdx++ )
+    {
+        mbPending[ slotIdx ] = false;
+    }
+}
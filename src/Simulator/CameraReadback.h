@@ -0,0 +1,70 @@
+//------------------------------------------------------------------------------
+// File: CameraReadback.h
+// Desc: Reads rendered camera images back from the graphics card without
+//       stalling the render loop. The read of frame N is queued into one of a
+//       small ring of OpenGL pixel buffer objects and the data for frame N-1,
+//       which will have finished transferring by then, is handed out instead.
+//       Each slot remembers the timestamp of the frame that was captured
+//       into it.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef CAMERA_READBACK_H
+#define CAMERA_READBACK_H
+
+//------------------------------------------------------------------------------
+#include "Common.h"
+
+//------------------------------------------------------------------------------
+class CameraReadback
+{
+    //--------------------------------------------------------------------------
+    public: static const S32 NUM_SLOTS = 3;
+
+    //--------------------------------------------------------------------------
+    public: CameraReadback();
+    public: ~CameraReadback();
+
+    //--------------------------------------------------------------------------
+    //! Sets up the pixel buffer objects. Must be called from the thread that
+    //! owns the OpenGL context. Returns false if pixel buffer objects aren't
+    //! supported, in which case the caller should fall back to a synchronous
+    //! read of the render target
+    public: bool Init( U32 width, U32 height );
+    public: void DeInit();
+
+    //--------------------------------------------------------------------------
+    public: bool IsInitialised() const { return mbInitialised; }
+
+    //--------------------------------------------------------------------------
+    //! Queues a read of the framebuffer that is currently bound. This returns
+    //! straight away, the copy carries on in the background
+    public: void QueueRead( double timestamp );
+
+    //--------------------------------------------------------------------------
+    //! Maps the most recent completed read, i.e. not the one that has just
+    //! been queued. Returns NULL if there is nothing to map yet. The data is
+    //! in A8R8G8B8 format. The pitch may be negative as OpenGL returns images
+    //! bottom row first. UnmapCompletedRead must be called once the data has
+    //! been used.
+    public: const U8* MapCompletedRead( S32* pPitchOut, double* pTimestampOut );
+    public: void UnmapCompletedRead();
+
+    //--------------------------------------------------------------------------
+    //! Throws away any reads that are still in flight. Used when the camera
+    //! stops being read so that a stale image isn't handed out later
+    public: void DiscardPendingReads();
+
+    //--------------------------------------------------------------------------
+    // Members
+    private: bool mbInitialised;
+    private: U32 mWidth;
+    private: U32 mHeight;
+    private: U32 mPixelBuffers[ NUM_SLOTS ];
+    private: double mTimestamps[ NUM_SLOTS ];
+    private: bool mbPending[ NUM_SLOTS ];
+    private: S32 mNextSlotIdx;
+    private: S32 mMappedSlotIdx;
+};
+
+#endif // CAMERA_READBACK_H
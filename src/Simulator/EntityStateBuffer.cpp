@@ -0,0 +1,116 @@
+//------------------------------------------------------------------------------
+// File: EntityStateBuffer.cpp
+// Desc: A double buffered snapshot of the state of every entity in the world.
+//       The simulation writes into the back buffer and then publishes it so
+//       that the render loop and the Player interfaces can read a consistent
+//       copy without holding up the simulation.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "EntityStateBuffer.h"
+
+#include <assert.h>
+
+//------------------------------------------------------------------------------
+EntityStateBuffer::EntityStateBuffer()
+    : mbInitialised( false ),
+    mNumEntities( 0 ),
+    mFrontBufferIdx( 0 )
+{
+    mFrameIdx[ 0 ] = 0;
+    mFrameIdx[ 1 ] = 0;
+    pthread_mutex_init( &mSwapMutex, NULL );
+}
+
+//------------------------------------------------------------------------------
+EntityStateBuffer::~EntityStateBuffer()
+{
+    DeInit();
+    pthread_mutex_destroy( &mSwapMutex );
+}
+
+//------------------------------------------------------------------------------
+bool EntityStateBuffer::Init( U32 numEntities )
+{
+    if ( !mbInitialised )
+    {
+        mNumEntities = numEntities;
+        for ( S32 bufferIdx = 0; bufferIdx < 2; bufferIdx++ )
+        {
+            mBuffers[ bufferIdx ].Resize( numEntities );
+            mFrameIdx[ bufferIdx ] = 0;
+        }
+        mFrontBufferIdx = 0;
+        
+        mbInitialised = true;
+    }
+    
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void EntityStateBuffer::DeInit()
+{
+    for ( S32 bufferIdx = 0; bufferIdx < 2; bufferIdx++ )
+    {
+        mBuffers[ bufferIdx ].Resize( 0 );
+    }
+    mNumEntities = 0;
+    
+    mbInitialised = false;
+}
+
+//------------------------------------------------------------------------------
+void EntityStateBuffer::Publish( U32 frameIdx )
+{
+    assert( mbInitialised && "Buffer not initialised" );
+    
+    pthread_mutex_lock( &mSwapMutex );
+    mFrontBufferIdx = 1 - mFrontBufferIdx;
+    mFrameIdx[ mFrontBufferIdx ] = frameIdx;
+    pthread_mutex_unlock( &mSwapMutex );
+}
+
+//------------------------------------------------------------------------------
+U32 EntityStateBuffer::CopyFrontBuffer( EntityStateTable* pStatesOut ) const
+{
+    U32 frameIdx = 0;
+    
+    pthread_mutex_lock( &mSwapMutex );
+    if ( mbInitialised )
+    {
+        // The destination keeps its capacity so this doesn't allocate 
+        // once it has been filled the first time
+        *pStatesOut = mBuffers[ mFrontBufferIdx ];
+        frameIdx = mFrameIdx[ mFrontBufferIdx ];
+    }
+    pthread_mutex_unlock( &mSwapMutex );
+    
+    return frameIdx;
+}
+
+//------------------------------------------------------------------------------
+U32 EntityStateBuffer::GetState( U32 entityIdx, EntityState* pStateOut ) const
+{
+    U32 frameIdx = 0;
+    
+    pthread_mutex_lock( &mSwapMutex );
+    if ( mbInitialised && entityIdx < mNumEntities )
+    {
+        mBuffers[ mFrontBufferIdx ].GetState( entityIdx, pStateOut );
+        frameIdx = mFrameIdx[ mFrontBufferIdx ];
+    }
+    pthread_mutex_unlock( &mSwapMutex );
+    
+    return frameIdx;
+}
+
+//------------------------------------------------------------------------------
+U32 EntityStateBuffer::GetFrameIdx() const
+{
+    pthread_mutex_lock( &mSwapMutex );
+    U32 frameIdx = mFrameIdx[ mFrontBufferIdx ];
+    pthread_mutex_unlock( &mSwapMutex );
+    
+    return frameIdx;
+}
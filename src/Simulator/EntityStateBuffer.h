@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------
+// File: EntityStateBuffer.h
+// Desc: A double buffered snapshot of the state of every entity in the world.
+//       The simulation writes into the back buffer and then publishes it so
+//       that the render loop and the Player interfaces can read a consistent
+//       copy without holding up the simulation.
+//
+//       The snapshot has the same layout as the table that the simulator
+//       keeps the live state of the entities in, so publishing or copying a
+//       snapshot is a handful of block copies.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef ENTITY_STATE_BUFFER_H
+#define ENTITY_STATE_BUFFER_H
+
+//------------------------------------------------------------------------------
+#include <pthread.h>
+#include "Common.h"
+#include "Entities/EntityStateTable.h"
+
+//------------------------------------------------------------------------------
+class EntityStateBuffer
+{
+    //--------------------------------------------------------------------------
+    public: EntityStateBuffer();
+    public: ~EntityStateBuffer();
+
+    //--------------------------------------------------------------------------
+    public: bool Init( U32 numEntities );
+    public: void DeInit();
+    
+    //--------------------------------------------------------------------------
+    public: U32 GetNumEntities() const { return mNumEntities; }
+    
+    //--------------------------------------------------------------------------
+    // Writer interface. Only one thread may write at a time. The back buffer
+    // can be filled in without any locking and then becomes visible to
+    // readers when Publish is called. The back buffer still holds the 
+    // snapshot from two publishes ago, so entities that haven't changed
+    // since then don't need writing
+    public: EntityStateTable* GetBackBuffer() { return &mBuffers[ 1 - mFrontBufferIdx ]; }
+    public: void Publish( U32 frameIdx );
+    
+    //--------------------------------------------------------------------------
+    // Reader interface. These can be called from any thread. The frame index
+    // of the most recently published snapshot is returned
+    public: U32 CopyFrontBuffer( EntityStateTable* pStatesOut ) const;
+    public: U32 GetState( U32 entityIdx, EntityState* pStateOut ) const;
+    public: U32 GetFrameIdx() const;
+
+    //--------------------------------------------------------------------------
+    // Members
+    private: bool mbInitialised;
+    private: U32 mNumEntities;
+    private: EntityStateTable mBuffers[ 2 ];
+    private: U32 mFrameIdx[ 2 ];
+    private: S32 mFrontBufferIdx;
+    private: mutable pthread_mutex_t mSwapMutex;
+};
+
+#endif // ENTITY_STATE_BUFFER_H
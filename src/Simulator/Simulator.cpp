@@ -8,7 +8,13 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
 #include <vector>
 #include <irrlicht/irrlicht.h>
 
@@ -16,6 +22,10 @@
 #include "Common/MathUtils.h"
 #include "Common/HighPrecisionTime.h"
 #include "Common/Utils.h"
+#include "Common/PixelFormatConversion.h"
+#include "Common/NameHashTable.h"
+#include "Common/LatestValueMailbox.h"
+#include "Common/Profiler.h"
 #include "Entities/Sub.h"
 #include "Entities/CoordinateSystemAxes.h"
 #include "Entities/Gate.h"
@@ -23,43 +33,214 @@
 #include "Entities/Pool.h"
 #include "Entities/FloorTarget.h"
 #include "Entities/XmlEntityParser.h"
+#include "Entities/CompiledWorld.h"
+#include "Entities/EntityFactory.h"
+#include "Entities/MeshCache.h"
 #include "CameraSceneNodeAnimator.h"
+#include "EntityStateBuffer.h"
+#include "CameraReadback.h"
+#include "SonarModel.h"
 
 #include <btBulletDynamicsCommon.h>
 
 //------------------------------------------------------------------------------
 // Constants and Typdefs
 //------------------------------------------------------------------------------
-static F32 SIM_DESIRED_SIM_FPS = 30.0f;
-static S32 SIM_MICRO_SECS_PER_SIM_FRAME = (S32)(1000000.0f / SIM_DESIRED_SIM_FPS);
-static F32 SIM_SECS_PER_SIM_FRAME = 1.0f / SIM_DESIRED_SIM_FPS;
-static S32 SIM_MAX_NUM_CATCHUP_FRAMES = 30; // If the simulator gets more than
-                                            // this number of frames behind it
-                                            // will start dropping frames
+static const F32 SIM_DESIRED_SIM_FPS = 30.0f;
+static const S32 SIM_MICRO_SECS_PER_SIM_FRAME = (S32)(1000000.0f / SIM_DESIRED_SIM_FPS);
+static const F32 SIM_SECS_PER_SIM_FRAME = 1.0f / SIM_DESIRED_SIM_FPS;
+static const S32 SIM_MAX_NUM_CATCHUP_FRAMES = 30; // If the simulator gets more than
+                                                  // this number of frames behind it
+                                                  // will start dropping frames
+static const S32 SIM_PHYSICS_SUB_STEPS_PER_FRAME = 2;
+static const F32 SIM_PHYSICS_FIXED_TIME_STEP = SIM_SECS_PER_SIM_FRAME / SIM_PHYSICS_SUB_STEPS_PER_FRAME;
+static const S32 SIM_DEFAULT_MAX_PHYSICS_SUB_STEPS =    // By default a whole catch up
+    SIM_MAX_NUM_CATCHUP_FRAMES*SIM_PHYSICS_SUB_STEPS_PER_FRAME;  // is done in one update
 
 typedef std::vector<Entity*> EntityPtrVector;
 
+// Links a rigid body to the entity that it drives. These are gathered once
+// when the world is loaded so that the physics sync pass is a flat loop
+struct PhysicsBinding
+{
+    btRigidBody* mpBody;
+    Entity* mpEntity;
+};
+
+typedef std::vector<PhysicsBinding> PhysicsBindingVector;
+
+// Entities that move themselves, grouped by type so that each group can be 
+// updated by a single loop
+struct EntityUpdateBatch
+{
+    Entity::eType mType;
+    EntityPtrVector mEntities;
+};
+
+typedef std::vector<EntityUpdateBatch> EntityUpdateBatchVector;
+
+// The layout of a saved state. The header is followed by a SavedEntityState
+// for each entity and then a SavedBodyState for each physics binding, both 
+// in the order they have in the simulator
+static const U32 SIM_SAVED_STATE_MAGIC = 0x53535353;    // "SSSS"
+static const U32 SIM_SAVED_STATE_VERSION = 2;
+
+struct SavedStateHeader
+{
+    U32 mMagic;
+    U32 mVersion;
+    U32 mNumEntities;
+    U32 mNumBodies;
+    U32 mNumSimFrames;
+    F32 mSubSetpoints[ 4 ];     // Forward, depth, yaw and pitch speeds
+    F32 mSubLinearVelocity[ 3 ];    // The velocities of the sub's last update
+    F32 mSubAngularVelocity[ 3 ];
+};
+
+struct SavedEntityState
+{
+    F32 mPosition[ 3 ];
+    F32 mRotation[ 3 ];
+};
+
+struct SavedBodyState
+{
+    F32 mOrigin[ 3 ];
+    F32 mOrientation[ 4 ];      // Quaternion as x, y, z, w
+    F32 mLinearVelocity[ 3 ];
+    F32 mAngularVelocity[ 3 ];
+};
+
 //------------------------------------------------------------------------------
-// Helper Routines
+// Copies a row from one state table to another
+static void CopyEntityState( const EntityStateTable& source, U32 entityIdx, EntityStateTable* pDest )
+{
+    pDest->mPositions[ entityIdx ] = source.mPositions[ entityIdx ];
+    pDest->mRotations[ entityIdx ] = source.mRotations[ entityIdx ];
+    pDest->mLinearVelocities[ entityIdx ] = source.mLinearVelocities[ entityIdx ];
+    pDest->mAngularVelocities[ entityIdx ] = source.mAngularVelocities[ entityIdx ];
+    pDest->mPoseVersions[ entityIdx ] = source.mPoseVersions[ entityIdx ];
+}
+
 //------------------------------------------------------------------------------
-static Entity* FindEntityByName( const char* entityName, EntityPtrVector entityList )
+// Updates a batch of entities that all have the given type
+static void UpdateEntityBatch( Entity::eType type, Entity** ppEntities, U32 numEntities )
 {
-    Entity* pResult = NULL;
-    
-    for ( EntityPtrVector::iterator entityIter = entityList.begin();
-        entityList.end() != entityIter; ++entityIter )
+    switch ( type )
     {
-        Entity* pEntity = *entityIter;
-        
-        if ( Utils::stricmp( pEntity->GetName(), entityName ) == 0 )
+        case Entity::eT_Sub:
         {
-            // Found the entity
-            pResult = pEntity;
+            // The type is known so the calls don't need to go through the
+            // virtual table
+            for ( U32 entityIdx = 0; entityIdx < numEntities; entityIdx++ )
+            {
+                static_cast<Sub*>( ppEntities[ entityIdx ] )->Sub::Update( SIM_SECS_PER_SIM_FRAME );
+            }
+            break;
+        }
+        default:
+        {
+            for ( U32 entityIdx = 0; entityIdx < numEntities; entityIdx++ )
+            {
+                ppEntities[ entityIdx ]->Update( SIM_SECS_PER_SIM_FRAME );
+            }
             break;
         }
     }
-    
-    return pResult;
+}
+
+//------------------------------------------------------------------------------
+// Builds the entities described in a compiled world file
+static bool BuildEntitiesFromCompiledWorld( const CompiledWorld& compiledWorld,
+                                            irr::scene::ISceneManager* pSceneMgr,
+                                            irr::video::IVideoDriver* pVideoDriver,
+                                            btDiscreteDynamicsWorld* pPhysicsWorld,
+                                            EntityPtrVector* pEntityListOut )
+{
+    HighPrecisionTime startTime = HighPrecisionTime::GetTime();
+
+    U32 numEntitiesFailed = 0;
+    for ( U32 entityIdx = 0; entityIdx < compiledWorld.GetNumEntities(); entityIdx++ )
+    {
+        Entity* pNewEntity = EntityFactory::BuildEntity( compiledWorld.GetEntityDesc( entityIdx ),
+            (S32)pEntityListOut->size(), pSceneMgr, pVideoDriver, pPhysicsWorld );
+        if ( NULL == pNewEntity )
+        {
+            fprintf( stderr, "Warning: Unable to build entity %u\n", entityIdx );
+            numEntitiesFailed++;
+        }
+        else
+        {
+            pEntityListOut->push_back( pNewEntity );
+        }
+    }
+
+    double loadSeconds = HighPrecisionTime::ConvertToSeconds(
+        HighPrecisionTime::GetDiff( HighPrecisionTime::GetTime(), startTime ) );
+    printf( "Loaded %u entities (%u failed) from a compiled world in %.2f ms\n",
+        (U32)pEntityListOut->size(), numEntitiesFailed, loadSeconds*1000.0 );
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Builds the entities of a world from its compiled world file if there's one
+// that's up to date, and from XML otherwise. worldFilename can name either the
+// XML file or the compiled file
+static bool BuildEntitiesFromWorldFile( const char* worldFilename,
+                                        irr::scene::ISceneManager* pSceneMgr,
+                                        irr::video::IVideoDriver* pVideoDriver,
+                                        btDiscreteDynamicsWorld* pPhysicsWorld,
+                                        EntityPtrVector* pEntityListOut )
+{
+    std::string xmlFilename;
+    std::string compiledFilename;
+    if ( CompiledWorld::IsCompiledFilename( worldFilename ) )
+    {
+        compiledFilename = worldFilename;
+    }
+    else
+    {
+        xmlFilename = worldFilename;
+
+        struct stat compiledStats;
+        std::string defaultCompiledFilename = CompiledWorld::GetCompiledFilename( worldFilename );
+        if ( 0 == stat( defaultCompiledFilename.c_str(), &compiledStats ) )
+        {
+            compiledFilename = defaultCompiledFilename;
+        }
+    }
+
+    if ( !compiledFilename.empty() )
+    {
+        CompiledWorld compiledWorld;
+        if ( compiledWorld.Open( compiledFilename.c_str() ) )
+        {
+            // A compiled world that was found next to the XML file must have
+            // come from that file
+            if ( !compiledWorld.IsStale()
+                && ( xmlFilename.empty() || xmlFilename == compiledWorld.GetSourceFilename() ) )
+            {
+                printf( "Loading %s\n", compiledFilename.c_str() );
+                return BuildEntitiesFromCompiledWorld( compiledWorld,
+                    pSceneMgr, pVideoDriver, pPhysicsWorld, pEntityListOut );
+            }
+
+            if ( xmlFilename.empty() )
+            {
+                xmlFilename = compiledWorld.GetSourceFilename();
+            }
+            printf( "%s is out of date, loading %s instead\n",
+                compiledFilename.c_str(), xmlFilename.c_str() );
+        }
+        else if ( xmlFilename.empty() )
+        {
+            return false;
+        }
+    }
+
+    return XmlEntityParser::BuildEntitiesFromXMLWorldFile( xmlFilename.c_str(),
+        pSceneMgr, pVideoDriver, pPhysicsWorld, pEntityListOut );
 }
 
 //------------------------------------------------------------------------------
@@ -75,13 +256,64 @@ struct SimulatorImpl
     Sub* mpSub;
     EntityPtrVector mEntityList;
     
+    // Tables built when the world is loaded. The entities keep their pose
+    // and velocities in the live state table, which the update kernels and
+    // the physics sync write straight into. Static entities are never 
+    // updated and only republished when something moves them
+    EntityStateTable mLiveStates;
+    std::vector<U8> mEntityTypes;           // Entity::eType of each entity
+    std::vector<U32> mDynamicEntityIdxs;    // Entities that can move by themselves
+    EntityUpdateBatchVector mUpdateBatches;
+    U32 mNumFullPublishesNeeded;            // Set when any entity may have been moved
+    
     // TODO: Tidy up the timing.
     HighPrecisionTime mSimulatorStartTime;
     HighPrecisionTime mLastTime;
     S32 mTimeAccumulatorUS; // The number of microseconds that we need to deal with in the next update
+    U32 mNumSimFrames;      // The number of frames simulated since Init
+    bool mbLockstep;
+    volatile bool mbPaused;
+    HighPrecisionTime mPauseStartTime;
+    double mTotalPauseTime; // Seconds spent paused, not counting the current pause
     
     S32 mLastFPS;
-    bool mbIsRunning;
+    S32 mNumFPSUpdates;
+    volatile bool mbIsRunning;
+    bool mbHeadless;
+    volatile bool mbSubCameraActive;
+    
+    // Threading. When running threaded the render thread owns the Irrlicht
+    // device and the scene graph, the sim thread advances the simulation and
+    // the caller (normally the Player thread) only touches the simulation 
+    // through the setters and the entity state snapshots
+    bool mbThreaded;
+    volatile bool mbStopThreads;
+    pthread_t mRenderThread;
+    pthread_t mSimThread;
+    bool mbRenderThreadStarted;
+    bool mbSimThreadStarted;
+    const char* mpInitWorldFilename;
+    pthread_mutex_t mInitMutex;
+    pthread_cond_t mInitCondition;
+    bool mbInitDone;
+    bool mbInitSucceeded;
+    pthread_mutex_t mSimMutex;  // Held whilst the simulation state is changed
+    
+    // Snapshots of the entity state published after every simulation frame
+    EntityStateBuffer mEntityStates;
+    EntityStateTable mRenderStates;
+    std::vector<U32> mRenderedPoseVersions;  // The pose last applied to each scene node
+    U32 mLastRenderedFrameIdx;
+    
+    // The last image read back from the sub camera along with the sim time
+    // of the frame it shows
+    pthread_mutex_t mCameraMutex;
+    std::vector<U8> mCameraImage;
+    double mCameraImageTimestamp;
+    U32 mSubCameraWidth;
+    U32 mSubCameraHeight;
+    CameraReadback mCameraReadback;     // Only used with the OpenGL driver
+    U32 mLastCapturedFrameIdx;
     
     // Physics stuff
     btDefaultCollisionConfiguration* mpCollisionConf;
@@ -89,6 +321,27 @@ struct SimulatorImpl
     btBroadphaseInterface* mpOverlappingPairCache;
     btSequentialImpulseConstraintSolver* mpPhysicsSolver;
     btDiscreteDynamicsWorld* mpPhysicsWorld;  
+    PhysicsBindingVector mPhysicsBindings;
+    S32 mMaxPhysicsSubSteps;
+    
+    // Maps entity names to their handles, i.e. their index in mEntityList
+    NameHashTable mEntityNameTable;
+    
+    // Ray casts the sonar beams against the world. The sonar mutex is held
+    // for the whole of a cast, but the sim mutex only whilst the poses are
+    // copied, so that a long scan doesn't hold up the simulation
+    SonarModel mSonarModel;
+    pthread_mutex_t mSonarMutex;
+    
+    // The state of the world when it was loaded, used by ResetWorld
+    std::vector<U8> mInitialState;
+    
+    // Commands for the sub are posted here by the controlling thread and
+    // picked up at the start of the next simulation frame. mPendingSubCommand
+    // is only touched by the controlling thread
+    LatestValueMailbox<SubVelocityCommand> mSubCommandMailbox;
+    SubVelocityCommand mPendingSubCommand;
+    volatile U32 mAppliedSubCommandIdx;
 };
 
 //------------------------------------------------------------------------------
@@ -108,127 +361,310 @@ Simulator::Simulator()
     mpImpl->mpOverlappingPairCache = NULL;
     mpImpl->mpPhysicsSolver = NULL;
     mpImpl->mpPhysicsWorld = NULL;
+    mpImpl->mNumFullPublishesNeeded = 0;
+    mpImpl->mMaxPhysicsSubSteps = SIM_DEFAULT_MAX_PHYSICS_SUB_STEPS;
     
     mpImpl->mbIsRunning = false;
+    mpImpl->mbHeadless = false;
+    mpImpl->mbSubCameraActive = false;
+    mpImpl->mNumSimFrames = 0;
+    mpImpl->mbLockstep = false;
+    mpImpl->mbPaused = false;
+    mpImpl->mTotalPauseTime = 0.0;
+    
+    mpImpl->mbThreaded = false;
+    mpImpl->mbStopThreads = false;
+    mpImpl->mbRenderThreadStarted = false;
+    mpImpl->mbSimThreadStarted = false;
+    mpImpl->mpInitWorldFilename = NULL;
+    mpImpl->mbInitDone = false;
+    mpImpl->mbInitSucceeded = false;
+    pthread_mutex_init( &mpImpl->mInitMutex, NULL );
+    pthread_cond_init( &mpImpl->mInitCondition, NULL );
+    pthread_mutex_init( &mpImpl->mSimMutex, NULL );
+    pthread_mutex_init( &mpImpl->mSonarMutex, NULL );
+    
+    mpImpl->mLastRenderedFrameIdx = 0;
+    pthread_mutex_init( &mpImpl->mCameraMutex, NULL );
+    mpImpl->mCameraImageTimestamp = 0.0;
+    mpImpl->mSubCameraWidth = 0;
+    mpImpl->mSubCameraHeight = 0;
+    mpImpl->mLastCapturedFrameIdx = 0;
+    
+    mpImpl->mPendingSubCommand.mForwardSpeed = 0.0f;
+    mpImpl->mPendingSubCommand.mDepthSpeed = 0.0f;
+    mpImpl->mPendingSubCommand.mYawSpeed = 0.0f;
+    mpImpl->mPendingSubCommand.mPitchSpeed = 0.0f;
+    mpImpl->mAppliedSubCommandIdx = 0;
 }
 
 //------------------------------------------------------------------------------
 Simulator::~Simulator()
 {
     DeInit();
+    
+    pthread_mutex_destroy( &mpImpl->mCameraMutex );
+    pthread_mutex_destroy( &mpImpl->mSonarMutex );
+    pthread_mutex_destroy( &mpImpl->mSimMutex );
+    pthread_cond_destroy( &mpImpl->mInitCondition );
+    pthread_mutex_destroy( &mpImpl->mInitMutex );
+    
     delete mpImpl;
     mpImpl = NULL;
 }
 
 //------------------------------------------------------------------------------
-bool Simulator::Init( const char* worldFilename )
+bool Simulator::Init( const char* worldFilename, bool bHeadless, bool bThreaded )
 {
     if ( !mpImpl->mbInitialised )
     { 
-        mpImpl->mpIrrDevice = irr::createDevice( 
-            irr::video::EDT_OPENGL, 
-            irr::core::dimension2d<irr::u32>( 640, 480 ), 
-            16, false, false, false, 0 );
-
-        if ( NULL == mpImpl->mpIrrDevice )
+        mpImpl->mbHeadless = bHeadless;
+        mpImpl->mbSubCameraActive = false;
+        mpImpl->mbThreaded = bThreaded;
+        mpImpl->mbStopThreads = false;
+        
+        if ( !bThreaded )
         {
-            fprintf( stderr, "Error: Unable to create Irrlicht Device\n" );
-            DeInit();
-            return false;
+            if ( !InitWorld( worldFilename ) )
+            {
+                DeInit();
+                return false;
+            }
         }
-
-        mpImpl->mpIrrDevice->setWindowCaption( L"SubSim" );
-    
-        irr::video::IVideoDriver* pVideoDriver = mpImpl->mpIrrDevice->getVideoDriver();
-        irr::scene::ISceneManager* pSceneMgr = mpImpl->mpIrrDevice->getSceneManager();
-        irr::gui::IGUIEnvironment* pGUIEnvironment = mpImpl->mpIrrDevice->getGUIEnvironment();
-    
-        mpImpl->mpText = pGUIEnvironment->addStaticText( 
-            L"Hello World!", irr::core::rect< irr::s32 >( 10, 10, 200, 40 ), true );
-    
-        // Setup physics for the world
-        mpImpl->mpCollisionConf = new btDefaultCollisionConfiguration();
-        mpImpl->mpCollisionDispatcher = new btCollisionDispatcher( mpImpl->mpCollisionConf );
-        mpImpl->mpOverlappingPairCache = new btDbvtBroadphase();
-        mpImpl->mpPhysicsSolver = new btSequentialImpulseConstraintSolver();
-        mpImpl->mpPhysicsWorld = new btDiscreteDynamicsWorld(
-            mpImpl->mpCollisionDispatcher, mpImpl->mpOverlappingPairCache,
-            mpImpl->mpPhysicsSolver, mpImpl->mpCollisionConf );
-        
-        mpImpl->mpPhysicsWorld->setGravity( btVector3( 0.0f, 0.0f, 0.0f ) );
-     
-        // Populate the world
-        if ( NULL != worldFilename )
-        {
-            char* modifiedFilename = NULL;
-            if ( worldFilename[ 0 ] == '~' )
+        else
+        {
+            // The world has to be built on the render thread as the thread 
+            // that creates the Irrlicht device must be the one that uses it
+            mpImpl->mpInitWorldFilename = worldFilename;
+            mpImpl->mbInitDone = false;
+            mpImpl->mbInitSucceeded = false;
+            
+            if ( 0 != pthread_create( &mpImpl->mRenderThread, NULL, 
+                                      RenderThreadEntry, this ) )
+            {
+                fprintf( stderr, "Error: Unable to create render thread\n" );
+                DeInit();
+                return false;
+            }
+            mpImpl->mbRenderThreadStarted = true;
+            
+            pthread_mutex_lock( &mpImpl->mInitMutex );
+            while ( !mpImpl->mbInitDone )
             {
-                const char* homeDirName = getenv( "HOME" );
-                if ( NULL == homeDirName )
-                {
-                    fprintf( stderr, "Error: Unable to find home dir\n" );
-                    DeInit();
-                    return false;
-                }
-                
-                U32 newStringLength = strlen( homeDirName ) 
-                    + strlen( worldFilename ) - 1;
-                modifiedFilename = new char[ newStringLength + 1 ];
-                strcpy( modifiedFilename, homeDirName );
-                strcat( modifiedFilename, &worldFilename[ 1 ] );
-                modifiedFilename[ newStringLength ] = '\0';
+                pthread_cond_wait( &mpImpl->mInitCondition, &mpImpl->mInitMutex );
             }
+            pthread_mutex_unlock( &mpImpl->mInitMutex );
+            mpImpl->mpInitWorldFilename = NULL;
             
-            bool bWorldBuilt = 
-                XmlEntityParser::BuildEntitiesFromXMLWorldFile( 
-                ( NULL != modifiedFilename ? modifiedFilename : worldFilename ), 
-                pSceneMgr, pVideoDriver, mpImpl->mpPhysicsWorld, &mpImpl->mEntityList );
-            if ( NULL != modifiedFilename )
+            if ( !mpImpl->mbInitSucceeded )
             {
-                delete [] modifiedFilename;
-                modifiedFilename = NULL;
+                DeInit();
+                return false;
             }
-            if ( !bWorldBuilt )
+            
+            if ( 0 != pthread_create( &mpImpl->mSimThread, NULL, 
+                                      SimThreadEntry, this ) )
             {
-                fprintf( stderr, "Error: Unable to build world\n" );
+                fprintf( stderr, "Error: Unable to create simulation thread\n" );
                 DeInit();
                 return false;
             }
+            mpImpl->mbSimThreadStarted = true;
         }
         
-        // Find the submarine
-        mpImpl->mpSub = NULL;
-        for ( EntityPtrVector::iterator entityIter = mpImpl->mEntityList.begin();
-            mpImpl->mEntityList.end() != entityIter; ++entityIter )
+        mpImpl->mbInitialised = true;
+    }
+    
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool Simulator::InitWorld( const char* worldFilename )
+{
+    bool bHeadless = mpImpl->mbHeadless;
+    
+    if ( bHeadless )
+    {
+        // Use the console device so that no window is opened, and the
+        // Burnings software rasteriser so that no GPU is needed
+        irr::SIrrlichtCreationParameters creationParams;
+        creationParams.DeviceType = irr::EIDT_CONSOLE;
+        creationParams.DriverType = irr::video::EDT_BURNINGSVIDEO;
+        creationParams.WindowSize = irr::core::dimension2d<irr::u32>( 320, 240 );
+        creationParams.Bits = 16;
+        
+        mpImpl->mpIrrDevice = irr::createDeviceEx( creationParams );
+    }
+    else
+    {
+        mpImpl->mpIrrDevice = irr::createDevice( 
+            irr::video::EDT_OPENGL, 
+            irr::core::dimension2d<irr::u32>( 640, 480 ), 
+            16, false, false, false, 0 );
+    }
+
+    if ( NULL == mpImpl->mpIrrDevice )
+    {
+        fprintf( stderr, "Error: Unable to create Irrlicht Device\n" );
+        DeInitWorld();
+        return false;
+    }
+
+    irr::video::IVideoDriver* pVideoDriver = mpImpl->mpIrrDevice->getVideoDriver();
+    irr::scene::ISceneManager* pSceneMgr = mpImpl->mpIrrDevice->getSceneManager();
+    
+    if ( !bHeadless )
+    {
+        mpImpl->mpIrrDevice->setWindowCaption( L"SubSim" );
+        
+        irr::gui::IGUIEnvironment* pGUIEnvironment = mpImpl->mpIrrDevice->getGUIEnvironment();
+        mpImpl->mpText = pGUIEnvironment->addStaticText( 
+            L"Hello World!", irr::core::rect< irr::s32 >( 10, 10, 200, 40 ), true );
+    }
+
+    // Setup physics for the world
+    mpImpl->mpCollisionConf = new btDefaultCollisionConfiguration();
+    mpImpl->mpCollisionDispatcher = new btCollisionDispatcher( mpImpl->mpCollisionConf );
+    mpImpl->mpOverlappingPairCache = new btDbvtBroadphase();
+    mpImpl->mpPhysicsSolver = new btSequentialImpulseConstraintSolver();
+    mpImpl->mpPhysicsWorld = new btDiscreteDynamicsWorld(
+        mpImpl->mpCollisionDispatcher, mpImpl->mpOverlappingPairCache,
+        mpImpl->mpPhysicsSolver, mpImpl->mpCollisionConf );
+    
+    mpImpl->mpPhysicsWorld->setGravity( btVector3( 0.0f, 0.0f, 0.0f ) );
+ 
+    // Populate the world
+    if ( NULL != worldFilename )
+    {
+        char* modifiedFilename = NULL;
+        if ( worldFilename[ 0 ] == '~' )
         {
-            Entity* pEntity = *entityIter;
-            if ( pEntity->GetType() == Entity::eT_Sub )
+            const char* homeDirName = getenv( "HOME" );
+            if ( NULL == homeDirName )
             {
-                mpImpl->mpSub = static_cast<Sub*>(pEntity);
-                break;
+                fprintf( stderr, "Error: Unable to find home dir\n" );
+                DeInitWorld();
+                return false;
             }
+            
+            U32 newStringLength = strlen( homeDirName ) 
+                + strlen( worldFilename ) - 1;
+            modifiedFilename = new char[ newStringLength + 1 ];
+            strcpy( modifiedFilename, homeDirName );
+            strcat( modifiedFilename, &worldFilename[ 1 ] );
+            modifiedFilename[ newStringLength ] = '\0';
         }
         
-        if ( NULL == mpImpl->mpSub )
+        bool bWorldBuilt = 
+            BuildEntitiesFromWorldFile( 
+            ( NULL != modifiedFilename ? modifiedFilename : worldFilename ), 
+            pSceneMgr, pVideoDriver, mpImpl->mpPhysicsWorld, &mpImpl->mEntityList );
+        if ( NULL != modifiedFilename )
+        {
+            delete [] modifiedFilename;
+            modifiedFilename = NULL;
+        }
+        if ( !bWorldBuilt )
         {
-            fprintf( stderr, "Error: The world does not contain a submarine\n" );
-            DeInit();
+            fprintf( stderr, "Error: Unable to build world\n" );
+            DeInitWorld();
             return false;
         }
+    }
+    
+    // Find the submarine
+    mpImpl->mpSub = NULL;
+    for ( EntityPtrVector::iterator entityIter = mpImpl->mEntityList.begin();
+        mpImpl->mEntityList.end() != entityIter; ++entityIter )
+    {
+        Entity* pEntity = *entityIter;
+        if ( pEntity->GetType() == Entity::eT_Sub )
+        {
+            mpImpl->mpSub = static_cast<Sub*>(pEntity);
+            break;
+        }
+    }
+    
+    if ( NULL == mpImpl->mpSub )
+    {
+        fprintf( stderr, "Error: The world does not contain a submarine\n" );
+        DeInitWorld();
+        return false;
+    }
+    
+    // Index the entities by name so that handles can be looked up quickly
+    mpImpl->mEntityNameTable.Clear();
+    for ( U32 entityIdx = 0; entityIdx < mpImpl->mEntityList.size(); entityIdx++ )
+    {
+        const char* entityName = mpImpl->mEntityList[ entityIdx ]->GetName();
+        if ( !mpImpl->mEntityNameTable.Insert( entityName, (S32)entityIdx ) )
+        {
+            fprintf( stderr, "Warning: More than one entity is called %s, "
+                "only the first can be looked up by name\n", entityName );
+        }
+    }
+    
+    // Gather the entities that are driven by the physics engine
+    mpImpl->mPhysicsBindings.clear();
+    for ( EntityPtrVector::iterator entityIter = mpImpl->mEntityList.begin();
+        mpImpl->mEntityList.end() != entityIter; ++entityIter )
+    {
+        Entity* pEntity = *entityIter;
+        btRigidBody* pBody = pEntity->GetPhysicsBody();
+        if ( NULL != pBody )
+        {
+            PhysicsBinding binding;
+            binding.mpBody = pBody;
+            binding.mpEntity = pEntity;
+            mpImpl->mPhysicsBindings.push_back( binding );
+        }
+    }
+    
+    BuildEntityTables();
+    
+    // Give the sonar something to see. Entities that are moved by the 
+    // physics engine are represented by their rigid bodies, everything else
+    // is static and gets a collision mesh built from its render meshes
+    if ( !mpImpl->mSonarModel.Init() )
+    {
+        fprintf( stderr, "Warning: Unable to start the sonar worker threads\n" );
+    }
+    for ( EntityPtrVector::iterator entityIter = mpImpl->mEntityList.begin();
+        mpImpl->mEntityList.end() != entityIter; ++entityIter )
+    {
+        Entity* pEntity = *entityIter;
+        if ( Entity::eT_Sub == pEntity->GetType()
+            || Entity::eT_CoordinateSystemAxes == pEntity->GetType() )
+        {
+            continue;
+        }
         
-        // Create some fog to represent underwater visibility
-        pVideoDriver->setFog( irr::video::SColor( 0,0,25,220 ), 
-                            irr::video::EFT_FOG_EXP, 50, 3000, 0.005f, true, false );
-                 
-                            //  -750.0f, 200.0f, 300.0f ); 
-        
-        // Create camera to view scene
+        btRigidBody* pBody = pEntity->GetPhysicsBody();
+        if ( NULL != pBody )
+        {
+            mpImpl->mSonarModel.AddPhysicsObject( pBody );
+        }
+        else
+        {
+            mpImpl->mSonarModel.AddStaticEntity( pEntity );
+        }
+    }
+    
+    // Create some fog to represent underwater visibility
+    pVideoDriver->setFog( irr::video::SColor( 0,0,25,220 ), 
+                        irr::video::EFT_FOG_EXP, 50, 3000, 0.005f, true, false );
+             
+                        //  -750.0f, 200.0f, 300.0f ); 
+    
+    // Create camera to view scene. There's no main view in headless mode
+    if ( !bHeadless )
+    {
         mpImpl->mpCamera = pSceneMgr->addCameraSceneNode( 0,
             irr::core::vector3df( 10.0f, 0, 0 ), irr::core::vector3df( 0, 0, 0 ) );
         if ( NULL == mpImpl->mpCamera )
         {
             fprintf( stderr, "Error: Unable to initialise main camera\n" );
-            DeInit();
+            DeInitWorld();
             return false;
         }
         
@@ -237,24 +673,98 @@ bool Simulator::Init( const char* worldFilename )
             irr::core::vector3df( 10.0f, 0, 0 ), -750.0f, 200.0f, 300.0f );
 
         mpImpl->mpCamera->addAnimator(anm);
+    }
+    
+    // Setup the buffers used to pass data between threads
+    U32 numEntities = mpImpl->mEntityList.size();
+    mpImpl->mEntityStates.Init( numEntities );
+    mpImpl->mRenderStates.Resize( numEntities );
+    mpImpl->mRenderedPoseVersions.assign( numEntities, 0 );
+    
+    irr::video::ITexture* pSubCameraRenderTarget = mpImpl->mpSub->GetCameraRenderTarget();
+    if ( NULL != pSubCameraRenderTarget )
+    {
+        irr::core::dimension2d<U32> imageSize = pSubCameraRenderTarget->getSize();
+        mpImpl->mSubCameraWidth = imageSize.Width;
+        mpImpl->mSubCameraHeight = imageSize.Height;
+        mpImpl->mCameraImage.resize( imageSize.Width*imageSize.Height*3, 0 );
+        mpImpl->mCameraImageTimestamp = 0.0;
         
-        mpImpl->mLastFPS = -1;
-        mpImpl->mbIsRunning = true;
-        
-        mpImpl->mTimeAccumulatorUS = 0;
-        mpImpl->mSimulatorStartTime = HighPrecisionTime::GetTime();
-        mpImpl->mLastTime = mpImpl->mSimulatorStartTime;      
-        
-        mpImpl->mbInitialised = true;
+        // Read the camera back asynchronously if the driver allows it
+        if ( irr::video::EDT_OPENGL == mpImpl->mpIrrDevice->getVideoDriver()->getDriverType()
+            && !mpImpl->mCameraReadback.Init( imageSize.Width, imageSize.Height ) )
+        {
+            fprintf( stderr, "Warning: Pixel buffer objects not available, "
+                "the sub camera will be read back synchronously\n" );
+        }
     }
+    mpImpl->mLastCapturedFrameIdx = (U32)-1;
+    
+    mpImpl->mLastFPS = -1;
+    mpImpl->mNumFPSUpdates = 0;
+    mpImpl->mbIsRunning = true;
+    
+    mpImpl->mTimeAccumulatorUS = 0;
+    mpImpl->mNumSimFrames = 0;
+    mpImpl->mSimulatorStartTime = HighPrecisionTime::GetTime();
+    mpImpl->mLastTime = mpImpl->mSimulatorStartTime;      
+    mpImpl->mbPaused = false;
+    mpImpl->mTotalPauseTime = 0.0;
+    
+    // Remember where everything started so that the world can be reset
+    WriteState( &mpImpl->mInitialState );
+    
+    // Publish the starting state of the world and make sure that it
+    // gets applied to the scene graph. Both buffers need every entity
+    mpImpl->mNumFullPublishesNeeded = 2;
+    PublishEntityStates();
+    mpImpl->mLastRenderedFrameIdx = (U32)-1;
     
     return true;
 }
 
 //------------------------------------------------------------------------------
 void Simulator::DeInit()
+{
+    if ( mpImpl->mbRenderThreadStarted || mpImpl->mbSimThreadStarted )
+    {
+        // The render thread tears down the world when it exits
+        mpImpl->mbStopThreads = true;
+        if ( mpImpl->mbSimThreadStarted )
+        {
+            pthread_join( mpImpl->mSimThread, NULL );
+            mpImpl->mbSimThreadStarted = false;
+        }
+        if ( mpImpl->mbRenderThreadStarted )
+        {
+            pthread_join( mpImpl->mRenderThread, NULL );
+            mpImpl->mbRenderThreadStarted = false;
+        }
+    }
+    else
+    {
+        DeInitWorld();
+    }
+    
+    mpImpl->mbThreaded = false;
+    mpImpl->mbIsRunning = false;
+    mpImpl->mbInitialised = false;
+}
+
+//------------------------------------------------------------------------------
+void Simulator::DeInitWorld()
 {
     mpImpl->mpSub = NULL;
+    mpImpl->mPhysicsBindings.clear();
+    mpImpl->mEntityTypes.clear();
+    mpImpl->mDynamicEntityIdxs.clear();
+    mpImpl->mUpdateBatches.clear();
+    mpImpl->mEntityNameTable.Clear();
+    
+    // Wait for any beams that are being cast
+    pthread_mutex_lock( &mpImpl->mSonarMutex );
+    mpImpl->mSonarModel.DeInit();
+    pthread_mutex_unlock( &mpImpl->mSonarMutex );
     
     for ( EntityPtrVector::iterator entityIter = mpImpl->mEntityList.begin();
             mpImpl->mEntityList.end() != entityIter; ++entityIter )
@@ -267,34 +777,41 @@ void Simulator::DeInit()
         }
     }
     mpImpl->mEntityList.clear();
+    mpImpl->mLiveStates.Resize( 0 );
+    
+    // The entities have let go of their meshes so the shared copies can go
+    if ( NULL != mpImpl->mpIrrDevice )
+    {
+        MeshCache::ReleaseSceneManager( mpImpl->mpIrrDevice->getSceneManager() );
+    }
     
     mpImpl->mpCamera = NULL;
     
-    if ( NULL == mpImpl->mpPhysicsWorld )
+    if ( NULL != mpImpl->mpPhysicsWorld )
     {
         delete mpImpl->mpPhysicsWorld;
         mpImpl->mpPhysicsWorld = NULL;
     }
     
-    if ( NULL == mpImpl->mpPhysicsSolver )
+    if ( NULL != mpImpl->mpPhysicsSolver )
     {
         delete mpImpl->mpPhysicsSolver;
         mpImpl->mpPhysicsSolver = NULL;
     }
     
-    if ( NULL == mpImpl->mpOverlappingPairCache )
+    if ( NULL != mpImpl->mpOverlappingPairCache )
     {
         delete mpImpl->mpOverlappingPairCache;
         mpImpl->mpOverlappingPairCache = NULL;
     }
     
-    if ( NULL == mpImpl->mpCollisionDispatcher )
+    if ( NULL != mpImpl->mpCollisionDispatcher )
     {
         delete mpImpl->mpCollisionDispatcher;
         mpImpl->mpCollisionDispatcher = NULL;
     }
     
-    if ( NULL == mpImpl->mpCollisionConf )
+    if ( NULL != mpImpl->mpCollisionConf )
     {
         delete mpImpl->mpCollisionConf;
         mpImpl->mpCollisionConf = NULL;
@@ -302,20 +819,34 @@ void Simulator::DeInit()
     
     mpImpl->mpText = NULL;
     
+    // The pixel buffers belong to the OpenGL context so they have to go 
+    // before the device
+    mpImpl->mCameraReadback.DeInit();
+    
     if ( NULL != mpImpl->mpIrrDevice )
     {
         mpImpl->mpIrrDevice->drop(); 
         mpImpl->mpIrrDevice = NULL; 
     }
     
-    mpImpl->mbInitialised = false;
+    mpImpl->mEntityStates.DeInit();
+    mpImpl->mRenderStates.Resize( 0 );
+    mpImpl->mRenderedPoseVersions.clear();
+    mpImpl->mInitialState.clear();
+    
+    pthread_mutex_lock( &mpImpl->mCameraMutex );
+    mpImpl->mCameraImage.clear();
+    mpImpl->mSubCameraWidth = 0;
+    mpImpl->mSubCameraHeight = 0;
+    pthread_mutex_unlock( &mpImpl->mCameraMutex );
 }
 
 //------------------------------------------------------------------------------
 void Simulator::Update()
 {
     if ( mpImpl->mbInitialised
-        && mpImpl->mbIsRunning )
+        && mpImpl->mbIsRunning
+        && !mpImpl->mbThreaded )
     {
         if ( mpImpl->mpIrrDevice->run() )
         {
@@ -330,57 +861,615 @@ void Simulator::Update()
     }
 }
 
-//--------------------------------------------------------------------------
-S32 Simulator::UpdateSimulator()
+//------------------------------------------------------------------------------
+void* Simulator::RenderThreadEntry( void* pSimulator )
 {
-    // Work out how many microseconds have elapsed since the last update
-    HighPrecisionTime newTime = HighPrecisionTime::GetTime();
-    HighPrecisionTime timeDiff = HighPrecisionTime::GetDiff( newTime,  mpImpl->mLastTime );
-    S32 elapsedUS = HighPrecisionTime::ConvertToMicroSeconds( timeDiff );
-    //printf( "Time = %i, %i, Elapsed US = %i\n", newTime.mSeconds, newTime.mNanoSeconds, elapsedUS );
+    ((Simulator*)pSimulator)->RenderThreadMain();
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+void* Simulator::SimThreadEntry( void* pSimulator )
+{
+    ((Simulator*)pSimulator)->SimThreadMain();
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+void Simulator::RenderThreadMain()
+{
+    Profiler::SetThreadName( "Render" );
+    bool bWorldBuilt = InitWorld( mpImpl->mpInitWorldFilename );
     
-    // Add the elapsed time onto the accumulator and also cap the accumukator
-    mpImpl->mTimeAccumulatorUS += elapsedUS;
-    if ( mpImpl->mTimeAccumulatorUS > SIM_MAX_NUM_CATCHUP_FRAMES*SIM_MICRO_SECS_PER_SIM_FRAME )
+    pthread_mutex_lock( &mpImpl->mInitMutex );
+    mpImpl->mbInitSucceeded = bWorldBuilt;
+    mpImpl->mbInitDone = true;
+    pthread_cond_signal( &mpImpl->mInitCondition );
+    pthread_mutex_unlock( &mpImpl->mInitMutex );
+    
+    if ( bWorldBuilt )
     {
-        mpImpl->mTimeAccumulatorUS = SIM_MAX_NUM_CATCHUP_FRAMES*SIM_MICRO_SECS_PER_SIM_FRAME;
+        while ( !mpImpl->mbStopThreads )
+        {
+            if ( !mpImpl->mpIrrDevice->run() )
+            {
+                mpImpl->mbIsRunning = false;
+                break;
+            }
+            
+            // There's no point redrawing in headless mode if the simulation
+            // hasn't moved on since the last render
+            U32 frameIdx = mpImpl->mEntityStates.GetFrameIdx();
+            if ( mpImpl->mbHeadless 
+                && frameIdx == mpImpl->mLastRenderedFrameIdx )
+            {
+                usleep( 1000 );
+                continue;
+            }
+            
+            U32 lastRenderedFrameIdx = mpImpl->mLastRenderedFrameIdx;
+            UpdateFrameRender();
+            UpdateFPSCounter( (S32)( mpImpl->mLastRenderedFrameIdx - lastRenderedFrameIdx ) );
+        }
     }
     
-    S32 numUpdates = 0;
+    DeInitWorld();
+}
+
+//------------------------------------------------------------------------------
+void Simulator::SimThreadMain()
+{
+    Profiler::SetThreadName( "Simulation" );
+    pthread_mutex_lock( &mpImpl->mSimMutex );
+    mpImpl->mTimeAccumulatorUS = 0;
+    mpImpl->mLastTime = HighPrecisionTime::GetTime();
+    pthread_mutex_unlock( &mpImpl->mSimMutex );
     
-    // Simulate the required number of frames
-    while ( mpImpl->mTimeAccumulatorUS >= SIM_MICRO_SECS_PER_SIM_FRAME )
+    while ( !mpImpl->mbStopThreads
+        && mpImpl->mbIsRunning )
     {
-        // Update all of the entities in the simulator
-        for ( EntityPtrVector::iterator entityIter = mpImpl->mEntityList.begin();
-            mpImpl->mEntityList.end() != entityIter; ++entityIter )
+        if ( 0 == UpdateSimulator() )
+        {
+            // Wait for more time to build up
+            usleep( 1000 );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void Simulator::SetLockstepEnabled( bool bEnabled )
+{
+    pthread_mutex_lock( &mpImpl->mSimMutex );
+    if ( bEnabled != mpImpl->mbLockstep )
+    {
+        // Restart the wall clock so that leaving lockstep mode doesn't
+        // produce a burst of catch up frames
+        mpImpl->mTimeAccumulatorUS = 0;
+        mpImpl->mLastTime = HighPrecisionTime::GetTime();
+        mpImpl->mbLockstep = bEnabled;
+    }
+    pthread_mutex_unlock( &mpImpl->mSimMutex );
+}
+
+//------------------------------------------------------------------------------
+bool Simulator::IsLockstepEnabled() const
+{
+    return mpImpl->mbLockstep;
+}
+
+//------------------------------------------------------------------------------
+void Simulator::SetPaused( bool bPaused )
+{
+    pthread_mutex_lock( &mpImpl->mSimMutex );
+    if ( bPaused != mpImpl->mbPaused )
+    {
+        HighPrecisionTime curTime = HighPrecisionTime::GetTime();
+        if ( bPaused )
+        {
+            mpImpl->mPauseStartTime = curTime;
+        }
+        else
+        {
+            mpImpl->mTotalPauseTime += HighPrecisionTime::ConvertToSeconds( 
+                HighPrecisionTime::GetDiff( curTime, mpImpl->mPauseStartTime ) );
+        }
+        
+        // As with lockstep, the time spent paused mustn't be caught up
+        mpImpl->mTimeAccumulatorUS = 0;
+        mpImpl->mLastTime = curTime;
+        mpImpl->mbPaused = bPaused;
+    }
+    pthread_mutex_unlock( &mpImpl->mSimMutex );
+}
+
+//------------------------------------------------------------------------------
+bool Simulator::IsPaused() const
+{
+    return mpImpl->mbPaused;
+}
+
+//------------------------------------------------------------------------------
+void Simulator::ResetWorld()
+{
+    if ( mpImpl->mbInitialised )
+    {
+        // Sim time carries on from where it was so that timestamps never go 
+        // backwards
+        ApplyState( &mpImpl->mInitialState[ 0 ], mpImpl->mInitialState.size(), false );
+    }
+}
+
+//------------------------------------------------------------------------------
+void Simulator::SaveState( std::vector<U8>* pStateOut ) const
+{
+    pStateOut->clear();
+    if ( mpImpl->mbInitialised )
+    {
+        pthread_mutex_lock( &mpImpl->mSimMutex );
+        WriteState( pStateOut );
+        pthread_mutex_unlock( &mpImpl->mSimMutex );
+    }
+}
+
+//------------------------------------------------------------------------------
+bool Simulator::RestoreState( const U8* pState, U32 stateSize )
+{
+    if ( !mpImpl->mbInitialised )
+    {
+        return false;
+    }
+    
+    return ApplyState( pState, stateSize, true );
+}
+
+//------------------------------------------------------------------------------
+void Simulator::WriteState( std::vector<U8>* pStateOut ) const
+{
+    U32 numEntities = mpImpl->mEntityList.size();
+    U32 numBodies = mpImpl->mPhysicsBindings.size();
+    pStateOut->resize( sizeof( SavedStateHeader ) 
+        + numEntities*sizeof( SavedEntityState ) + numBodies*sizeof( SavedBodyState ) );
+    
+    SavedStateHeader* pHeader = (SavedStateHeader*)&(*pStateOut)[ 0 ];
+    pHeader->mMagic = SIM_SAVED_STATE_MAGIC;
+    pHeader->mVersion = SIM_SAVED_STATE_VERSION;
+    pHeader->mNumEntities = numEntities;
+    pHeader->mNumBodies = numBodies;
+    pHeader->mNumSimFrames = mpImpl->mNumSimFrames;
+    pHeader->mSubSetpoints[ 0 ] = mpImpl->mpSub->GetForwardSpeed();
+    pHeader->mSubSetpoints[ 1 ] = mpImpl->mpSub->GetDepthSpeed();
+    pHeader->mSubSetpoints[ 2 ] = mpImpl->mpSub->GetYawSpeed();
+    pHeader->mSubSetpoints[ 3 ] = mpImpl->mpSub->GetPitchSpeed();
+    
+    const Vector& subLinearVelocity = mpImpl->mpSub->GetLinearVelocity();
+    const Vector& subAngularVelocity = mpImpl->mpSub->GetAngularVelocity();
+    pHeader->mSubLinearVelocity[ 0 ] = subLinearVelocity.mX;
+    pHeader->mSubLinearVelocity[ 1 ] = subLinearVelocity.mY;
+    pHeader->mSubLinearVelocity[ 2 ] = subLinearVelocity.mZ;
+    pHeader->mSubAngularVelocity[ 0 ] = subAngularVelocity.mX;
+    pHeader->mSubAngularVelocity[ 1 ] = subAngularVelocity.mY;
+    pHeader->mSubAngularVelocity[ 2 ] = subAngularVelocity.mZ;
+    
+    SavedEntityState* pEntityStates = (SavedEntityState*)( pHeader + 1 );
+    for ( U32 entityIdx = 0; entityIdx < numEntities; entityIdx++ )
+    {
+        const Entity* pEntity = mpImpl->mEntityList[ entityIdx ];
+        const Vector& pos = pEntity->GetPosition();
+        const Vector& rotation = pEntity->GetRotation();
+        
+        SavedEntityState& entityState = pEntityStates[ entityIdx ];
+        entityState.mPosition[ 0 ] = pos.mX;
+        entityState.mPosition[ 1 ] = pos.mY;
+        entityState.mPosition[ 2 ] = pos.mZ;
+        entityState.mRotation[ 0 ] = rotation.mX;
+        entityState.mRotation[ 1 ] = rotation.mY;
+        entityState.mRotation[ 2 ] = rotation.mZ;
+    }
+    
+    SavedBodyState* pBodyStates = (SavedBodyState*)( pEntityStates + numEntities );
+    for ( U32 bodyIdx = 0; bodyIdx < numBodies; bodyIdx++ )
+    {
+        const btRigidBody* pBody = mpImpl->mPhysicsBindings[ bodyIdx ].mpBody;
+        const btTransform& bodyTransform = pBody->getWorldTransform();
+        const btVector3& origin = bodyTransform.getOrigin();
+        btQuaternion orientation = bodyTransform.getRotation();
+        const btVector3& linearVelocity = pBody->getLinearVelocity();
+        const btVector3& angularVelocity = pBody->getAngularVelocity();
+        
+        SavedBodyState& bodyState = pBodyStates[ bodyIdx ];
+        bodyState.mOrigin[ 0 ] = origin.x();
+        bodyState.mOrigin[ 1 ] = origin.y();
+        bodyState.mOrigin[ 2 ] = origin.z();
+        bodyState.mOrientation[ 0 ] = orientation.x();
+        bodyState.mOrientation[ 1 ] = orientation.y();
+        bodyState.mOrientation[ 2 ] = orientation.z();
+        bodyState.mOrientation[ 3 ] = orientation.w();
+        bodyState.mLinearVelocity[ 0 ] = linearVelocity.x();
+        bodyState.mLinearVelocity[ 1 ] = linearVelocity.y();
+        bodyState.mLinearVelocity[ 2 ] = linearVelocity.z();
+        bodyState.mAngularVelocity[ 0 ] = angularVelocity.x();
+        bodyState.mAngularVelocity[ 1 ] = angularVelocity.y();
+        bodyState.mAngularVelocity[ 2 ] = angularVelocity.z();
+    }
+}
+
+//------------------------------------------------------------------------------
+bool Simulator::ApplyState( const U8* pState, U32 stateSize, bool bRestoreSimTime )
+{
+    // Check that the state came from this world
+    U32 numEntities = mpImpl->mEntityList.size();
+    U32 numBodies = mpImpl->mPhysicsBindings.size();
+    U32 expectedSize = sizeof( SavedStateHeader ) 
+        + numEntities*sizeof( SavedEntityState ) + numBodies*sizeof( SavedBodyState );
+    
+    const SavedStateHeader* pHeader = (const SavedStateHeader*)pState;
+    if ( NULL == pState
+        || stateSize != expectedSize
+        || SIM_SAVED_STATE_MAGIC != pHeader->mMagic
+        || SIM_SAVED_STATE_VERSION != pHeader->mVersion
+        || numEntities != pHeader->mNumEntities
+        || numBodies != pHeader->mNumBodies )
+    {
+        fprintf( stderr, "Error: Saved state doesn't match the current world\n" );
+        return false;
+    }
+    
+    // Commands sent before the restore are thrown away. The pending command
+    // belongs to the thread that controls the sub, which is the one calling
+    // this, so the setters carry on from the restored setpoints
+    mpImpl->mPendingSubCommand.mForwardSpeed = pHeader->mSubSetpoints[ 0 ];
+    mpImpl->mPendingSubCommand.mDepthSpeed = pHeader->mSubSetpoints[ 1 ];
+    mpImpl->mPendingSubCommand.mYawSpeed = pHeader->mSubSetpoints[ 2 ];
+    mpImpl->mPendingSubCommand.mPitchSpeed = pHeader->mSubSetpoints[ 3 ];
+    
+    pthread_mutex_lock( &mpImpl->mSimMutex );
+    
+    SubVelocityCommand oldCommand;
+    mpImpl->mSubCommandMailbox.TakeLatest( &oldCommand );
+    
+    const SavedEntityState* pEntityStates = (const SavedEntityState*)( pHeader + 1 );
+    for ( U32 entityIdx = 0; entityIdx < numEntities; entityIdx++ )
+    {
+        const SavedEntityState& entityState = pEntityStates[ entityIdx ];
+        Entity* pEntity = mpImpl->mEntityList[ entityIdx ];
+        pEntity->ResetMotion();
+        pEntity->SetPose( 
+            Vector( entityState.mPosition[ 0 ], entityState.mPosition[ 1 ], entityState.mPosition[ 2 ] ),
+            Vector( entityState.mRotation[ 0 ], entityState.mRotation[ 1 ], entityState.mRotation[ 2 ] ) );
+    }
+    
+    mpImpl->mpSub->SetForwardSpeed( pHeader->mSubSetpoints[ 0 ] );
+    mpImpl->mpSub->SetDepthSpeed( pHeader->mSubSetpoints[ 1 ] );
+    mpImpl->mpSub->SetYawSpeed( pHeader->mSubSetpoints[ 2 ] );
+    mpImpl->mpSub->SetPitchSpeed( pHeader->mSubSetpoints[ 3 ] );
+    
+    // ResetMotion cleared the velocities, which are published straight away
+    mpImpl->mpSub->SetVelocities( 
+        Vector( pHeader->mSubLinearVelocity[ 0 ], pHeader->mSubLinearVelocity[ 1 ], 
+                pHeader->mSubLinearVelocity[ 2 ] ),
+        Vector( pHeader->mSubAngularVelocity[ 0 ], pHeader->mSubAngularVelocity[ 1 ], 
+                pHeader->mSubAngularVelocity[ 2 ] ) );
+    
+    // Setting the entity poses moves some bodies, so the bodies are done 
+    // afterwards to make sure that they end up exactly as they were saved
+    const SavedBodyState* pBodyStates = (const SavedBodyState*)( pEntityStates + numEntities );
+    for ( U32 bodyIdx = 0; bodyIdx < numBodies; bodyIdx++ )
+    {
+        const SavedBodyState& bodyState = pBodyStates[ bodyIdx ];
+        btRigidBody* pBody = mpImpl->mPhysicsBindings[ bodyIdx ].mpBody;
+        
+        btTransform bodyTransform( 
+            btQuaternion( bodyState.mOrientation[ 0 ], bodyState.mOrientation[ 1 ],
+                          bodyState.mOrientation[ 2 ], bodyState.mOrientation[ 3 ] ),
+            btVector3( bodyState.mOrigin[ 0 ], bodyState.mOrigin[ 1 ], bodyState.mOrigin[ 2 ] ) );
+        pBody->setWorldTransform( bodyTransform );
+        pBody->getMotionState()->setWorldTransform( bodyTransform );
+        pBody->setLinearVelocity( btVector3( bodyState.mLinearVelocity[ 0 ],
+            bodyState.mLinearVelocity[ 1 ], bodyState.mLinearVelocity[ 2 ] ) );
+        pBody->setAngularVelocity( btVector3( bodyState.mAngularVelocity[ 0 ],
+            bodyState.mAngularVelocity[ 1 ], bodyState.mAngularVelocity[ 2 ] ) );
+        pBody->clearForces();
+        pBody->activate();
+    }
+    
+    if ( bRestoreSimTime )
+    {
+        mpImpl->mNumSimFrames = pHeader->mNumSimFrames;
+        mpImpl->mTimeAccumulatorUS = 0;
+        mpImpl->mLastTime = HighPrecisionTime::GetTime();
+    }
+    
+    // Make the restored state visible straight away. Any entity may have
+    // moved so the next two publishes cover all of them
+    mpImpl->mNumFullPublishesNeeded = 2;
+    PublishEntityStates();
+    
+    pthread_mutex_unlock( &mpImpl->mSimMutex );
+    
+    return true;
+}
+
+//------------------------------------------------------------------------------
+double Simulator::GetRealTime() const
+{
+    if ( !mpImpl->mbInitialised )
+    {
+        return 0.0;
+    }
+    
+    return HighPrecisionTime::ConvertToSeconds( HighPrecisionTime::GetDiff( 
+        HighPrecisionTime::GetTime(), mpImpl->mSimulatorStartTime ) );
+}
+
+//------------------------------------------------------------------------------
+double Simulator::GetPauseTime() const
+{
+    pthread_mutex_lock( &mpImpl->mSimMutex );
+    double pauseTime = mpImpl->mTotalPauseTime;
+    if ( mpImpl->mbPaused )
+    {
+        pauseTime += HighPrecisionTime::ConvertToSeconds( HighPrecisionTime::GetDiff( 
+            HighPrecisionTime::GetTime(), mpImpl->mPauseStartTime ) );
+    }
+    pthread_mutex_unlock( &mpImpl->mSimMutex );
+    
+    return pauseTime;
+}
+
+//------------------------------------------------------------------------------
+void Simulator::Step( U32 numFrames )
+{
+    if ( mpImpl->mbInitialised
+        && mpImpl->mbIsRunning )
+    {
+        for ( U32 frameIdx = 0; frameIdx < numFrames; frameIdx++ )
+        {
+            SimulateFrame();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+U32 Simulator::RunFor( double simSeconds )
+{
+    U32 numFrames = 0;
+    if ( simSeconds > 0.0 )
+    {
+        // Small tolerance so that whole numbers of frames aren't rounded up
+        numFrames = (U32)ceil( simSeconds*SIM_DESIRED_SIM_FPS - 1.0e-6 );
+        Step( numFrames );
+    }
+    
+    return numFrames;
+}
+
+//--------------------------------------------------------------------------
+void Simulator::SimulateFrame()
+{
+    PROFILE_SCOPE( "SimulateFrame" );
+    pthread_mutex_lock( &mpImpl->mSimMutex );
+    
+    ApplySubCommand();
+    
+    // Update the entities that move themselves, a type at a time
+    {
+        PROFILE_SCOPE( "EntityUpdate" );
+        EntityUpdateBatchVector& batches = mpImpl->mUpdateBatches;
+        for ( U32 batchIdx = 0; batchIdx < batches.size(); batchIdx++ )
+        {
+            UpdateEntityBatch( batches[ batchIdx ].mType, 
+                &batches[ batchIdx ].mEntities[ 0 ], batches[ batchIdx ].mEntities.size() );
+        }
+    }
+    
+    // Advance the physics world and then copy the results back out
+    {
+        PROFILE_SCOPE( "PhysicsStep" );
+        // Bullet is allowed one more sub step than a frame needs so that
+        // rounding in its time accumulator never drops physics time. The 
+        // budget for catching up is applied to whole frames in UpdateSimulator
+        mpImpl->mpPhysicsWorld->stepSimulation( SIM_SECS_PER_SIM_FRAME,
+            SIM_PHYSICS_SUB_STEPS_PER_FRAME + 1, SIM_PHYSICS_FIXED_TIME_STEP );
+        SyncEntitiesWithPhysics();
+    }
+    
+    mpImpl->mNumSimFrames++;
+    PublishEntityStates();
+    
+    pthread_mutex_unlock( &mpImpl->mSimMutex );
+}
+
+//--------------------------------------------------------------------------
+void Simulator::PublishEntityStates()
+{
+    EntityStateTable* pStates = mpImpl->mEntityStates.GetBackBuffer();
+    
+    // The back buffer already holds the static entities unless something
+    // has moved them, in which case every column is copied
+    if ( mpImpl->mNumFullPublishesNeeded > 0 )
+    {
+        *pStates = mpImpl->mLiveStates;
+        mpImpl->mNumFullPublishesNeeded--;
+    }
+    else
+    {
+        const std::vector<U32>& dynamicEntityIdxs = mpImpl->mDynamicEntityIdxs;
+        U32 numDynamicEntities = dynamicEntityIdxs.size();
+        for ( U32 dynamicIdx = 0; dynamicIdx < numDynamicEntities; dynamicIdx++ )
+        {
+            CopyEntityState( mpImpl->mLiveStates, dynamicEntityIdxs[ dynamicIdx ], pStates );
+        }
+    }
+    
+    mpImpl->mEntityStates.Publish( mpImpl->mNumSimFrames );
+}
+
+//--------------------------------------------------------------------------
+void Simulator::BuildEntityTables()
+{
+    mpImpl->mEntityTypes.clear();
+    mpImpl->mDynamicEntityIdxs.clear();
+    mpImpl->mUpdateBatches.clear();
+    
+    // Move the state of every entity into the live table. It isn't resized
+    // again until the entities have been destroyed
+    U32 numEntities = mpImpl->mEntityList.size();
+    mpImpl->mLiveStates.Resize( numEntities );
+    mpImpl->mEntityTypes.reserve( numEntities );
+    for ( U32 entityIdx = 0; entityIdx < numEntities; entityIdx++ )
+    {
+        Entity* pEntity = mpImpl->mEntityList[ entityIdx ];
+        pEntity->BindStateTable( &mpImpl->mLiveStates, entityIdx );
+        
+        Entity::eType type = pEntity->GetType();
+        mpImpl->mEntityTypes.push_back( (U8)type );
+        
+        bool bNeedsUpdate = pEntity->NeedsUpdate();
+        if ( !bNeedsUpdate && NULL == pEntity->GetPhysicsBody() )
         {
-            (*entityIter)->Update( SIM_SECS_PER_SIM_FRAME );
+            continue;
         }
+        mpImpl->mDynamicEntityIdxs.push_back( entityIdx );
         
-        mpImpl->mTimeAccumulatorUS -= SIM_MICRO_SECS_PER_SIM_FRAME;
-        numUpdates++;
+        if ( bNeedsUpdate )
+        {
+            EntityUpdateBatchVector& batches = mpImpl->mUpdateBatches;
+            U32 batchIdx = 0;
+            while ( batchIdx < batches.size() && batches[ batchIdx ].mType != type )
+            {
+                batchIdx++;
+            }
+            if ( batchIdx == batches.size() )
+            {
+                batches.push_back( EntityUpdateBatch() );
+                batches.back().mType = type;
+            }
+            batches[ batchIdx ].mEntities.push_back( pEntity );
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+void Simulator::SyncEntitiesWithPhysics()
+{
+    PhysicsBindingVector& bindings = mpImpl->mPhysicsBindings;
+    U32 numBindings = bindings.size();
+    
+    for ( U32 bindingIdx = 0; bindingIdx < numBindings; bindingIdx++ )
+    {
+        const PhysicsBinding& binding = bindings[ bindingIdx ];
+        
+        // Sleeping bodies haven't moved so there's nothing to copy
+        if ( !binding.mpBody->isActive() )
+        {
+            continue;
+        }
+        
+        btTransform bodyTransform;
+        binding.mpBody->getMotionState()->getWorldTransform( bodyTransform );
+        
+        const btVector3& origin = bodyTransform.getOrigin();
+        btScalar rotZ, rotY, rotX;
+        bodyTransform.getBasis().getEulerZYX( rotZ, rotY, rotX );
+        
+        binding.mpEntity->SetPoseFromPhysics( 
+            Vector( origin.x(), origin.y(), origin.z() ),
+            Vector( rotX, rotY, rotZ ) );
+    }
+}
+
+//------------------------------------------------------------------------------
+void Simulator::SetMaxPhysicsSubSteps( S32 maxSubSteps )
+{
+    if ( maxSubSteps < SIM_PHYSICS_SUB_STEPS_PER_FRAME )
+    {
+        fprintf( stderr, "Warning: Max physics sub steps must be at least %i, "
+            "the number taken by one frame\n", SIM_PHYSICS_SUB_STEPS_PER_FRAME );
+        maxSubSteps = SIM_PHYSICS_SUB_STEPS_PER_FRAME;
     }
     
+    pthread_mutex_lock( &mpImpl->mSimMutex );
+    mpImpl->mMaxPhysicsSubSteps = maxSubSteps;
+    pthread_mutex_unlock( &mpImpl->mSimMutex );
+}
+
+//--------------------------------------------------------------------------
+S32 Simulator::UpdateSimulator()
+{
+    pthread_mutex_lock( &mpImpl->mSimMutex );
+    
+    // Work out how many microseconds have elapsed since the last update
+    HighPrecisionTime newTime = HighPrecisionTime::GetTime();
+    if ( mpImpl->mbLockstep || mpImpl->mbPaused )
+    {
+        // The simulation is only advanced by Step in lockstep mode or
+        // whilst paused
+        mpImpl->mLastTime = newTime;
+        pthread_mutex_unlock( &mpImpl->mSimMutex );
+        return 0;
+    }
+    
+    HighPrecisionTime timeDiff = HighPrecisionTime::GetDiff( newTime,  mpImpl->mLastTime );
+    S32 elapsedUS = HighPrecisionTime::ConvertToMicroSeconds( timeDiff );
+    //printf( "Time = %i, %i, Elapsed US = %i\n", newTime.mSeconds, newTime.mNanoSeconds, elapsedUS );
+    
+    // Add the elapsed time onto the accumulator and also cap the accumukator
+    mpImpl->mTimeAccumulatorUS += elapsedUS;
+    if ( mpImpl->mTimeAccumulatorUS > SIM_MAX_NUM_CATCHUP_FRAMES*SIM_MICRO_SECS_PER_SIM_FRAME )
+    {
+        mpImpl->mTimeAccumulatorUS = SIM_MAX_NUM_CATCHUP_FRAMES*SIM_MICRO_SECS_PER_SIM_FRAME;
+    }
+    
+    // Only simulate as many frames as the physics budget allows. Any time
+    // left over stays in the accumulator and is caught up on next update
+    S32 numUpdates = mpImpl->mTimeAccumulatorUS / SIM_MICRO_SECS_PER_SIM_FRAME;
+    S32 maxNumUpdates = mpImpl->mMaxPhysicsSubSteps / SIM_PHYSICS_SUB_STEPS_PER_FRAME;
+    if ( numUpdates > maxNumUpdates )
+    {
+        numUpdates = maxNumUpdates;
+    }
+    mpImpl->mTimeAccumulatorUS -= numUpdates*SIM_MICRO_SECS_PER_SIM_FRAME;
     mpImpl->mLastTime = newTime;
     
+    pthread_mutex_unlock( &mpImpl->mSimMutex );
+    
+    // Simulate the required number of frames. The lock is released between 
+    // frames so that commands aren't held up by a long catch up
+    for ( S32 updateIdx = 0; updateIdx < numUpdates; updateIdx++ )
+    {
+        SimulateFrame();
+    }
+    
     return numUpdates;
 }
 
 //--------------------------------------------------------------------------
 void Simulator::UpdateFrameRender()
 {
+    PROFILE_SCOPE( "Render" );
     irr::video::IVideoDriver* pVideoDriver = mpImpl->mpIrrDevice->getVideoDriver();
     irr::scene::ISceneManager* pSceneMgr = mpImpl->mpIrrDevice->getSceneManager();
-    irr::gui::IGUIEnvironment* pGUIEnvironment = mpImpl->mpIrrDevice->getGUIEnvironment();
+    
+    ApplyRenderTransforms();
+
+    // In headless mode the sub camera is the only thing that gets drawn so
+    // there's nothing to do unless someone wants to see its view
+    irr::video::ITexture* pSubCameraRenderTarget = mpImpl->mpSub->GetCameraRenderTarget();
+    bool bRenderSubCamera = ( NULL != pSubCameraRenderTarget
+        && ( !mpImpl->mbHeadless || mpImpl->mbSubCameraActive ) );
+    if ( mpImpl->mbHeadless && !bRenderSubCamera )
+    {
+        return;
+    }
 
     const irr::video::SColor CLEAR_COLOUR(  255, 100, 101, 140 );
     pVideoDriver->beginScene( true, true, CLEAR_COLOUR );
 
     // Render the view from the submarine's camera
-    irr::video::ITexture* pSubCameraRenderTarget = mpImpl->mpSub->GetCameraRenderTarget();
-    if ( NULL != pSubCameraRenderTarget )
+    if ( bRenderSubCamera )
     {                        
+        PROFILE_SCOPE( "SubCameraRender" );
+        
         // Set render target texture
         pVideoDriver->setRenderTarget( pSubCameraRenderTarget, 
                                        true, true, CLEAR_COLOUR );
@@ -390,34 +1479,96 @@ void Simulator::UpdateFrameRender()
         
         // Draw whole scene into render buffer
         pSceneMgr->drawAll();
+        
+        // Only pay for the read back if someone is going to use the image,
+        // and then only once per simulation frame
+        bool bCaptureImage = ( mpImpl->mbSubCameraActive
+            && mpImpl->mLastRenderedFrameIdx != mpImpl->mLastCapturedFrameIdx );
+        if ( bCaptureImage && mpImpl->mCameraReadback.IsInitialised() )
+        {
+            // The read has to be queued whilst the render target is bound
+            mpImpl->mCameraReadback.QueueRead( 
+                (double)mpImpl->mLastRenderedFrameIdx / (double)SIM_DESIRED_SIM_FPS );
+        }
+        else if ( !mpImpl->mbSubCameraActive )
+        {
+            mpImpl->mCameraReadback.DiscardPendingReads();
+            mpImpl->mLastCapturedFrameIdx = (U32)-1;
+        }
+        
         // Set back old render target
         // The buffer might have been distorted, so clear it
         pVideoDriver->setRenderTarget( 0, true, true, CLEAR_COLOUR );
         pSceneMgr->setActiveCamera( mpImpl->mpCamera );
+        
+        if ( bCaptureImage )
+        {
+            ReadBackSubCameraImage();
+            mpImpl->mLastCapturedFrameIdx = mpImpl->mLastRenderedFrameIdx;
+        }
     }
     
     // Draw the rest of the scene normally
-    pSceneMgr->drawAll();
-    pGUIEnvironment->drawAll();
+    {
+        PROFILE_SCOPE( "MainRender" );
+        if ( !mpImpl->mbHeadless )
+        {
+            pSceneMgr->drawAll();
+            mpImpl->mpIrrDevice->getGUIEnvironment()->drawAll();
+        }
+        
+        pVideoDriver->endScene();
+    }
+}
+
+//--------------------------------------------------------------------------
+void Simulator::ApplyRenderTransforms()
+{
+    const EntityStateTable& states = mpImpl->mRenderStates;
+    U32 frameIdx = mpImpl->mEntityStates.CopyFrontBuffer( &mpImpl->mRenderStates );
+    if ( frameIdx == mpImpl->mLastRenderedFrameIdx )
+    {
+        return;
+    }
     
-    pVideoDriver->endScene();
+    // Only entities that have moved since they were last drawn need their
+    // scene nodes updating. Most of the world is static
+    U32 numEntities = mpImpl->mEntityList.size();
+    for ( U32 entityIdx = 0; entityIdx < numEntities; entityIdx++ )
+    {
+        if ( states.mPoseVersions[ entityIdx ] == mpImpl->mRenderedPoseVersions[ entityIdx ] )
+        {
+            continue;
+        }
+        
+        mpImpl->mEntityList[ entityIdx ]->ApplyRenderTransform( 
+            states.mPositions[ entityIdx ], states.mRotations[ entityIdx ] );
+        mpImpl->mRenderedPoseVersions[ entityIdx ] = states.mPoseVersions[ entityIdx ];
+    }
+    
+    mpImpl->mLastRenderedFrameIdx = frameIdx;
 }
 //--------------------------------------------------------------------------
 void Simulator::UpdateFPSCounter( S32 numUpdates )
 {
-    static S32 updates = 0;
+    mpImpl->mNumFPSUpdates += numUpdates;
+    if ( NULL == mpImpl->mpText )
+    {
+        return;
+    }
     
-    updates += numUpdates;
-    F32 numSecs = (F32)clock() / (F32)CLOCKS_PER_SEC;
+    // Wall clock time rather than clock(), which only counts CPU time
+    F32 numSecs = (F32)HighPrecisionTime::ConvertToSeconds( HighPrecisionTime::GetDiff( 
+        HighPrecisionTime::GetTime(), mpImpl->mSimulatorStartTime ) );
     
     irr::video::IVideoDriver* pVideoDriver = mpImpl->mpIrrDevice->getVideoDriver();
     S32 fps = pVideoDriver->getFPS();
     if ( mpImpl->mLastFPS != fps )
     {
-        irr::core::stringw str = L"Hello World - FPS: ";
+        irr::core::stringw str = L"SubSim - FPS: ";
         str += fps;
         str += " Num Updates: ";
-        str += updates;
+        str += mpImpl->mNumFPSUpdates;
         str += " s ";
         str += numSecs;
         
@@ -439,63 +1590,230 @@ bool Simulator::IsRunning() const
     return bIsRunning;
 }
 
+//------------------------------------------------------------------------------
+bool Simulator::IsHeadless() const
+{
+    return mpImpl->mbHeadless;
+}
+
+//--------------------------------------------------------------------------
+U32 Simulator::SetSubVelocities( const SubVelocityCommand& command )
+{
+    mpImpl->mPendingSubCommand = command;
+    return mpImpl->mSubCommandMailbox.Post( command );
+}
+
 //--------------------------------------------------------------------------
 void Simulator::SetSubForwardSpeed( F32 forwardSpeed )
 {
-    if ( mpImpl->mbInitialised )
-    {
-        mpImpl->mpSub->SetForwardSpeed( forwardSpeed );
-    }
+    mpImpl->mPendingSubCommand.mForwardSpeed = forwardSpeed;
+    mpImpl->mSubCommandMailbox.Post( mpImpl->mPendingSubCommand );
 }
 
 //--------------------------------------------------------------------------
 void Simulator::SetSubDepthSpeed( F32 depthSpeed )
 {
-    if ( mpImpl->mbInitialised )
+    mpImpl->mPendingSubCommand.mDepthSpeed = depthSpeed;
+    mpImpl->mSubCommandMailbox.Post( mpImpl->mPendingSubCommand );
+}
+
+//--------------------------------------------------------------------------
+void Simulator::SetSubYawSpeed( F32 yawSpeed )
+{
+    mpImpl->mPendingSubCommand.mYawSpeed = yawSpeed;
+    mpImpl->mSubCommandMailbox.Post( mpImpl->mPendingSubCommand );
+}
+
+//--------------------------------------------------------------------------
+void Simulator::SetSubPitchSpeed( F32 pitchSpeed )
+{
+    mpImpl->mPendingSubCommand.mPitchSpeed = pitchSpeed;
+    mpImpl->mSubCommandMailbox.Post( mpImpl->mPendingSubCommand );
+}
+
+//--------------------------------------------------------------------------
+U32 Simulator::GetAppliedSubCommandIdx() const
+{
+    return mpImpl->mAppliedSubCommandIdx;
+}
+
+//--------------------------------------------------------------------------
+void Simulator::ApplySubCommand()
+{
+    SubVelocityCommand command;
+    U32 commandIdx;
+    if ( mpImpl->mSubCommandMailbox.TakeLatest( &command, &commandIdx ) )
     {
-        mpImpl->mpSub->SetDepthSpeed( depthSpeed );
+        mpImpl->mpSub->SetForwardSpeed( command.mForwardSpeed );
+        mpImpl->mpSub->SetDepthSpeed( command.mDepthSpeed );
+        mpImpl->mpSub->SetYawSpeed( command.mYawSpeed );
+        mpImpl->mpSub->SetPitchSpeed( command.mPitchSpeed );
+        mpImpl->mAppliedSubCommandIdx = commandIdx;
     }
 }
 
 //--------------------------------------------------------------------------
-void Simulator::SetSubYawSpeed( F32 yawSpeed )
+EntityHandle Simulator::GetEntityHandle( const char* entityName ) const
 {
-    if ( mpImpl->mbInitialised )
+    if ( !mpImpl->mbInitialised )
     {
-        mpImpl->mpSub->SetYawSpeed( yawSpeed );
+        return INVALID_ENTITY_HANDLE;
     }
-}   
+    
+    return mpImpl->mEntityNameTable.Find( entityName );
+}
 
 //--------------------------------------------------------------------------
-void Simulator::SetSubPitchSpeed( F32 pitchSpeed )
+bool Simulator::GetEntityPose( EntityHandle entityHandle, Vector* pPosOut, Vector* pRotationOut ) const
 {
-    if ( mpImpl->mbInitialised )
+    bool bEntityFound = false;
+    if ( mpImpl->mbInitialised
+        && entityHandle >= 0 
+        && (U32)entityHandle < mpImpl->mEntityStates.GetNumEntities() )
     {
-        mpImpl->mpSub->SetPitchSpeed( pitchSpeed );
+        // Read from the snapshot so that we don't have to wait for the
+        // simulation to finish a frame
+        EntityState state;
+        mpImpl->mEntityStates.GetState( entityHandle, &state );
+        *pPosOut = state.mPosition;
+        *pRotationOut = state.mRotation;
+        bEntityFound = true;
     }
-} 
+    
+    return bEntityFound;
+}
 
 //--------------------------------------------------------------------------
 bool Simulator::GetEntityPose( const char* entityName, Vector* pPosOut, Vector* pRotationOut ) const
+{
+    return GetEntityPose( GetEntityHandle( entityName ), pPosOut, pRotationOut );
+} 
+
+//--------------------------------------------------------------------------
+bool Simulator::GetEntityMotion( EntityHandle entityHandle, Vector* pPosOut, Vector* pRotationOut,
+                                 Vector* pLinearVelocityOut, Vector* pAngularVelocityOut,
+                                 double* pTimestampOut ) const
 {
     bool bEntityFound = false;
-    Entity* pEntity = FindEntityByName( entityName, mpImpl->mEntityList );
-    if ( NULL != pEntity )
+    if ( mpImpl->mbInitialised
+        && entityHandle >= 0 
+        && (U32)entityHandle < mpImpl->mEntityStates.GetNumEntities() )
     {
-        *pPosOut = pEntity->GetPosition();
-        *pRotationOut = pEntity->GetRotation();
+        EntityState state;
+        U32 frameIdx = mpImpl->mEntityStates.GetState( entityHandle, &state );
+        *pPosOut = state.mPosition;
+        *pRotationOut = state.mRotation;
+        *pLinearVelocityOut = state.mLinearVelocity;
+        *pAngularVelocityOut = state.mAngularVelocity;
+        *pTimestampOut = (double)frameIdx / (double)SIM_DESIRED_SIM_FPS;
         bEntityFound = true;
     }
     
     return bEntityFound;
-} 
+}
+
+//--------------------------------------------------------------------------
+bool Simulator::GetEntityPoseList( const char* typeName, EntityPoseListHeader* pHeaderOut,
+                                   std::vector<EntityPoseRecord>* pRecordsOut ) const
+{
+    Entity::eType typeFilter = Entity::eT_Invalid;
+    if ( NULL != typeName )
+    {
+        typeFilter = Entity::GetTypeFromString( typeName );
+        if ( Entity::eT_Invalid == typeFilter )
+        {
+            return false;
+        }
+    }
+    
+    pRecordsOut->clear();
+    memset( pHeaderOut, 0, sizeof( EntityPoseListHeader ) );
+    pHeaderOut->mVersion = ENTITY_POSE_LIST_VERSION;
+    if ( !mpImpl->mbInitialised )
+    {
+        return true;
+    }
+    
+    // Take a copy of the whole snapshot so that all the poses come from
+    // the same frame
+    EntityStateTable states;
+    U32 frameIdx = mpImpl->mEntityStates.CopyFrontBuffer( &states );
+    U32 numEntities = states.GetNumEntities();
+    
+    pRecordsOut->reserve( numEntities );
+    for ( U32 entityIdx = 0; entityIdx < numEntities; entityIdx++ )
+    {
+        Entity::eType type = (Entity::eType)mpImpl->mEntityTypes[ entityIdx ];
+        if ( NULL != typeName && type != typeFilter )
+        {
+            continue;
+        }
+        
+        EntityPoseRecord record;
+        memset( &record, 0, sizeof( record ) );
+        strncpy( record.mName, mpImpl->mEntityList[ entityIdx ]->GetName(), 
+                 ENTITY_POSE_LIST_NAME_LENGTH - 1 );
+        strncpy( record.mTypeName, Entity::ConvertTypeToString( type ),
+                 ENTITY_POSE_LIST_NAME_LENGTH - 1 );
+        
+        const Vector& position = states.mPositions[ entityIdx ];
+        const Vector& rotation = states.mRotations[ entityIdx ];
+        record.mPosition[ 0 ] = position.mX;
+        record.mPosition[ 1 ] = position.mY;
+        record.mPosition[ 2 ] = position.mZ;
+        record.mRotation[ 0 ] = rotation.mX;
+        record.mRotation[ 1 ] = rotation.mY;
+        record.mRotation[ 2 ] = rotation.mZ;
+        pRecordsOut->push_back( record );
+    }
+    
+    pHeaderOut->mNumEntities = pRecordsOut->size();
+    pHeaderOut->mFrameIdx = frameIdx;
+    pHeaderOut->mSimTime = (double)frameIdx / (double)SIM_DESIRED_SIM_FPS;
+    return true;
+}
 
 //--------------------------------------------------------------------------
 double Simulator::GetSimTime() const
 {
-    return HighPrecisionTime::ConvertToSeconds( 
-        HighPrecisionTime::GetDiff( 
-            mpImpl->mLastTime, mpImpl->mSimulatorStartTime ) );
+    // Use the time of the latest snapshot so that it matches the poses
+    // returned by GetEntityPose
+    return (double)mpImpl->mEntityStates.GetFrameIdx() / (double)SIM_DESIRED_SIM_FPS;
+}
+
+//--------------------------------------------------------------------------
+U32 Simulator::GetSimFrameIdx() const
+{
+    return mpImpl->mEntityStates.GetFrameIdx();
+}
+
+//--------------------------------------------------------------------------
+double Simulator::CastSubSonarBeams( const F32* pBeamAngles, U32 numBeams,
+                                     F32 range, U32 numBins, F32 gain, U8* pBinsOut )
+{
+    if ( !mpImpl->mbInitialised )
+    {
+        memset( pBinsOut, 0, numBeams*numBins );
+        return 0.0;
+    }
+    
+    pthread_mutex_lock( &mpImpl->mSonarMutex );
+    
+    // Only hold the simulation still for long enough to copy the poses that
+    // the beams are cast from and against
+    pthread_mutex_lock( &mpImpl->mSimMutex );
+    Vector subPos = mpImpl->mpSub->GetPosition();
+    Vector subRotation = mpImpl->mpSub->GetRotation();
+    mpImpl->mSonarModel.UpdateTargetTransforms();
+    double simTime = (double)mpImpl->mNumSimFrames / (double)SIM_DESIRED_SIM_FPS;
+    pthread_mutex_unlock( &mpImpl->mSimMutex );
+    
+    mpImpl->mSonarModel.CastBeams( subPos, subRotation,
+        pBeamAngles, numBeams, range, numBins, gain, pBinsOut );
+    
+    pthread_mutex_unlock( &mpImpl->mSonarMutex );
+    
+    return simTime;
 }
 
 //--------------------------------------------------------------------------
@@ -506,95 +1824,126 @@ void Simulator::GetSubCameraImageDimensions( U32* pWidthOut, U32* pHeightOut ) c
     
     if ( mpImpl->mbInitialised )
     {
-        irr::video::ITexture* pSubCameraRenderTarget = mpImpl->mpSub->GetCameraRenderTarget();
-        if ( NULL != pSubCameraRenderTarget )
-        {                        
-            irr::core::dimension2d<U32> imageSize =
-                pSubCameraRenderTarget->getSize();
-            
-            *pWidthOut = imageSize.Width;
-            *pHeightOut = imageSize.Height;
-        }
+        *pWidthOut = mpImpl->mSubCameraWidth;
+        *pHeightOut = mpImpl->mSubCameraHeight;
     }
 }
     
 //--------------------------------------------------------------------------
-void Simulator::GetSubCameraImage( U8* pBufferInOut, U32 bufferSize ) const
+void Simulator::GetSubCameraImage( U8* pBufferInOut, U32 bufferSize, 
+                                   double* pTimestampOut ) const
 {
     if ( mpImpl->mbInitialised )
     {
-        irr::video::ITexture* pSubCameraRenderTarget = mpImpl->mpSub->GetCameraRenderTarget();
-        if ( NULL != pSubCameraRenderTarget )
+        pthread_mutex_lock( &mpImpl->mCameraMutex );
+        
+        U32 requiredBufferSize = mpImpl->mCameraImage.size();
+        if ( bufferSize < requiredBufferSize )
         {
-            irr::core::dimension2d<U32> imageSize =
-                pSubCameraRenderTarget->getSize();
-                
-            U32 requiredBufferSize = imageSize.Width*imageSize.Height*3;
-            if ( bufferSize < requiredBufferSize )
-            {
-                fprintf( stderr, "Warning: Supplied buffer is too small\n ");
-                return;
-            }
-            
-            U8* pImageData = (U8*)pSubCameraRenderTarget->lock( true );
-            if ( NULL == pImageData )
-            {
-                fprintf( stderr, "Warning: Unable to lock camera texture for reading\n ");
-                return;
-            }
-            
-            U32 imagePitch = pSubCameraRenderTarget->getPitch();
-            switch ( pSubCameraRenderTarget->getColorFormat() )
+            fprintf( stderr, "Warning: Supplied buffer is too small\n ");
+        }
+        else if ( requiredBufferSize > 0 )
+        {
+            memcpy( pBufferInOut, &mpImpl->mCameraImage[ 0 ], requiredBufferSize );
+        }
+        
+        if ( NULL != pTimestampOut )
+        {
+            *pTimestampOut = mpImpl->mCameraImageTimestamp;
+        }
+        
+        pthread_mutex_unlock( &mpImpl->mCameraMutex );
+    }
+}
+
+//--------------------------------------------------------------------------
+// Converts an image from the render target into packed RGB888. The source
+// pitch can be negative if the rows are stored bottom first
+static bool ConvertCameraImageToRGB( const U8* pImageData, S32 imagePitch,
+    irr::video::ECOLOR_FORMAT colourFormat, U32 width, U32 height, U8* pBufferInOut )
+{
+    switch ( colourFormat )
+    {
+        case irr::video::ECF_A1R5G5B5:
+        {
+            PixelFormatConversion::A1R5G5B5ToRGB888( pImageData, imagePitch, 
+                width, height, pBufferInOut, 3*width );
+            return true;
+        }
+        case irr::video::ECF_A8R8G8B8:
+        {
+            PixelFormatConversion::ARGB8888ToRGB888( pImageData, imagePitch, 
+                width, height, pBufferInOut, 3*width );
+            return true;
+        }
+        default:
+        {
+            fprintf( stderr, "Warning: Unhandled colour format for camera texture, 0x%X\n",
+                     colourFormat );
+            return false;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+void Simulator::ReadBackSubCameraImage()
+{
+    PROFILE_SCOPE( "CameraReadback" );
+    irr::video::ITexture* pSubCameraRenderTarget = mpImpl->mpSub->GetCameraRenderTarget();
+    if ( NULL == pSubCameraRenderTarget )
+    {
+        return;
+    }
+    
+    irr::core::dimension2d<U32> imageSize = pSubCameraRenderTarget->getSize();
+    
+    if ( mpImpl->mCameraReadback.IsInitialised() )
+    {
+        // Pick up the read queued last frame. This only waits if the card
+        // is more than a frame behind
+        S32 imagePitch = 0;
+        double timestamp = 0.0;
+        const U8* pImageData = mpImpl->mCameraReadback.MapCompletedRead( &imagePitch, &timestamp );
+        if ( NULL != pImageData )
+        {
+            pthread_mutex_lock( &mpImpl->mCameraMutex );
+            if ( ConvertCameraImageToRGB( pImageData, imagePitch, irr::video::ECF_A8R8G8B8, 
+                imageSize.Width, imageSize.Height, &mpImpl->mCameraImage[ 0 ] ) )
             {
-                case irr::video::ECF_A1R5G5B5:
-                {
-                    for ( U32 rowIdx = 0; rowIdx < imageSize.Height; rowIdx++ )
-                    {
-                        U16* pSrcPixel = (U16*)(pImageData + imagePitch*rowIdx);
-                        U8* pDstPixel = pBufferInOut + 3*imageSize.Width*rowIdx;
-                        U8* pLastPixel = pDstPixel + 3*imageSize.Width;
-                        
-                        while ( pDstPixel < pLastPixel )
-                        {
-                            *pDstPixel++ = (U8)( ( *pSrcPixel & 0x00007C00 ) >> 10 ); // R
-                            *pDstPixel++ = (U8)( ( *pSrcPixel & 0x000003E0 ) >> 5 );  // G
-                            *pDstPixel++ = (U8)( ( *pSrcPixel & 0x0000001F ) );       // B
-                            pSrcPixel++;
-                        }
-                    }
-                    
-                    break;
-                }
-                case irr::video::ECF_A8R8G8B8:
-                {
-                    for ( U32 rowIdx = 0; rowIdx < imageSize.Height; rowIdx++ )
-                    {
-                        U32* pSrcPixel = (U32*)(pImageData + imagePitch*rowIdx);
-                        U8* pDstPixel = pBufferInOut + 3*imageSize.Width*rowIdx;
-                        U8* pLastPixel = pDstPixel + 3*imageSize.Width;
-                        
-                        while ( pDstPixel < pLastPixel )
-                        {
-                            irr::video::SColor sourceColour( *pSrcPixel );
-                            
-                            //U8* pSrcPixelData = (U8*)pSrcPixel;
-                            *pDstPixel++ = sourceColour.getRed(); // pSrcPixelData[ 1 ]; // R
-                            *pDstPixel++ = sourceColour.getGreen(); // pSrcPixelData[ 2 ]; // G
-                            *pDstPixel++ = sourceColour.getBlue(); // pSrcPixelData[ 3 ]; // B
-                            pSrcPixel++;
-                        }
-                    }
-                    
-                    break;
-                }
-                default:
-                {
-                    fprintf( stderr, "Warning: Unhandled colour format for camera texture, 0x%X\n",
-                             pSubCameraRenderTarget->getColorFormat() );
-                }
+                mpImpl->mCameraImageTimestamp = timestamp;
             }
+            pthread_mutex_unlock( &mpImpl->mCameraMutex );
             
-            pSubCameraRenderTarget->unlock();
+            mpImpl->mCameraReadback.UnmapCompletedRead();
         }
     }
-}
\ No newline at end of file
+    else
+    {
+        // Fall back to reading the render target directly. For the software 
+        // drivers this is just a pointer to the image in memory
+        U8* pImageData = (U8*)pSubCameraRenderTarget->lock( true );
+        if ( NULL == pImageData )
+        {
+            fprintf( stderr, "Warning: Unable to lock camera texture for reading\n ");
+            return;
+        }
+        
+        pthread_mutex_lock( &mpImpl->mCameraMutex );
+        if ( ConvertCameraImageToRGB( pImageData, (S32)pSubCameraRenderTarget->getPitch(),
+            pSubCameraRenderTarget->getColorFormat(), 
+            imageSize.Width, imageSize.Height, &mpImpl->mCameraImage[ 0 ] ) )
+        {
+            mpImpl->mCameraImageTimestamp = 
+                (double)mpImpl->mLastRenderedFrameIdx / (double)SIM_DESIRED_SIM_FPS;
+        }
+        pthread_mutex_unlock( &mpImpl->mCameraMutex );
+        
+        pSubCameraRenderTarget->unlock();
+    }
+}
+
+//--------------------------------------------------------------------------
+void Simulator::SetSubCameraActive( bool bActive )
+{
+    mpImpl->mbSubCameraActive = bActive;
+}
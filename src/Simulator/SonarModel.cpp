@@ -0,0 +1,226 @@
+//------------------------------------------------------------------------------
+// File: SonarModel.cpp
+// Desc: Models a mechanically scanned sonar, such as the Tritech Micron, by
+//       ray casting each beam against the collision shapes of the entities
+//       in the world. Beams are cast in parallel on a thread pool.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include "SonarModel.h"
+
+#include <math.h>
+#include <string.h>
+#include "Common/MathUtils.h"
+#include "Entities/Entity.h"
+
+#include <btBulletDynamicsCommon.h>
+
+//------------------------------------------------------------------------------
+// The beam is narrow horizontally and wide vertically. It's sampled with a
+// fan of rays spread across its vertical width
+static const F32 SM_VERTICAL_BEAM_WIDTH = MathUtils::DegToRad( 35.0f );
+static const U32 SM_NUM_RAYS_PER_BEAM = 7;
+
+// A gain of 1 saturates a bin when every ray in a beam hits a surface face on
+static const F32 SM_MAX_BIN_VALUE = 255.0f;
+
+// Number of rays given to a worker thread at a time
+static const U32 SM_RAYS_PER_CHUNK = 4;
+
+//------------------------------------------------------------------------------
+SonarModel::SonarModel()
+{
+}
+
+//------------------------------------------------------------------------------
+SonarModel::~SonarModel()
+{
+    DeInit();
+}
+
+//------------------------------------------------------------------------------
+bool SonarModel::Init( S32 numWorkerThreads )
+{
+    return mThreadPool.Init( numWorkerThreads );
+}
+
+//------------------------------------------------------------------------------
+void SonarModel::DeInit()
+{
+    mThreadPool.DeInit();
+    ClearTargets();
+}
+
+//------------------------------------------------------------------------------
+void SonarModel::AddStaticEntity( Entity* pEntity )
+{
+    btTriangleMesh* pTriangleMesh = new btTriangleMesh();
+    if ( 0 == pEntity->AddMeshTriangles( pTriangleMesh ) )
+    {
+        // Nothing for the sonar to see
+        delete pTriangleMesh;
+        return;
+    }
+
+    // The triangles are already in world coordinates
+    Target target;
+    target.mpOwnedTriangleMesh = pTriangleMesh;
+    target.mpOwnedShape = new btBvhTriangleMeshShape( pTriangleMesh, true );
+    target.mpObject = new btCollisionObject();
+    target.mpObject->setCollisionShape( target.mpOwnedShape );
+
+    btTransform identity;
+    identity.setIdentity();
+    target.mpObject->setWorldTransform( identity );
+
+    mTargets.push_back( target );
+    mTargetTransforms.push_back( identity );
+}
+
+//------------------------------------------------------------------------------
+void SonarModel::AddPhysicsObject( btCollisionObject* pObject )
+{
+    Target target;
+    target.mpObject = pObject;
+    target.mpOwnedShape = NULL;
+    target.mpOwnedTriangleMesh = NULL;
+
+    mTargets.push_back( target );
+    mTargetTransforms.push_back( pObject->getWorldTransform() );
+}
+
+//------------------------------------------------------------------------------
+void SonarModel::UpdateTargetTransforms()
+{
+    for ( U32 targetIdx = 0; targetIdx < mTargets.size(); targetIdx++ )
+    {
+        // The static meshes never move
+        const Target& target = mTargets[ targetIdx ];
+        if ( NULL == target.mpOwnedShape )
+        {
+            mTargetTransforms[ targetIdx ] = target.mpObject->getWorldTransform();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void SonarModel::ClearTargets()
+{
+    for ( U32 targetIdx = 0; targetIdx < mTargets.size(); targetIdx++ )
+    {
+        Target& target = mTargets[ targetIdx ];
+        if ( NULL != target.mpOwnedShape )
+        {
+            delete target.mpObject;
+            delete target.mpOwnedShape;
+            delete target.mpOwnedTriangleMesh;
+        }
+    }
+    mTargets.clear();
+    mTargetTransforms.clear();
+}
+
+//------------------------------------------------------------------------------
+void SonarModel::CastBeams( const Vector& headPos, const Vector& headRotation,
+                            const F32* pBeamAngles, U32 numBeams,
+                            F32 range, U32 numBins, F32 gain, U8* pBinsOut )
+{
+    memset( pBinsOut, 0, numBeams*numBins );
+    if ( 0 == numBeams || 0 == numBins || range <= 0.0f || mTargets.empty() )
+    {
+        return;
+    }
+
+    CastBeamsTask task;
+    task.mpModel = this;
+    task.mHeadPos = headPos;
+    task.mHeadRotation = headRotation;
+    task.mpBeamAngles = pBeamAngles;
+    task.mRange = range;
+    task.mNumBins = numBins;
+
+    // Only a couple of beams may be cast at a time so the work is split up
+    // by ray rather than by beam
+    U32 numRays = numBeams*SM_NUM_RAYS_PER_BEAM;
+    if ( mRayReturns.size() < numRays )
+    {
+        mRayReturns.resize( numRays );
+    }
+    task.mpRayReturnsOut = &mRayReturns[ 0 ];
+
+    if ( mThreadPool.IsInitialised() )
+    {
+        mThreadPool.ParallelFor( numRays, CastRaysTaskFunction, &task, SM_RAYS_PER_CHUNK );
+    }
+    else
+    {
+        CastRaysTaskFunction( &task, 0, numRays );
+    }
+
+    // Add the returns to the bins
+    F32 rayScale = SM_MAX_BIN_VALUE*gain / (F32)SM_NUM_RAYS_PER_BEAM;
+    for ( U32 rayIdx = 0; rayIdx < numRays; rayIdx++ )
+    {
+        const RayReturn& rayReturn = mRayReturns[ rayIdx ];
+        if ( rayReturn.mBinIdx < numBins )
+        {
+            U8* pBin = &pBinsOut[ ( rayIdx/SM_NUM_RAYS_PER_BEAM )*numBins + rayReturn.mBinIdx ];
+            U32 binValue = *pBin + (U32)( rayScale*rayReturn.mStrength + 0.5f );
+            *pBin = (U8)( binValue > 255 ? 255 : binValue );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void SonarModel::CastRaysTaskFunction( void* pTask, U32 startIdx, U32 endIdx )
+{
+    const CastBeamsTask* pCastBeamsTask = (const CastBeamsTask*)pTask;
+    for ( U32 rayIdx = startIdx; rayIdx < endIdx; rayIdx++ )
+    {
+        pCastBeamsTask->mpModel->CastRay( *pCastBeamsTask, rayIdx,
+                                          &pCastBeamsTask->mpRayReturnsOut[ rayIdx ] );
+    }
+}
+
+//------------------------------------------------------------------------------
+void SonarModel::CastRay( const CastBeamsTask& task, U32 rayIdx, RayReturn* pReturnOut ) const
+{
+    U32 beamIdx = rayIdx / SM_NUM_RAYS_PER_BEAM;
+    U32 beamRayIdx = rayIdx % SM_NUM_RAYS_PER_BEAM;
+
+    // Spread the rays evenly across the vertical width of the beam
+    F32 heading = task.mHeadRotation.mZ + task.mpBeamAngles[ beamIdx ];
+    F32 elevation = task.mHeadRotation.mX
+        + SM_VERTICAL_BEAM_WIDTH*( ( beamRayIdx + 0.5f )/(F32)SM_NUM_RAYS_PER_BEAM - 0.5f );
+    F32 cosElevation = cosf( elevation );
+    btVector3 rayDir( -sinf( heading )*cosElevation, cosf( heading )*cosElevation, sinf( elevation ) );
+
+    btTransform rayFromTransform;
+    rayFromTransform.setIdentity();
+    rayFromTransform.setOrigin( btVector3( task.mHeadPos.mX, task.mHeadPos.mY, task.mHeadPos.mZ ) );
+    btTransform rayToTransform;
+    rayToTransform.setIdentity();
+    rayToTransform.setOrigin( rayFromTransform.getOrigin() + rayDir*task.mRange );
+
+    // The callback only accepts hits closer than the closest one so far
+    // so it can be shared by all of the targets
+    btCollisionWorld::ClosestRayResultCallback rayCallback(
+        rayFromTransform.getOrigin(), rayToTransform.getOrigin() );
+    for ( U32 targetIdx = 0; targetIdx < mTargets.size(); targetIdx++ )
+    {
+        btCollisionObject* pObject = mTargets[ targetIdx ].mpObject;
+        btCollisionWorld::rayTestSingle( rayFromTransform, rayToTransform, pObject,
+            pObject->getCollisionShape(), mTargetTransforms[ targetIdx ], rayCallback );
+    }
+
+    pReturnOut->mBinIdx = task.mNumBins;
+    pReturnOut->mStrength = 0.0f;
+    if ( rayCallback.hasHit() )
+    {
+        U32 binIdx = (U32)( rayCallback.m_closestHitFraction*task.mNumBins );
+        pReturnOut->mBinIdx = ( binIdx < task.mNumBins ? binIdx : task.mNumBins - 1 );
+
+        // Surfaces facing the sonar head return the most energy
+        pReturnOut->mStrength = fabsf( rayDir.dot( rayCallback.m_hitNormalWorld.normalized() ) );
+    }
+}
@@ -0,0 +1,111 @@
+//------------------------------------------------------------------------------
+// File: SonarModel.h
+// Desc: Models a mechanically scanned sonar, such as the Tritech Micron, by
+//       ray casting each beam against the collision shapes of the entities
+//       in the world. Beams are cast in parallel on a thread pool.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#ifndef SONAR_MODEL_H
+#define SONAR_MODEL_H
+
+//------------------------------------------------------------------------------
+#include <vector>
+#include "Common.h"
+#include "Vector.h"
+#include "Common/ThreadPool.h"
+
+#include <btBulletDynamicsCommon.h>
+
+//------------------------------------------------------------------------------
+// Forward declarations
+class Entity;
+
+//------------------------------------------------------------------------------
+class SonarModel
+{
+    //--------------------------------------------------------------------------
+    public: SonarModel();
+    public: ~SonarModel();
+
+    //--------------------------------------------------------------------------
+    public: bool Init( S32 numWorkerThreads = -1 );
+    public: void DeInit();
+
+    //--------------------------------------------------------------------------
+    //! Adds an entity that doesn't move. A collision mesh is built from the
+    //! meshes of the entity so this must be called from the thread that owns
+    //! the scene manager
+    public: void AddStaticEntity( Entity* pEntity );
+
+    //--------------------------------------------------------------------------
+    //! Adds an object from the physics world. Beams are cast against the
+    //! transform that the object had when UpdateTargetTransforms was last
+    //! called
+    public: void AddPhysicsObject( btCollisionObject* pObject );
+
+    //--------------------------------------------------------------------------
+    //! Copies the current transforms of the physics objects. This must be
+    //! called whilst the physics world is held still, but the beams can then
+    //! be cast whilst the world carries on changing
+    public: void UpdateTargetTransforms();
+
+    //--------------------------------------------------------------------------
+    public: void ClearTargets();
+    public: U32 GetNumTargets() const { return mTargets.size(); }
+
+    //--------------------------------------------------------------------------
+    //! Casts beams out from a sonar head at the given position and rotation
+    //! (in SubSim coordinates). Beam angles are in radians, anticlockwise
+    //! from the heading of the sonar head. The returns of each beam are
+    //! binned into numBins bins covering range metres and written to
+    //! pBinsOut, which must hold numBeams*numBins bytes. Only one thread
+    //! should cast beams at a time
+    public: void CastBeams( const Vector& headPos, const Vector& headRotation,
+                            const F32* pBeamAngles, U32 numBeams,
+                            F32 range, U32 numBins, F32 gain, U8* pBinsOut );
+
+    //--------------------------------------------------------------------------
+    private: struct Target
+    {
+        btCollisionObject* mpObject;
+        btCollisionShape* mpOwnedShape;         // NULL unless we created the object
+        btTriangleMesh* mpOwnedTriangleMesh;
+    };
+
+    // Where a ray hit and how much energy came back. mBinIdx is set to the
+    // number of bins if the ray didn't hit anything
+    private: struct RayReturn
+    {
+        U32 mBinIdx;
+        F32 mStrength;
+    };
+
+    private: struct CastBeamsTask
+    {
+        const SonarModel* mpModel;
+        Vector mHeadPos;
+        Vector mHeadRotation;
+        const F32* mpBeamAngles;
+        F32 mRange;
+        U32 mNumBins;
+        RayReturn* mpRayReturnsOut;
+    };
+
+    //--------------------------------------------------------------------------
+    // The rays are cast in parallel and then added to the bins afterwards so 
+    // that the threads don't have to share any bins
+    private: static void CastRaysTaskFunction( void* pTask, U32 startIdx, U32 endIdx );
+    private: void CastRay( const CastBeamsTask& task, U32 rayIdx, RayReturn* pReturnOut ) const;
+
+    //--------------------------------------------------------------------------
+    // Members
+    private: std::vector<Target> mTargets;
+    // The transform of each target used to cast the beams. Kept apart from
+    // the targets as Bullet's maths types may need to be aligned
+    private: btAlignedObjectArray<btTransform> mTargetTransforms;
+    private: ThreadPool mThreadPool;
+    private: std::vector<RayReturn> mRayReturns;
+};
+
+#endif // SONAR_MODEL_H
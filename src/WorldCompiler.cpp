@@ -0,0 +1,82 @@
+//------------------------------------------------------------------------------
+// subsim-worldc: Compiles an XML world file into a compiled world file that
+// the simulator can load without parsing any XML
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "Common/CommandLineParser.h"
+#include "Entities/XmlEntityParser.h"
+#include "Entities/CompiledWorld.h"
+
+//------------------------------------------------------------------------------
+void ShowUsage( const char* programName );
+
+//------------------------------------------------------------------------------
+int main( int argc, const char** argv )
+{
+    CommandLineParser commandLineParser;
+    commandLineParser.ParseCommandLine( argc, argv );
+    if ( commandLineParser.IsArgSet( "h" ) )
+    {
+        ShowUsage( argv[ 0 ] );
+        return 0;
+    }
+
+    const char* worldFilename = commandLineParser.GetArgValue( "world" );
+    if ( NULL == worldFilename )
+    {
+        fprintf( stderr, "Error: No world file given\n" );
+        ShowUsage( argv[ 0 ] );
+        return -1;
+    }
+
+    std::string outputFilename;
+    const char* outputFilenameArg = commandLineParser.GetArgValue( "out" );
+    if ( NULL != outputFilenameArg )
+    {
+        outputFilename = outputFilenameArg;
+    }
+    else
+    {
+        outputFilename = CompiledWorld::GetCompiledFilename( worldFilename );
+    }
+
+    if ( outputFilename == worldFilename )
+    {
+        fprintf( stderr, "Error: The compiled world would overwrite %s\n", worldFilename );
+        return -1;
+    }
+
+    std::vector<EntityDesc> entityDescs;
+    bool bValidate = commandLineParser.IsArgSet( "validate" );
+    if ( !XmlEntityParser::ReadEntityDescsFromXMLWorldFile( worldFilename, &entityDescs, bValidate ) )
+    {
+        fprintf( stderr, "Error: Unable to read %s\n", worldFilename );
+        return -1;
+    }
+
+    if ( !CompiledWorld::WriteCompiledWorldFile( outputFilename.c_str(), worldFilename, entityDescs ) )
+    {
+        return -1;
+    }
+
+    printf( "Compiled %u entities into %s\n", (U32)entityDescs.size(), outputFilename.c_str() );
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+void ShowUsage( const char* programName )
+{
+    printf( "\n" );
+    printf( "Usage:\n" );
+    printf( "%s -world=WORLD_FILE [Options]\n", programName );
+    printf( "\t-h\t\t\tShow this message\n" );
+    printf( "\t-world=WORLD_FILE\tThe XML world file to compile\n" );
+    printf( "\t-out=FILE\t\tWrite the compiled world to FILE. By default it's written\n" );
+    printf( "\t\t\t\tnext to WORLD_FILE with the extension %s, which is\n", CompiledWorld::FILE_EXTENSION );
+    printf( "\t\t\t\twhere subsim looks for it\n" );
+    printf( "\t-validate\t\tCheck WORLD_FILE against the DTD or schema that it names\n" );
+    printf( "\n" );
+}
@@ -2,39 +2,191 @@
 // A simple simulator for the UWE group project
 //------------------------------------------------------------------------------
 #include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <vector>
 
 #include "Simulator/Simulator.h"
 #include "Common/CommandLineParser.h"
+#include "Common/HighPrecisionTime.h"
+#include "Common/Profiler.h"
+
+//------------------------------------------------------------------------------
+// The settings and results for one of the worlds run with -instances
+struct InstanceRun
+{
+    S32 mInstanceIdx;
+    const char* mWorldFilename;
+    S32 mMaxPhysicsSubSteps;    // Negative to use the simulator default
+    double mSimSeconds;
+
+    pthread_t mThread;
+    bool mbThreadStarted;
+    bool mbSucceeded;
+    U32 mNumFrames;
+    double mSimTime;
+};
 
 //------------------------------------------------------------------------------
 void ShowUsage( const char* programName );
+void* RunInstance( void* pInstanceRun );
 
 //------------------------------------------------------------------------------
 int main( int argc, const char** argv )
-{   
-    CommandLineParser::ParseCommandLine( argc, argv );
-    if ( CommandLineParser::IsArgSet( "h" ) )
+{
+    CommandLineParser commandLineParser;
+    commandLineParser.ParseCommandLine( argc, argv );
+    if ( commandLineParser.IsArgSet( "h" ) )
     {
         ShowUsage( argv[ 0 ] );
         return 0;
     }
-    
+
+    // The profile is written out when the simulation finishes
+    const char* profileFilename = commandLineParser.GetArgValue( "profile" );
+    if ( NULL != profileFilename )
+    {
+        Profiler::SetThreadName( "Main" );
+        Profiler::Start( profileFilename );
+    }
+
+    const char* worldFilename = commandLineParser.GetArgValue( "world" );
+    const char* maxPhysicsSubStepsString = commandLineParser.GetArgValue( "maxPhysicsSubSteps" );
+    const char* runForString = commandLineParser.GetArgValue( "runFor" );
+
+    const char* numInstancesString = commandLineParser.GetArgValue( "instances" );
+    if ( NULL != numInstancesString )
+    {
+        // Run several copies of the world at once, each headless and on its
+        // own thread. Each simulator has its own renderer and physics world
+        // so nothing is shared between them
+        S32 numInstances = atoi( numInstancesString );
+        if ( numInstances <= 0 || NULL == runForString )
+        {
+            fprintf( stderr, "Error: -instances needs a positive number of "
+                "instances and a time to run for with -runFor\n" );
+            return -1;
+        }
+
+        std::vector<InstanceRun> instanceRuns( numInstances );
+        HighPrecisionTime startTime = HighPrecisionTime::GetTime();
+        for ( S32 instanceIdx = 0; instanceIdx < numInstances; instanceIdx++ )
+        {
+            InstanceRun* pRun = &instanceRuns[ instanceIdx ];
+            pRun->mInstanceIdx = instanceIdx;
+            pRun->mWorldFilename = worldFilename;
+            pRun->mMaxPhysicsSubSteps = ( NULL != maxPhysicsSubStepsString ?
+                atoi( maxPhysicsSubStepsString ) : -1 );
+            pRun->mSimSeconds = atof( runForString );
+            pRun->mbSucceeded = false;
+            pRun->mNumFrames = 0;
+            pRun->mSimTime = 0.0;
+            pRun->mbThreadStarted =
+                ( 0 == pthread_create( &pRun->mThread, NULL, RunInstance, pRun ) );
+            if ( !pRun->mbThreadStarted )
+            {
+                fprintf( stderr, "Error: Unable to start a thread for instance %i\n", instanceIdx );
+            }
+        }
+
+        S32 numFailedInstances = 0;
+        for ( S32 instanceIdx = 0; instanceIdx < numInstances; instanceIdx++ )
+        {
+            InstanceRun* pRun = &instanceRuns[ instanceIdx ];
+            if ( pRun->mbThreadStarted )
+            {
+                pthread_join( pRun->mThread, NULL );
+            }
+
+            if ( pRun->mbSucceeded )
+            {
+                printf( "Instance %i: Simulated %u frames (%.2f s)\n",
+                        instanceIdx, pRun->mNumFrames, pRun->mSimTime );
+            }
+            else
+            {
+                numFailedInstances++;
+            }
+        }
+
+        double wallSeconds = HighPrecisionTime::ConvertToSeconds(
+            HighPrecisionTime::GetDiff( HighPrecisionTime::GetTime(), startTime ) );
+        printf( "Ran %i instances in %.3f s\n", numInstances, wallSeconds );
+        Profiler::Stop();
+
+        return ( 0 == numFailedInstances ? 0 : -1 );
+    }
+
     Simulator sim;
-    
-    if ( !sim.Init( CommandLineParser::GetArgValue( "world" ) ) )
+
+    bool bHeadless = commandLineParser.IsArgSet( "headless" );
+    if ( !sim.Init( worldFilename, bHeadless ) )
     {
         fprintf( stderr, "Error: Unable to initialise simulator\n" );
         return -1;
     }
-    
+
+    if ( NULL != maxPhysicsSubStepsString )
+    {
+        sim.SetMaxPhysicsSubSteps( atoi( maxPhysicsSubStepsString ) );
+    }
+
+    if ( NULL != runForString )
+    {
+        // Run a fixed amount of simulation time as quickly as possible
+        // and then quit
+        double simSeconds = atof( runForString );
+
+        HighPrecisionTime startTime = HighPrecisionTime::GetTime();
+        sim.SetLockstepEnabled( true );
+        U32 numFrames = sim.RunFor( simSeconds );
+        double wallSeconds = HighPrecisionTime::ConvertToSeconds(
+            HighPrecisionTime::GetDiff( HighPrecisionTime::GetTime(), startTime ) );
+
+        printf( "Simulated %u frames (%.2f s) in %.3f s\n",
+                numFrames, sim.GetSimTime(), wallSeconds );
+        Profiler::Stop();
+        return 0;
+    }
+
     while ( sim.IsRunning() )
     {
         sim.Update();
     }
 
+    Profiler::Stop();
     return 0;
 }
 
+//------------------------------------------------------------------------------
+void* RunInstance( void* pInstanceRun )
+{
+    InstanceRun* pRun = (InstanceRun*)pInstanceRun;
+
+    char threadName[ 32 ];
+    snprintf( threadName, sizeof( threadName ), "Instance %i", pRun->mInstanceIdx );
+    Profiler::SetThreadName( threadName );
+
+    Simulator sim;
+    if ( !sim.Init( pRun->mWorldFilename, true ) )
+    {
+        fprintf( stderr, "Error: Unable to initialise simulator\n" );
+        return NULL;
+    }
+
+    if ( pRun->mMaxPhysicsSubSteps >= 0 )
+    {
+        sim.SetMaxPhysicsSubSteps( pRun->mMaxPhysicsSubSteps );
+    }
+
+    sim.SetLockstepEnabled( true );
+    pRun->mNumFrames = sim.RunFor( pRun->mSimSeconds );
+    pRun->mSimTime = sim.GetSimTime();
+    pRun->mbSucceeded = true;
+
+    return NULL;
+}
+
 //------------------------------------------------------------------------------
 void ShowUsage( const char* programName )
 {
@@ -42,6 +194,15 @@ void ShowUsage( const char* programName )
     printf( "Usage:\n" );
     printf( "%s [Options]\n", programName );
     printf( "\t-h\t\t\tShow this message\n" );
-    printf( "\t-world=WORLD_FILE\tLoad world from world file\n" );
+    printf( "\t-world=WORLD_FILE\tLoad world from world file. If there's an up to date compiled\n" );
+    printf( "\t\t\t\tversion of the world from subsim-worldc then that's used instead\n" );
+    printf( "\t-headless\t\tRun without a window using the software renderer\n" );
+    printf( "\t-runFor=SECONDS\t\tSimulate SECONDS of time as fast as possible then quit\n" );
+    printf( "\t-maxPhysicsSubSteps=N\tLimit the physics to N sub steps per update when\n" );
+    printf( "\t\t\t\tcatching up with the clock. A frame takes 2\n" );
+    printf( "\t-instances=N\t\tRun N headless copies of the world on their own threads.\n" );
+    printf( "\t\t\t\tNeeds -runFor\n" );
+    printf( "\t-profile=FILE\t\tTime each part of a frame and write the timings to FILE as\n" );
+    printf( "\t\t\t\tChrome trace JSON, or as collapsed stacks if FILE ends in .folded\n" );
     printf( "\n" );
-}
\ No newline at end of file
+}
@@ -24,15 +24,35 @@ class CommandLineParserTests : public CxxTest::TestSuite
             "-dog="
         };
         
-        CommandLineParser::ParseCommandLine( 4, argc );
+        CommandLineParser parser;
+        parser.ParseCommandLine( 4, argc );
         
-        TS_ASSERT( CommandLineParser::IsArgSet( "bunny" ) );
-        TS_ASSERT( CommandLineParser::IsArgSet( "buNnY" ) );
-        TS_ASSERT( CommandLineParser::IsArgSet( "frog" ) );
-        TS_ASSERT( CommandLineParser::IsArgSet( "toad" ) == false );
+        TS_ASSERT( parser.IsArgSet( "bunny" ) );
+        TS_ASSERT( parser.IsArgSet( "buNnY" ) );
+        TS_ASSERT( parser.IsArgSet( "frog" ) );
+        TS_ASSERT( parser.IsArgSet( "toad" ) == false );
         
-        TS_ASSERT( Utils::stricmp( CommandLineParser::GetArgValue( "bunny" ), "rabbit" ) == 0 );
-        TS_ASSERT( CommandLineParser::GetArgValue( "frog" ) == NULL );
-        TS_ASSERT( CommandLineParser::GetArgValue( "dog" ) == NULL );
+        TS_ASSERT( Utils::stricmp( parser.GetArgValue( "bunny" ), "rabbit" ) == 0 );
+        TS_ASSERT( parser.GetArgValue( "frog" ) == NULL );
+        TS_ASSERT( parser.GetArgValue( "dog" ) == NULL );
     }
-};
\ No newline at end of file
+    
+    //--------------------------------------------------------------------------
+    public: void testParsersAreIndependent()
+    {
+        const char* firstArgs[] = { "programName", "-world=first.xml" };
+        const char* secondArgs[] = { "programName", "-headless" };
+        
+        CommandLineParser firstParser;
+        CommandLineParser secondParser;
+        firstParser.ParseCommandLine( 2, firstArgs );
+        secondParser.ParseCommandLine( 2, secondArgs );
+        
+        TS_ASSERT_EQUALS( firstParser.GetNumArgs(), 1 );
+        TS_ASSERT_EQUALS( secondParser.GetNumArgs(), 1 );
+        TS_ASSERT( firstParser.IsArgSet( "world" ) );
+        TS_ASSERT( !firstParser.IsArgSet( "headless" ) );
+        TS_ASSERT( secondParser.IsArgSet( "headless" ) );
+        TS_ASSERT( !secondParser.IsArgSet( "world" ) );
+    }
+};
@@ -0,0 +1,195 @@
+//------------------------------------------------------------------------------
+// File: CompiledWorldTests.h
+// Desc: Unit tests for compiled world files
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include <cxxtest/TestSuite.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include "Entities/CompiledWorld.h"
+
+//------------------------------------------------------------------------------
+class CompiledWorldTests : public CxxTest::TestSuite
+{
+    //--------------------------------------------------------------------------
+    public: void setUp()
+    {
+        snprintf( mSourceFilename, sizeof( mSourceFilename ), "/tmp/subsim_test_world_%i.xml", (S32)getpid() );
+        mCompiledFilename = CompiledWorld::GetCompiledFilename( mSourceFilename );
+        WriteSourceFile( "<world></world>" );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void tearDown()
+    {
+        unlink( mSourceFilename );
+        unlink( mCompiledFilename.c_str() );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testCompiledFilenames()
+    {
+        TS_ASSERT_EQUALS( CompiledWorld::GetCompiledFilename( "data/TestWorld.xml" ), "data/TestWorld.ssw" );
+        TS_ASSERT_EQUALS( CompiledWorld::GetCompiledFilename( "../worlds/World" ), "../worlds/World.ssw" );
+        TS_ASSERT( CompiledWorld::IsCompiledFilename( "data/TestWorld.ssw" ) );
+        TS_ASSERT( !CompiledWorld::IsCompiledFilename( "data/TestWorld.xml" ) );
+        TS_ASSERT( !CompiledWorld::IsCompiledFilename( "ssw" ) );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testWriteAndOpen()
+    {
+        std::vector<EntityDesc> entityDescs( 2 );
+        entityDescs[ 0 ].Reset();
+        entityDescs[ 0 ].mType = Entity::eT_Sub;
+        entityDescs[ 0 ].SetName( "Sub" );
+        entityDescs[ 0 ].mFloats[ EntityDesc::eF_Yaw ] = 45.0f;
+        entityDescs[ 0 ].mFloatsFound = ( 1 << EntityDesc::eF_Yaw );
+        SetPos( &entityDescs[ 0 ], 1.0f, 2.0f, -1.0f );
+
+        entityDescs[ 1 ].Reset();
+        entityDescs[ 1 ].mType = Entity::eT_Buoy;
+        SetPos( &entityDescs[ 1 ], 10.0f, -5.0f, -1.0f );
+
+        TS_ASSERT( CompiledWorld::WriteCompiledWorldFile(
+            mCompiledFilename.c_str(), mSourceFilename, entityDescs ) );
+
+        CompiledWorld compiledWorld;
+        TS_ASSERT( compiledWorld.Open( mCompiledFilename.c_str() ) );
+        TS_ASSERT_EQUALS( compiledWorld.GetNumEntities(), 2u );
+        TS_ASSERT_EQUALS( std::string( compiledWorld.GetSourceFilename() ), mSourceFilename );
+        TS_ASSERT( !compiledWorld.IsStale() );
+
+        const EntityDesc& sub = compiledWorld.GetEntityDesc( 0 );
+        TS_ASSERT_EQUALS( sub.mType, Entity::eT_Sub );
+        TS_ASSERT( sub.mbHasName );
+        TS_ASSERT_EQUALS( std::string( sub.mName ), "Sub" );
+
+        F32 yaw = 0.0f;
+        TS_ASSERT( sub.GetFloat( EntityDesc::eF_Yaw, &yaw ) );
+        TS_ASSERT_EQUALS( yaw, 45.0f );
+
+        const EntityDesc& buoy = compiledWorld.GetEntityDesc( 1 );
+        TS_ASSERT_EQUALS( buoy.mType, Entity::eT_Buoy );
+        TS_ASSERT( !buoy.mbHasName );
+
+        F32 radius = 0.0f;
+        TS_ASSERT( !buoy.GetFloat( EntityDesc::eF_Radius, &radius ) );
+
+        Vector pos;
+        TS_ASSERT( buoy.GetPos( &pos ) );
+        TS_ASSERT_EQUALS( pos.mX, 10.0f );
+        TS_ASSERT_EQUALS( pos.mY, -5.0f );
+        TS_ASSERT_EQUALS( pos.mZ, -1.0f );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testChangedSourceMakesWorldStale()
+    {
+        std::vector<EntityDesc> entityDescs;
+        TS_ASSERT( CompiledWorld::WriteCompiledWorldFile(
+            mCompiledFilename.c_str(), mSourceFilename, entityDescs ) );
+
+        WriteSourceFile( "<world><entity type=\"Buoy\"/></world>" );
+
+        CompiledWorld compiledWorld;
+        TS_ASSERT( compiledWorld.Open( mCompiledFilename.c_str() ) );
+        TS_ASSERT_EQUALS( compiledWorld.GetNumEntities(), 0u );
+        TS_ASSERT( compiledWorld.IsStale() );
+
+        // Without its source the compiled world is all there is
+        unlink( mSourceFilename );
+        TS_ASSERT( !compiledWorld.IsStale() );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testEditOfTheSameSizeMakesWorldStale()
+    {
+        std::vector<EntityDesc> entityDescs;
+        TS_ASSERT( CompiledWorld::WriteCompiledWorldFile(
+            mCompiledFilename.c_str(), mSourceFilename, entityDescs ) );
+
+        // Made straight away, so most likely in the same second as the compile
+        WriteSourceFile( "<w0rld></w0rld>" );
+
+        CompiledWorld compiledWorld;
+        TS_ASSERT( compiledWorld.Open( mCompiledFilename.c_str() ) );
+        TS_ASSERT( compiledWorld.IsStale() );
+
+        WriteSourceFile( "<world></world>" );
+        TS_ASSERT( !compiledWorld.IsStale() );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testUnterminatedNamesAreRejected()
+    {
+        std::vector<EntityDesc> entityDescs( 1 );
+        entityDescs[ 0 ].Reset();
+        entityDescs[ 0 ].mType = Entity::eT_Buoy;
+        memset( entityDescs[ 0 ].mName, 'a', sizeof( entityDescs[ 0 ].mName ) );
+        entityDescs[ 0 ].mbHasName = 1;
+        TS_ASSERT( CompiledWorld::WriteCompiledWorldFile(
+            mCompiledFilename.c_str(), mSourceFilename, entityDescs ) );
+
+        CompiledWorld compiledWorld;
+        TS_ASSERT( !compiledWorld.Open( mCompiledFilename.c_str() ) );
+        TS_ASSERT( !compiledWorld.IsOpen() );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testOtherFilesAreRejected()
+    {
+        CompiledWorld compiledWorld;
+        TS_ASSERT( !compiledWorld.Open( mSourceFilename ) );
+        TS_ASSERT( !compiledWorld.IsOpen() );
+        TS_ASSERT( !compiledWorld.Open( "/tmp/subsim_test_world_that_does_not_exist.ssw" ) );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testTruncatedFilesAreRejected()
+    {
+        std::vector<EntityDesc> entityDescs( 3 );
+        for ( U32 entityIdx = 0; entityIdx < entityDescs.size(); entityIdx++ )
+        {
+            entityDescs[ entityIdx ].Reset();
+        }
+        TS_ASSERT( CompiledWorld::WriteCompiledWorldFile(
+            mCompiledFilename.c_str(), mSourceFilename, entityDescs ) );
+
+        struct stat compiledStats;
+        TS_ASSERT_EQUALS( 0, stat( mCompiledFilename.c_str(), &compiledStats ) );
+        TS_ASSERT_EQUALS( 0, truncate( mCompiledFilename.c_str(), compiledStats.st_size - 1 ) );
+
+        CompiledWorld compiledWorld;
+        TS_ASSERT( !compiledWorld.Open( mCompiledFilename.c_str() ) );
+    }
+
+    //--------------------------------------------------------------------------
+    private: static void SetPos( EntityDesc* pDesc, F32 x, F32 y, F32 z )
+    {
+        pDesc->mVectors[ EntityDesc::eV_Pos ][ 0 ] = x;
+        pDesc->mVectors[ EntityDesc::eV_Pos ][ 1 ] = y;
+        pDesc->mVectors[ EntityDesc::eV_Pos ][ 2 ] = z;
+        pDesc->mVectorsFound |= ( 1 << EntityDesc::eV_Pos );
+        pDesc->mVectorComponentsFound[ EntityDesc::eV_Pos ] = EntityDesc::ALL_VECTOR_COMPONENTS;
+    }
+
+    //--------------------------------------------------------------------------
+    private: void WriteSourceFile( const char* contents )
+    {
+        FILE* pFile = fopen( mSourceFilename, "w" );
+        if ( NULL != pFile )
+        {
+            fputs( contents, pFile );
+            fclose( pFile );
+        }
+    }
+
+    private: char mSourceFilename[ 256 ];
+    private: std::string mCompiledFilename;
+};
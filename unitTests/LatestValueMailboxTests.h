@@ -0,0 +1,121 @@
+//------------------------------------------------------------------------------
+// File: LatestValueMailboxTests.h
+// Desc: Unit tests for the latest value mailbox
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include <cxxtest/TestSuite.h>
+#include <pthread.h>
+#include "Common/LatestValueMailbox.h"
+
+//------------------------------------------------------------------------------
+class LatestValueMailboxTests : public CxxTest::TestSuite
+{
+    //--------------------------------------------------------------------------
+    // A value made up of several parts so that torn reads can be spotted
+    private: struct TestValue
+    {
+        U32 mA;
+        U32 mB;
+        U32 mC;
+    };
+
+    private: static const U32 NUM_THREADED_POSTS = 200000;
+
+    //--------------------------------------------------------------------------
+    public: void testEmptyMailbox()
+    {
+        LatestValueMailbox<S32> mailbox;
+        S32 value = 7;
+        TS_ASSERT( !mailbox.TakeLatest( &value ) );
+        TS_ASSERT_EQUALS( value, 7 );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testValueIsOnlyTakenOnce()
+    {
+        LatestValueMailbox<S32> mailbox;
+        TS_ASSERT_EQUALS( mailbox.Post( 5 ), 1u );
+
+        S32 value = 0;
+        U32 sequenceNumber = 0;
+        TS_ASSERT( mailbox.TakeLatest( &value, &sequenceNumber ) );
+        TS_ASSERT_EQUALS( value, 5 );
+        TS_ASSERT_EQUALS( sequenceNumber, 1u );
+        TS_ASSERT( !mailbox.TakeLatest( &value ) );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testOldValuesAreDropped()
+    {
+        LatestValueMailbox<S32> mailbox;
+        for ( S32 i = 1; i <= 10; i++ )
+        {
+            mailbox.Post( i );
+        }
+
+        S32 value = 0;
+        U32 sequenceNumber = 0;
+        TS_ASSERT( mailbox.TakeLatest( &value, &sequenceNumber ) );
+        TS_ASSERT_EQUALS( value, 10 );
+        TS_ASSERT_EQUALS( sequenceNumber, 10u );
+        TS_ASSERT( !mailbox.TakeLatest( &value ) );
+
+        TS_ASSERT_EQUALS( mailbox.Post( 11 ), 11u );
+        TS_ASSERT( mailbox.TakeLatest( &value, &sequenceNumber ) );
+        TS_ASSERT_EQUALS( value, 11 );
+        TS_ASSERT_EQUALS( sequenceNumber, 11u );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testConcurrentPostsAreNeverTorn()
+    {
+        LatestValueMailbox<TestValue> mailbox;
+        pthread_t writerThread;
+        TS_ASSERT_EQUALS( 0, pthread_create( &writerThread, NULL, WriterThreadEntry, &mailbox ) );
+
+        U32 lastSequenceNumber = 0;
+        U32 numBadValues = 0;
+        U32 numOutOfOrder = 0;
+        while ( lastSequenceNumber < NUM_THREADED_POSTS )
+        {
+            TestValue value;
+            U32 sequenceNumber;
+            if ( mailbox.TakeLatest( &value, &sequenceNumber ) )
+            {
+                if ( value.mA != sequenceNumber
+                    || value.mB != 2*sequenceNumber
+                    || value.mC != 3*sequenceNumber )
+                {
+                    numBadValues++;
+                }
+                if ( sequenceNumber <= lastSequenceNumber )
+                {
+                    numOutOfOrder++;
+                }
+                lastSequenceNumber = sequenceNumber;
+            }
+        }
+
+        pthread_join( writerThread, NULL );
+        TS_ASSERT_EQUALS( numBadValues, 0u );
+        TS_ASSERT_EQUALS( numOutOfOrder, 0u );
+        TS_ASSERT_EQUALS( lastSequenceNumber, NUM_THREADED_POSTS );
+    }
+
+    //--------------------------------------------------------------------------
+    private: static void* WriterThreadEntry( void* pMailbox )
+    {
+        LatestValueMailbox<TestValue>* pTestMailbox = (LatestValueMailbox<TestValue>*)pMailbox;
+        for ( U32 i = 1; i <= NUM_THREADED_POSTS; i++ )
+        {
+            TestValue value;
+            value.mA = i;
+            value.mB = 2*i;
+            value.mC = 3*i;
+            pTestMailbox->Post( value );
+        }
+
+        return NULL;
+    }
+};
@@ -0,0 +1,136 @@
+//------------------------------------------------------------------------------
+// File: MeshCacheTests.h
+// Desc: Unit tests for the mesh cache and the batching of entity mesh nodes
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include <cxxtest/TestSuite.h>
+#include <irrlicht/irrlicht.h>
+#include "Entities/MeshCache.h"
+
+//------------------------------------------------------------------------------
+class MeshCacheTests : public CxxTest::TestSuite
+{
+    //--------------------------------------------------------------------------
+    public: void setUp()
+    {
+        mpDevice = irr::createDevice( irr::video::EDT_NULL );
+        mpSceneManager = ( NULL != mpDevice ? mpDevice->getSceneManager() : NULL );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void tearDown()
+    {
+        if ( NULL != mpDevice )
+        {
+            MeshCache::ReleaseSceneManager( mpSceneManager );
+            mpDevice->drop();
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testIdenticalMeshesAreShared()
+    {
+        TS_ASSERT( NULL != mpSceneManager );
+
+        irr::video::SColor red( 255, 255, 0, 0 );
+        irr::scene::IMesh* pFirstMesh = MeshCache::GetSphereMesh( mpSceneManager, 0.5f, red );
+        irr::scene::IMesh* pSecondMesh = MeshCache::GetSphereMesh( mpSceneManager, 0.5f, red );
+        TS_ASSERT( NULL != pFirstMesh );
+        TS_ASSERT_EQUALS( pFirstMesh, pSecondMesh );
+        TS_ASSERT_EQUALS( MeshCache::GetNumCachedMeshes( mpSceneManager ), 1U );
+
+        // A different colour needs a mesh of its own
+        irr::scene::IMesh* pGreenMesh = MeshCache::GetSphereMesh(
+            mpSceneManager, 0.5f, irr::video::SColor( 255, 0, 255, 0 ) );
+        TS_ASSERT( pFirstMesh != pGreenMesh );
+        TS_ASSERT_EQUALS( MeshCache::GetNumCachedMeshes( mpSceneManager ), 2U );
+
+        pFirstMesh->drop();
+        pSecondMesh->drop();
+        pGreenMesh->drop();
+
+        MeshCache::ReleaseSceneManager( mpSceneManager );
+        TS_ASSERT_EQUALS( MeshCache::GetNumCachedMeshes( mpSceneManager ), 0U );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testStaticNodesAreMerged()
+    {
+        TS_ASSERT( NULL != mpSceneManager );
+
+        irr::scene::IMesh* pMesh = MeshCache::GetCubeMesh( mpSceneManager,
+            irr::core::vector3df( 1.0f, 0.1f, 0.1f ), irr::video::SColor( 255, 255, 128, 0 ) );
+        TS_ASSERT( NULL != pMesh );
+
+        irr::scene::IMeshSceneNode* pLeftNode = mpSceneManager->addMeshSceneNode( pMesh );
+        irr::scene::IMeshSceneNode* pRightNode = mpSceneManager->addMeshSceneNode( pMesh );
+        pRightNode->setPosition( irr::core::vector3df( 5.0f, 0.0f, 0.0f ) );
+
+        TS_ASSERT( MeshCache::AddToBatch( mpSceneManager, Entity::eT_Gate,
+            BatchSceneNode::eM_Static, pLeftNode ) );
+        TS_ASSERT( MeshCache::AddToBatch( mpSceneManager, Entity::eT_Gate,
+            BatchSceneNode::eM_Static, pRightNode ) );
+
+        // A type can only be batched one way
+        TS_ASSERT( !MeshCache::AddToBatch( mpSceneManager, Entity::eT_Gate,
+            BatchSceneNode::eM_Dynamic, pRightNode ) );
+
+        BatchSceneNode* pBatch = MeshCache::GetBatch( mpSceneManager, Entity::eT_Gate );
+        TS_ASSERT( NULL != pBatch );
+        TS_ASSERT( NULL == MeshCache::GetBatch( mpSceneManager, Entity::eT_Buoy ) );
+        TS_ASSERT_EQUALS( pBatch->GetNumMembers(), 2U );
+        TS_ASSERT( !pLeftNode->isVisible() );
+
+        // Both cubes fit in a single merged buffer
+        pBatch->Refresh();
+        TS_ASSERT_EQUALS( pBatch->GetNumMergedBuffers(), 1U );
+        TS_ASSERT( pBatch->getBoundingBox().MaxEdge.X > 5.0f );
+
+        // Removed nodes are drawn by themselves again
+        MeshCache::RemoveFromBatch( mpSceneManager, pLeftNode );
+        TS_ASSERT_EQUALS( pBatch->GetNumMembers(), 1U );
+        TS_ASSERT( pLeftNode->isVisible() );
+
+        MeshCache::RemoveFromBatch( mpSceneManager, pRightNode );
+        pBatch->Refresh();
+        TS_ASSERT_EQUALS( pBatch->GetNumMergedBuffers(), 0U );
+
+        pMesh->drop();
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testDynamicNodesFollowTheirMembers()
+    {
+        TS_ASSERT( NULL != mpSceneManager );
+
+        irr::scene::IMesh* pMesh = MeshCache::GetSphereMesh(
+            mpSceneManager, 0.5f, irr::video::SColor( 255, 255, 0, 0 ) );
+        irr::scene::IMeshSceneNode* pFirstNode = mpSceneManager->addMeshSceneNode( pMesh );
+        irr::scene::IMeshSceneNode* pSecondNode = mpSceneManager->addMeshSceneNode( pMesh );
+        TS_ASSERT( MeshCache::AddToBatch( mpSceneManager, Entity::eT_Buoy,
+            BatchSceneNode::eM_Dynamic, pFirstNode ) );
+        TS_ASSERT( MeshCache::AddToBatch( mpSceneManager, Entity::eT_Buoy,
+            BatchSceneNode::eM_Dynamic, pSecondNode ) );
+
+        BatchSceneNode* pBatch = MeshCache::GetBatch( mpSceneManager, Entity::eT_Buoy );
+        TS_ASSERT( NULL != pBatch );
+        pBatch->Refresh();
+        TS_ASSERT_EQUALS( pBatch->GetNumMergedBuffers(), 1U );
+        TS_ASSERT( pBatch->getBoundingBox().MaxEdge.X < 1.0f );
+
+        // Moving a member rebuilds the merged buffer where it now is
+        pSecondNode->setPosition( irr::core::vector3df( 10.0f, 0.0f, 0.0f ) );
+        pBatch->Refresh();
+        TS_ASSERT_EQUALS( pBatch->GetNumMergedBuffers(), 1U );
+        TS_ASSERT( pBatch->getBoundingBox().MaxEdge.X > 10.0f );
+
+        MeshCache::RemoveFromBatch( mpSceneManager, pFirstNode );
+        MeshCache::RemoveFromBatch( mpSceneManager, pSecondNode );
+        pMesh->drop();
+    }
+
+    //--------------------------------------------------------------------------
+    private: irr::IrrlichtDevice* mpDevice;
+    private: irr::scene::ISceneManager* mpSceneManager;
+};
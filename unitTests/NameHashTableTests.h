@@ -0,0 +1,81 @@
+//------------------------------------------------------------------------------
+// File: NameHashTableTests.h
+// Desc: Unit tests for the name hash table
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include <cxxtest/TestSuite.h>
+#include <stdio.h>
+#include "Common/NameHashTable.h"
+
+//------------------------------------------------------------------------------
+class NameHashTableTests : public CxxTest::TestSuite
+{
+    //--------------------------------------------------------------------------
+    public: void testInsertAndFind()
+    {
+        NameHashTable table;
+        TS_ASSERT_EQUALS( table.Find( "Sub" ), -1 );
+
+        TS_ASSERT( table.Insert( "Sub", 0 ) );
+        TS_ASSERT( table.Insert( "Buoy", 1 ) );
+        TS_ASSERT( table.Insert( "Gate", 2 ) );
+
+        TS_ASSERT_EQUALS( table.GetNumEntries(), 3u );
+        TS_ASSERT_EQUALS( table.Find( "Sub" ), 0 );
+        TS_ASSERT_EQUALS( table.Find( "Buoy" ), 1 );
+        TS_ASSERT_EQUALS( table.Find( "Gate" ), 2 );
+        TS_ASSERT_EQUALS( table.Find( "Pool" ), -1 );
+        TS_ASSERT_EQUALS( table.Find( "" ), -1 );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testCaseInsensitive()
+    {
+        NameHashTable table;
+        table.Insert( "FloorTarget", 7 );
+
+        TS_ASSERT_EQUALS( table.Find( "floortarget" ), 7 );
+        TS_ASSERT_EQUALS( table.Find( "FLOORTARGET" ), 7 );
+        TS_ASSERT_EQUALS( NameHashTable::HashName( "FloorTarget" ),
+                          NameHashTable::HashName( "fLOORtARGET" ) );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testDuplicatesAndInvalidValues()
+    {
+        NameHashTable table;
+        TS_ASSERT( table.Insert( "Sub", 3 ) );
+        TS_ASSERT( !table.Insert( "SUB", 4 ) );
+        TS_ASSERT( !table.Insert( "Buoy", -1 ) );
+
+        TS_ASSERT_EQUALS( table.GetNumEntries(), 1u );
+        TS_ASSERT_EQUALS( table.Find( "sub" ), 3 );
+        TS_ASSERT_EQUALS( table.Find( "Buoy" ), -1 );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testGrowing()
+    {
+        const S32 NUM_NAMES = 1000;
+        char name[ 32 ];
+
+        NameHashTable table;
+        for ( S32 nameIdx = 0; nameIdx < NUM_NAMES; nameIdx++ )
+        {
+            snprintf( name, sizeof( name ), "Entity%i", nameIdx );
+            TS_ASSERT( table.Insert( name, nameIdx ) );
+        }
+
+        TS_ASSERT_EQUALS( table.GetNumEntries(), (U32)NUM_NAMES );
+        for ( S32 nameIdx = 0; nameIdx < NUM_NAMES; nameIdx++ )
+        {
+            snprintf( name, sizeof( name ), "entity%i", nameIdx );
+            TS_ASSERT_EQUALS( table.Find( name ), nameIdx );
+        }
+
+        table.Clear();
+        TS_ASSERT_EQUALS( table.GetNumEntries(), 0u );
+        TS_ASSERT_EQUALS( table.Find( "Entity0" ), -1 );
+    }
+};
@@ -0,0 +1,155 @@
+//------------------------------------------------------------------------------
+// File: PixelFormatConversionTests.h
+// Desc: Unit tests for the pixel format conversion routines
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include <cxxtest/TestSuite.h>
+#include <string.h>
+#include <vector>
+#include "Common/PixelFormatConversion.h"
+
+//------------------------------------------------------------------------------
+typedef void (*ImageConverter)( const U8* pSrc, S32 srcPitch, U32 width, U32 height,
+    U8* pDst, S32 dstPitch, PixelFormatConversion::eInstructionSet instructionSet );
+
+//------------------------------------------------------------------------------
+class PixelFormatConversionTests : public CxxTest::TestSuite
+{
+    //--------------------------------------------------------------------------
+    public: void testARGB8888ToRGB888()
+    {
+        const U32 SRC_PIXELS[] = { 0x80FF8040, 0x00000000, 0xFF123456 };
+        const U8 EXPECTED_PIXELS[] = { 0xFF, 0x80, 0x40, 0x00, 0x00, 0x00, 0x12, 0x34, 0x56 };
+        U8 dstPixels[ 9 ];
+
+        PixelFormatConversion::ARGB8888ToRGB888( (const U8*)SRC_PIXELS, 12, 3, 1, dstPixels, 9 );
+        TS_ASSERT_SAME_DATA( dstPixels, EXPECTED_PIXELS, 9 );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testARGB8888ToBGR888()
+    {
+        const U32 SRC_PIXELS[] = { 0x80FF8040, 0x00000000, 0xFF123456 };
+        const U8 EXPECTED_PIXELS[] = { 0x40, 0x80, 0xFF, 0x00, 0x00, 0x00, 0x56, 0x34, 0x12 };
+        U8 dstPixels[ 9 ];
+
+        PixelFormatConversion::ARGB8888ToBGR888( (const U8*)SRC_PIXELS, 12, 3, 1, dstPixels, 9 );
+        TS_ASSERT_SAME_DATA( dstPixels, EXPECTED_PIXELS, 9 );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testARGB8888ToGRAY8()
+    {
+        const U32 SRC_PIXELS[] = { 0x00FFFFFF, 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF };
+        const U8 EXPECTED_PIXELS[] = { 255, 0, 77, 149, 29 };
+        U8 dstPixels[ 5 ];
+
+        PixelFormatConversion::ARGB8888ToGRAY8( (const U8*)SRC_PIXELS, 20, 5, 1, dstPixels, 5 );
+        TS_ASSERT_SAME_DATA( dstPixels, EXPECTED_PIXELS, 5 );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testA1R5G5B5ToRGB888()
+    {
+        // Channel values of 31 should become 255, 16 should become 132
+        const U16 SRC_PIXELS[] = { 0xFFFF, 0x0000, 0x7C00, 0x4210 };
+        const U8 EXPECTED_PIXELS[] =
+        {
+            255, 255, 255,
+            0, 0, 0,
+            255, 0, 0,
+            132, 132, 132
+        };
+        U8 dstPixels[ 12 ];
+
+        PixelFormatConversion::A1R5G5B5ToRGB888( (const U8*)SRC_PIXELS, 8, 4, 1, dstPixels, 12 );
+        TS_ASSERT_SAME_DATA( dstPixels, EXPECTED_PIXELS, 12 );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testNegativePitch()
+    {
+        // Two rows stored bottom first should come out top first
+        const U32 SRC_PIXELS[] = { 0x00010203, 0x00040506 };
+        const U8 EXPECTED_PIXELS[] = { 0x04, 0x05, 0x06, 0x01, 0x02, 0x03 };
+        U8 dstPixels[ 6 ];
+
+        PixelFormatConversion::ARGB8888ToRGB888( (const U8*)&SRC_PIXELS[ 1 ], -4, 1, 2, dstPixels, 3 );
+        TS_ASSERT_SAME_DATA( dstPixels, EXPECTED_PIXELS, 6 );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testARGB8888ToRGB888VariantsMatch()
+    {
+        CheckVariantsMatch( PixelFormatConversion::ARGB8888ToRGB888, 4, 3 );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testARGB8888ToBGR888VariantsMatch()
+    {
+        CheckVariantsMatch( PixelFormatConversion::ARGB8888ToBGR888, 4, 3 );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testARGB8888ToGRAY8VariantsMatch()
+    {
+        CheckVariantsMatch( PixelFormatConversion::ARGB8888ToGRAY8, 4, 1 );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testA1R5G5B5ToRGB888VariantsMatch()
+    {
+        CheckVariantsMatch( PixelFormatConversion::A1R5G5B5ToRGB888, 2, 3 );
+    }
+
+    //--------------------------------------------------------------------------
+    // Converts images of a range of widths with every supported instruction
+    // set and checks that the results are identical to the scalar version.
+    // The widths cover the blocks used by the SIMD versions along with the
+    // leftover pixels at the end of each row. Padding is left at the end of
+    // each destination row to check that nothing is written past the row
+    private: void CheckVariantsMatch( ImageConverter converter,
+                                      U32 srcBytesPerPixel, U32 dstBytesPerPixel )
+    {
+        const U32 HEIGHT = 3;
+        const U32 PADDING = 16;
+        const U8 PADDING_VALUE = 0xCD;
+
+        U32 randomState = 12345;
+        for ( U32 width = 1; width <= 100; width++ )
+        {
+            U32 srcPitch = width*srcBytesPerPixel + PADDING;
+            U32 dstPitch = width*dstBytesPerPixel + PADDING;
+
+            std::vector<U8> srcImage( srcPitch*HEIGHT );
+            for ( U32 byteIdx = 0; byteIdx < srcImage.size(); byteIdx++ )
+            {
+                randomState = randomState*1103515245 + 12345;
+                srcImage[ byteIdx ] = (U8)( randomState >> 16 );
+            }
+
+            std::vector<U8> expectedImage( dstPitch*HEIGHT, PADDING_VALUE );
+            converter( &srcImage[ 0 ], srcPitch, width, HEIGHT,
+                       &expectedImage[ 0 ], dstPitch, PixelFormatConversion::eIS_Scalar );
+
+            for ( S32 instructionSet = PixelFormatConversion::eIS_Scalar + 1;
+                instructionSet < PixelFormatConversion::eIS_NumInstructionSets; instructionSet++ )
+            {
+                if ( !PixelFormatConversion::IsInstructionSetSupported(
+                    (PixelFormatConversion::eInstructionSet)instructionSet ) )
+                {
+                    continue;
+                }
+
+                std::vector<U8> dstImage( dstPitch*HEIGHT, PADDING_VALUE );
+                converter( &srcImage[ 0 ], srcPitch, width, HEIGHT, &dstImage[ 0 ], dstPitch,
+                           (PixelFormatConversion::eInstructionSet)instructionSet );
+
+                TSM_ASSERT_SAME_DATA( PixelFormatConversion::GetInstructionSetName(
+                    (PixelFormatConversion::eInstructionSet)instructionSet ),
+                    &dstImage[ 0 ], &expectedImage[ 0 ], dstImage.size() );
+            }
+        }
+    }
+};
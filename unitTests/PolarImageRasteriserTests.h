@@ -0,0 +1,141 @@
+//------------------------------------------------------------------------------
+// File: PolarImageRasteriserTests.h
+// Desc: Unit tests for the polar image rasteriser
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include <cxxtest/TestSuite.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "Common/PolarImageRasteriser.h"
+
+//------------------------------------------------------------------------------
+class PolarImageRasteriserTests : public CxxTest::TestSuite
+{
+    //--------------------------------------------------------------------------
+    public: void testGeometry()
+    {
+        PolarImageRasteriser rasteriser;
+        TS_ASSERT( rasteriser.SetGeometry( 10, 200, 0.0f, DegToRad( 1.8f ) ) );
+        TS_ASSERT( !rasteriser.SetGeometry( 10, 200, 0.0f, DegToRad( 1.8f ) ) );
+        TS_ASSERT_EQUALS( rasteriser.GetImageWidth(), 20u );
+        TS_ASSERT_EQUALS( rasteriser.GetImageHeight(), 20u );
+
+        // Changing any part of the geometry rebuilds the tables
+        TS_ASSERT( rasteriser.SetGeometry( 10, 200, 0.5f, DegToRad( 1.8f ) ) );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testBeamDirections()
+    {
+        // Four beams pointing forwards, left, backwards and right, with the
+        // bins of each beam set to a different value
+        const U32 NUM_BINS = 8;
+        PolarImageRasteriser rasteriser;
+        rasteriser.SetGeometry( NUM_BINS, 4, 0.0f, DegToRad( 90.0f ) );
+
+        std::vector<U8> bins( 4*NUM_BINS + PolarImageRasteriser::BIN_PADDING, 0 );
+        for ( U32 beamIdx = 0; beamIdx < 4; beamIdx++ )
+        {
+            memset( &bins[ beamIdx*NUM_BINS ], 10*( beamIdx + 1 ), NUM_BINS );
+        }
+        bins[ NUM_BINS - 1 ] = 99;   // Far end of the forward beam
+
+        std::vector<U8> image( rasteriser.GetImageSize() );
+        rasteriser.Rasterise( &bins[ 0 ], &image[ 0 ] );
+
+        U32 imageDim = rasteriser.GetImageWidth();
+        TS_ASSERT_EQUALS( image[ 2*imageDim + NUM_BINS ], 10 );              // Forward
+        TS_ASSERT_EQUALS( image[ 0*imageDim + NUM_BINS ], 99 );              // Top edge
+        TS_ASSERT_EQUALS( image[ NUM_BINS*imageDim + 1 ], 20 );              // Left
+        TS_ASSERT_EQUALS( image[ ( imageDim - 2 )*imageDim + NUM_BINS ], 30 ); // Backwards
+        TS_ASSERT_EQUALS( image[ NUM_BINS*imageDim + imageDim - 2 ], 40 );   // Right
+        TS_ASSERT_EQUALS( image[ 0 ], 0 );                                   // Corner
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testSectorOutsideBeamsIsBlank()
+    {
+        const U32 NUM_BINS = 16;
+        PolarImageRasteriser rasteriser;
+        rasteriser.SetGeometry( NUM_BINS, 11, DegToRad( -9.0f ), DegToRad( 1.8f ) );
+
+        std::vector<U8> bins( 11*NUM_BINS + PolarImageRasteriser::BIN_PADDING, 200 );
+        std::vector<U8> image( rasteriser.GetImageSize(), 1 );
+        rasteriser.Rasterise( &bins[ 0 ], &image[ 0 ] );
+
+        U32 imageDim = rasteriser.GetImageWidth();
+        TS_ASSERT_EQUALS( image[ 1*imageDim + NUM_BINS ], 200 );
+        TS_ASSERT_EQUALS( image[ ( imageDim - 2 )*imageDim + NUM_BINS ], 0 );
+        TS_ASSERT_EQUALS( image[ NUM_BINS*imageDim + 1 ], 0 );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testInstructionSetsMatch()
+    {
+        // Odd sizes so that the vector loops have some pixels left over
+        const U32 NUM_BINS = 37;
+        const U32 NUM_BEAMS = 201;
+        PolarImageRasteriser rasteriser;
+        rasteriser.SetGeometry( NUM_BINS, NUM_BEAMS, 0.3f, DegToRad( 1.8f ) );
+
+        std::vector<U8> bins( NUM_BEAMS*NUM_BINS + PolarImageRasteriser::BIN_PADDING, 0 );
+        for ( U32 binIdx = 0; binIdx < NUM_BEAMS*NUM_BINS; binIdx++ )
+        {
+            bins[ binIdx ] = (U8)( binIdx*7 + 3 );
+        }
+
+        std::vector<U8> scalarImage( rasteriser.GetImageSize(), 1 );
+        rasteriser.Rasterise( &bins[ 0 ], &scalarImage[ 0 ], PixelFormatConversion::eIS_Scalar );
+
+        for ( S32 instructionSet = PixelFormatConversion::eIS_SSE2;
+            instructionSet < PixelFormatConversion::eIS_NumInstructionSets; instructionSet++ )
+        {
+            std::vector<U8> image( rasteriser.GetImageSize(), 1 );
+            rasteriser.Rasterise( &bins[ 0 ], &image[ 0 ],
+                (PixelFormatConversion::eInstructionSet)instructionSet );
+            TS_ASSERT( image == scalarImage );
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testBeamUpdatesMatchFullImage()
+    {
+        const U32 NUM_BINS = 25;
+        const U32 NUM_BEAMS = 200;
+        PolarImageRasteriser rasteriser;
+        rasteriser.SetGeometry( NUM_BINS, NUM_BEAMS, 0.0f, DegToRad( 1.8f ) );
+
+        std::vector<U8> bins( NUM_BEAMS*NUM_BINS + PolarImageRasteriser::BIN_PADDING, 0 );
+        for ( U32 binIdx = 0; binIdx < NUM_BEAMS*NUM_BINS; binIdx++ )
+        {
+            bins[ binIdx ] = (U8)( 1 + binIdx%250 );
+        }
+
+        std::vector<U8> fullImage( rasteriser.GetImageSize() );
+        rasteriser.Rasterise( &bins[ 0 ], &fullImage[ 0 ] );
+
+        // Draw the beams a few at a time as a scanning sonar would
+        std::vector<U8> image( rasteriser.GetImageSize(), 0 );
+        for ( U32 beamIdx = 0; beamIdx < NUM_BEAMS; beamIdx += 3 )
+        {
+            rasteriser.RasteriseBeams( &bins[ 0 ], beamIdx, beamIdx + 3, &image[ 0 ] );
+        }
+        TS_ASSERT( image == fullImage );
+
+        // Only the given beams should be touched
+        std::vector<U8> sectorImage( rasteriser.GetImageSize(), 0 );
+        rasteriser.RasteriseBeams( &bins[ 0 ], 0, 5, &sectorImage[ 0 ] );
+        U32 imageDim = rasteriser.GetImageWidth();
+        TS_ASSERT_EQUALS( sectorImage[ 1*imageDim + NUM_BINS - 1 ], fullImage[ 1*imageDim + NUM_BINS - 1 ] );
+        TS_ASSERT_DIFFERS( sectorImage[ 1*imageDim + NUM_BINS - 1 ], 0 );
+        TS_ASSERT_EQUALS( sectorImage[ NUM_BINS*imageDim + 1 ], 0 );
+    }
+
+    //--------------------------------------------------------------------------
+    private: static F32 DegToRad( F32 degrees )
+    {
+        return degrees*(F32)M_PI/180.0f;
+    }
+};
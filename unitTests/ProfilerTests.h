@@ -0,0 +1,160 @@
+//------------------------------------------------------------------------------
+// File: ProfilerTests.h
+// Desc: Unit tests for the scoped timer profiler
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include <cxxtest/TestSuite.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string>
+#include "Common/Profiler.h"
+
+//------------------------------------------------------------------------------
+class ProfilerTests : public CxxTest::TestSuite
+{
+    //--------------------------------------------------------------------------
+    public: void setUp()
+    {
+        snprintf( mTraceFilename, sizeof( mTraceFilename ), "/tmp/subsim_test_profile_%i.json", (S32)getpid() );
+        snprintf( mFoldedFilename, sizeof( mFoldedFilename ), "/tmp/subsim_test_profile_%i.folded", (S32)getpid() );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void tearDown()
+    {
+        unlink( mTraceFilename );
+        unlink( mFoldedFilename );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testNothingIsRecordedWhenStopped()
+    {
+        TS_ASSERT( !Profiler::IsEnabled() );
+        {
+            PROFILE_SCOPE( "NotRecorded" );
+        }
+        TS_ASSERT( !Profiler::Stop() );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testChromeTrace()
+    {
+        TS_ASSERT( Profiler::Start( mTraceFilename ) );
+        TS_ASSERT( !Profiler::Start( mTraceFilename ) );
+        Profiler::SetThreadName( "Tester" );
+        {
+            PROFILE_SCOPE( "Outer" );
+            PROFILE_SCOPE( "Inner" );
+        }
+        TS_ASSERT( Profiler::Stop() );
+        TS_ASSERT( !Profiler::IsEnabled() );
+
+        std::string trace = ReadFile( mTraceFilename );
+        TS_ASSERT_EQUALS( trace.find( "{\"traceEvents\":[" ), 0u );
+        TS_ASSERT_DIFFERS( trace.find( "\"args\":{\"name\":\"Tester\"}" ), std::string::npos );
+        TS_ASSERT_DIFFERS( trace.find( "{\"name\":\"Outer\",\"ph\":\"X\"" ), std::string::npos );
+        TS_ASSERT_DIFFERS( trace.find( "{\"name\":\"Inner\",\"ph\":\"X\"" ), std::string::npos );
+        TS_ASSERT_EQUALS( CountOccurrences( trace, "\"ph\":\"X\"" ), 2u );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testFoldedStacks()
+    {
+        TS_ASSERT( Profiler::Start( mFoldedFilename ) );
+        Profiler::SetThreadName( "Tester" );
+        {
+            PROFILE_SCOPE( "Outer" );
+            usleep( 2000 );
+            {
+                PROFILE_SCOPE( "Inner" );
+                usleep( 2000 );
+            }
+        }
+        TS_ASSERT( Profiler::Stop() );
+
+        std::string folded = ReadFile( mFoldedFilename );
+        TS_ASSERT_DIFFERS( folded.find( "Tester;Outer " ), std::string::npos );
+        TS_ASSERT_DIFFERS( folded.find( "Tester;Outer;Inner " ), std::string::npos );
+        TS_ASSERT_EQUALS( folded.find( "Tester;Inner" ), std::string::npos );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testOnlyTheNewestEventsAreKept()
+    {
+        TS_ASSERT( Profiler::Start( mTraceFilename, 4 ) );
+        for ( S32 i = 0; i < 10; i++ )
+        {
+            PROFILE_SCOPE( "Repeated" );
+        }
+        TS_ASSERT( Profiler::Stop() );
+
+        // The oldest slot of a full buffer is left out
+        std::string trace = ReadFile( mTraceFilename );
+        TS_ASSERT_EQUALS( CountOccurrences( trace, "\"name\":\"Repeated\"" ), 3u );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testThreadsAreKeptApart()
+    {
+        TS_ASSERT( Profiler::Start( mTraceFilename ) );
+        {
+            PROFILE_SCOPE( "MainThread" );
+        }
+
+        pthread_t workerThread;
+        TS_ASSERT_EQUALS( 0, pthread_create( &workerThread, NULL, WorkerThreadEntry, NULL ) );
+        pthread_join( workerThread, NULL );
+        TS_ASSERT( Profiler::Stop() );
+
+        std::string trace = ReadFile( mTraceFilename );
+        TS_ASSERT_DIFFERS( trace.find( "\"args\":{\"name\":\"Worker\"}" ), std::string::npos );
+        TS_ASSERT_DIFFERS( trace.find( "\"name\":\"MainThread\"" ), std::string::npos );
+        TS_ASSERT_DIFFERS( trace.find( "\"name\":\"WorkerThread\"" ), std::string::npos );
+    }
+
+    //--------------------------------------------------------------------------
+    private: static void* WorkerThreadEntry( void* )
+    {
+        Profiler::SetThreadName( "Worker" );
+        PROFILE_SCOPE( "WorkerThread" );
+        return NULL;
+    }
+
+    //--------------------------------------------------------------------------
+    private: static std::string ReadFile( const char* filename )
+    {
+        std::string contents;
+        FILE* pFile = fopen( filename, "r" );
+        if ( NULL != pFile )
+        {
+            char buffer[ 1024 ];
+            size_t numBytesRead;
+            while ( ( numBytesRead = fread( buffer, 1, sizeof( buffer ), pFile ) ) > 0 )
+            {
+                contents.append( buffer, numBytesRead );
+            }
+            fclose( pFile );
+        }
+
+        return contents;
+    }
+
+    //--------------------------------------------------------------------------
+    private: static U32 CountOccurrences( const std::string& text, const char* pattern )
+    {
+        U32 count = 0;
+        size_t pos = text.find( pattern );
+        while ( std::string::npos != pos )
+        {
+            count++;
+            pos = text.find( pattern, pos + 1 );
+        }
+
+        return count;
+    }
+
+    private: char mTraceFilename[ 256 ];
+    private: char mFoldedFilename[ 256 ];
+};
@@ -0,0 +1,106 @@
+//------------------------------------------------------------------------------
+// File: SharedMemoryImageRingTests.h
+// Desc: Unit tests for the shared memory image ring
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include <cxxtest/TestSuite.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "Common/SharedMemoryImageRing.h"
+
+//------------------------------------------------------------------------------
+class SharedMemoryImageRingTests : public CxxTest::TestSuite
+{
+    //--------------------------------------------------------------------------
+    public: void setUp()
+    {
+        snprintf( mRingName, sizeof( mRingName ), "/subsim_test_ring_%i", (S32)getpid() );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testWriteAndRead()
+    {
+        SharedMemoryImageRing writer;
+        TS_ASSERT( writer.Create( mRingName, 2, 16 ) );
+
+        SharedMemoryImageRing reader;
+        TS_ASSERT( reader.Open( mRingName ) );
+        TS_ASSERT_EQUALS( reader.GetNumSlots(), 2u );
+        TS_ASSERT_EQUALS( reader.GetSlotDataSize(), 16u );
+
+        SharedMemoryImageDescriptor descriptor;
+        WriteFrame( &writer, 7, 0.5, &descriptor );
+
+        TS_ASSERT_EQUALS( descriptor.mFrameIdx, 0u );
+        TS_ASSERT_EQUALS( descriptor.mWidth, 4u );
+        TS_ASSERT_EQUALS( descriptor.mHeight, 4u );
+        TS_ASSERT_EQUALS( descriptor.mDataSize, 16u );
+        TS_ASSERT_EQUALS( descriptor.mTimestamp, 0.5 );
+        TS_ASSERT_EQUALS( strcmp( descriptor.mRingName, mRingName ), 0 );
+
+        const U8* pImageData = reader.GetImageData( descriptor );
+        TS_ASSERT( NULL != pImageData );
+        if ( NULL != pImageData )
+        {
+            TS_ASSERT_EQUALS( pImageData[ 0 ], 7 );
+            TS_ASSERT_EQUALS( pImageData[ 15 ], 7 );
+        }
+
+        U8 buffer[ 16 ];
+        TS_ASSERT( reader.CopyImage( descriptor, buffer, sizeof( buffer ) ) );
+        TS_ASSERT_EQUALS( buffer[ 3 ], 7 );
+        TS_ASSERT( !reader.CopyImage( descriptor, buffer, 8 ) );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testOverwrittenSlotsAreInvalid()
+    {
+        SharedMemoryImageRing writer;
+        TS_ASSERT( writer.Create( mRingName, 2, 16 ) );
+
+        SharedMemoryImageRing reader;
+        TS_ASSERT( reader.Open( mRingName ) );
+
+        SharedMemoryImageDescriptor descriptors[ 3 ];
+        WriteFrame( &writer, 1, 1.0, &descriptors[ 0 ] );
+        WriteFrame( &writer, 2, 2.0, &descriptors[ 1 ] );
+        TS_ASSERT( reader.IsDescriptorValid( descriptors[ 0 ] ) );
+
+        // The third frame reuses the first slot
+        WriteFrame( &writer, 3, 3.0, &descriptors[ 2 ] );
+        TS_ASSERT_EQUALS( descriptors[ 2 ].mSlotIdx, descriptors[ 0 ].mSlotIdx );
+        TS_ASSERT( !reader.IsDescriptorValid( descriptors[ 0 ] ) );
+        TS_ASSERT( NULL == reader.GetImageData( descriptors[ 0 ] ) );
+        TS_ASSERT( reader.IsDescriptorValid( descriptors[ 1 ] ) );
+        TS_ASSERT( reader.IsDescriptorValid( descriptors[ 2 ] ) );
+
+        const U8* pImageData = reader.GetImageData( descriptors[ 2 ] );
+        TS_ASSERT( NULL != pImageData && 3 == pImageData[ 0 ] );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testRingIsRemovedOnClose()
+    {
+        SharedMemoryImageRing writer;
+        TS_ASSERT( writer.Create( mRingName, 2, 16 ) );
+        writer.Close();
+
+        SharedMemoryImageRing reader;
+        TS_ASSERT( !reader.Open( mRingName ) );
+    }
+
+    //--------------------------------------------------------------------------
+    private: void WriteFrame( SharedMemoryImageRing* pRing, U8 value, double timestamp,
+                              SharedMemoryImageDescriptor* pDescriptorOut )
+    {
+        U8* pImageData = pRing->BeginWrite();
+        TS_ASSERT( NULL != pImageData );
+        memset( pImageData, value, 16 );
+        pRing->EndWrite( 4, 4, 0, 16, timestamp, pDescriptorOut );
+    }
+
+    //--------------------------------------------------------------------------
+    private: char mRingName[ 64 ];
+};
@@ -0,0 +1,150 @@
+//------------------------------------------------------------------------------
+// File: SimulationRecorderTests.h
+// Desc: Unit tests for the simulation recorder and the random number 
+//       generator used to make runs repeatable
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include <cxxtest/TestSuite.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "Common/SimulationRecorder.h"
+#include "Common/Random.h"
+
+//------------------------------------------------------------------------------
+class SimulationRecorderTests : public CxxTest::TestSuite
+{
+    //--------------------------------------------------------------------------
+    public: void setUp()
+    {
+        snprintf( mFilename, sizeof( mFilename ), "/tmp/subsim_test_recording_%i", (S32)getpid() );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void tearDown()
+    {
+        unlink( mFilename );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testRecordAndLoad()
+    {
+        F32 command[ 4 ] = { 0.5f, -0.25f, 0.0f, 1.0f };
+        {
+            SimulationRecorder recorder;
+            TS_ASSERT( recorder.StartRecording( mFilename, 1234, 42 ) );
+            TS_ASSERT( recorder.RecordMessage( 0, 2, 1, 30, 0, command, sizeof( command ) ) );
+            TS_ASSERT( recorder.RecordMessage( 17, 2, 2, 31, 1, NULL, 0 ) );
+        }
+
+        SimulationRecorder replayer;
+        TS_ASSERT( replayer.LoadRecording( mFilename ) );
+        TS_ASSERT_EQUALS( replayer.GetWorldHash(), 1234u );
+        TS_ASSERT_EQUALS( replayer.GetRandomSeed(), 42u );
+        TS_ASSERT_EQUALS( replayer.GetNumMessages(), 2u );
+
+        const RecordedMessage& firstMessage = replayer.GetMessage( 0 );
+        TS_ASSERT_EQUALS( firstMessage.mFrameIdx, 0u );
+        TS_ASSERT_EQUALS( firstMessage.mType, 2 );
+        TS_ASSERT_EQUALS( firstMessage.mSubtype, 1 );
+        TS_ASSERT_EQUALS( firstMessage.mInterface, 30 );
+        TS_ASSERT_EQUALS( firstMessage.mData.size(), sizeof( command ) );
+        TS_ASSERT_SAME_DATA( &firstMessage.mData[ 0 ], command, sizeof( command ) );
+
+        const RecordedMessage& secondMessage = replayer.GetMessage( 1 );
+        TS_ASSERT_EQUALS( secondMessage.mFrameIdx, 17u );
+        TS_ASSERT_EQUALS( secondMessage.mIndex, 1 );
+        TS_ASSERT( secondMessage.mData.empty() );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testTruncatedRecording()
+    {
+        U8 data[ 64 ] = { 0 };
+        {
+            SimulationRecorder recorder;
+            TS_ASSERT( recorder.StartRecording( mFilename, 1, 1 ) );
+            recorder.RecordMessage( 3, 2, 1, 30, 0, data, sizeof( data ) );
+            recorder.RecordMessage( 4, 2, 1, 30, 0, data, sizeof( data ) );
+        }
+
+        // Chop the end off the last message as a crash would
+        FILE* pFile = fopen( mFilename, "rb+" );
+        TS_ASSERT( NULL != pFile );
+        fseek( pFile, 0, SEEK_END );
+        long fileSize = ftell( pFile );
+        fclose( pFile );
+        TS_ASSERT_EQUALS( 0, truncate( mFilename, fileSize - 10 ) );
+
+        SimulationRecorder replayer;
+        TS_ASSERT( replayer.LoadRecording( mFilename ) );
+        TS_ASSERT_EQUALS( replayer.GetNumMessages(), 1u );
+        TS_ASSERT_EQUALS( replayer.GetMessage( 0 ).mFrameIdx, 3u );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testNotARecording()
+    {
+        FILE* pFile = fopen( mFilename, "wb" );
+        fputs( "Not a recording at all", pFile );
+        fclose( pFile );
+
+        SimulationRecorder replayer;
+        TS_ASSERT( !replayer.LoadRecording( mFilename ) );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testHashData()
+    {
+        U8 data[ 3 ] = { 1, 2, 3 };
+        TS_ASSERT_EQUALS( SimulationRecorder::HashData( data, 3 ),
+                          SimulationRecorder::HashData( data, 3 ) );
+        U32 hash = SimulationRecorder::HashData( data, 3 );
+        data[ 1 ] = 4;
+        TS_ASSERT_DIFFERS( SimulationRecorder::HashData( data, 3 ), hash );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testRandomIsRepeatable()
+    {
+        Random random1( 99 );
+        Random random2( 99 );
+        Random random3( 100 );
+
+        U32 numDifferent = 0;
+        for ( U32 i = 0; i < 1000; i++ )
+        {
+            U32 value = random1.NextU32();
+            TS_ASSERT_EQUALS( value, random2.NextU32() );
+            if ( value != random3.NextU32() )
+            {
+                numDifferent++;
+            }
+        }
+        TS_ASSERT( numDifferent > 990 );
+
+        // Reseeding starts the sequence again
+        Random random4( 0 );
+        U32 firstValue = random4.NextU32();
+        random4.SetSeed( 0 );
+        TS_ASSERT_EQUALS( random4.NextU32(), firstValue );
+        TS_ASSERT_DIFFERS( firstValue, 0u );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testRandomF32Range()
+    {
+        Random random( 7 );
+        F32 total = 0.0f;
+        for ( U32 i = 0; i < 10000; i++ )
+        {
+            F32 value = random.NextF32();
+            TS_ASSERT( value >= 0.0f && value < 1.0f );
+            total += value;
+        }
+        TS_ASSERT_DELTA( total/10000.0f, 0.5f, 0.02f );
+    }
+
+    //--------------------------------------------------------------------------
+    private: char mFilename[ 64 ];
+};
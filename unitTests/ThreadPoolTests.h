@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+// File: ThreadPoolTests.h
+// Desc: Unit tests for the thread pool
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#include <cxxtest/TestSuite.h>
+#include <vector>
+#include "Common/ThreadPool.h"
+
+//------------------------------------------------------------------------------
+class ThreadPoolTests : public CxxTest::TestSuite
+{
+    //--------------------------------------------------------------------------
+    public: void testEveryItemIsProcessedOnce()
+    {
+        ThreadPool threadPool;
+        TS_ASSERT( threadPool.Init( 3 ) );
+        TS_ASSERT_EQUALS( threadPool.GetNumWorkerThreads(), 3u );
+
+        // Run lots of loops to give any races a chance to show up
+        for ( U32 loopIdx = 0; loopIdx < 200; loopIdx++ )
+        {
+            U32 numItems = 1 + loopIdx*7;
+            std::vector<U32> counts( numItems, 0 );
+            threadPool.ParallelFor( numItems, CountItems, &counts[ 0 ], 1 + loopIdx%5 );
+
+            U32 numBadCounts = 0;
+            for ( U32 itemIdx = 0; itemIdx < numItems; itemIdx++ )
+            {
+                if ( 1 != counts[ itemIdx ] )
+                {
+                    numBadCounts++;
+                }
+            }
+            TS_ASSERT_EQUALS( numBadCounts, 0u );
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testNoWorkerThreads()
+    {
+        ThreadPool threadPool;
+        TS_ASSERT( threadPool.Init( 0 ) );
+        TS_ASSERT_EQUALS( threadPool.GetNumWorkerThreads(), 0u );
+
+        std::vector<U32> counts( 10, 0 );
+        threadPool.ParallelFor( 10, CountItems, &counts[ 0 ], 3 );
+        TS_ASSERT_EQUALS( counts[ 0 ], 1u );
+        TS_ASSERT_EQUALS( counts[ 9 ], 1u );
+    }
+
+    //--------------------------------------------------------------------------
+    public: void testEmptyLoop()
+    {
+        ThreadPool threadPool;
+        TS_ASSERT( threadPool.Init( 2 ) );
+        threadPool.ParallelFor( 0, CountItems, NULL );
+        threadPool.DeInit();
+        TS_ASSERT( !threadPool.IsInitialised() );
+    }
+
+    //--------------------------------------------------------------------------
+    private: static void CountItems( void* pUserData, U32 startIdx, U32 endIdx )
+    {
+        U32* pCounts = (U32*)pUserData;
+        for ( U32 itemIdx = startIdx; itemIdx < endIdx; itemIdx++ )
+        {
+            __sync_fetch_and_add( &pCounts[ itemIdx ], 1 );
+        }
+    }
+};